@@ -0,0 +1,76 @@
+/** \file    NyaaAttribContext.h
+ *  \brief   Interface through which the Nyaa interpreter looks up attribute values.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef NYAA_ATTRIB_CONTEXT_H
+#define NYAA_ATTRIB_CONTEXT_H
+
+
+#include <string>
+#include <cinttypes>
+
+
+namespace Nyaa {
+
+
+/** \class AttribContext
+ *  \brief Provides the attribute values, e.g. the cells of a table row, that an equation is evaluated against.
+ *
+ *  Only the getter that corresponds to the type an attribute was declared with at compile time will be called for it.
+ */
+class AttribContext {
+public:
+    virtual ~AttribContext() { }
+
+    /** \return true if the attribute has a value, which will then have been stored in "*value", else false. */
+    virtual bool getFloatAttrib(const std::string &attrib_name, double * const value) const = 0;
+    virtual bool getIntAttrib(const std::string &attrib_name, int64_t * const value) const = 0;
+    virtual bool getBooleanAttrib(const std::string &attrib_name, bool * const value) const = 0;
+
+    /** \return a pointer to the value of the attribute or nullptr if it has no value.
+     *  \note   The pointed-to string has to remain unchanged until the evaluation has completed.
+     */
+    virtual const std::string *getStringAttrib(const std::string &attrib_name) const = 0;
+};
+
+
+/** \class IndexedAttribContext
+ *  \brief Like AttribContext but attributes are identified by their slot in a Schema, see Binding.
+ */
+class IndexedAttribContext {
+public:
+    virtual ~IndexedAttribContext() { }
+
+    /** \return true if the attribute has a value, which will then have been stored in "*value", else false. */
+    virtual bool getFloatAttrib(const uint32_t slot, double * const value) const = 0;
+    virtual bool getIntAttrib(const uint32_t slot, int64_t * const value) const = 0;
+    virtual bool getBooleanAttrib(const uint32_t slot, bool * const value) const = 0;
+
+    /** \return a pointer to the value of the attribute or nullptr if it has no value.
+     *  \note   The pointed-to string has to remain unchanged until the evaluation has completed.
+     */
+    virtual const std::string *getStringAttrib(const uint32_t slot) const = 0;
+};
+
+
+} // namespace Nyaa
+
+
+#endif // ifndef NYAA_ATTRIB_CONTEXT_H
@@ -0,0 +1,78 @@
+/** \file    NyaaBatchCompiler.h
+ *  \brief   Declaration of the BatchCompiler class, which compiles many equations in parallel.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef NYAA_BATCH_COMPILER_H
+#define NYAA_BATCH_COMPILER_H
+
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "NyaaFunctionRegistry.h"
+#include "NyaaParser.h"
+#include "NyaaProgram.h"
+
+
+namespace Nyaa {
+
+
+/** \class BatchCompiler
+ *  \brief Compiles any number of independent equations on a pool of threads, each thread using its own Compiler.
+ *
+ *  Equations are handed out to the threads in small chunks, so that a few expensive equations can't hold up the
+ *  others.  All functions in the FunctionRegistry must tolerate concurrent calls, as pure functions may be called
+ *  by the ConstantFolder.
+ */
+class BatchCompiler {
+public:
+    struct Result {
+        std::shared_ptr<const Program> program_; // nullptr if the equation was invalid.
+        std::string error_msg_;                  // Only set if the equation was invalid.
+    };
+private:
+    const FunctionRegistry &function_registry_;
+    unsigned thread_count_;
+public:
+    /** \param function_registry  Must not be modified while compileAll() is running.
+     *  \param thread_count       The maximum number of threads to use, 0 means one per hardware thread.
+     */
+    explicit BatchCompiler(const FunctionRegistry &function_registry, const unsigned thread_count = 0);
+
+    inline unsigned getThreadCount() const { return thread_count_; }
+
+    /** \brief Compiles "equation_count" equations starting at "equations".
+     *  \return the results indexed like the equations.
+     *  \note   Errors in individual equations are reported through their results, exceptions thrown by a thread,
+     *          e.g. std::bad_alloc, are rethrown after all threads have finished.
+     */
+    std::vector<Result> compileAll(const std::string * const equations, const size_t equation_count,
+                                   const Parser::AttribNameToTypeMap &attrib_name_to_type_map) const;
+
+    inline std::vector<Result> compileAll(const std::vector<std::string> &equations,
+                                          const Parser::AttribNameToTypeMap &attrib_name_to_type_map) const
+        { return compileAll(equations.data(), equations.size(), attrib_name_to_type_map); }
+};
+
+
+} // namespace Nyaa
+
+
+#endif // ifndef NYAA_BATCH_COMPILER_H
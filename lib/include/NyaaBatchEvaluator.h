@@ -0,0 +1,178 @@
+/** \file    NyaaBatchEvaluator.h
+ *  \brief   Declaration of the BatchEvaluator class, which evaluates a compiled Nyaa program over many rows at once.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef NYAA_BATCH_EVALUATOR_H
+#define NYAA_BATCH_EVALUATOR_H
+
+
+#include <string>
+#include <vector>
+#include <cinttypes>
+#include "NyaaColumn.h"
+#include "NyaaProgram.h"
+#include "NyaaSchema.h"
+#include "NyaaSimdKernels.h"
+
+
+namespace Nyaa {
+
+
+/** \class BatchEvaluator
+ *  \brief Evaluates a Program for all rows of a set of columns.
+ *
+ *  Rows are processed in chunks of CHUNK_SIZE.  For each chunk every instruction is executed exactly once, operating
+ *  on vectors of values, so that the instruction dispatch cost is amortised over the chunk.  Floating point arithmetic
+ *  and the float and integer comparisons are delegated to the SimdKernels, booleans are kept as packed masks.  Unlike
+ *  the Interpreter, errors like a division by zero do not abort the evaluation but are recorded for the affected rows
+ *  only.
+ *
+ *  Programs w/ jumps are executed under a selection mask of the active rows of a chunk.  A conditional jump
+ *  deactivates the rows that take it until the execution reaches the jump target, and code that no active rows are
+ *  left for is skipped.  The cheap instructions still operate on all rows of a chunk, but errors are only reported
+ *  for active rows and functions are only called for those.
+ *
+ *  A BatchEvaluator may be used for any number of programs but not from more than one thread at a time.
+ */
+class BatchEvaluator {
+public:
+    static constexpr size_t CHUNK_SIZE = 1024;
+private:
+    /** The vector analogue of a slot on the Interpreter's operand stack. */
+    struct Register {
+        std::vector<double> floats_;
+        std::vector<int64_t> ints_;
+        std::vector<uint64_t> bools_; // Packed, see GetMaskBit().
+        std::vector<const std::string *> strings_;
+        std::vector<std::string> string_buffers_;
+
+        Register(): floats_(CHUNK_SIZE), ints_(CHUNK_SIZE), bools_(MaskWordCount(CHUNK_SIZE)), strings_(CHUNK_SIZE),
+                    string_buffers_(CHUNK_SIZE) { }
+    };
+
+    /** The rows that took a jump and wait for the execution to get to its target. */
+    struct JumpTarget {
+        std::vector<uint64_t> arriving_rows_; // Packed like booleans.
+        std::vector<uint64_t> carried_rows_;  // The arriving rows whose JUMP left a value in "carried_values_".
+        Register carried_values_;
+        NodeType carried_type_;
+        unsigned depth_;                      // The stack depth at the target.
+
+        JumpTarget(): arriving_rows_(MaskWordCount(CHUNK_SIZE)), carried_rows_(MaskWordCount(CHUNK_SIZE)),
+                      carried_type_(NodeType::NULL_NODE), depth_(0) { }
+    };
+
+    static constexpr uint32_t NO_JUMP_TARGET = UINT32_MAX;
+
+    const SimdKernels *kernels_;
+    std::vector<Register> registers_;
+    std::vector<Register> locals_;
+    std::vector<const ColumnView *> attrib_columns_; // Indexed by attribute reference index.
+    std::vector<BatchFuncArgs::Column> call_arg_columns_;
+    std::vector<std::pair<size_t, std::string>> call_errors_;
+    bool program_has_jumps_;
+    std::vector<uint32_t> jump_target_indices_; // Indexed by code address, including the one past the end.
+    std::vector<JumpTarget> jump_targets_;
+    std::vector<uint64_t> active_rows_;         // Packed like booleans.
+    std::vector<uint8_t> skipped_rows_;         // Rows that failed or are inactive, one byte per row.
+    std::vector<uint64_t> overflow_rows_;       // Rows whose last integer operation overflowed, packed like booleans.
+public:
+    explicit BatchEvaluator(const SimdKernels &kernels = SimdKernels::GetBest())
+        : kernels_(&kernels), program_has_jumps_(false), active_rows_(MaskWordCount(CHUNK_SIZE)),
+          skipped_rows_(CHUNK_SIZE), overflow_rows_(MaskWordCount(CHUNK_SIZE)) { }
+
+    /** \brief Evaluates "program" for the rows [0, row_count) of "columns" and stores the results in "*result".
+     *  \throws std::invalid_argument if an attribute referenced by "program" is missing from "columns", has a type
+     *          other than the one the program was compiled for or has fewer than "row_count" rows.
+     */
+    void evaluate(const Program &program, const ColumnMap &columns, const size_t row_count,
+                  ResultColumn * const result);
+
+    /** \brief Like the name-based overload but "columns" are indexed by the slots of the schema "binding" has been
+     *         created for.
+     *  \throws std::invalid_argument if the number of columns differs from the size of the schema or a column has
+     *          the wrong type or too few rows.
+     */
+    void evaluate(const Binding &binding, const std::vector<ColumnView> &columns, const size_t row_count,
+                  ResultColumn * const result);
+
+    /** \brief Like the name-based overload of evaluate() but only evaluates the rows [first_row, first_row + row_count)
+     *         and leaves the other rows of "*result" alone.  Different BatchEvaluators may evaluate disjoint ranges
+     *         into the same result concurrently as long as the ranges don't share a ResultColumn::ERROR_BLOCK_SIZE
+     *         block.
+     *  \throws std::invalid_argument in the same cases as evaluate() and if "*result" does not have the result type
+     *          of "program" or has fewer than first_row + row_count rows.
+     */
+    void evaluateRange(const Program &program, const ColumnMap &columns, const size_t first_row,
+                       const size_t row_count, ResultColumn * const result);
+private:
+    void bindColumns(const Program &program, const ColumnMap &columns, const size_t row_count);
+    static void CheckColumn(const ConstantPool::AttribRef &attrib_ref, const ColumnView &column,
+                            const size_t row_count);
+    void evaluateRows(const Program &program, const size_t first_row, const size_t row_count,
+                      ResultColumn * const result);
+    void evaluateChunk(const Program &program, const size_t first_row, const size_t row_count,
+                       ResultColumn * const result);
+    void findJumpTargets(const Program &program);
+    inline bool isActive(const size_t row) const
+        { return not program_has_jumps_ or GetMaskBit(active_rows_.data(), row); }
+
+    /** \return the error flags of the rows of the current chunk, plus the inactive rows if there are any. */
+    const uint8_t *getSkippedRows(const size_t first_row, const size_t row_count, const ResultColumn &result);
+
+    /** Flags the active rows of the current chunk for which "column" has no value as failed. */
+    void reportMissingValues(const CodeAndSourceLocation &attrib_ref_instruction, const ColumnView &column,
+                             const ConstantPool &constant_pool, const size_t first_row, const size_t row_count,
+                             ResultColumn * const result);
+
+    /** Executes one of the fused B??FAC and B??IAC instructions. */
+    void compareAttribWithConstant(const CodeAndSourceLocation &comparison, const ConstantPool &constant_pool,
+                                   const size_t first_row, const size_t row_count, Register * const target,
+                                   ResultColumn * const result);
+
+    /** Flags the active rows of the current chunk that are set in "overflow_rows_" as failed. */
+    void reportIntOverflows(const size_t source_location, const size_t first_row, const size_t row_count,
+                            ResultColumn * const result);
+
+    void takeJump(const CodeAndSourceLocation &jump, const unsigned depth, const size_t row_count);
+
+    /** Activates the rows that are waiting for "address" and restores the values they carried there. */
+    void mergeArrivingRows(const uint32_t address, const size_t row_count, unsigned * const depth);
+
+    /** \return the instruction before the next one that rows are waiting for, or the last one if there is none. */
+    const CodeAndSourceLocation *skipInactiveCode(const Program &program, const CodeAndSourceLocation * const pc) const;
+    /** Copies the first "row_count" values of type "type" from "source" to "*target", w/o the string buffers. */
+    static void CopyRegister(const Register &source, const NodeType type, const size_t row_count,
+                             Register * const target);
+    /** Moves the values of type "type" of the "rows" from "*source" to "*target".  Strings that live in the buffers of
+     *  "*source" end up in the buffers of "*target".
+     */
+    static void MoveRows(Register * const source, const NodeType type, const uint64_t * const rows,
+                         const size_t row_count, Register * const target);
+    void call(const ConstantPool::CallSite &call_site, const unsigned first_arg_register, const size_t first_row,
+              const size_t row_count, const size_t source_location, const uint8_t * const skipped_rows,
+              ResultColumn * const result);
+};
+
+
+} // namespace Nyaa
+
+
+#endif // ifndef NYAA_BATCH_EVALUATOR_H
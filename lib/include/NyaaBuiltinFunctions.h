@@ -0,0 +1,49 @@
+/** \file    NyaaBuiltinFunctions.h
+ *  \brief   The standard library of functions that may be called in equations.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef NYAA_BUILTIN_FUNCTIONS_H
+#define NYAA_BUILTIN_FUNCTIONS_H
+
+
+#include <vector>
+#include "NyaaFunctionRegistry.h"
+
+
+namespace Nyaa {
+
+
+/** \return the built-in mathematical, statistical, string and logical functions.
+ *  \note   The functions are stateless, pure and live until the program terminates.  Where the argument types
+ *          permit it, they provide fast paths and vectorised batch implementations.
+ */
+const std::vector<const Function *> &GetBuiltinFunctions();
+
+
+/** \brief Registers all functions returned by GetBuiltinFunctions() w/ "function_registry".
+ *  \throws std::invalid_argument if "function_registry" already contains a function w/ the name of a built-in.
+ */
+void RegisterBuiltinFunctions(FunctionRegistry * const function_registry);
+
+
+} // namespace Nyaa
+
+
+#endif // ifndef NYAA_BUILTIN_FUNCTIONS_H
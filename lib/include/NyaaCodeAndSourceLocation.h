@@ -24,6 +24,7 @@
 
 
 #include <cinttypes>
+#include <cstddef>
 #include <NyaaInstructions.h>
 
 
@@ -32,18 +33,32 @@ namespace Nyaa {
 
 /** \class CodeAndSourceLocation
  *  \brief Encapsulates a single opcode code and the location in the original source equation.
+ *  \note  All instances have the same size so that a compiled program is a flat array of them.  Payloads that do
+ *         not fit into the two 32-bit operands are referenced by index into tables owned by the Program.
  */
 class CodeAndSourceLocation {
-    const Instruction instruction_;
-    const size_t source_location_;
+    static constexpr uint32_t NO_SOURCE_LOCATION = UINT32_MAX;
+
+    Instruction instruction_;
+    uint32_t operand_, operand2_;
+    uint32_t source_location_;
 public:
-    inline CodeAndSourceLocation(const Instruction instruction, const size_t source_location)
-        : instruction_(instruction), source_location_(source_location) { }
+    inline CodeAndSourceLocation(const Instruction instruction, const size_t source_location, const uint32_t operand = 0,
+                                 const uint32_t operand2 = 0)
+        : instruction_(instruction), operand_(operand), operand2_(operand2),
+          source_location_(source_location == static_cast<size_t>(-1) ? NO_SOURCE_LOCATION
+                                                                       : static_cast<uint32_t>(source_location)) { }
     CodeAndSourceLocation() = default;
     CodeAndSourceLocation(const CodeAndSourceLocation &rhs) = default;
+    CodeAndSourceLocation &operator=(const CodeAndSourceLocation &rhs) = default;
 
     inline Instruction getCode() const { return instruction_; }
-    inline int getSourceLocation() const { return source_location_; }
+    inline uint32_t getOperand() const { return operand_; }
+    inline uint32_t getOperand2() const { return operand2_; }
+
+    /** \return the location in the source equation or static_cast<size_t>(-1) for compiler-generated code. */
+    inline size_t getSourceLocation() const
+        { return source_location_ == NO_SOURCE_LOCATION ? static_cast<size_t>(-1) : source_location_; }
 };
 
 
@@ -0,0 +1,138 @@
+/** \file    NyaaColumn.h
+ *  \brief   Column types used for evaluating Nyaa programs over many rows at once.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef NYAA_COLUMN_H
+#define NYAA_COLUMN_H
+
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cinttypes>
+#include "NyaaFunction.h"
+
+
+namespace Nyaa {
+
+
+/** \class ColumnView
+ *  \brief A non-owning, read-only view of the values of one attribute for consecutive rows.
+ *
+ *  The optional "missing" array flags rows w/o a value w/ a non-zero byte.  Boolean values are stored as one byte
+ *  per row w/ zero representing false.
+ */
+class ColumnView {
+    NodeType type_;
+    const void *values_;
+    const uint8_t *missing_;
+    size_t size_;
+public:
+    ColumnView(): type_(NodeType::NULL_NODE), values_(nullptr), missing_(nullptr), size_(0) { }
+    ColumnView(const double * const values, const size_t size, const uint8_t * const missing = nullptr)
+        : type_(NodeType::FLOAT_NODE), values_(values), missing_(missing), size_(size) { }
+    ColumnView(const int64_t * const values, const size_t size, const uint8_t * const missing = nullptr)
+        : type_(NodeType::INT_NODE), values_(values), missing_(missing), size_(size) { }
+    ColumnView(const uint8_t * const values, const size_t size, const uint8_t * const missing = nullptr)
+        : type_(NodeType::BOOLEAN_NODE), values_(values), missing_(missing), size_(size) { }
+    ColumnView(const std::string * const values, const size_t size, const uint8_t * const missing = nullptr)
+        : type_(NodeType::STRING_NODE), values_(values), missing_(missing), size_(size) { }
+
+    inline NodeType getType() const { return type_; }
+    inline size_t size() const { return size_; }
+    inline bool isMissing(const size_t row) const { return missing_ != nullptr and missing_[row] != 0; }
+    inline const uint8_t *getMissingFlags() const { return missing_; }
+
+    inline const double *getFloats() const { return static_cast<const double *>(values_); }
+    inline const int64_t *getInts() const { return static_cast<const int64_t *>(values_); }
+    inline const uint8_t *getBools() const { return static_cast<const uint8_t *>(values_); }
+    inline const std::string *getStrings() const { return static_cast<const std::string *>(values_); }
+};
+
+
+/** Maps attribute names to their values. */
+typedef std::unordered_map<std::string, ColumnView> ColumnMap;
+
+
+/** \class ResultColumn
+ *  \brief Holds the results of evaluating a program over a number of rows.
+ *
+ *  Rows whose evaluation failed are flagged as errors and have an associated error message, their values are
+ *  unspecified.  The values and errors of rows in different blocks of ERROR_BLOCK_SIZE rows may be set concurrently.
+ */
+class ResultColumn {
+public:
+    static constexpr size_t ERROR_BLOCK_SIZE = 1024;
+private:
+    NodeType type_;
+    std::vector<double> floats_;
+    std::vector<int64_t> ints_;
+    std::vector<uint8_t> bools_;
+    std::vector<std::string> strings_;
+    std::vector<uint8_t> errors_;
+    std::vector<std::unordered_map<size_t, std::string>> error_messages_; // One map per block of rows.
+public:
+    ResultColumn(): type_(NodeType::NULL_NODE) { }
+
+    /** Discards the previous contents and makes room for "size" values of type "type" w/o any errors. */
+    void reset(const NodeType type, const size_t size);
+
+    inline NodeType getType() const { return type_; }
+    inline size_t size() const { return errors_.size(); }
+
+    inline double getFloat(const size_t row) const { return floats_[row]; }
+    inline int64_t getInt(const size_t row) const { return ints_[row]; }
+    inline bool getBool(const size_t row) const { return bools_[row] != 0; }
+    inline const std::string &getString(const size_t row) const { return strings_[row]; }
+
+    inline void setFloat(const size_t row, const double value) { floats_[row] = value; }
+    inline void setInt(const size_t row, const int64_t value) { ints_[row] = value; }
+    inline void setBool(const size_t row, const bool value) { bools_[row] = value; }
+    inline void setString(const size_t row, const std::string &value) { strings_[row] = value; }
+
+    inline double *getFloats() { return floats_.data(); }
+    inline int64_t *getInts() { return ints_.data(); }
+    inline uint8_t *getBools() { return bools_.data(); }
+    inline std::string *getStrings() { return strings_.data(); }
+
+    inline bool hasError(const size_t row) const { return errors_[row] != 0; }
+    inline const uint8_t *getErrorFlags() const { return errors_.data(); }
+    size_t getErrorCount() const;
+
+    /** \return the error message for "row" or the empty string if the evaluation for "row" succeeded. */
+    const std::string &getErrorMessage(const size_t row) const;
+
+    /** Flags "row" as failed.  Only the first error message for any given row is retained. */
+    void setError(const size_t row, const std::string &error_message);
+
+    /** Removes the error flag and message of "row", if any. */
+    void clearError(const size_t row);
+
+    /** \return a view of the values w/ rows whose evaluation failed flagged as missing.
+     *  \note   The view is invalidated by the next call to reset().
+     */
+    ColumnView getColumnView() const;
+};
+
+
+} // namespace Nyaa
+
+
+#endif // ifndef NYAA_COLUMN_H
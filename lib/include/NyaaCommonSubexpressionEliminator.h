@@ -0,0 +1,107 @@
+/** \file    NyaaCommonSubexpressionEliminator.h
+ *  \brief   Declaration of the CommonSubexpressionEliminator class, an optimisation pass over programs.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef NYAA_COMMON_SUBEXPRESSION_ELIMINATOR_H
+#define NYAA_COMMON_SUBEXPRESSION_ELIMINATOR_H
+
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cinttypes>
+#include "NyaaProgram.h"
+
+
+namespace Nyaa {
+
+
+/** \class CommonSubexpressionEliminator
+ *  \brief Makes sure that every distinct subexpression of a program is only computed once per evaluation.
+ *
+ *  The postfix code of a program is run on a symbolic operand stack and every subexpression is assigned a value
+ *  number, identical subexpressions sharing the same number.  The first evaluation of a subexpression that occurs
+ *  more than once is followed by a STORE to a local variable and later occurrences that it dominates, i.e. that can
+ *  only be reached by passing through it, are replaced by a LOAD from it.  Most importantly this means that repeated
+ *  references to an attribute result in a single lookup, even if some of them are in the branches of a conditional
+ *  expression.
+ *
+ *  Constants are not worth storing, and calls of functions that are not pure, as well as any subexpressions
+ *  containing such calls, are never shared.  Neither are the results of conditional expressions, as they are only
+ *  known once the branches merge again.
+ */
+class CommonSubexpressionEliminator {
+    struct StackEntry {
+        uint32_t value_number_;
+        uint32_t start_; // The address of the first instruction of the code that computes the value.
+        bool is_pure_;
+    };
+
+    struct Node {
+        uint32_t value_number_;
+        uint32_t start_;
+        bool is_candidate_;
+        unsigned reuse_count_;  // How many later occurrences load the value from "local_".
+        uint32_t local_;
+        uint32_t definition_;   // For a reuse, the address of the occurrence whose value it loads.
+        uint32_t reuse_end_;    // If set, the code from here to "reuse_end_" is replaced by a LOAD.
+    };
+
+    struct Definition {
+        uint32_t address_;
+        uint32_t previous_; // Index of the previous Definition w/ the same value number.
+    };
+
+    std::vector<CodeAndSourceLocation> code_;
+    std::vector<Node> nodes_;                        // Parallel to "code_", unused for jumps.
+    std::unordered_map<std::string, uint32_t> key_to_value_number_map_;
+    std::vector<uint32_t> candidates_;               // Addresses of the shareable subexpressions.
+    std::vector<Definition> definitions_;
+    std::vector<uint32_t> last_definitions_;         // Indexed by value number.
+    bool has_jumps_;
+    std::vector<uint32_t> min_jump_sources_;         // Sparse table of the lowest jump source per target address.
+    std::vector<uint32_t> first_jump_to_, next_jump_; // Unpatched jumps per target address while emitting.
+    size_t reuse_count_;
+public:
+    CommonSubexpressionEliminator(): has_jumps_(false), reuse_count_(0) { }
+
+    /** Rewrites the code of "*program". */
+    void eliminate(Program * const program);
+
+    /** \return the number of subexpressions the last call to eliminate() replaced by a LOAD. */
+    inline size_t getReuseCount() const { return reuse_count_; }
+private:
+    void numberValues(const ConstantPool &constant_pool);
+    void buildDominanceTable();
+
+    /** \return true if every path from the start of the code to "address2" passes through "address1". */
+    bool dominates(const uint32_t address1, const uint32_t address2) const;
+
+    void markReuses();
+    void emit(Program * const program);
+    void addPendingJump(const uint32_t old_target, const uint32_t new_jump_address);
+    void patchPendingJumps(const uint32_t old_target, Program * const program);
+};
+
+
+} // namespace Nyaa
+
+
+#endif // ifndef NYAA_COMMON_SUBEXPRESSION_ELIMINATOR_H
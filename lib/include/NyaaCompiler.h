@@ -0,0 +1,89 @@
+/** \file    NyaaCompiler.h
+ *  \brief   Declaration of the Compiler class, which turns equations into programs.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef NYAA_COMPILER_H
+#define NYAA_COMPILER_H
+
+
+#include <set>
+#include <string>
+#include "NyaaCommonSubexpressionEliminator.h"
+#include "NyaaConstantFolder.h"
+#include "NyaaParser.h"
+#include "NyaaPeepholeOptimizer.h"
+#include "NyaaProgram.h"
+
+
+namespace Nyaa {
+
+
+/** \class Compiler
+ *  \brief Runs the parser, the ConstantFolder, the code generator, the CommonSubexpressionEliminator and the
+ *         PeepholeOptimizer.
+ *  \note  A Compiler must not be used by more than one thread at a time, but any number of Compilers may share the
+ *         same FunctionRegistry as long as it is not modified.
+ */
+class Compiler {
+    Parser parser_;
+    ConstantFolder constant_folder_;
+    CommonSubexpressionEliminator common_subexpression_eliminator_;
+    PeepholeOptimizer peephole_optimizer_;
+    std::string error_msg_;
+    size_t node_bytes_;
+public:
+    explicit Compiler(const FunctionRegistry &function_registry): parser_(function_registry), node_bytes_(0) { }
+
+    /** \brief Compiles "equation" into "*program", replacing its previous contents.
+     *  \return true if "equation" was valid, else false, in which case getErrorMsg() tells what went wrong.
+     */
+    bool compile(const std::string &equation, const Parser::AttribNameToTypeMap &attrib_name_to_type_map,
+                 Program * const program);
+
+    inline const std::string &getErrorMsg() const { return error_msg_; }
+
+    /** \return the names of all attributes referenced by the last equation, even those eliminated by constant
+     *          folding.
+     */
+    inline const std::set<std::string> &getAttribReferences() const { return parser_.getAttribReferences(); }
+
+    /** \return the number of parse tree nodes the last call to compile() got rid of by constant folding. */
+    inline size_t getEliminatedNodeCount() const { return constant_folder_.getEliminatedNodeCount(); }
+
+    /** \return the number of subexpressions in the program generated by the last call to compile() that reuse an
+     *          earlier result.
+     */
+    inline size_t getReuseCount() const { return common_subexpression_eliminator_.getReuseCount(); }
+
+    /** \return the number of instructions the last call to compile() saved by using superinstructions. */
+    inline size_t getFusedInstructionCount() const { return peephole_optimizer_.getSavedInstructionCount(); }
+
+    /** \return the memory used by the parse-tree nodes of the last successful call to compile(). */
+    inline size_t getNodeBytes() const { return node_bytes_; }
+
+    /** \return the largest amount of memory the parse-tree nodes of any one compilation have ever used. */
+    inline size_t getPeakNodeBytes() const { return parser_.getNodeArena().getPeakBytesInUse(); }
+};
+
+
+} // namespace Nyaa
+
+
+#endif // ifndef NYAA_COMPILER_H
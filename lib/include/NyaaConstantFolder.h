@@ -0,0 +1,77 @@
+/** \file    NyaaConstantFolder.h
+ *  \brief   Declaration of the ConstantFolder class, an optimisation pass over parse trees.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef NYAA_CONSTANT_FOLDER_H
+#define NYAA_CONSTANT_FOLDER_H
+
+
+#include "NyaaInterpreter.h"
+#include "NyaaNodeArena.h"
+#include "NyaaNodes.h"
+#include "NyaaProgram.h"
+
+
+namespace Nyaa {
+
+
+/** \class ConstantFolder
+ *  \brief Replaces constant subexpressions w/ their values and removes operations that are identities.
+ *
+ *  Operators, type conversions and calls of pure functions whose operands are all constants are evaluated at
+ *  compile time.  Additionally x*1, 1*x, x/1, x^1, x-0 w/ an integer 0 or +0.0 and concatenations w/ an empty string
+ *  are reduced to x, as are IF(true, x, y) and IF(false, y, x), x+0 and 0+x for integers and -(-x) for floats.
+ *  Subexpressions whose evaluation fails, e.g. 1/0, are left alone so that the error is reported when the program
+ *  gets executed.
+ *
+ *  The folded tree shares all unchanged subtrees w/ the original one, new nodes are allocated in the arena the
+ *  original tree lives in.
+ */
+class ConstantFolder {
+    Program scratch_program_;
+    Interpreter interpreter_;
+    NodeArena *node_arena_; // Only valid during a call to fold().
+    size_t eliminated_node_count_;
+public:
+    ConstantFolder(): interpreter_(Interpreter::NO_JIT), node_arena_(nullptr), eliminated_node_count_(0) { }
+
+    /** \return an optimised version of "tree", whose new nodes have been allocated in "*node_arena". */
+    const AbstractNode *fold(const AbstractNode &tree, NodeArena * const node_arena);
+
+    /** \return how many fewer nodes the tree returned by the last call to fold() had than the original one. */
+    inline size_t getEliminatedNodeCount() const { return eliminated_node_count_; }
+private:
+    const AbstractNode *foldNode(const AbstractNode &node);
+    const AbstractNode *foldBinOpNode(const BinOpNode &bin_op_node);
+    const AbstractNode *foldUnaryOpNode(const UnaryOpNode &unary_op_node);
+    const AbstractNode *foldFuncCallNode(const FuncCallNode &func_call_node);
+
+    /** \return a new FConvNode or SConvNode, depending on the type of "conversion_node", for "convertee". */
+    const AbstractNode *makeConversionNode(const AbstractNode &conversion_node, const AbstractNode * const convertee);
+
+    /** \return a constant node w/ the value of "node" or "node" itself if it couldn't be evaluated. */
+    const AbstractNode *evaluate(const AbstractNode &node);
+};
+
+
+} // namespace Nyaa
+
+
+#endif // ifndef NYAA_CONSTANT_FOLDER_H
@@ -0,0 +1,113 @@
+/** \file    NyaaConstantPool.h
+ *  \brief   Declaration of the ConstantPool class.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef NYAA_CONSTANT_POOL_H
+#define NYAA_CONSTANT_POOL_H
+
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cinttypes>
+#include "NyaaFunction.h"
+
+
+namespace Nyaa {
+
+
+/** \class ConstantPool
+ *  \brief Holds the operands of a compiled program that do not fit into an instruction.
+ *
+ *  Every value is stored only once, no matter how often it is interned.  Instructions refer to pool entries by their
+ *  index, so that executing a program never has to copy a string or touch a reference count.
+ */
+class ConstantPool {
+public:
+    struct AttribRef {
+        std::string name_;
+        NodeType type_;
+
+        AttribRef(const std::string &name, const NodeType type): name_(name), type_(type) { }
+    };
+
+    /** A function together with the static types of the arguments it is called with. */
+    struct CallSite {
+        const Function *function_;
+        std::vector<NodeType> arg_types_;
+        NodeType return_type_;
+        FuncFastPath fast_path_; // nullptr if the function has no fast path for "arg_types_".
+
+        CallSite(const Function &function, const std::vector<NodeType> &arg_types, const NodeType return_type)
+            : function_(&function), arg_types_(arg_types), return_type_(return_type),
+              fast_path_(return_type == NodeType::STRING_NODE ? nullptr : function.getFastPath(arg_types)) { }
+    };
+private:
+    std::vector<double> floats_;
+    std::unordered_map<uint64_t, uint32_t> float_bits_to_index_; // Keyed by the bit pattern to keep -0.0 and NaN's.
+    std::vector<int64_t> ints_;
+    std::unordered_map<int64_t, uint32_t> int_to_index_;
+    std::vector<std::string> strings_;
+    std::unordered_map<std::string, uint32_t> string_to_index_;
+    std::vector<AttribRef> attrib_refs_;
+    std::unordered_map<std::string, uint32_t> attrib_name_to_index_;
+    std::vector<CallSite> call_sites_;
+public:
+    ConstantPool() = default;
+
+    /** Removes all entries but keeps the allocated storage. */
+    void clear();
+
+    /** \return the index of "value" in the table of floating point constants. */
+    uint32_t internFloat(const double value);
+
+    /** \return the index of "value" in the table of integer constants. */
+    uint32_t internInt(const int64_t value);
+
+    /** \return the index of "value" in the table of string constants. */
+    uint32_t internString(const std::string &value);
+
+    /** \return the index of the attribute reference in the table of attribute references.
+     *  \throws std::invalid_argument if the attribute has been interned before with a different type.
+     */
+    uint32_t internAttribRef(const std::string &attrib_name, const NodeType type);
+
+    /** \return the index of the call signature in the table of call sites. */
+    uint32_t internCallSite(const Function &function, const std::vector<NodeType> &arg_types,
+                            const NodeType return_type);
+
+    inline double getFloat(const uint32_t index) const { return floats_[index]; }
+    inline int64_t getInt(const uint32_t index) const { return ints_[index]; }
+    inline const std::string &getString(const uint32_t index) const { return strings_[index]; }
+    inline const AttribRef &getAttribRef(const uint32_t index) const { return attrib_refs_[index]; }
+    inline const CallSite &getCallSite(const uint32_t index) const { return call_sites_[index]; }
+
+    inline size_t getFloatCount() const { return floats_.size(); }
+    inline size_t getIntCount() const { return ints_.size(); }
+    inline size_t getStringCount() const { return strings_.size(); }
+    inline size_t getAttribRefCount() const { return attrib_refs_.size(); }
+    inline size_t getCallSiteCount() const { return call_sites_.size(); }
+};
+
+
+} // namespace Nyaa
+
+
+#endif // ifndef NYAA_CONSTANT_POOL_H
@@ -0,0 +1,60 @@
+/** \file    NyaaConversions.h
+ *  \brief   Value conversions shared by the various execution engines of the Nyaa interpreter.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef NYAA_CONVERSIONS_H
+#define NYAA_CONVERSIONS_H
+
+
+#include <string>
+#include <cinttypes>
+
+
+namespace Nyaa {
+
+
+/** \brief Converts a string to a floating point number.  Leading and trailing whitespace is ignored.
+ *  \return true if all of "s" could be converted, else false.
+ */
+bool StringToFloat(const std::string &s, double * const value);
+
+
+/** \brief Generates the shortest representation of "value" that converts back to the same number.
+ *  \note  The previous contents of "*s" are replaced but its storage is reused.
+ */
+void FloatToString(const double value, std::string * const s);
+
+
+/** \note The previous contents of "*s" are replaced but its storage is reused. */
+void IntToString(const int64_t value, std::string * const s);
+
+
+/** \return either "true" or "false". */
+const std::string &BoolToString(const bool value);
+
+
+/** \return "source_location: " or the empty string for compiler-generated code, for prefixing error messages. */
+std::string SourceLocationPrefix(const size_t source_location);
+
+
+} // namespace Nyaa
+
+
+#endif // ifndef NYAA_CONVERSIONS_H
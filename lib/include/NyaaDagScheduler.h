@@ -0,0 +1,128 @@
+/** \file    NyaaDagScheduler.h
+ *  \brief   Declaration of the DagScheduler class, which runs a graph of dependent tasks on a pool of threads.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef NYAA_DAG_SCHEDULER_H
+#define NYAA_DAG_SCHEDULER_H
+
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <cinttypes>
+#include <cstddef>
+
+
+namespace Nyaa {
+
+
+/** \class TaskGraph
+ *  \brief Tasks, identified by consecutive indices, and the order in which they have to be run.
+ */
+class TaskGraph {
+    size_t task_count_;
+    std::vector<std::pair<size_t, size_t>> dependencies_; // (prerequisite, dependent) pairs.
+public:
+    explicit TaskGraph(const size_t task_count = 0): task_count_(task_count) { }
+
+    /** \return the index of the new task. */
+    inline size_t addTask() { return task_count_++; }
+
+    /** Requires that "prerequisite" has completed before "dependent" may start. */
+    inline void addDependency(const size_t prerequisite, const size_t dependent)
+        { dependencies_.emplace_back(prerequisite, dependent); }
+
+    inline size_t size() const { return task_count_; }
+    inline const std::vector<std::pair<size_t, size_t>> &getDependencies() const { return dependencies_; }
+    inline void clear() { task_count_ = 0; dependencies_.clear(); }
+};
+
+
+/** \class DagScheduler
+ *  \brief Runs the tasks of a TaskGraph on a pool of threads, each task as soon as all of its prerequisites have
+ *         completed.
+ *
+ *  Every thread has its own queue of ready tasks.  A thread pushes the tasks that became ready through the
+ *  completion of one of its tasks onto its own queue and takes the next task from there, most recently pushed first,
+ *  which keeps the data a task produced hot in the cache of the thread that will consume it.  Idle threads steal the
+ *  oldest tasks from the queues of the others and block until a task becomes ready if there is none.
+ *
+ *  The threads are started by the constructor and reused by all runs, sleeping in between.
+ */
+class DagScheduler {
+public:
+    /** Called for each task w/ the index of the task and the number, in [0, getThreadCount()), of the thread that
+     *  runs it.  No two tasks will be run concurrently w/ the same thread number.
+     */
+    typedef std::function<void(const size_t task, const unsigned thread_no)> TaskFunction;
+
+    struct TaskTiming {
+        double start_; // In seconds since the start of the run.
+        double end_;
+    };
+
+    struct Statistics {
+        std::vector<TaskTiming> task_timings_; // Indexed by task.
+        double wall_seconds_;                  // The duration of the entire run.
+        double critical_path_seconds_;         // The maximum over all chains of dependent tasks of their total time.
+    };
+private:
+    struct Run;
+
+    unsigned thread_count_;
+    std::vector<std::thread> threads_; // Thread number i + 1 runs on threads_[i].
+    std::mutex run_mutex_;             // Serialises calls to run().
+    std::mutex mutex_;                 // Protects the members below.
+    std::condition_variable run_started_, run_finished_;
+    Run *run_;
+    uint64_t run_number_;
+    unsigned run_worker_count_;        // The number of thread numbers the current run uses.
+    unsigned busy_thread_count_;       // Pool threads that have not yet finished their share of the current run.
+    bool shutting_down_;
+public:
+    /** \param thread_count  The maximum number of threads to use, 0 means one per hardware thread.  Fewer threads
+     *                       will be used if not all of them can be created.
+     */
+    explicit DagScheduler(const unsigned thread_count = 0);
+    DagScheduler(const DagScheduler &) = delete;
+    DagScheduler &operator=(const DagScheduler &) = delete;
+    ~DagScheduler();
+
+    inline unsigned getThreadCount() const { return thread_count_; }
+
+    /** \brief Runs all tasks of "task_graph" w/ "task_function", the calling thread being one of the workers.
+     *  \param statistics  If not nullptr, the timings of the run will be stored here.
+     *  \throws std::invalid_argument if the dependencies are circular or refer to nonexistent tasks.
+     *  \note   If a task throws, no further tasks will be started and the first exception is rethrown after all
+     *          threads have finished.  Concurrent calls are run one after the other.
+     */
+    void run(const TaskGraph &task_graph, const TaskFunction &task_function, Statistics * const statistics = nullptr);
+private:
+    void serve(const unsigned thread_no);
+};
+
+
+} // namespace Nyaa
+
+
+#endif // ifndef NYAA_DAG_SCHEDULER_H
@@ -0,0 +1,113 @@
+/** \file    NyaaDependencyGraph.h
+ *  \brief   Declaration of the DependencyGraph class, which tracks which computed columns depend on which.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef NYAA_DEPENDENCY_GRAPH_H
+#define NYAA_DEPENDENCY_GRAPH_H
+
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "NyaaProgram.h"
+
+
+namespace Nyaa {
+
+
+/** \class DependencyGraph
+ *  \brief A set of computed columns, each defined by a compiled equation, and the dependencies between them.
+ *
+ *  A computed column depends on every other computed column its program references.  Attributes that are not
+ *  computed columns are base columns whose values are provided from the outside.  Since equations only ever refer to
+ *  values in the same row, a change to a row of any column only affects the same row of the columns downstream.
+ *
+ *  After adding or changing columns resolve() has to be called before the dependencies can be queried.
+ */
+class DependencyGraph {
+    struct Column {
+        std::string name_;
+        std::shared_ptr<const Program> program_;
+        std::vector<size_t> dependencies_; // The computed columns referenced by "program_".
+        std::vector<size_t> dependents_;   // The computed columns whose programs reference this one.
+
+        Column(const std::string &name, const std::shared_ptr<const Program> &program)
+            : name_(name), program_(program) { }
+    };
+
+    std::vector<Column> columns_;
+    std::unordered_map<std::string, size_t> name_to_index_map_;
+    std::unordered_map<std::string, std::vector<size_t>> attrib_name_to_readers_map_;
+    std::vector<size_t> evaluation_order_;
+    std::vector<size_t> evaluation_ranks_; // The position of each column in "evaluation_order_".
+    bool is_resolved_;
+public:
+    DependencyGraph(): is_resolved_(true) { }
+
+    /** \return the index of the new column.
+     *  \throws std::invalid_argument if there already is a column named "name" or "program" is nullptr.
+     */
+    size_t addColumn(const std::string &name, const std::shared_ptr<const Program> &program);
+
+    /** Replaces the equation of an existing column. */
+    void setProgram(const size_t column_index, const std::shared_ptr<const Program> &program);
+
+    /** \return true if a computed column named "name" exists, in which case its index will be stored in "*index". */
+    bool lookup(const std::string &name, size_t * const index) const;
+
+    inline size_t size() const { return columns_.size(); }
+    inline const std::string &getName(const size_t column_index) const { return columns_[column_index].name_; }
+    inline const Program &getProgram(const size_t column_index) const { return *columns_[column_index].program_; }
+
+    /** \brief Determines the dependencies and an order in which the columns can be evaluated.
+     *  \throws std::runtime_error if there is a circular dependency, the message naming the columns involved.
+     *  \throws std::invalid_argument if a program expects a computed column to be of a type other than the result
+     *          type of that column's program.
+     */
+    void resolve();
+
+    inline bool isResolved() const { return is_resolved_; }
+
+    /** \return the column indices in an order in which every column comes after all of its dependencies.
+     *  \throws std::logic_error if the graph has not been resolved.
+     */
+    const std::vector<size_t> &getEvaluationOrder() const;
+
+    const std::vector<size_t> &getDependencies(const size_t column_index) const;
+    const std::vector<size_t> &getDependents(const size_t column_index) const;
+
+    /** \brief Determines the columns that have to be recomputed after changes to the attributes named by
+     *         "changed_attrib_names", which may be base as well as computed columns.  A changed computed column,
+     *         e.g. one whose program has been replaced, is part of the result itself.
+     *  \return the affected columns in evaluation order.
+     *  \throws std::logic_error if the graph has not been resolved.
+     */
+    std::vector<size_t> getAffectedColumns(const std::vector<std::string> &changed_attrib_names) const;
+private:
+    void checkResolved(const char * const function_name) const;
+    std::string describeCycle(const std::vector<size_t> &in_degrees) const;
+};
+
+
+} // namespace Nyaa
+
+
+#endif // ifndef NYAA_DEPENDENCY_GRAPH_H
@@ -0,0 +1,114 @@
+/** \file    NyaaEquationCache.h
+ *  \brief   Declaration of the EquationCache class.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef NYAA_EQUATION_CACHE_H
+#define NYAA_EQUATION_CACHE_H
+
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <cinttypes>
+#include "NyaaFunctionRegistry.h"
+#include "NyaaParser.h"
+#include "NyaaProgram.h"
+
+
+namespace Nyaa {
+
+
+/** \class EquationCache
+ *  \brief A thread-safe, size-bounded cache of compiled equations.
+ *
+ *  Equations are looked up by their normalised text, i.e. their token stream w/o an optional leading "=", so
+ *  that whitespace between tokens doesn't matter.  As the same text may refer to attributes of different types,
+ *  e.g. in different tables, every text may have several compiled variants, and a variant is only used if the types
+ *  of all attributes it references match those passed in.  When the cache is full, the least recently used text and
+ *  all of its variants are evicted.
+ *
+ *  The returned programs are immutable and may be evaluated concurrently from any number of threads, each w/ its
+ *  own Interpreter or BatchEvaluator.  The source locations in a cached program refer to the first equation text
+ *  that was compiled for it, which may differ from later ones in whitespace.
+ */
+class EquationCache {
+public:
+    static constexpr size_t DEFAULT_MAX_SIZE = 10000;
+private:
+    struct Variant {
+        std::shared_ptr<const Program> program_;
+        std::vector<std::pair<std::string, NodeType>> attrib_names_and_types_; // As referenced in the equation.
+
+        explicit Variant(const std::shared_ptr<const Program> &program): program_(program) { }
+    };
+
+    struct Entry {
+        std::string normalised_equation_;
+        std::vector<Variant> variants_;
+
+        explicit Entry(const std::string &normalised_equation): normalised_equation_(normalised_equation) { }
+    };
+
+    const FunctionRegistry &function_registry_;
+    const size_t max_size_;
+    mutable std::mutex mutex_;
+    std::list<Entry> entries_; // Most recently used first.
+    std::unordered_map<std::string, std::list<Entry>::iterator> normalised_equation_to_entry_map_;
+    std::atomic<uint64_t> hit_count_, miss_count_;
+public:
+    /** \param function_registry  Must not be modified while the cache is in use.
+     *  \param max_size           The maximum number of distinct equation texts retained.
+     */
+    explicit EquationCache(const FunctionRegistry &function_registry, const size_t max_size = DEFAULT_MAX_SIZE);
+
+    /** \brief Returns the compiled version of "equation", compiling it only if it can't be found in the cache.
+     *  \return the compiled program or nullptr if "equation" is invalid, in which case "*error_msg" will be set.
+     *  \note   Invalid equations are not cached.
+     */
+    std::shared_ptr<const Program> compile(const std::string &equation,
+                                           const Parser::AttribNameToTypeMap &attrib_name_to_type_map,
+                                           std::string * const error_msg);
+
+    /** Discards all cached programs.  The hit and miss counts are retained. */
+    void clear();
+
+    /** \return the number of distinct equation texts currently cached. */
+    size_t size() const;
+
+    inline uint64_t getHitCount() const { return hit_count_.load(std::memory_order_relaxed); }
+    inline uint64_t getMissCount() const { return miss_count_.load(std::memory_order_relaxed); }
+private:
+    /** \return the cached variant of "normalised_equation" compatible w/ "attrib_name_to_type_map" or nullptr. */
+    std::shared_ptr<const Program> lookup(const std::string &normalised_equation,
+                                          const Parser::AttribNameToTypeMap &attrib_name_to_type_map);
+
+    void insert(const std::string &normalised_equation, Variant &&variant);
+};
+
+
+} // namespace Nyaa
+
+
+#endif // ifndef NYAA_EQUATION_CACHE_H
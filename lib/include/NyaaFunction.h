@@ -23,9 +23,10 @@
 #define NYAA_FUNCTION_H
 
 
-#include <memory>
+#include <new>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 #include <cinttypes>
 
@@ -33,24 +34,47 @@
 namespace Nyaa {
 
 
-// Forward declaration:
-class AbstractNode;
-
-
 enum class NodeType { BOOLEAN_NODE, INT_NODE, FLOAT_NODE, STRING_NODE, NULL_NODE };
 
 
+/** \class FuncArg
+ *  \brief A self-contained value of any of the types an equation can produce.
+ *
+ *  Only the member for the current type is alive.  Short strings are stored inline by std::string itself.
+ */
 class FuncArg {
     NodeType type_;
-    bool bool_value_;
-    double double_value_;
-    int64_t int_value_;
-    std::string string_value_;
+    union {
+        bool bool_value_;
+        double double_value_;
+        int64_t int_value_;
+        std::string string_value_;
+    };
 public:
     FuncArg(const bool bool_value): type_(NodeType::BOOLEAN_NODE), bool_value_(bool_value) { }
     FuncArg(const double double_value): type_(NodeType::FLOAT_NODE), double_value_(double_value) { }
     FuncArg(const int64_t int_value): type_(NodeType::INT_NODE), int_value_(int_value) { }
     FuncArg(const std::string &string_value): type_(NodeType::STRING_NODE), string_value_(string_value) { }
+    FuncArg(std::string &&string_value): type_(NodeType::STRING_NODE), string_value_(std::move(string_value)) { }
+    FuncArg(const FuncArg &other): type_(NodeType::NULL_NODE) { assign(other); }
+    FuncArg(FuncArg &&other): type_(NodeType::NULL_NODE) { assign(std::move(other)); }
+    ~FuncArg() { destroy(); }
+
+    inline FuncArg &operator=(const FuncArg &rhs) {
+        if (&rhs != this) {
+            destroy();
+            assign(rhs);
+        }
+        return *this;
+    }
+
+    inline FuncArg &operator=(FuncArg &&rhs) {
+        if (&rhs != this) {
+            destroy();
+            assign(std::move(rhs));
+        }
+        return *this;
+    }
 
     inline NodeType getType() const { return type_; }
 
@@ -77,9 +101,218 @@ public:
             throw std::logic_error("in FuncArg::getStringValue: not a string argument!");
 	return string_value_;
     }
+private:
+    inline void destroy() {
+        if (type_ == NodeType::STRING_NODE)
+            string_value_.~basic_string();
+        type_ = NodeType::NULL_NODE;
+    }
+
+    /** \note Our type has to be NULL_NODE, i.e. no member may be alive. */
+    template<typename OtherFuncArg> inline void assign(OtherFuncArg &&other) {
+        switch (other.type_) {
+        case NodeType::BOOLEAN_NODE:
+            bool_value_ = other.bool_value_;
+            break;
+        case NodeType::FLOAT_NODE:
+            double_value_ = other.double_value_;
+            break;
+        case NodeType::INT_NODE:
+            int_value_ = other.int_value_;
+            break;
+        case NodeType::STRING_NODE:
+            new (&string_value_) std::string(std::forward<OtherFuncArg>(other).string_value_);
+            break;
+        default:
+            break;
+        }
+        type_ = other.type_;
+    }
+};
+
+
+/** A function argument or result.  Which member is valid follows from the static type of the value. */
+union FuncValue {
+    double float_;
+    int64_t int_;
+    bool bool_;
+    const std::string *string_;
+};
+
+
+/** \class FuncArgs
+ *  \brief A non-owning view of the arguments of a function call, e.g. of the section of the Interpreter's stack that
+ *         holds them.
+ */
+class FuncArgs {
+    const FuncValue *values_;
+    const NodeType *types_;
+    size_t size_;
+public:
+    FuncArgs(const FuncValue * const values, const NodeType * const types, const size_t size)
+        : values_(values), types_(types), size_(size) { }
+
+    inline size_t size() const { return size_; }
+    inline NodeType getType(const size_t arg_no) const { return types_[arg_no]; }
+    inline const FuncValue *getValues() const { return values_; }
+
+    inline double getFloat(const size_t arg_no) const { return values_[arg_no].float_; }
+    inline int64_t getInt(const size_t arg_no) const { return values_[arg_no].int_; }
+    inline bool getBool(const size_t arg_no) const { return values_[arg_no].bool_; }
+    inline const std::string &getString(const size_t arg_no) const { return *values_[arg_no].string_; }
+};
+
+
+/** \class FuncResult
+ *  \brief Receives the result of a function call.
+ *
+ *  The result may occupy the storage of the first argument, so a function must not set its result before it is done
+ *  reading its arguments.  String results are copied into a buffer that is provided by the caller and reused from
+ *  call to call, so that the copy usually doesn't allocate.
+ */
+class FuncResult {
+    FuncValue *value_;
+    std::string *string_buffer_;
+    NodeType type_;
+public:
+    FuncResult(FuncValue * const value, std::string * const string_buffer)
+        : value_(value), string_buffer_(string_buffer), type_(NodeType::NULL_NODE) { }
+
+    /** \return the type of the value that has been set or NULL_NODE if none has been set yet. */
+    inline NodeType getType() const { return type_; }
+
+    inline void setFloat(const double value) { value_->float_ = value; type_ = NodeType::FLOAT_NODE; }
+    inline void setInt(const int64_t value) { value_->int_ = value; type_ = NodeType::INT_NODE; }
+    inline void setBool(const bool value) { value_->bool_ = value; type_ = NodeType::BOOLEAN_NODE; }
+
+    /** \return the stored string, which may be modified in place, e.g. to build the result incrementally.
+     *  \note   As the first argument may share storage w/ the result, it must not be read after the stored string has
+     *          been modified.
+     */
+    inline std::string &setString(const std::string &value) { return setString(value.data(), value.size()); }
+    inline std::string &setString(const char * const data, const size_t size) {
+        string_buffer_->assign(data, size);
+        value_->string_ = string_buffer_;
+        type_ = NodeType::STRING_NODE;
+        return *string_buffer_;
+    }
 };
 
 
+/** \brief A non-virtual implementation of a function for fixed argument types, see Function::getFastPath().
+ *  \param args       The arguments, in consecutive slots.  The result has to be stored in args[0].
+ *  \param arg_count  The number of arguments, only of interest for functions w/ a variable number of arguments.
+ */
+typedef void (*FuncFastPath)(FuncValue * const args, const size_t arg_count);
+
+
+/** \class BatchFuncArgs
+ *  \brief A non-owning view of the arguments of a function for a number of consecutive rows.
+ *
+ *  Each argument is an array w/ one value per row.  Boolean arguments are packed, the value for row i being bit
+ *  i % 64 of word i / 64, see GetMaskBit() in NyaaSimdKernels.h.
+ */
+class BatchFuncArgs {
+public:
+    union Column {
+        const double *floats_;
+        const int64_t *ints_;
+        const uint64_t *bools_;
+        const std::string * const *strings_;
+    };
+private:
+    const Column *columns_;
+    const NodeType *types_;
+    size_t size_;
+    size_t row_count_;
+public:
+    BatchFuncArgs(const Column * const columns, const NodeType * const types, const size_t size,
+                  const size_t row_count)
+        : columns_(columns), types_(types), size_(size), row_count_(row_count) { }
+
+    inline size_t size() const { return size_; }
+    inline size_t getRowCount() const { return row_count_; }
+    inline NodeType getType(const size_t arg_no) const { return types_[arg_no]; }
+    inline const NodeType *getTypes() const { return types_; }
+
+    inline const double *getFloats(const size_t arg_no) const { return columns_[arg_no].floats_; }
+    inline const int64_t *getInts(const size_t arg_no) const { return columns_[arg_no].ints_; }
+    inline const uint64_t *getBools(const size_t arg_no) const { return columns_[arg_no].bools_; }
+    inline const std::string * const *getStrings(const size_t arg_no) const { return columns_[arg_no].strings_; }
+};
+
+
+/** \class BatchFuncResult
+ *  \brief Receives the results of a function for a number of consecutive rows.
+ *
+ *  The results may share storage w/ the first argument, so the result for a row must not be set before the
+ *  arguments of that row have been read.  Rows for which the evaluation of the equation had already failed before
+ *  the call, or which don't need the result, e.g. because they took the other branch of an IF, are flagged as
+ *  failed.  Their arguments are garbage and their results will be ignored.  Functions that don't take
+ *  advantage of that, e.g. because they are vectorised, should make sure not to report errors for such rows.
+ */
+class BatchFuncResult {
+    NodeType type_;
+    void *values_;
+    const std::string **strings_;
+    std::string *string_buffers_;
+    size_t row_count_;
+    const uint8_t *failed_rows_;
+    std::vector<std::pair<size_t, std::string>> *errors_;
+public:
+    /** \param values          An array of double, int64_t or packed booleans, depending on "type".
+     *  \param strings         Only used if "type" is STRING_NODE, receives pointers to the string results.
+     *  \param string_buffers  Only used if "type" is STRING_NODE, one reusable buffer per row.
+     *  \param failed_rows     One byte per row, non-zero for rows that had already failed, or nullptr.
+     *  \param errors          Receives the rows for which the function failed and the associated error messages.
+     */
+    BatchFuncResult(const NodeType type, void * const values, const std::string ** const strings,
+                    std::string * const string_buffers, const size_t row_count, const uint8_t * const failed_rows,
+                    std::vector<std::pair<size_t, std::string>> * const errors)
+        : type_(type), values_(values), strings_(strings), string_buffers_(string_buffers), row_count_(row_count),
+          failed_rows_(failed_rows), errors_(errors) { }
+
+    /** \return the type the results have to be of. */
+    inline NodeType getType() const { return type_; }
+    inline size_t getRowCount() const { return row_count_; }
+    inline bool hasFailed(const size_t row) const { return failed_rows_ != nullptr and failed_rows_[row] != 0; }
+
+    inline double *getFloats() { return static_cast<double *>(values_); }
+    inline int64_t *getInts() { return static_cast<int64_t *>(values_); }
+    inline uint64_t *getBools() { return static_cast<uint64_t *>(values_); }
+
+    /** \return the reusable buffer for the string result of "row". */
+    inline std::string *getStringBuffer(const size_t row) { return &string_buffers_[row]; }
+
+    /** \param value  Must outlive the evaluation of the equation, e.g. a string returned by getStringBuffer(). */
+    inline void setStringPointer(const size_t row, const std::string * const value) { strings_[row] = value; }
+
+    inline void setString(const size_t row, const std::string &value) {
+        string_buffers_[row] = value;
+        strings_[row] = &string_buffers_[row];
+    }
+
+    /** Flags "row" as failed. */
+    inline void setError(const size_t row, const std::string &error_message)
+        { errors_->emplace_back(row, error_message); }
+};
+
+
+/** Functions that don't always need all of their arguments.  Calls to them are compiled to jumps rather than to a
+ *  CALL, so that arguments that don't contribute to the result are never evaluated.
+ *  - IF: IF(condition, value_if_true, value_if_false), both values having the same type.
+ *  - AND, OR: any number of booleans, evaluated from left to right until the result is known.
+ */
+enum class ShortCircuitKind { NONE, IF, AND, OR };
+
+
+/** Functions whose calls w/ certain argument types are compiled to a single instruction instead of a CALL.
+ *  - INT_QUOTIENT: (dividend, divisor), two integers, to IDIV.
+ *  - INT_MODULO: (dividend, divisor), two integers, to IMOD.
+ */
+enum class IntrinsicKind { NONE, INT_QUOTIENT, INT_MODULO };
+
+
 /**
  * The function interface.
  */
@@ -127,12 +360,51 @@ public:
 
     /**
      *  Used to invoke this function.
-     *  \param args the function arguments which must correspond in type and number to what getParameterTypes() returns.
-     *  \return the result of the function evaluation.  The actual type of the returned object will be what getReturnType() returns.
+     *  \param args    the function arguments which correspond in type and number to what validateArgTypes() accepted.
+     *  \param result  where the result has to be stored.  Its type must be what validateArgTypes() returned.
      *  \throws std::domain_error thrown if a numeric error, e.g. a division by zero occurred.
      *  \throws std::invalid_argument thrown for any error that is not a numeric error, for example if a function only accepts positive numbers and a negative number was passed in.
      */
-    virtual std::unique_ptr<AbstractNode> evaluateFunction(const std::vector<AbstractNode *> &args) const = 0;
+    virtual void evaluateFunction(const FuncArgs &args, FuncResult * const result) const = 0;
+
+    /**
+     *  Used to invoke this function for many rows at once.  The default implementation calls evaluateFunction() for
+     *  each row that hasn't failed yet.  Functions that can process many rows faster than one at a time, e.g. w/
+     *  vectorised code, should override it.
+     *  \param args    the function arguments, like those of evaluateFunction() but for args.getRowCount() rows.
+     *  \param result  where the results have to be stored.  Instead of throwing, errors have to be reported through
+     *                 result->setError() and only affect the failing rows.
+     */
+    virtual void evaluateBatch(const BatchFuncArgs &args, BatchFuncResult * const result) const;
+
+    /**
+     *  Called at compile time to let functions provide implementations that are specialised for the argument types
+     *  of a particular call and are called directly instead of through evaluateFunction().
+     *  \param arg_types  Argument types that validateArgTypes() has accepted.
+     *  \return a specialised implementation or nullptr if there is none.  Functions w/ a string result can't have
+     *          fast paths.  A fast path may throw the same exceptions as evaluateFunction().
+     */
+    virtual FuncFastPath getFastPath(const std::vector<NodeType> &/*arg_types*/) const { return nullptr; }
+
+    /**
+     *  \return true if the result only depends on the arguments and calling the function has no side effects, in
+     *          which case calls w/ constant arguments may be evaluated at compile time.
+     */
+    virtual bool isPure() const { return false; }
+
+    /**
+     *  \return how calls to this function may be short-circuited.  Functions that return something other than NONE
+     *          must also implement evaluateFunction() w/ the same semantics, e.g. for constant folding.
+     */
+    virtual ShortCircuitKind getShortCircuitKind() const { return ShortCircuitKind::NONE; }
+
+    /**
+     *  \param arg_types  Argument types that validateArgTypes() has accepted.
+     *  \return the instruction that calls w/ "arg_types" may be compiled to.  Functions that return something other
+     *          than NONE must also implement evaluateFunction() w/ the semantics of the instruction.
+     */
+    virtual IntrinsicKind getIntrinsicKind(const std::vector<NodeType> &/*arg_types*/) const
+        { return IntrinsicKind::NONE; }
 };
 
 
@@ -0,0 +1,74 @@
+/** \file    NyaaFunctionRegistry.h
+ *  \brief   Declaration of the FunctionRegistry class.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef NYAA_FUNCTION_REGISTRY_H
+#define NYAA_FUNCTION_REGISTRY_H
+
+
+#include <string>
+#include <vector>
+#include <cinttypes>
+#include "NyaaFunction.h"
+
+
+namespace Nyaa {
+
+
+/** \class FunctionRegistry
+ *  \brief Maps function names, which are case-insensitive, to the functions that may be called in equations.
+ *
+ *  Names are kept in an open-addressing hash table keyed by a hash of their upper-case form, so that a lookup neither
+ *  allocates nor has to case-fold the stored names.
+ *  \note  The registry does not own the functions.
+ */
+class FunctionRegistry {
+    struct Entry {
+        uint64_t hash_;
+        std::string upper_case_name_;
+        const Function *function_; // nullptr for unused entries.
+
+        Entry(): hash_(0), function_(nullptr) { }
+    };
+
+    std::vector<Entry> entries_; // The size is always a power of two.
+    size_t size_;
+public:
+    FunctionRegistry(): size_(0) { }
+
+    /** \throws std::invalid_argument if a function w/ the same name, ignoring case, has already been registered. */
+    void registerFunction(const Function &function);
+
+    /** \return the function named "name", ignoring case, or nullptr if there is none. */
+    const Function *lookup(const char * const name, const size_t name_length) const;
+    inline const Function *lookup(const std::string &name) const { return lookup(name.data(), name.size()); }
+
+    inline size_t size() const { return size_; }
+private:
+    static uint64_t CaseInsensitiveHash(const char * const name, const size_t name_length);
+    const Entry *findEntry(const char * const name, const size_t name_length, const uint64_t hash) const;
+    void grow();
+};
+
+
+} // namespace Nyaa
+
+
+#endif // ifndef NYAA_FUNCTION_REGISTRY_H
@@ -23,10 +23,13 @@
 #define NYAA_INSTRUCTIONS_H
 
 
+#include <cinttypes>
+
+
 namespace Nyaa {
 
 
-enum class Instruction {
+enum class Instruction: uint8_t {
     FADD,     // addition of two floating-point numbers
     FSUB,     // subtraction of two floating-point numbers
     FMUL,     // multiplication of two floating-point numbers
@@ -58,6 +61,7 @@ enum class Instruction {
     BGTEI,    // greater than or equal test for integers
     BLTEI,    // less than or equal test for integers
     CALL,     // function call
+    CALLF,    // function call through the fast path of the call site
     FUMINUS,  // unary minus for a floating-point numbers
     FUPLUS,   // unary plus for a floating-point numbers
     AREF,     // attribute reference
@@ -67,7 +71,38 @@ enum class Instruction {
     FCONVS,   // conversion of a string to floating point
     SCONVF,   // conversion of a floating point number to a string
     SCONVI,   // conversion of an integer to a string
-    SCONVB    // conversion of a boolean to a string
+    SCONVB,   // conversion of a boolean to a string
+    FPUSH,    // push a floating-point constant
+    SPUSH,    // push a string constant
+    BPUSH,    // push a boolean constant
+    IPUSH,    // push an integer constant
+    STORE,    // copy the value on top of the stack to a local variable w/o popping it
+    LOAD,     // push the value of a local variable
+    JUMP,     // unconditional jump
+    JUMP_IF_FALSE, // pop a boolean and jump if it is false
+    JUMP_IF_TRUE,  // pop a boolean and jump if it is true
+    IADD,     // addition of two integers
+    ISUB,     // subtraction of two integers
+    IMUL,     // multiplication of two integers
+    IDIV,     // division of two integers, rounding towards zero
+    IMOD,     // remainder of the division of two integers, w/ the sign of the divisor
+    IUMINUS,  // unary minus for an integer
+    FAREFI,   // attribute reference to an integer attribute, converted to floating point
+    BEQLFAC,  // equality test for a floating-point attribute and a constant
+    BNEQLFAC, // inequality test for a floating-point attribute and a constant
+    BGTFAC,   // greater-than test for a floating-point attribute and a constant
+    BLTFAC,   // less-than test for a floating-point attribute and a constant
+    BGTEFAC,  // greater-than-or-equal test for a floating-point attribute and a constant
+    BLTEFAC,  // less-than-or-equal test for a floating-point attribute and a constant
+    BEQLIAC,  // equality test for an integer attribute and a constant
+    BNEQLIAC, // inequality test for an integer attribute and a constant
+    BGTIAC,   // greater-than test for an integer attribute and a constant
+    BLTIAC,   // less-than test for an integer attribute and a constant
+    BGTEIAC,  // greater-than-or-equal test for an integer attribute and a constant
+    BLTEIAC,  // less-than-or-equal test for an integer attribute and a constant
+    SCONCATF, // string concatenation w/ a floating-point number converted to a string as the left operand
+    SCONCATI, // string concatenation w/ an integer converted to a string as the left operand
+    SCONCATB  // string concatenation w/ a boolean converted to a string as the left operand
 };
  
 
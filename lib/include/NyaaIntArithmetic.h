@@ -0,0 +1,117 @@
+/** \file    NyaaIntArithmetic.h
+ *  \brief   Integer arithmetic shared by the various execution engines of the Nyaa interpreter.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef NYAA_INT_ARITHMETIC_H
+#define NYAA_INT_ARITHMETIC_H
+
+
+#include <cinttypes>
+
+
+namespace Nyaa {
+
+
+/** Integer overflows are reported as errors unless the library has been built w/ NYAA_UNCHECKED_INT_ARITHMETIC
+ *  defined, in which case they silently wrap around.  Only use the latter if the inputs are known to be bounded.
+ */
+#ifdef NYAA_UNCHECKED_INT_ARITHMETIC
+constexpr bool CHECK_INT_OVERFLOW(false);
+#else
+constexpr bool CHECK_INT_OVERFLOW(true);
+#endif
+
+
+// Addition, subtraction, multiplication and negation that wrap around modulo 2^64, like the machine instructions do.
+// They are computed w/ unsigned numbers, as signed overflow would be undefined.
+
+
+inline int64_t WrappingAdd(const int64_t lhs, const int64_t rhs)
+    { return static_cast<int64_t>(static_cast<uint64_t>(lhs) + static_cast<uint64_t>(rhs)); }
+inline int64_t WrappingSub(const int64_t lhs, const int64_t rhs)
+    { return static_cast<int64_t>(static_cast<uint64_t>(lhs) - static_cast<uint64_t>(rhs)); }
+inline int64_t WrappingMul(const int64_t lhs, const int64_t rhs)
+    { return static_cast<int64_t>(static_cast<uint64_t>(lhs) * static_cast<uint64_t>(rhs)); }
+inline int64_t WrappingNegate(const int64_t value) { return static_cast<int64_t>(-static_cast<uint64_t>(value)); }
+
+
+// The checked operations store the wrapped-around result in "*result" and return true if it overflowed.  W/o
+// CHECK_INT_OVERFLOW they always return false.
+
+
+inline bool AddOverflows(const int64_t lhs, const int64_t rhs, int64_t * const result) {
+    if (not CHECK_INT_OVERFLOW) {
+        *result = WrappingAdd(lhs, rhs);
+        return false;
+    }
+    return __builtin_add_overflow(lhs, rhs, result);
+}
+
+
+inline bool SubOverflows(const int64_t lhs, const int64_t rhs, int64_t * const result) {
+    if (not CHECK_INT_OVERFLOW) {
+        *result = WrappingSub(lhs, rhs);
+        return false;
+    }
+    return __builtin_sub_overflow(lhs, rhs, result);
+}
+
+
+inline bool MulOverflows(const int64_t lhs, const int64_t rhs, int64_t * const result) {
+    if (not CHECK_INT_OVERFLOW) {
+        *result = WrappingMul(lhs, rhs);
+        return false;
+    }
+    return __builtin_mul_overflow(lhs, rhs, result);
+}
+
+
+inline bool NegateOverflows(const int64_t value, int64_t * const result) {
+    *result = WrappingNegate(value);
+    return CHECK_INT_OVERFLOW and value == INT64_MIN;
+}
+
+
+/** Computes "dividend / divisor" rounded towards zero.  The only overflow is INT64_MIN / -1.
+ *  \note "divisor" must not be zero.
+ */
+inline bool QuotientOverflows(const int64_t dividend, const int64_t divisor, int64_t * const result) {
+    if (divisor == -1) // Avoids the trap of INT64_MIN / -1.
+        return NegateOverflows(dividend, result);
+    *result = dividend / divisor;
+    return false;
+}
+
+
+/** \return the remainder of "dividend / divisor" w/ the sign of the divisor, as in spreadsheets.  It can't overflow.
+ *  \note   "divisor" must not be zero.
+ */
+inline int64_t IntModulo(const int64_t dividend, const int64_t divisor) {
+    if (divisor == -1) // Avoids the trap of INT64_MIN % -1.
+        return 0;
+    const int64_t remainder(dividend % divisor);
+    return (remainder != 0 and (remainder < 0) != (divisor < 0)) ? remainder + divisor : remainder;
+}
+
+
+} // namespace Nyaa
+
+
+#endif // ifndef NYAA_INT_ARITHMETIC_H
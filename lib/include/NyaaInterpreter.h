@@ -0,0 +1,115 @@
+/** \file    NyaaInterpreter.h
+ *  \brief   Declaration of the Interpreter class, the virtual machine that executes compiled Nyaa programs.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef NYAA_INTERPRETER_H
+#define NYAA_INTERPRETER_H
+
+
+#include <exception>
+#include <string>
+#include <vector>
+#include <cinttypes>
+#include "NyaaAttribContext.h"
+#include "NyaaFunction.h"
+#include "NyaaJitCompiler.h"
+#include "NyaaProgram.h"
+#include "NyaaSchema.h"
+
+
+namespace Nyaa {
+
+
+/** \class Interpreter
+ *  \brief A stack machine that executes a Program.
+ *
+ *  The operand stack is sized from Program::getMaxStackDepth() and retained between calls, so after the first
+ *  evaluation of a program no heap allocations take place unless the program produces strings or calls functions or
+ *  gets JIT compiled.
+ *  An Interpreter may be used for any number of programs but not from more than one thread at a time.
+ *
+ *  Programs that have been evaluated "jit_threshold" times, counting the evaluations by all Interpreters, are
+ *  translated to native code by the JitCompiler, which is then executed instead, where possible.  Function calls made
+ *  by the native code are still executed by the Interpreter.
+ */
+class Interpreter {
+public:
+    static constexpr uint32_t DEFAULT_JIT_THRESHOLD = 1000;
+    static constexpr uint32_t NO_JIT = 0;
+private:
+    /** Every slot holds a value of the static type the compiler determined for it.  Functions get to see the slots
+     *  of their arguments directly.
+     */
+    typedef FuncValue Value;
+
+    std::vector<Value> stack_;
+
+    /** String results produced at stack depth i are stored in string_buffers_[i]. */
+    std::vector<std::string> string_buffers_;
+
+    /** The local variables of the program, strings that live in "string_buffers_" get copied on STORE. */
+    std::vector<Value> locals_;
+    std::vector<std::string> local_string_buffers_;
+
+    uint32_t jit_threshold_;
+    std::exception_ptr jit_exception_; // Thrown by a callback of native code.
+public:
+    /** \param jit_threshold  The number of evaluations after which a program gets JIT compiled, NO_JIT disables the
+     *                        JIT tier.
+     */
+    explicit Interpreter(const uint32_t jit_threshold = DEFAULT_JIT_THRESHOLD): jit_threshold_(jit_threshold) { }
+
+    /** \brief Executes "program" against the attribute values provided by "context".
+     *  \return the value left on the stack, its type being program.getResultType().
+     *  \throws std::domain_error for numeric errors, e.g. a division by zero.
+     *  \throws std::invalid_argument if a conversion failed or a function rejected its arguments.
+     *  \throws std::runtime_error if a referenced attribute has no value and no default had been specified.
+     */
+    FuncArg evaluate(const Program &program, const AttribContext &context);
+
+    /** \brief Executes the program "binding" has been created for against the attribute values provided by
+     *         "context".  Attributes are fetched by slot, i.e. w/o any name lookups.
+     *  \note   "binding" must be valid for its program and schema, see Binding::isValidFor().
+     *  \throws the same exceptions as the name-based overload.
+     */
+    FuncArg evaluate(const Binding &binding, const IndexedAttribContext &context);
+private:
+    template<typename AttribSource> FuncArg execute(const Program &program, const AttribSource &attrib_source);
+    template<typename AttribSource> FuncArg executeNative(const NativeCode &native_code, const Program &program,
+                                                          const AttribSource &attrib_source);
+
+    // The callbacks of the JitFrame.
+    template<typename AttribSource, typename ValueType,
+             bool (AttribSource::*getter)(const uint32_t, ValueType * const) const>
+    static int GetAttrib(JitFrame * const frame, const uint32_t attrib_ref_index, ValueType * const value);
+    static int Call(JitFrame * const frame, const uint32_t address, Value * const args);
+
+    /** Calls a function w/ the arguments starting at "args" and stores the result in args[0]. */
+    void call(const ConstantPool::CallSite &call_site, Value * const args, const size_t stack_depth,
+              const size_t source_location);
+    void callFastPath(const ConstantPool::CallSite &call_site, Value * const args, const size_t arg_count,
+                      const size_t source_location);
+};
+
+
+} // namespace Nyaa
+
+
+#endif // ifndef NYAA_INTERPRETER_H
@@ -0,0 +1,151 @@
+/** \file    NyaaJitCompiler.h
+ *  \brief   Declaration of the JitCompiler class, which translates programs to native x86-64 code, and its helpers.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef NYAA_JIT_COMPILER_H
+#define NYAA_JIT_COMPILER_H
+
+
+#include <atomic>
+#include <memory>
+#include <cinttypes>
+#include <cstddef>
+#include "NyaaFunction.h"
+
+
+namespace Nyaa {
+
+
+class Program;
+
+
+/** How the native code of a program finished. */
+enum class JitStatus : uint32_t {
+    OK,
+    NO_VALUE,         // An AREF found no value.
+    DIVISION_BY_ZERO,
+    INT_OVERFLOW,
+    EXCEPTION         // A callback threw.
+};
+
+
+/** \struct JitFrame
+ *  \brief The interface between native code and the Interpreter that runs it.
+ *
+ *  Native code keeps its operand stack and its locals in the arrays the Interpreter uses, so that a callback can
+ *  operate on them just like the Interpreter would.  The callbacks return a negative number if they threw, in which
+ *  case the native code returns JitStatus::EXCEPTION and the Interpreter has to rethrow the exception.  Otherwise
+ *  the attribute getters return whether the attribute had a value and "call_" returns 0.
+ */
+struct JitFrame {
+    FuncValue *stack_;
+    FuncValue *locals_;
+    const Program *program_;
+    const void *attrib_source_;
+    void *interpreter_;
+    int (*get_float_attrib_)(JitFrame * const frame, const uint32_t attrib_ref_index, double * const value);
+    int (*get_int_attrib_)(JitFrame * const frame, const uint32_t attrib_ref_index, int64_t * const value);
+    int (*get_boolean_attrib_)(JitFrame * const frame, const uint32_t attrib_ref_index, bool * const value);
+
+    /** Executes the CALL or CALLF at "address", whose arguments start at "args". */
+    int (*call_)(JitFrame * const frame, const uint32_t address, FuncValue * const args);
+
+    uint32_t error_address_; // The address of the instruction that failed if the status is not JitStatus::OK.
+};
+
+
+struct ExecutableChunk;
+
+
+/** \class NativeCode
+ *  \brief The executable translation of a Program.
+ *
+ *  The code of all programs is allocated from a shared arena of large chunks, so that we don't need a mapping of our
+ *  own per program and won't run into the kernel's limit on the number of mappings.
+ */
+class NativeCode {
+    typedef JitStatus (*EntryPoint)(JitFrame * const frame);
+
+    void *memory_;
+    ExecutableChunk *chunk_; // The chunk "memory_" has been allocated from.
+public:
+    /** \throws std::runtime_error if no executable memory could be allocated. */
+    NativeCode(const uint8_t * const code, const size_t code_size);
+    ~NativeCode();
+    NativeCode(const NativeCode &rhs) = delete;
+    NativeCode &operator=(const NativeCode &rhs) = delete;
+
+    /** Executes the code, whose result will be in frame->stack_[0] if JitStatus::OK is returned. */
+    inline JitStatus run(JitFrame * const frame) const { return reinterpret_cast<EntryPoint>(memory_)(frame); }
+};
+
+
+/** \class JitCompiler
+ *  \brief Translates Programs to x86-64 machine code that produces bit for bit the same results as the Interpreter.
+ *
+ *  Every instruction is translated to a fixed sequence of machine instructions that operate on the stack slot its
+ *  operands had in the Interpreter, so neither instruction dispatch nor stack pointer updates remain.  Attribute
+ *  references and function calls go through the callbacks in the JitFrame.  Programs that contain string
+ *  operations, other than calls and pushing string constants, are not supported and have to be interpreted.
+ */
+class JitCompiler {
+public:
+    /** \return whether native code can be generated for the platform we're running on. */
+    static bool IsAvailable();
+
+    /** \return the native code for "program" or nullptr if the program uses unsupported instructions or
+     *          IsAvailable() returns false.
+     *  \note   The native code references the constant pool of "program" and must not be used after "program" has
+     *          been modified or destroyed.
+     */
+    static std::unique_ptr<NativeCode> Compile(const Program &program);
+};
+
+
+/** \class JitTier
+ *  \brief Counts the evaluations of a Program and holds its native code once it has been JIT compiled.
+ *
+ *  Copies start counting from scratch.  All member functions, except for assignment and reset(), may be called
+ *  concurrently.
+ */
+class JitTier {
+    mutable std::atomic<uint32_t> evaluation_count_;
+    mutable std::atomic<bool> compilation_started_;
+    mutable std::atomic<const NativeCode *> native_code_; // Owned.
+public:
+    JitTier(): evaluation_count_(0), compilation_started_(false), native_code_(nullptr) { }
+    JitTier(const JitTier &): JitTier() { }
+    ~JitTier() { delete native_code_.load(); }
+    JitTier &operator=(const JitTier &) { reset(); return *this; }
+
+    /** Discards the native code and the evaluation count. */
+    void reset();
+
+    /** \brief Counts an evaluation of "program" and compiles it once it has been evaluated "threshold" times.
+     *  \return the native code of "program" or nullptr if it should be interpreted.
+     */
+    const NativeCode *countEvaluation(const Program &program, const uint32_t threshold) const;
+};
+
+
+} // namespace Nyaa
+
+
+#endif // ifndef NYAA_JIT_COMPILER_H
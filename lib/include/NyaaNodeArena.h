@@ -0,0 +1,108 @@
+/** \file    NyaaNodeArena.h
+ *  \brief   Declaration of the NodeArena class, a bump-pointer allocator for parse-tree nodes.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef NYAA_NODE_ARENA_H
+#define NYAA_NODE_ARENA_H
+
+
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <cstddef>
+
+
+namespace Nyaa {
+
+
+/** \class NodeArena
+ *  \brief Owns all the nodes of a parse tree.
+ *
+ *  Objects are carved out of large blocks by bumping a pointer and are destroyed all at once by clear() or the
+ *  destructor, in the reverse order of their creation.  After clear() the largest block is retained, so that an arena
+ *  that is used for one compilation after another quickly stops allocating memory altogether.
+ */
+class NodeArena {
+    struct Block {
+        Block *next_;
+        size_t size_; // Usable bytes following the header.
+    };
+
+    struct Destructor {
+        void (*destroy_)(void *object);
+        void *object_;
+
+        Destructor(void (*destroy)(void *object), void * const object): destroy_(destroy), object_(object) { }
+    };
+
+    size_t min_block_size_;
+    Block *blocks_; // The current block, linked to the previously allocated ones.
+    char *next_free_, *block_end_;
+    std::vector<Destructor> destructors_;
+    size_t bytes_in_use_, peak_bytes_in_use_, block_bytes_;
+public:
+    static constexpr size_t DEFAULT_MIN_BLOCK_SIZE = 16384;
+
+    explicit NodeArena(const size_t min_block_size = DEFAULT_MIN_BLOCK_SIZE);
+    NodeArena(const NodeArena &rhs) = delete;
+    ~NodeArena();
+
+    NodeArena &operator=(const NodeArena &rhs) = delete;
+
+    /** \return a new "T" constructed from "args" that lives until the next call to clear(). */
+    template<typename T, typename... Args> T *create(Args&&... args) {
+        const bool needs_destructor(not std::is_trivially_destructible<T>::value);
+        if (needs_destructor)
+            destructors_.reserve(destructors_.size() + 1); // Must not fail after the object has been constructed.
+        T * const object(new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...));
+        if (needs_destructor)
+            destructors_.emplace_back(&Destroy<T>, object);
+        return object;
+    }
+
+    /** \return an uninitialised array of "count" elements, "T" must be trivially destructible. */
+    template<typename T> T *allocateArray(const size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "NodeArena::allocateArray: T needs a destructor!");
+        return static_cast<T *>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    /** Destroys all objects that have been created since the last call to clear(). */
+    void clear();
+
+    /** \return the number of bytes occupied by objects, excluding alignment padding and unused block space. */
+    inline size_t getBytesInUse() const { return bytes_in_use_; }
+
+    /** \return the maximum of getBytesInUse() over the lifetime of the arena. */
+    inline size_t getPeakBytesInUse() const { return peak_bytes_in_use_; }
+
+    /** \return the size of all blocks currently held by the arena. */
+    inline size_t getBlockBytes() const { return block_bytes_; }
+private:
+    void *allocate(const size_t size, const size_t alignment);
+    void addBlock(const size_t min_size);
+    template<typename T> static void Destroy(void * const object) { static_cast<T *>(object)->~T(); }
+};
+
+
+} // namespace Nyaa
+
+
+#endif // ifndef NYAA_NODE_ARENA_H
@@ -23,20 +23,25 @@
 #define NYAA_NODES_H
 
 
-#include <stack>
 #include <string>
 #include "NyaaFunction.h"
 #include "NyaaInstructions.h"
+#include "NyaaProgram.h"
 #include "NyaaToken.h"
 
 
 namespace Nyaa {
 
 
-// Forward declaration:
-class CodeAndSourceLocation;
+/** \return a textual representation of "node_type", e.g. "FLOAT" for NodeType::FLOAT_NODE. */
+std::string NodeTypeToString(const NodeType node_type);
 
 
+/** \class TreeNode
+ *  \brief Base class of all parse-tree nodes.
+ *  \note  Nodes do not own their children.  The nodes of a tree are normally created in a NodeArena, which owns
+ *         them, so subtrees may be shared between trees created in the same arena.
+ */
 class TreeNode {
 public:
     virtual ~TreeNode() { }
@@ -62,10 +67,10 @@ public:
      */
     virtual const TreeNode *getRightChild() const = 0;
 
-    /** Generates code for this node and pushes it onto the execution stack.
-     * \param code_stack the execution stack to push the generated code for this node.
+    /** Generates code for this node and appends it to a program.
+     * \param program  the program to which the generated code for this node will be appended.
      */
-    virtual void genCode(std::stack<CodeAndSourceLocation> * const code_stack) const = 0;
+    virtual void genCode(Program * const program) const = 0;
 };
 
 
@@ -94,7 +99,6 @@ class BinOpNode: public AbstractNode {
 public:
     BinOpNode(const size_t source_location, const Token &operator_type, const TreeNode * const lhs,
 	      const TreeNode * const rhs);
-    virtual ~BinOpNode() final { delete lhs_; delete rhs_;}
 
     inline virtual std::string toString() const final { return "BinOpNode: " + operator_.getStringRep(); }
 
@@ -106,7 +110,7 @@ public:
     /** \return the right operand */
     virtual inline const TreeNode *getRightChild() const final { return rhs_; }
 
-    virtual void genCode(std::stack<CodeAndSourceLocation> * const code_stack) const final;
+    virtual void genCode(Program * const program) const final;
 
     inline const Token &getOperator() const { return operator_; }
 private:
@@ -144,7 +148,8 @@ public:
 
     inline bool getValue() const { return value_; }
 
-    virtual void genCode(std::stack<CodeAndSourceLocation> * const code_stack) const final;
+    virtual inline void genCode(Program * const program) const final
+        { program->emit(Instruction::BPUSH, getSourceLocation(), value_); }
 };
 
 
@@ -173,7 +178,38 @@ public:
 
     inline double getValue() const { return value_; }
 
-    virtual void genCode(std::stack<CodeAndSourceLocation> * const code_stack) const final;
+    virtual inline void genCode(Program * const program) const final
+        { program->emit(Instruction::FPUSH, getSourceLocation(), program->getConstantPool().internFloat(value_)); }
+};
+
+
+/**
+ *  A node in the parse tree representing an integer constant.
+ */
+class IntConstantNode: public AbstractNode {
+    int64_t value_;
+public:
+    IntConstantNode(const size_t source_location, const int64_t value)
+        : AbstractNode(source_location), value_(value) { }
+
+    virtual inline std::string toString() const final { return "IntConstantNode: " + std::to_string(value_); }
+
+    virtual inline NodeType getType() const final { return NodeType::INT_NODE; }
+
+    /**
+     *  \return null, This type of node never has any children!
+     */
+    virtual inline const TreeNode *getLeftChild() const final { return nullptr; }
+
+    /**
+     *  \return null, This type of node never has any children!
+     */
+    virtual inline const TreeNode *getRightChild() const final { return nullptr; }
+
+    inline int64_t getValue() const { return value_; }
+
+    virtual inline void genCode(Program * const program) const final
+        { program->emit(Instruction::IPUSH, getSourceLocation(), program->getConstantPool().internInt(value_)); }
 };
 
 
@@ -183,13 +219,15 @@ public:
 class FuncCallNode: public AbstractNode {
     const Function &func_;
     NodeType return_type_;
-    std::vector<TreeNode *> args_;
+    const TreeNode * const *args_;
+    size_t arg_count_;
 public:
-    FuncCallNode(const size_t source_location, const Function &func, const NodeType return_type, const std::vector<TreeNode *> &args);
-    virtual ~FuncCallNode();
+    /** \note "args" has to outlive the node, typically it has been allocated in the same NodeArena. */
+    FuncCallNode(const size_t source_location, const Function &func, const NodeType return_type,
+                 const TreeNode * const * const args, const size_t arg_count);
 
     virtual inline std::string toString() const final {
-        return "FuncCallNode: call to " + func_.getName() + " with " + std::to_string(args_.size()) + " args";
+        return "FuncCallNode: call to " + func_.getName() + " with " + std::to_string(arg_count_) + " args";
     }
 
     virtual inline NodeType getType() const final { return return_type_; }
@@ -204,13 +242,22 @@ public:
      */
     virtual inline const TreeNode *getRightChild() const final { return nullptr; }
 
-    virtual void genCode(std::stack<CodeAndSourceLocation> * const code_stack) const final {
-        for (int i(args_.size() - 1); i >= 0; --i)
-            args_[i]->genCode(code_stack);
-        code_stack->push(CodeAndSourceLocation(args_.size(), -1));
-        code_stack->push(CodeAndSourceLocation(func_, -1));
-        code_stack->push(CodeAndSourceLocation(Instruction::CALL, getSourceLocation()));
-    }
+    inline const Function &getFunction() const { return func_; }
+    inline size_t getArgCount() const { return arg_count_; }
+    inline const TreeNode *getArg(const size_t arg_no) const { return args_[arg_no]; }
+
+    /** Generates the arguments in order, so that they end up in consecutive stack slots, the first one deepest.
+     *  Calls to functions that can be short-circuited are compiled to jumps instead and intrinsics to their
+     *  instructions.
+     */
+    virtual void genCode(Program * const program) const final;
+private:
+    void genConditionalCode(Program * const program) const;
+
+    /** \param short_circuit_jump  JUMP_IF_FALSE for AND, JUMP_IF_TRUE for OR. */
+    void genShortCircuitCode(const Instruction short_circuit_jump, Program * const program) const;
+
+    void genIntrinsicCode(const IntrinsicKind intrinsic_kind, Program * const program) const;
 };
 
 
@@ -219,11 +266,11 @@ public:
  */
 class IdentNode: public AbstractNode {
     const std::string attrib_name_;
-    const std::shared_ptr<AbstractNode> default_value_;
+    const AbstractNode * const default_value_;
     const NodeType type_;
 public:
-    IdentNode(const size_t source_location, const std::string &attrib_name,
-	      const std::shared_ptr<AbstractNode> default_value, const NodeType type)
+    IdentNode(const size_t source_location, const std::string &attrib_name, const AbstractNode * const default_value,
+              const NodeType type)
         : AbstractNode(source_location), attrib_name_(attrib_name), default_value_(default_value), type_(type)
     {
         if (type == NodeType::NULL_NODE)
@@ -249,14 +296,9 @@ public:
     inline const TreeNode *getRightChild() const final { return nullptr; }
 
     inline const std::string &getAttribName() const { return attrib_name_; }
-    inline const AbstractNode *getDefaultValue() const { return default_value_.get(); }
+    inline const AbstractNode *getDefaultValue() const { return default_value_; }
 
-    virtual void genCode(std::stack<CodeAndSourceLocation> * const code_stack) const final {
-        if (default_value_ != nullptr)
-            code_stack->push(CodeAndSourceLocation(default_value_, -1));
-        code_stack->push(CodeAndSourceLocation(attribName, -1));
-        code_stack->push(CodeAndSourceLocation(default_value_ == nullptr ? Instruction::AREF : Instruction::AREF2, getSourceLocation()));
-    }
+    virtual void genCode(Program * const program) const final;
 };
 
 
@@ -264,9 +306,9 @@ public:
  *  A node in the parse tree representing a conversion to a string
  */
 class SConvNode: public AbstractNode {
-    const std::shared_ptr<AbstractNode> convertee_;
+    const AbstractNode * const convertee_;
 public:
-    SConvNode(const std::shared_ptr<AbstractNode> convertee)
+    explicit SConvNode(const AbstractNode * const convertee)
         : AbstractNode(-1 /* Type conversions are generated by the compiler and do not correspond to actual source locations! */),
           convertee_(convertee)
     {
@@ -287,127 +329,86 @@ public:
     /**
      *  \return the only child of this node
      */
-    inline const TreeNode *getLeftChild() const final { return convertee_.get(); }
+    inline const TreeNode *getLeftChild() const final { return convertee_; }
 
     /**
      *  \return nullptr, This type of node never has any right children!
      */
     inline const TreeNode *getRightChild() const final { return nullptr; }
 
-    void genCode(std::stack<CodeAndSourceLocation> * const code_stack) const final {
-        convertee_->genCode(code_stack);
-
-        const NodeType type(convertee_->getType());
-        if (type == NodeType::FLOAT_NODE)
-            code_stack->push(CodeAndSourceLocation(Instruction::SCONVF, getSourceLocation()));
-        else if (type == NodeType::INT_NODE)
-            code_stack->push(CodeAndSourceLocation(Instruction::SCONVI, getSourceLocation()));
-        else if (type == NodeType::BOOLEAN_NODE)
-            code_stack->push(CodeAndSourceLocation(Instruction::SCONVB, getSourceLocation()));
-        else
-            throw std::range_error("unknown node type: " + type + ".");
-    }
+    void genCode(Program * const program) const final;
 };
 
 
 /**
  *  A node in the parse tree representing a unary operator application.
  */
-public class UnaryOpNode extends AbstractNode {
-    private final Token operator;
-    private final TreeNode operand;
-
-    public UnaryOpNode(final int sourceLocation, final Token operator, final TreeNode operand) {
-        super(sourceLocation);
-
+class UnaryOpNode: public AbstractNode {
+    const Token operator_;
+    const AbstractNode * const operand_;
+public:
+    UnaryOpNode(const size_t source_location, const Token &operator_type, const AbstractNode * const operand)
+        : AbstractNode(source_location), operator_(operator_type), operand_(operand)
+    {
         if (operand == nullptr)
-            throw new IllegalArgumentException("operand must not be nullptr.");
-
-        this.operator = operator;
-        this.operand = operand;
+            throw std::invalid_argument("in UnaryOpNode::UnaryOpNode: operand must not be nullptr.");
     }
 
-    public String toString() { return "UnaryOpNode: " + operator; }
+    virtual inline std::string toString() const final { return "UnaryOpNode: " + operator_.getStringRep(); }
 
-    inline NodeType getType() const final { return operand.getType(); }
+    inline NodeType getType() const final { return operand_->getType(); }
 
     /**
      *  \return the operand
      */
-    inline const TreeNode *getLeftChild() const final { return operand; }
+    inline const TreeNode *getLeftChild() const final { return operand_; }
 
     /**
-     *  \return nullptr, This type of node never has any left children!
+     *  \return nullptr, This type of node never has any right children!
      */
     inline const TreeNode *getRightChild() const final { return nullptr; }
 
-    public Token getOperator() { return operator; }
-
-    public void genCode(final Stack<CodeAndSourceLocation> code_stack) {
-        operand.genCode(code_stack);
-
-        switch (operator) {
-        case PLUS:
-            code_stack.push(new CodeAndSourceLocation(Instruction.FUPLUS, getSourceLocation()));
-            break;
-        case MINUS:
-            code_stack.push(new CodeAndSourceLocation(Instruction.FUMINUS, getSourceLocation()));
-            break;
-        default:
-            throw new IllegalStateException("invalid unary operation: " + operator + ".");
-        }
-    }
+    inline const Token &getOperator() const { return operator_; }
+
+    void genCode(Program * const program) const final;
 };
 
 
 /**
  *  A node in the parse tree representing a conversion to a floating point number
  */
-public class FConvNode extends AbstractNode {
-    private final TreeNode convertee;
-
-    public FConvNode(final TreeNode convertee) {
-        super(-1); // Type conversions are generated by the compiler and do not correspond to actual source locations!
-
+class FConvNode: public AbstractNode {
+    const AbstractNode * const convertee_;
+public:
+    explicit FConvNode(const AbstractNode * const convertee)
+        : AbstractNode(-1 /* Type conversions are generated by the compiler and do not correspond to actual source locations! */),
+          convertee_(convertee)
+    {
         if (convertee == nullptr)
-            throw new IllegalArgumentException("convertee must not be nullptr.");
-
-        final Class type = convertee.getType();
-        if (type != Long.class && type != Boolean.class && type != String.class)
-            throw new IllegalArgumentException("convertee must be of type Long, Boolean or String.");
+            throw std::invalid_argument("in FConvNode::FConvNode: convertee must not be nullptr.");
 
-        this.convertee = convertee;
+        const NodeType type(convertee_->getType());
+        if (type != NodeType::INT_NODE and type != NodeType::BOOLEAN_NODE and type != NodeType::STRING_NODE)
+            throw std::invalid_argument("in FConvNode::FConvNode: convertee must be of type INT, BOOLEAN, or STRING.");
     }
 
-    public String toString() {
-        return "FConvNode: convertee = " + convertee;
+    virtual inline std::string toString() const final {
+        return "FConvNode: convertee = " + convertee_->toString();
     }
 
-    inline NodeType getType() const final { return Double.class; }
+    inline NodeType getType() const final { return NodeType::FLOAT_NODE; }
 
     /**
      *  \return the only child of this node
      */
-    inline const TreeNode *getLeftChild() const final { return convertee; }
+    inline const TreeNode *getLeftChild() const final { return convertee_; }
 
     /**
      *  \return nullptr, This type of node never has any right children!
      */
     inline const TreeNode *getRightChild() const final { return nullptr; }
 
-    public void genCode(final Stack<CodeAndSourceLocation> code_stack) {
-        convertee.genCode(code_stack);
-
-        final Class type = convertee.getType();
-        if (type == Long.class)
-            code_stack.push(new CodeAndSourceLocation(Instruction.FCONVI, getSourceLocation()));
-        else if (type == Boolean.class)
-            code_stack.push(new CodeAndSourceLocation(Instruction.FCONVB, getSourceLocation()));
-        else if (type == String.class)
-            code_stack.push(new CodeAndSourceLocation(Instruction.FCONVS, getSourceLocation()));
-        else
-            throw new IllegalStateException("unknown type: " + type + ".");
-    }
+    void genCode(Program * const program) const final;
 };
 
 
@@ -436,9 +437,8 @@ public:
 
     inline const std::string &getValue() const { return value_; }
 
-    virtual inline void genCode(std::stack<CodeAndSourceLocation> * const code_stack) const final {
-        code_stack->push(CodeAndSourceLocation(value_, getSourceLocation()));
-    }
+    virtual inline void genCode(Program * const program) const final
+        { program->emit(Instruction::SPUSH, getSourceLocation(), program->getConstantPool().internString(value_)); }
 };
 
 
@@ -1,5 +1,5 @@
 /** \file    NyaaParser.h
- *  \brief   Interface of the parser for the Nyaa interpreter.
+ *  \brief   Declaration of the Parser class, which turns equations into parse trees.
  *  \author  Dr. Johannes Ruscheinski
  */
 
@@ -23,17 +23,117 @@
 #define NYAA_PARSER_H
 
 
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "NyaaFunctionRegistry.h"
+#include "NyaaNodeArena.h"
+#include "NyaaNodes.h"
+#include "NyaaTokenizer.h"
+
+
 namespace Nyaa {
 
-  
+
+/** \class Parser
+ *  \brief A recursive-descent parser for equations.
+ *
+ *  The grammar, in order of increasing precedence, is
+ *
+ *      equation       --> ["="] comparison EOS
+ *      comparison     --> concatenation { comp_op concatenation }
+ *      concatenation  --> sum { "&" sum }
+ *      sum            --> term { ("+" | "-") term }
+ *      term           --> power { ("*" | "/") power }
+ *      power          --> factor [ "^" power ]
+ *      factor         --> constant | attrib_ref | func_call | "(" comparison ")" | ("+" | "-") factor
+ *      attrib_ref     --> "$" ident | ["$"] "{" ident [ ":" default_value ] "}"
+ *      func_call      --> ident "(" [ comparison { "," comparison } ] ")"
+ *
+ *  The parser never looks more than one token ahead.  Type conversions are inserted where needed: integer operands
+ *  of arithmetic operators and numeric comparisons are converted to floating point and the operands of "&" to
+ *  strings.  Integer arguments of a function call are converted to floating point if the function doesn't accept
+ *  them as they are.
+ *
+ *  All nodes are allocated in an arena owned by the parser, so a parse tree remains valid until the next call to
+ *  parse() or clear().
+ *
+ *  The parser and the passes that operate on parse trees are recursive.  In order to bound their recursion depth,
+ *  equations may contain at most MAX_OPERATOR_COUNT operators and function calls and factors may be nested at most
+ *  MAX_NESTING_DEPTH levels deep, e.g. w/ parentheses.
+ */
 class Parser {
 public:
-    Parser();
+    typedef std::unordered_map<std::string, NodeType> AttribNameToTypeMap;
+    static constexpr unsigned MAX_NESTING_DEPTH = 256;
+    static constexpr size_t MAX_OPERATOR_COUNT = 4096;
+private:
+    const FunctionRegistry &function_registry_;
+    Tokenizer *tokenizer_;                                // Only valid during a call to parse().
+    const AttribNameToTypeMap *attrib_name_to_type_map_; // Only valid during a call to parse().
+    NodeArena node_arena_;
+    const AbstractNode *parse_tree_;
+    std::vector<const AbstractNode *> arg_stack_; // The arguments of the function calls being parsed.
+    std::set<std::string> attrib_references_;
+    std::string error_msg_;
+    unsigned nesting_depth_;  // Of the factor being parsed.
+    size_t operator_count_;   // Operators and function calls seen so far.
+public:
+    explicit Parser(const FunctionRegistry &function_registry)
+        : function_registry_(function_registry), tokenizer_(nullptr), attrib_name_to_type_map_(nullptr),
+          parse_tree_(nullptr), nesting_depth_(0), operator_count_(0) { }
+
+    /** \brief Parses "equation", which may only refer to attributes contained in "attrib_name_to_type_map".
+     *  \return true if "equation" was valid, else false, in which case getErrorMsg() tells what went wrong.
+     */
+    bool parse(const std::string &equation, const AttribNameToTypeMap &attrib_name_to_type_map);
+
+    /** \return a description of the error prefixed w/ its location, if the last call to parse() failed. */
+    inline const std::string &getErrorMsg() const { return error_msg_; }
+
+    /** \return the parse tree resulting from the last successful call to parse() or nullptr. */
+    inline const AbstractNode *getParseTree() const { return parse_tree_; }
+
+    /** \return the arena holding the nodes of the parse tree.  Nodes derived from the parse tree, e.g. by the
+     *          ConstantFolder, may be allocated here too and share its lifetime.
+     */
+    inline NodeArena &getNodeArena() { return node_arena_; }
+    inline const NodeArena &getNodeArena() const { return node_arena_; }
+
+    /** Releases the parse tree and all other nodes in the arena in one go. */
+    inline void clear() { parse_tree_ = nullptr; node_arena_.clear(); }
+
+    /** \return the type of the equation that has been parsed last. */
+    inline NodeType getType() const { return parse_tree_ == nullptr ? NodeType::NULL_NODE : parse_tree_->getType(); }
+
+    /** \return the names of the attributes referenced by the equation that has been parsed last. */
+    inline const std::set<std::string> &getAttribReferences() const { return attrib_references_; }
 private:
+    /** \return the next token. \throws std::runtime_error if the tokenizer encountered an error. */
+    Token nextToken();
+
+    /** \throws std::runtime_error if the equation has too many operators, counting the one at "source_location". */
+    void countOperator(const size_t source_location);
+
+    const AbstractNode *parseComparison();
+    const AbstractNode *parseConcatenation();
+    const AbstractNode *parseSum();
+    const AbstractNode *parseTerm();
+    const AbstractNode *parsePower();
+    const AbstractNode *parseFactor();
+
+    /** Gets called after the opening "{" or, if "in_braces" is false, the "$" of an attribute reference. */
+    const AbstractNode *parseAttribRef(const size_t source_location, const bool in_braces);
+
+    const AbstractNode *parseDefaultValue(const std::string &attrib_name, const NodeType attrib_type);
+
+    /** Gets called after the function name has been consumed. */
+    const AbstractNode *parseFunctionCall(const size_t source_location, const std::string &function_name);
 };
 
 
 } // namespace Nyaa
 
 
-#endif // fndef NYAA_PARSER_H
+#endif // ifndef NYAA_PARSER_H
@@ -0,0 +1,80 @@
+/** \file    NyaaPeepholeOptimizer.h
+ *  \brief   Declaration of the PeepholeOptimizer class, an optimisation pass over programs.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef NYAA_PEEPHOLE_OPTIMIZER_H
+#define NYAA_PEEPHOLE_OPTIMIZER_H
+
+
+#include <vector>
+#include <cinttypes>
+#include "NyaaProgram.h"
+
+
+namespace Nyaa {
+
+
+/** \class PeepholeOptimizer
+ *  \brief Replaces common sequences of adjacent instructions w/ fused superinstructions, so that fewer instructions
+ *         have to be dispatched per evaluation.
+ *
+ *  The sequences are:
+ *  - AREF of an integer attribute followed by FCONVI, e.g. an integer attribute in floating-point arithmetic, becomes
+ *    FAREFI.
+ *  - FPUSH/IPUSH, AREF and a float/integer comparison, i.e. a comparison of an attribute w/ a constant as in threshold
+ *    filters, becomes one of the B??FAC and B??IAC instructions.  If the attribute is the right operand, the
+ *    comparison is mirrored.
+ *  - SCONVF/SCONVI/SCONVB followed by SCONCAT, i.e. a number or boolean on the left of an "&", becomes SCONCATF,
+ *    SCONCATI or SCONCATB.
+ *
+ *  Sequences that span a jump target are left alone and jumps are retargeted to the rewritten code.  The pass has to
+ *  run after the CommonSubexpressionEliminator, which doesn't know about the fused instructions.
+ */
+class PeepholeOptimizer {
+    std::vector<CodeAndSourceLocation> code_;
+    std::vector<uint8_t> is_jump_target_;                  // Indexed by address, including the one past the end.
+    std::vector<uint32_t> first_jump_to_, next_jump_;      // Unpatched jumps per original target address.
+    size_t saved_instruction_count_;
+public:
+    PeepholeOptimizer(): saved_instruction_count_(0) { }
+
+    /** Rewrites the code of "*program". */
+    void optimize(Program * const program);
+
+    /** \return the number of instructions the last call to optimize() got rid of. */
+    inline size_t getSavedInstructionCount() const { return saved_instruction_count_; }
+private:
+    /** \return whether the "length" instructions starting at "address" may be replaced. */
+    bool canFuse(const uint32_t address, const unsigned length) const;
+
+    /** \return the number of instructions starting at "address" that have been replaced by a superinstruction or 0
+     *          if none have been.
+     */
+    unsigned emitFused(const uint32_t address, Program * const program) const;
+
+    void addPendingJump(const uint32_t original_target, const uint32_t new_jump_address);
+    void patchJumpsTo(const uint32_t address, Program * const program);
+};
+
+
+} // namespace Nyaa
+
+
+#endif // ifndef NYAA_PEEPHOLE_OPTIMIZER_H
@@ -0,0 +1,143 @@
+/** \file    NyaaProgram.h
+ *  \brief   Declaration of the Program class, the container for compiled Nyaa code.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef NYAA_PROGRAM_H
+#define NYAA_PROGRAM_H
+
+
+#include <vector>
+#include <cinttypes>
+#include "NyaaCodeAndSourceLocation.h"
+#include "NyaaConstantPool.h"
+#include "NyaaJitCompiler.h"
+
+
+namespace Nyaa {
+
+
+/** \class Program
+ *  \brief A compiled equation.
+ *
+ *  The code is a single contiguous array of fixed-size instructions in execution order, i.e. an interpreter can
+ *  walk it linearly from front to back.  Operands that do not fit into an instruction are stored in the program's
+ *  constant pool and referenced by index.
+ *
+ *  Operand conventions:
+ *  - FPUSH, IPUSH, SPUSH: operand is the index of the constant in the pool.
+ *  - BPUSH: operand is the constant itself, 0 or 1.
+ *  - AREF: operand is the index of the attribute reference in the pool.
+ *  - AREF2: like AREF, operand2 is the default value, encoded like the operand of the ?PUSH instruction for the
+ *    attribute's type.
+ *  - FAREFI: like AREF.
+ *  - B??FAC, B??IAC: operand is the index of the attribute reference, which is the left operand, operand2 the index
+ *    of the constant in the pool.
+ *  - CALL: operand is the index of the call site in the pool, operand2 the argument count.  The first argument is
+ *    the deepest on the stack and gets replaced by the result.
+ *  - CALLF: like CALL, for call sites that have a fast path.
+ *  - STORE, LOAD: operand is the index of the local variable, operand2 the NodeType of its value.
+ *  - JUMP, JUMP_IF_FALSE, JUMP_IF_TRUE: operand is the address of the target, which always lies after the jump and
+ *    may be the address just past the end of the code.  The conditional jumps pop their condition whether they jump
+ *    or not.  JUMP's operand2 is the NodeType of the value on top of the stack, which the target expects.
+ *
+ *  Jumps only occur in code for conditional expressions.  Code that lies between a jump and its target never
+ *  modifies the stack slots below the stack depth at the target, except for the topmost one in the case of JUMP,
+ *  i.e. it only works on values of its own.
+ */
+class Program {
+    std::vector<CodeAndSourceLocation> code_;
+    ConstantPool constant_pool_;
+    NodeType result_type_;
+    unsigned stack_depth_, max_stack_depth_;
+    unsigned local_count_;
+    JitTier jit_tier_;
+public:
+    typedef std::vector<CodeAndSourceLocation>::const_iterator const_iterator;
+public:
+    Program(): result_type_(NodeType::NULL_NODE), stack_depth_(0), max_stack_depth_(0), local_count_(0) { }
+
+    /** \brief Removes all code and operands.
+     *  \note  The allocated storage is retained, so that a Program can be reused for generating code over and over
+     *         again without reallocating.
+     */
+    void clear();
+
+    /** Removes the code and the local variables but retains the constant pool and the result type, e.g. to allow an
+     *  optimisation pass to re-emit the code.
+     */
+    void clearCode();
+
+    /** Appends an instruction to the end of the code and keeps track of the required operand stack size. */
+    void emit(const Instruction instruction, const size_t source_location, const uint32_t operand = 0,
+              const uint32_t operand2 = 0);
+
+    /** \brief  Appends a jump whose target is not known yet.
+     *  \param  carried_type  For JUMP, the type of the value on top of the stack.
+     *  \return the address of the jump, which has to be passed to patchJump() once the target is known.
+     */
+    uint32_t emitJump(const Instruction jump, const size_t source_location,
+                      const NodeType carried_type = NodeType::NULL_NODE);
+
+    /** Makes the jump at "jump_address" target the next instruction that will be emitted. */
+    void patchJump(const uint32_t jump_address);
+
+    /** Records the type of the value that is left on the stack after executing the code. */
+    inline void setResultType(const NodeType result_type) { result_type_ = result_type; }
+    inline NodeType getResultType() const { return result_type_; }
+
+    /** \return the maximum number of values that will be on the operand stack while the code is executed. */
+    inline unsigned getMaxStackDepth() const { return max_stack_depth_; }
+
+    /** \return the index of a new local variable for use w/ STORE and LOAD. */
+    inline uint32_t allocateLocal() { return local_count_++; }
+    inline unsigned getLocalCount() const { return local_count_; }
+
+    inline ConstantPool &getConstantPool() { return constant_pool_; }
+    inline const ConstantPool &getConstantPool() const { return constant_pool_; }
+
+    /** \return the evaluation count and native code of the program, see Interpreter. */
+    inline const JitTier &getJitTier() const { return jit_tier_; }
+
+    inline size_t size() const { return code_.size(); }
+    inline bool empty() const { return code_.empty(); }
+    inline const CodeAndSourceLocation &operator[](const size_t index) const { return code_[index]; }
+    inline const CodeAndSourceLocation *data() const { return code_.data(); }
+    inline const_iterator begin() const { return code_.cbegin(); }
+    inline const_iterator end() const { return code_.cend(); }
+};
+
+
+/** \return the number of values "instruction" pops off the operand stack.  Every instruction, except for the jumps,
+ *          pushes a single value.
+ *  \param  operand2  The instruction's second operand, which is only relevant for CALL.
+ */
+unsigned GetOperandCount(const Instruction instruction, const uint32_t operand2);
+
+
+inline bool IsJump(const Instruction instruction) {
+    return instruction == Instruction::JUMP or instruction == Instruction::JUMP_IF_FALSE
+           or instruction == Instruction::JUMP_IF_TRUE;
+}
+
+
+} // namespace Nyaa
+
+
+#endif // ifndef NYAA_PROGRAM_H
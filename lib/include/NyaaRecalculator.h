@@ -0,0 +1,116 @@
+/** \file    NyaaRecalculator.h
+ *  \brief   Declaration of the Recalculator class, which keeps the computed columns of a DependencyGraph up to date.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef NYAA_RECALCULATOR_H
+#define NYAA_RECALCULATOR_H
+
+
+#include <string>
+#include <vector>
+#include "NyaaBatchEvaluator.h"
+#include "NyaaColumn.h"
+#include "NyaaDagScheduler.h"
+#include "NyaaDependencyGraph.h"
+#include "NyaaInterpreter.h"
+
+
+namespace Nyaa {
+
+
+/** \class Recalculator
+ *  \brief Evaluates the columns of a DependencyGraph over a table of base columns and incrementally re-evaluates
+ *         them after changes.
+ *
+ *  Computed columns are made available to the columns downstream under their names.  Rows for which a column could
+ *  not be computed are treated as missing by the columns that read it.  The base columns are held as views, so after
+ *  changing base values in place only the recalculate*() function matching the extent of the change has to be
+ *  called.  If the graph or the number of rows changes, recalculateAll() has to be called again.
+ *
+ *  Whole columns are evaluated on a DagScheduler.  As equations only ever refer to values in the same row, a column
+ *  is split into tasks of ROWS_PER_TASK rows, each of which only has to wait for the same rows of the columns it
+ *  depends on.  Therefore independent columns as well as the rows of a single column can be evaluated in parallel.
+ */
+class Recalculator {
+public:
+    static constexpr size_t ROWS_PER_TASK = 16 * BatchEvaluator::CHUNK_SIZE;
+
+    struct Statistics {
+        std::vector<double> column_seconds_; // Indexed by column index, 0 for columns that were not recalculated.
+        double wall_seconds_;
+        double critical_path_seconds_;       // The lower bound for "wall_seconds_" w/ an unlimited number of threads.
+    };
+private:
+    const DependencyGraph &graph_;
+    std::vector<ResultColumn> results_; // Indexed by column index.
+    ColumnMap columns_;                 // The base columns and views of "results_".
+    size_t row_count_;
+    DagScheduler scheduler_;
+    std::vector<BatchEvaluator> batch_evaluators_; // One per scheduler thread.
+    Interpreter interpreter_;
+    TaskGraph task_graph_;
+    Statistics statistics_;
+public:
+    /** \param graph         Has to outlive the Recalculator.
+     *  \param thread_count  The maximum number of threads to use for evaluating whole columns, 0 means one per
+     *                       hardware thread.
+     */
+    explicit Recalculator(const DependencyGraph &graph, const unsigned thread_count = 0);
+
+    /** \brief Evaluates all computed columns for the rows [0, row_count) of "base_columns".
+     *  \throws std::invalid_argument if a base column has the name of a computed column or, like
+     *          BatchEvaluator::evaluate(), if a column is missing, has the wrong type or too few rows.
+     *  \throws std::logic_error if the graph has not been resolved.
+     */
+    void recalculateAll(const ColumnMap &base_columns, const size_t row_count);
+
+    /** \brief Re-evaluates the columns affected by changes to the attributes named by "changed_attrib_names" for all
+     *         rows.
+     *  \return the number of columns that have been re-evaluated.
+     */
+    size_t recalculateColumns(const std::vector<std::string> &changed_attrib_names);
+
+    /** \brief Re-evaluates the columns affected by changes to the attributes named by "changed_attrib_names" but only
+     *         for "rows".
+     *  \return the number of columns that have been re-evaluated.
+     *  \note   The rows are evaluated on the calling thread and are not reflected in getStatistics().
+     */
+    size_t recalculateRows(const std::vector<std::string> &changed_attrib_names, const std::vector<size_t> &rows);
+
+    inline size_t getRowCount() const { return row_count_; }
+    inline unsigned getThreadCount() const { return scheduler_.getThreadCount(); }
+    inline const ResultColumn &getResult(const size_t column_index) const { return results_[column_index]; }
+
+    /** \throws std::out_of_range if there is no computed column named "column_name". */
+    const ResultColumn &getResult(const std::string &column_name) const;
+
+    /** \return the timings of the last call to recalculateAll() or recalculateColumns(). */
+    inline const Statistics &getStatistics() const { return statistics_; }
+private:
+    /** Evaluates "column_indices", which have to be in evaluation order, for all rows. */
+    void evaluateColumns(const std::vector<size_t> &column_indices);
+    void recalculateCell(const size_t column_index, const size_t row);
+};
+
+
+} // namespace Nyaa
+
+
+#endif // ifndef NYAA_RECALCULATOR_H
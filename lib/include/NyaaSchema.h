@@ -0,0 +1,109 @@
+/** \file    NyaaSchema.h
+ *  \brief   Declaration of the Schema and Binding classes, which map attribute names to slots.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef NYAA_SCHEMA_H
+#define NYAA_SCHEMA_H
+
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cinttypes>
+#include "NyaaFunction.h"
+#include "NyaaParser.h"
+#include "NyaaProgram.h"
+
+
+namespace Nyaa {
+
+
+/** \class Schema
+ *  \brief The attributes of a table.  Every attribute has a type and a slot, i.e. its index in the order in which
+ *         the attributes have been added.
+ */
+class Schema {
+    struct Attribute {
+        std::string name_;
+        NodeType type_;
+
+        Attribute(const std::string &name, const NodeType type): name_(name), type_(type) { }
+    };
+
+    std::vector<Attribute> attributes_;
+    std::unordered_map<std::string, uint32_t> name_to_slot_map_;
+    Parser::AttribNameToTypeMap attrib_name_to_type_map_;
+    uint64_t version_; // Changes whenever an attribute is added.
+public:
+    Schema(): version_(0) { }
+
+    /** \return the slot of the new attribute.
+     *  \throws std::invalid_argument if there already is an attribute named "name" or "type" is NULL_NODE.
+     */
+    uint32_t addAttribute(const std::string &name, const NodeType type);
+
+    /** \return true if an attribute named "name" exists, in which case its slot will be stored in "*slot". */
+    bool lookup(const std::string &name, uint32_t * const slot) const;
+
+    inline size_t size() const { return attributes_.size(); }
+    inline const std::string &getName(const uint32_t slot) const { return attributes_[slot].name_; }
+    inline NodeType getType(const uint32_t slot) const { return attributes_[slot].type_; }
+    inline uint64_t getVersion() const { return version_; }
+
+    /** \return the attributes in the form the Parser and the Compiler expect. */
+    inline const Parser::AttribNameToTypeMap &getAttribNameToTypeMap() const { return attrib_name_to_type_map_; }
+};
+
+
+/** \class Binding
+ *  \brief Maps the attribute references of a Program to the slots of a Schema.
+ *
+ *  Programs don't know about schemas, so that the same program can be shared by tables w/ different layouts, e.g.
+ *  through the EquationCache.  A Binding has to be created once per program and schema and remains valid for as long
+ *  as neither of them changes.
+ */
+class Binding {
+    const Program *program_;
+    const Schema *schema_;
+    uint64_t schema_version_;
+    std::vector<uint32_t> slots_; // Indexed by attribute reference index.
+public:
+    /** \throws std::invalid_argument if "program" references an attribute that is missing from "schema" or has a
+     *          different type there.
+     */
+    Binding(const Program &program, const Schema &schema);
+
+    /** \return true if the Binding has been created for "program" and "schema" and "schema" has not been modified
+     *          since.
+     */
+    inline bool isValidFor(const Program &program, const Schema &schema) const
+        { return &program == program_ and &schema == schema_ and schema.getVersion() == schema_version_; }
+
+    inline uint32_t getSlot(const uint32_t attrib_ref_index) const { return slots_[attrib_ref_index]; }
+    inline size_t size() const { return slots_.size(); }
+    inline const Program &getProgram() const { return *program_; }
+    inline const Schema &getSchema() const { return *schema_; }
+};
+
+
+} // namespace Nyaa
+
+
+#endif // ifndef NYAA_SCHEMA_H
@@ -0,0 +1,111 @@
+/** \file    NyaaSimdKernels.h
+ *  \brief   Explicitly vectorised kernels for the data-parallel instructions of batch evaluation.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef NYAA_SIMD_KERNELS_H
+#define NYAA_SIMD_KERNELS_H
+
+
+#include <string>
+#include <cinttypes>
+#include <cstddef>
+
+
+namespace Nyaa {
+
+
+/** Instruction set extensions for which kernels exist, in increasing order of vector width. */
+enum class SimdLevel { SCALAR, SSE2, AVX2, AVX512 };
+
+
+/** \return the widest instruction set extension supported by the CPU we're running on.
+ *  \note   The CPU is only queried on the first call.
+ */
+SimdLevel GetSimdLevel();
+
+
+std::string SimdLevelToString(const SimdLevel simd_level);
+
+
+/** Boolean vectors are packed, the value for row i being bit i % 64 of word i / 64. */
+inline size_t MaskWordCount(const size_t row_count) { return (row_count + 63) / 64; }
+inline bool GetMaskBit(const uint64_t * const mask, const size_t row) { return (mask[row / 64] >> (row % 64)) & 1u; }
+inline void SetMaskBit(uint64_t * const mask, const size_t row, const bool value) {
+    const uint64_t bit(uint64_t(1) << (row % 64));
+    if (value)
+        mask[row / 64] |= bit;
+    else
+        mask[row / 64] &= ~bit;
+}
+
+
+/** Kernels for the binary operators.  Like their instructions they compute "lhs op rhs" for "count" rows. */
+typedef void (*FloatArithmeticKernel)(double * const rhs_and_result, const double * const lhs, const size_t count);
+/** Also flags the rows whose results overflowed in "overflow_mask", which is packed like a boolean vector. */
+typedef void (*IntArithmeticKernel)(int64_t * const rhs_and_result, const int64_t * const lhs,
+                                    uint64_t * const overflow_mask, const size_t count);
+typedef void (*FloatComparisonKernel)(uint64_t * const result_mask, const double * const lhs,
+                                      const double * const rhs, const size_t count);
+typedef void (*IntComparisonKernel)(uint64_t * const result_mask, const int64_t * const lhs,
+                                    const int64_t * const rhs, const size_t count);
+
+
+/** \class SimdKernels
+ *  \brief The kernels for one SimdLevel.
+ */
+class SimdKernels {
+public:
+    enum ArithmeticOp { ADD, SUB, MUL, DIV, ARITHMETIC_OP_COUNT };
+    enum ComparisonOp {
+        EQUAL, NOT_EQUAL, GREATER_THAN, LESS_THAN, GREATER_OR_EQUAL, LESS_OR_EQUAL, COMPARISON_OP_COUNT
+    };
+private:
+    SimdLevel simd_level_;
+    FloatArithmeticKernel float_arithmetic_kernels_[ARITHMETIC_OP_COUNT];
+    IntArithmeticKernel int_arithmetic_kernels_[ARITHMETIC_OP_COUNT];
+    FloatComparisonKernel float_comparison_kernels_[COMPARISON_OP_COUNT];
+    IntComparisonKernel int_comparison_kernels_[COMPARISON_OP_COUNT];
+public:
+    /** \throws std::invalid_argument if "simd_level" exceeds GetSimdLevel(). */
+    explicit SimdKernels(const SimdLevel simd_level);
+
+    inline SimdLevel getSimdLevel() const { return simd_level_; }
+    inline FloatArithmeticKernel getFloatArithmeticKernel(const ArithmeticOp op) const
+        { return float_arithmetic_kernels_[op]; }
+
+    /** \return the kernel for "op" or nullptr for DIV.  (Integer division has to check every row for a zero divisor
+     *          anyway.)
+     */
+    inline IntArithmeticKernel getIntArithmeticKernel(const ArithmeticOp op) const
+        { return int_arithmetic_kernels_[op]; }
+    inline FloatComparisonKernel getFloatComparisonKernel(const ComparisonOp op) const
+        { return float_comparison_kernels_[op]; }
+    inline IntComparisonKernel getIntComparisonKernel(const ComparisonOp op) const
+        { return int_comparison_kernels_[op]; }
+
+    /** \return the kernels for GetSimdLevel(). */
+    static const SimdKernels &GetBest();
+};
+
+
+} // namespace Nyaa
+
+
+#endif // ifndef NYAA_SIMD_KERNELS_H
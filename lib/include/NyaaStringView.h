@@ -0,0 +1,64 @@
+/** \file    NyaaStringView.h
+ *  \brief   Declaration of the StringView class, a non-owning reference to a sequence of characters.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef NYAA_STRING_VIEW_H
+#define NYAA_STRING_VIEW_H
+
+
+#include <string>
+#include <cstddef>
+#include <cstring>
+
+
+namespace Nyaa {
+
+
+/** \class StringView
+ *  \brief A pointer and a length.  The referenced characters must outlive the view.
+ *  \note  We can't use std::string_view as we have to support C++11.
+ */
+class StringView {
+    const char *data_;
+    size_t size_;
+public:
+    StringView(): data_(""), size_(0) { }
+    StringView(const char * const data, const size_t size): data_(data), size_(size) { }
+    explicit StringView(const std::string &s): data_(s.data()), size_(s.size()) { }
+
+    inline const char *data() const { return data_; }
+    inline size_t size() const { return size_; }
+    inline bool empty() const { return size_ == 0; }
+    inline const char *begin() const { return data_; }
+    inline const char *end() const { return data_ + size_; }
+    inline char operator[](const size_t index) const { return data_[index]; }
+
+    inline std::string toString() const { return std::string(data_, size_); }
+
+    inline bool operator==(const StringView &rhs) const
+        { return size_ == rhs.size_ and std::memcmp(data_, rhs.data_, size_) == 0; }
+    inline bool operator!=(const StringView &rhs) const { return not operator==(rhs); }
+};
+
+
+} // namespace Nyaa
+
+
+#endif // ifndef NYAA_STRING_VIEW_H
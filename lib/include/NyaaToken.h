@@ -24,13 +24,14 @@
 
 
 #include <string>
+#include <cstddef>
 
 
 namespace Nyaa {
 
 
 enum class TokenType {
-    STRING_CONSTANT, FLOAT_CONSTANT, BOOLEAN_CONSTANT, IDENTIFIER, OPEN_BRACE, CLOSE_BRACE,
+    STRING_CONSTANT, FLOAT_CONSTANT, INT_CONSTANT, BOOLEAN_CONSTANT, IDENTIFIER, OPEN_BRACE, CLOSE_BRACE,
     OPEN_PAREN, CLOSE_PAREN, COLON, CARET, PLUS, MINUS, DIV, MUL, EQUAL, NOT_EQUAL, GREATER_THAN,
     LESS_THAN, GREATER_OR_EQUAL, LESS_OR_EQUAL, DOLLAR, COMMA, AMPERSAND, EOS, ERROR, NULL_TOKEN
 };
@@ -39,55 +40,74 @@ enum class TokenType {
 enum class OpType { NONE, COMP_OP, ARITH_OP, STRING_OP };
 
 
+/** \class Token
+ *  \brief A token type and, for tokens returned by the Tokenizer, the extent of the token in the source.
+ *  \note  Tokens don't own any memory and are cheap to copy.
+ */
 class Token {
 public:
-    static const std::string NO_STRING_REP;
+    static constexpr const char *NO_STRING_REP = "?";
 private:
     TokenType token_type_;
-    std::string string_rep_; // The sting representation.
+    const char *string_rep_; // The string representation.
     OpType op_type_;
+    size_t offset_, length_;
 public:
-    inline Token(const TokenType token_type, const std::string &string_rep, const OpType op_type)
-        : token_type_(token_type), string_rep_(string_rep), op_type_(op_type) { }
+    constexpr Token(const TokenType token_type, const char * const string_rep, const OpType op_type,
+                    const size_t offset = 0, const size_t length = 0)
+        : token_type_(token_type), string_rep_(string_rep), op_type_(op_type), offset_(offset), length_(length) { }
     Token(const Token &other) = default;
 
-    inline bool operator=(const Token &rhs) { return token_type_ == rhs.token_type_; }
-    inline bool operator!=(const Token &rhs) { return token_type_ != rhs.token_type_; }
+    Token &operator=(const Token &rhs) = default;
+    inline bool operator==(const Token &rhs) const { return token_type_ == rhs.token_type_; }
+    inline bool operator!=(const Token &rhs) const { return token_type_ != rhs.token_type_; }
     inline TokenType getType() const { return token_type_; }
     inline bool isCompOp() const { return op_type_ == OpType::COMP_OP; }
     inline bool isArithOp() const { return op_type_ == OpType::ARITH_OP; }
     inline bool isStringOp() const { return op_type_ == OpType::STRING_OP; }
     inline std::string getStringRep() const { return string_rep_; }
+
+    /** \return the position of the first character of the token in the source. */
+    inline size_t getOffset() const { return offset_; }
+
+    /** \return the number of characters of the source the token has been scanned from. */
+    inline size_t getLength() const { return length_; }
+
+    /** \return a copy of this token that covers "length" characters of the source starting at "offset". */
+    inline Token withExtent(const size_t offset, const size_t length) const
+        { return Token(token_type_, string_rep_, op_type_, offset, length); }
+
     Token &swap(Token &other);
 };
 
 
-const Token STRING_CONSTANT(TokenType::STRING_CONSTANT, Token::NO_STRING_REP, OpType::NONE);
-const Token FLOAT_CONSTANT(TokenType::FLOAT_CONSTANT, Token::NO_STRING_REP, OpType::NONE);
-const Token BOOLEAN_CONSTANT(TokenType::BOOLEAN_CONSTANT, Token::NO_STRING_REP, OpType::NONE);
-const Token IDENTIFIER(TokenType::IDENTIFIER, Token::NO_STRING_REP, OpType::NONE);
-const Token OPEN_BRACE(TokenType::OPEN_BRACE, "{", OpType::NONE);
-const Token CLOSE_BRACE(TokenType::CLOSE_BRACE, "}", OpType::NONE);
-const Token OPEN_PAREN(TokenType::OPEN_PAREN, "(", OpType::NONE);
-const Token CLOSE_PAREN(TokenType::CLOSE_PAREN, ")", OpType::NONE);
-const Token COLON(TokenType::COLON, ":", OpType::NONE);
-const Token CARET(TokenType::CARET, "^", OpType::ARITH_OP);
-const Token PLUS(TokenType::PLUS, "+", OpType::ARITH_OP);
-const Token MINUS(TokenType::MINUS, "-", OpType::ARITH_OP);
-const Token DIV(TokenType::DIV, "/", OpType::ARITH_OP);
-const Token MUL(TokenType::MUL, "*", OpType::ARITH_OP);
-const Token EQUAL(TokenType::EQUAL, "=", OpType::COMP_OP);
-const Token NOT_EQUAL(TokenType::NOT_EQUAL, "<>", OpType::COMP_OP);
-const Token GREATER_THAN(TokenType::GREATER_THAN, ">", OpType::COMP_OP);
-const Token LESS_THAN(TokenType::LESS_THAN, "<", OpType::COMP_OP);
-const Token GREATER_OR_EQUAL(TokenType::GREATER_OR_EQUAL, ">=", OpType::COMP_OP);
-const Token LESS_OR_EQUAL(TokenType::LESS_OR_EQUAL, "<=", OpType::COMP_OP);
-const Token DOLLAR(TokenType::DOLLAR, "$", OpType::NONE);
-const Token COMMA(TokenType::COMMA, ",", OpType::NONE);
-const Token AMPERSAND(TokenType::AMPERSAND, "&", OpType::NONE);
-const Token EOS(TokenType::EOS, Token::NO_STRING_REP, OpType::NONE);
-const Token ERROR(TokenType::ERROR, Token::NO_STRING_REP, OpType::NONE);
-const Token NULL_TOKEN(TokenType::NULL_TOKEN, Token::NO_STRING_REP, OpType::NONE);
+constexpr Token STRING_CONSTANT(TokenType::STRING_CONSTANT, Token::NO_STRING_REP, OpType::NONE);
+constexpr Token FLOAT_CONSTANT(TokenType::FLOAT_CONSTANT, Token::NO_STRING_REP, OpType::NONE);
+constexpr Token INT_CONSTANT(TokenType::INT_CONSTANT, Token::NO_STRING_REP, OpType::NONE);
+constexpr Token BOOLEAN_CONSTANT(TokenType::BOOLEAN_CONSTANT, Token::NO_STRING_REP, OpType::NONE);
+constexpr Token IDENTIFIER(TokenType::IDENTIFIER, Token::NO_STRING_REP, OpType::NONE);
+constexpr Token OPEN_BRACE(TokenType::OPEN_BRACE, "{", OpType::NONE);
+constexpr Token CLOSE_BRACE(TokenType::CLOSE_BRACE, "}", OpType::NONE);
+constexpr Token OPEN_PAREN(TokenType::OPEN_PAREN, "(", OpType::NONE);
+constexpr Token CLOSE_PAREN(TokenType::CLOSE_PAREN, ")", OpType::NONE);
+constexpr Token COLON(TokenType::COLON, ":", OpType::NONE);
+constexpr Token CARET(TokenType::CARET, "^", OpType::ARITH_OP);
+constexpr Token PLUS(TokenType::PLUS, "+", OpType::ARITH_OP);
+constexpr Token MINUS(TokenType::MINUS, "-", OpType::ARITH_OP);
+constexpr Token DIV(TokenType::DIV, "/", OpType::ARITH_OP);
+constexpr Token MUL(TokenType::MUL, "*", OpType::ARITH_OP);
+constexpr Token EQUAL(TokenType::EQUAL, "=", OpType::COMP_OP);
+constexpr Token NOT_EQUAL(TokenType::NOT_EQUAL, "<>", OpType::COMP_OP);
+constexpr Token GREATER_THAN(TokenType::GREATER_THAN, ">", OpType::COMP_OP);
+constexpr Token LESS_THAN(TokenType::LESS_THAN, "<", OpType::COMP_OP);
+constexpr Token GREATER_OR_EQUAL(TokenType::GREATER_OR_EQUAL, ">=", OpType::COMP_OP);
+constexpr Token LESS_OR_EQUAL(TokenType::LESS_OR_EQUAL, "<=", OpType::COMP_OP);
+constexpr Token DOLLAR(TokenType::DOLLAR, "$", OpType::NONE);
+constexpr Token COMMA(TokenType::COMMA, ",", OpType::NONE);
+constexpr Token AMPERSAND(TokenType::AMPERSAND, "&", OpType::NONE);
+constexpr Token EOS(TokenType::EOS, Token::NO_STRING_REP, OpType::NONE);
+constexpr Token ERROR(TokenType::ERROR, Token::NO_STRING_REP, OpType::NONE);
+constexpr Token NULL_TOKEN(TokenType::NULL_TOKEN, Token::NO_STRING_REP, OpType::NONE);
 
 
 } // namespace Nyaa
@@ -24,6 +24,8 @@
 
 
 #include <string>
+#include <cinttypes>
+#include "NyaaStringView.h"
 #include "NyaaToken.h"
 
 
@@ -32,42 +34,60 @@ namespace Nyaa {
 
 /** \class NyaaTokenizer
   * \brief Generates a token stream for the parser.
+  *
+  * Tokens know their extent in the source and identifiers and string constants are views into the source, so no
+  * memory gets allocated unless an identifier or a string constant contains backslash escapes.
   */
 class Tokenizer {
     const std::string &source_;
     Token previous_token_;
-    size_t current_pos_, previous_current_pos_;
-    bool identifier_in_braces_, previous_identifier_in_braces_;
-    std::string::const_iterator ch_, previous_ch_;
-    std::string::const_iterator token_start_pos_, previous_token_start_pos_;
-    std::string string_constant_, previous_string_constant_;
-    double float_constant_, previous_float_constant_;
-    bool boolean_constant_, previous_boolean_constant_;
-    long int_constant_, previous_int_constant_;
-    std::string identifier_, previous_identifier_;
+    bool identifier_in_braces_;
+    std::string::const_iterator ch_;
+    std::string::const_iterator token_start_pos_;
+    StringView string_constant_;
+    std::string string_constant_buffer_; // Only used for string constants w/ escapes.
+    double float_constant_;
+    bool boolean_constant_;
+    int64_t int_constant_;
+    StringView identifier_;
+    std::string identifier_buffer_; // Only used for identifiers w/ escapes.
     std::string error_msg_;
 public:
     explicit Tokenizer(const std::string &source)
-        : source_(source), previous_token_(NULL_TOKEN), current_pos_(-1),
-          identifier_in_braces_(false), ch_(source_.cbegin()) { }
+        : source_(source), previous_token_(NULL_TOKEN), identifier_in_braces_(false), ch_(source_.cbegin()),
+          token_start_pos_(source_.cbegin()), float_constant_(0.0), boolean_constant_(false), int_constant_(0) { }
 
     /** Call this until it returns EOS. */
     Token getToken();
 
-    /** You may only call this optionally once after a prior call to getToken(). */
+    /** You may only call this optionally once after a prior call to getToken().  Since no input is consumed
+     *  until the token has been retrieved again, the accessors below keep referring to the pushed back token.
+     */
     void ungetToken(const Token &token);
 
     /** \return The position where the current token started. */
-    size_t getStartPos() const;
+    inline size_t getStartPos() const { return token_start_pos_ - source_.cbegin(); }
+
+    /** \return the text of the token in the source, e.g. w/ quotes and escapes for a string constant. */
+    inline StringView getText(const Token &token) const
+        { return StringView(source_.data() + token.getOffset(), token.getLength()); }
 
-    const std::string &getStringConstant() const { return string_constant_; }
+    /** The views returned by these remain valid until the next call to getToken() that consumes input. */
+    StringView getStringConstant() const { return string_constant_; }
     double getFloatConstant() const { return float_constant_; }
     bool getBooleanConstant() const { return boolean_constant_; }
-    long getIntConstant() const { return int_constant_; }
-    const std::string &getIdent() const { return identifier_; }
+    int64_t getIntConstant() const { return int_constant_; }
+    StringView getIdent() const { return identifier_; }
     inline const std::string &getErrMsg() const { return error_msg_; }
 private:
+    Token scanToken();
+    inline const char *getData(const std::string::const_iterator &ch) const
+        { return source_.data() + (ch - source_.cbegin()); }
+    inline void setPosition(const char * const ch) { ch_ = source_.cbegin() + (ch - source_.data()); }
     Token parseStringConstant();
+    /** Literals w/o a decimal point or an exponent that fit into an int64_t become INT_CONSTANTs, everything else
+     *  FLOAT_CONSTANTs.
+     */
     Token parseNumericConstant();
 
     /**
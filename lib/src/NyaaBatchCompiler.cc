@@ -0,0 +1,102 @@
+/** \file    NyaaBatchCompiler.cc
+ *  \brief   Implementation of the BatchCompiler class.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "NyaaBatchCompiler.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include "NyaaCompiler.h"
+
+
+namespace Nyaa {
+
+
+// Equations are claimed this many at a time.  Small enough for good load balancing, large enough to keep the
+// contention on the shared counter negligible.
+static const size_t CHUNK_SIZE(16);
+
+
+BatchCompiler::BatchCompiler(const FunctionRegistry &function_registry, const unsigned thread_count)
+    : function_registry_(function_registry), thread_count_(thread_count)
+{
+    if (thread_count_ == 0)
+        thread_count_ = std::max(1u, std::thread::hardware_concurrency());
+}
+
+
+std::vector<BatchCompiler::Result> BatchCompiler::compileAll(
+    const std::string * const equations, const size_t equation_count,
+    const Parser::AttribNameToTypeMap &attrib_name_to_type_map) const
+{
+    std::vector<Result> results(equation_count);
+    std::atomic<size_t> next_equation(0);
+    std::exception_ptr first_exception;
+    std::mutex first_exception_mutex;
+
+    const auto compile_chunks([&]() {
+        try {
+            Compiler compiler(function_registry_);
+            for (;;) {
+                const size_t first(next_equation.fetch_add(CHUNK_SIZE, std::memory_order_relaxed));
+                if (first >= equation_count)
+                    return;
+
+                const size_t last(std::min(first + CHUNK_SIZE, equation_count));
+                for (size_t equation_no(first); equation_no < last; ++equation_no) {
+                    std::shared_ptr<Program> program(new Program);
+                    if (compiler.compile(equations[equation_no], attrib_name_to_type_map, program.get()))
+                        results[equation_no].program_ = std::move(program);
+                    else
+                        results[equation_no].error_msg_ = compiler.getErrorMsg();
+                }
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(first_exception_mutex);
+            if (first_exception == nullptr)
+                first_exception = std::current_exception();
+            next_equation.store(equation_count, std::memory_order_relaxed); // Make the other threads stop early.
+        }
+    });
+
+    // The calling thread does its share of the work.
+    const size_t chunk_count((equation_count + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    const size_t additional_thread_count(std::min<size_t>(thread_count_, chunk_count) - (chunk_count > 0 ? 1 : 0));
+    std::vector<std::thread> threads;
+    threads.reserve(additional_thread_count);
+    try {
+        for (size_t thread_no(0); thread_no < additional_thread_count; ++thread_no)
+            threads.emplace_back(compile_chunks);
+    } catch (...) { // We may not be able to create as many threads as we wanted, which is OK.
+    }
+    compile_chunks();
+    for (auto &thread : threads)
+        thread.join();
+
+    if (first_exception != nullptr)
+        std::rethrow_exception(first_exception);
+
+    return results;
+}
+
+
+} // namespace Nyaa
@@ -0,0 +1,926 @@
+/** \file    NyaaBatchEvaluator.cc
+ *  \brief   Implementation of the BatchEvaluator class.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "NyaaBatchEvaluator.h"
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <cmath>
+#include <cstring>
+#include "NyaaConversions.h"
+#include "NyaaIntArithmetic.h"
+#include "NyaaNodes.h"
+
+
+namespace Nyaa {
+
+
+constexpr size_t BatchEvaluator::CHUNK_SIZE;
+constexpr uint32_t BatchEvaluator::NO_JUMP_TARGET;
+
+
+// Binary operators find their left operand in the upper register and store their result in the register of the
+// right operand.  The kernels for the operators that have no SimdKernels counterpart are kept trivial so that the
+// compiler can vectorise them.  Boolean operators work on whole mask words, the bits past the last row of a chunk
+// are garbage and must never be looked at.
+
+
+template<typename OperandType, typename Operator> static inline void ArithmeticKernel(
+    OperandType * __restrict__ rhs_and_result, const OperandType * __restrict__ lhs, const size_t count,
+    const Operator op)
+{
+    for (size_t i(0); i < count; ++i)
+        rhs_and_result[i] = op(lhs[i], rhs_and_result[i]);
+}
+
+
+static inline bool AnyRows(const uint64_t * const rows, const size_t row_count) {
+    for (size_t word_no(0); word_no < MaskWordCount(row_count); ++word_no) {
+        if (rows[word_no] != 0)
+            return true;
+    }
+    return false;
+}
+
+
+/** Stores "lhs" followed by "*strings[row]" in "buffers[row]", which may be where the right operand lives. */
+static inline void ConcatenateRow(const std::string &lhs, const size_t row, const std::string ** const strings,
+                                  std::string * const buffers)
+{
+    std::string &concatenation(buffers[row]);
+    if (strings[row] == &concatenation)
+        concatenation.insert(0, lhs);
+    else {
+        concatenation.assign(lhs);
+        concatenation.append(*strings[row]);
+    }
+    strings[row] = &concatenation;
+}
+
+
+template<typename Operator> static inline void StringComparisonKernel(
+    uint64_t * __restrict__ result_mask, const std::string * const * __restrict__ lhs,
+    const std::string * const * __restrict__ rhs, const size_t row_count, const Operator op)
+{
+    std::fill_n(result_mask, MaskWordCount(row_count), 0);
+    for (size_t row(0); row < row_count; ++row)
+        result_mask[row / 64] |= static_cast<uint64_t>(op(lhs[row]->compare(*rhs[row]), 0)) << (row % 64);
+}
+
+
+void BatchEvaluator::evaluate(const Program &program, const ColumnMap &columns, const size_t row_count,
+                              ResultColumn * const result)
+{
+    bindColumns(program, columns, row_count);
+    result->reset(program.getResultType(), row_count);
+    evaluateRows(program, 0, row_count, result);
+}
+
+
+void BatchEvaluator::evaluateRange(const Program &program, const ColumnMap &columns, const size_t first_row,
+                                   const size_t row_count, ResultColumn * const result)
+{
+    if (result->getType() != program.getResultType())
+        throw std::invalid_argument("in BatchEvaluator::evaluateRange: result column has type "
+                                    + NodeTypeToString(result->getType()) + " but the program's result type is "
+                                    + NodeTypeToString(program.getResultType()) + "!");
+    if (result->size() < first_row + row_count)
+        throw std::invalid_argument("in BatchEvaluator::evaluateRange: result column has only "
+                                    + std::to_string(result->size()) + " rows!");
+    bindColumns(program, columns, first_row + row_count);
+
+    // Rows flagged as errors would be skipped by function calls.
+    for (size_t row(first_row); row < first_row + row_count; ++row)
+        result->clearError(row);
+    evaluateRows(program, first_row, row_count, result);
+}
+
+
+void BatchEvaluator::bindColumns(const Program &program, const ColumnMap &columns, const size_t row_count) {
+    const ConstantPool &constant_pool(program.getConstantPool());
+    attrib_columns_.resize(constant_pool.getAttribRefCount());
+    for (uint32_t attrib_ref_index(0); attrib_ref_index < constant_pool.getAttribRefCount(); ++attrib_ref_index) {
+        const ConstantPool::AttribRef &attrib_ref(constant_pool.getAttribRef(attrib_ref_index));
+        const auto name_and_column(columns.find(attrib_ref.name_));
+        if (name_and_column == columns.cend())
+            throw std::invalid_argument("in BatchEvaluator::evaluate: no column for attribute \"" + attrib_ref.name_
+                                        + "\"!");
+        CheckColumn(attrib_ref, name_and_column->second, row_count);
+        attrib_columns_[attrib_ref_index] = &name_and_column->second;
+    }
+}
+
+
+void BatchEvaluator::evaluate(const Binding &binding, const std::vector<ColumnView> &columns, const size_t row_count,
+                              ResultColumn * const result)
+{
+    const size_t schema_size(binding.getSchema().size());
+    if (columns.size() != schema_size)
+        throw std::invalid_argument("in BatchEvaluator::evaluate: expected " + std::to_string(schema_size)
+                                    + " columns but got " + std::to_string(columns.size()) + "!");
+
+    const Program &program(binding.getProgram());
+    const ConstantPool &constant_pool(program.getConstantPool());
+    attrib_columns_.resize(constant_pool.getAttribRefCount());
+    for (uint32_t attrib_ref_index(0); attrib_ref_index < constant_pool.getAttribRefCount(); ++attrib_ref_index) {
+        const ColumnView &column(columns[binding.getSlot(attrib_ref_index)]);
+        CheckColumn(constant_pool.getAttribRef(attrib_ref_index), column, row_count);
+        attrib_columns_[attrib_ref_index] = &column;
+    }
+
+    result->reset(program.getResultType(), row_count);
+    evaluateRows(program, 0, row_count, result);
+}
+
+
+void BatchEvaluator::CheckColumn(const ConstantPool::AttribRef &attrib_ref, const ColumnView &column,
+                                 const size_t row_count)
+{
+    if (column.getType() != attrib_ref.type_)
+        throw std::invalid_argument("in BatchEvaluator::evaluate: column \"" + attrib_ref.name_ + "\" has type "
+                                    + NodeTypeToString(column.getType()) + " but "
+                                    + NodeTypeToString(attrib_ref.type_) + " was expected!");
+    if (column.size() < row_count)
+        throw std::invalid_argument("in BatchEvaluator::evaluate: column \"" + attrib_ref.name_ + "\" has only "
+                                    + std::to_string(column.size()) + " rows!");
+}
+
+
+void BatchEvaluator::evaluateRows(const Program &program, const size_t first_row, const size_t row_count,
+                                  ResultColumn * const result)
+{
+    if (registers_.size() < program.getMaxStackDepth())
+        registers_.resize(program.getMaxStackDepth());
+    if (locals_.size() < program.getLocalCount())
+        locals_.resize(program.getLocalCount());
+
+    findJumpTargets(program);
+
+    const size_t end_row(first_row + row_count);
+    for (size_t chunk_start(first_row); chunk_start < end_row; chunk_start += CHUNK_SIZE)
+        evaluateChunk(program, chunk_start, std::min(CHUNK_SIZE, end_row - chunk_start), result);
+}
+
+
+void BatchEvaluator::findJumpTargets(const Program &program) {
+    program_has_jumps_ = false;
+    jump_target_indices_.assign(program.size() + 1, NO_JUMP_TARGET);
+    uint32_t jump_target_count(0);
+    for (const auto &instruction : program) {
+        if (not IsJump(instruction.getCode()))
+            continue;
+        program_has_jumps_ = true;
+        if (jump_target_indices_[instruction.getOperand()] == NO_JUMP_TARGET)
+            jump_target_indices_[instruction.getOperand()] = jump_target_count++;
+    }
+
+    if (jump_targets_.size() < jump_target_count)
+        jump_targets_.resize(jump_target_count);
+}
+
+
+void BatchEvaluator::evaluateChunk(const Program &program, const size_t first_row, const size_t row_count,
+                                   ResultColumn * const result)
+{
+    const ConstantPool &constant_pool(program.getConstantPool());
+    unsigned depth(0); // The number of registers currently in use.
+
+    if (program_has_jumps_) {
+        std::fill(active_rows_.begin(), active_rows_.end(), 0);
+        for (size_t row(0); row < row_count; ++row)
+            SetMaskBit(active_rows_.data(), row, true);
+        for (auto &jump_target : jump_targets_) {
+            std::fill(jump_target.arriving_rows_.begin(), jump_target.arriving_rows_.end(), 0);
+            std::fill(jump_target.carried_rows_.begin(), jump_target.carried_rows_.end(), 0);
+        }
+    }
+
+    const CodeAndSourceLocation * const end(program.data() + program.size());
+    for (const CodeAndSourceLocation *pc(program.data()); pc != end; ++pc) {
+        if (program_has_jumps_ and jump_target_indices_[pc - program.data()] != NO_JUMP_TARGET)
+            mergeArrivingRows(static_cast<uint32_t>(pc - program.data()), row_count, &depth);
+
+        Register &top(registers_[depth == 0 ? 0 : depth - 1]);
+        Register &below_top(registers_[depth < 2 ? 0 : depth - 2]);
+
+        switch (pc->getCode()) {
+        case Instruction::FADD:
+            kernels_->getFloatArithmeticKernel(SimdKernels::ADD)(below_top.floats_.data(), top.floats_.data(),
+                                                                 row_count);
+            --depth;
+            break;
+        case Instruction::FSUB:
+            kernels_->getFloatArithmeticKernel(SimdKernels::SUB)(below_top.floats_.data(), top.floats_.data(),
+                                                                 row_count);
+            --depth;
+            break;
+        case Instruction::FMUL:
+            kernels_->getFloatArithmeticKernel(SimdKernels::MUL)(below_top.floats_.data(), top.floats_.data(),
+                                                                 row_count);
+            --depth;
+            break;
+        case Instruction::FDIV:
+            for (size_t row(0); row < row_count; ++row) {
+                if (below_top.floats_[row] == 0.0 and isActive(row))
+                    result->setError(first_row + row,
+                                     SourceLocationPrefix(pc->getSourceLocation()) + "division by zero!");
+            }
+            kernels_->getFloatArithmeticKernel(SimdKernels::DIV)(below_top.floats_.data(), top.floats_.data(),
+                                                                 row_count);
+            --depth;
+            break;
+        case Instruction::FPOW:
+            ArithmeticKernel(below_top.floats_.data(), top.floats_.data(), row_count,
+                             [](const double base, const double exponent) { return std::pow(base, exponent); });
+            --depth;
+            break;
+        case Instruction::SCONCAT:
+            for (size_t row(0); row < row_count; ++row)
+                ConcatenateRow(*top.strings_[row], row, below_top.strings_.data(), below_top.string_buffers_.data());
+            --depth;
+            break;
+        case Instruction::BEQLF:
+            kernels_->getFloatComparisonKernel(SimdKernels::EQUAL)(
+                below_top.bools_.data(), top.floats_.data(), below_top.floats_.data(), row_count);
+            --depth;
+            break;
+        case Instruction::BNEQLF:
+            kernels_->getFloatComparisonKernel(SimdKernels::NOT_EQUAL)(
+                below_top.bools_.data(), top.floats_.data(), below_top.floats_.data(), row_count);
+            --depth;
+            break;
+        case Instruction::BGTF:
+            kernels_->getFloatComparisonKernel(SimdKernels::GREATER_THAN)(
+                below_top.bools_.data(), top.floats_.data(), below_top.floats_.data(), row_count);
+            --depth;
+            break;
+        case Instruction::BLTF:
+            kernels_->getFloatComparisonKernel(SimdKernels::LESS_THAN)(
+                below_top.bools_.data(), top.floats_.data(), below_top.floats_.data(), row_count);
+            --depth;
+            break;
+        case Instruction::BGTEF:
+            kernels_->getFloatComparisonKernel(SimdKernels::GREATER_OR_EQUAL)(
+                below_top.bools_.data(), top.floats_.data(), below_top.floats_.data(), row_count);
+            --depth;
+            break;
+        case Instruction::BLTEF:
+            kernels_->getFloatComparisonKernel(SimdKernels::LESS_OR_EQUAL)(
+                below_top.bools_.data(), top.floats_.data(), below_top.floats_.data(), row_count);
+            --depth;
+            break;
+        case Instruction::BEQLS:
+            StringComparisonKernel(below_top.bools_.data(), top.strings_.data(), below_top.strings_.data(),
+                                   row_count, std::equal_to<int>());
+            --depth;
+            break;
+        case Instruction::BNEQLS:
+            StringComparisonKernel(below_top.bools_.data(), top.strings_.data(), below_top.strings_.data(),
+                                   row_count, std::not_equal_to<int>());
+            --depth;
+            break;
+        case Instruction::BGTS:
+            StringComparisonKernel(below_top.bools_.data(), top.strings_.data(), below_top.strings_.data(),
+                                   row_count, std::greater<int>());
+            --depth;
+            break;
+        case Instruction::BLTS:
+            StringComparisonKernel(below_top.bools_.data(), top.strings_.data(), below_top.strings_.data(),
+                                   row_count, std::less<int>());
+            --depth;
+            break;
+        case Instruction::BGTES:
+            StringComparisonKernel(below_top.bools_.data(), top.strings_.data(), below_top.strings_.data(),
+                                   row_count, std::greater_equal<int>());
+            --depth;
+            break;
+        case Instruction::BLTES:
+            StringComparisonKernel(below_top.bools_.data(), top.strings_.data(), below_top.strings_.data(),
+                                   row_count, std::less_equal<int>());
+            --depth;
+            break;
+        case Instruction::BGTB:
+            ArithmeticKernel(below_top.bools_.data(), top.bools_.data(), MaskWordCount(row_count),
+                             [](const uint64_t lhs, const uint64_t rhs) { return lhs & ~rhs; });
+            --depth;
+            break;
+        case Instruction::BLTB:
+            ArithmeticKernel(below_top.bools_.data(), top.bools_.data(), MaskWordCount(row_count),
+                             [](const uint64_t lhs, const uint64_t rhs) { return ~lhs & rhs; });
+            --depth;
+            break;
+        case Instruction::BGTEB:
+            ArithmeticKernel(below_top.bools_.data(), top.bools_.data(), MaskWordCount(row_count),
+                             [](const uint64_t lhs, const uint64_t rhs) { return lhs | ~rhs; });
+            --depth;
+            break;
+        case Instruction::BLTEB:
+            ArithmeticKernel(below_top.bools_.data(), top.bools_.data(), MaskWordCount(row_count),
+                             [](const uint64_t lhs, const uint64_t rhs) { return ~lhs | rhs; });
+            --depth;
+            break;
+        case Instruction::BEQLB:
+            ArithmeticKernel(below_top.bools_.data(), top.bools_.data(), MaskWordCount(row_count),
+                             [](const uint64_t lhs, const uint64_t rhs) { return ~(lhs ^ rhs); });
+            --depth;
+            break;
+        case Instruction::BNEQLB:
+            ArithmeticKernel(below_top.bools_.data(), top.bools_.data(), MaskWordCount(row_count),
+                             [](const uint64_t lhs, const uint64_t rhs) { return lhs ^ rhs; });
+            --depth;
+            break;
+        case Instruction::BEQLI:
+            kernels_->getIntComparisonKernel(SimdKernels::EQUAL)(
+                below_top.bools_.data(), top.ints_.data(), below_top.ints_.data(), row_count);
+            --depth;
+            break;
+        case Instruction::BNEQLI:
+            kernels_->getIntComparisonKernel(SimdKernels::NOT_EQUAL)(
+                below_top.bools_.data(), top.ints_.data(), below_top.ints_.data(), row_count);
+            --depth;
+            break;
+        case Instruction::BGTI:
+            kernels_->getIntComparisonKernel(SimdKernels::GREATER_THAN)(
+                below_top.bools_.data(), top.ints_.data(), below_top.ints_.data(), row_count);
+            --depth;
+            break;
+        case Instruction::BLTI:
+            kernels_->getIntComparisonKernel(SimdKernels::LESS_THAN)(
+                below_top.bools_.data(), top.ints_.data(), below_top.ints_.data(), row_count);
+            --depth;
+            break;
+        case Instruction::BGTEI:
+            kernels_->getIntComparisonKernel(SimdKernels::GREATER_OR_EQUAL)(
+                below_top.bools_.data(), top.ints_.data(), below_top.ints_.data(), row_count);
+            --depth;
+            break;
+        case Instruction::BLTEI:
+            kernels_->getIntComparisonKernel(SimdKernels::LESS_OR_EQUAL)(
+                below_top.bools_.data(), top.ints_.data(), below_top.ints_.data(), row_count);
+            --depth;
+            break;
+        case Instruction::CALL:
+        case Instruction::CALLF: // Batches go through Function::evaluateBatch() either way.
+            depth -= pc->getOperand2();
+            call(constant_pool.getCallSite(pc->getOperand()), depth, first_row, row_count, pc->getSourceLocation(),
+                 getSkippedRows(first_row, row_count, *result), result);
+            ++depth;
+            break;
+        case Instruction::FUMINUS:
+            for (size_t row(0); row < row_count; ++row)
+                top.floats_[row] = -top.floats_[row];
+            break;
+        case Instruction::FUPLUS:
+            break;
+        case Instruction::AREF:
+        case Instruction::AREF2: {
+            Register &target(registers_[depth++]);
+            const ColumnView &column(*attrib_columns_[pc->getOperand()]);
+            switch (column.getType()) {
+            case NodeType::FLOAT_NODE:
+                std::memcpy(target.floats_.data(), column.getFloats() + first_row, row_count * sizeof(double));
+                break;
+            case NodeType::INT_NODE:
+                std::memcpy(target.ints_.data(), column.getInts() + first_row, row_count * sizeof(int64_t));
+                break;
+            case NodeType::BOOLEAN_NODE:
+                std::fill_n(target.bools_.begin(), MaskWordCount(row_count), 0);
+                for (size_t row(0); row < row_count; ++row)
+                    target.bools_[row / 64] |= static_cast<uint64_t>(column.getBools()[first_row + row] != 0)
+                                               << (row % 64);
+                break;
+            case NodeType::STRING_NODE:
+                for (size_t row(0); row < row_count; ++row)
+                    target.strings_[row] = column.getStrings() + first_row + row;
+                break;
+            default:
+                throw std::logic_error("in BatchEvaluator::evaluateChunk: unexpected column type "
+                                       + NodeTypeToString(column.getType()) + "!");
+            }
+
+            if (column.getMissingFlags() == nullptr)
+                break;
+            if (pc->getCode() == Instruction::AREF) {
+                reportMissingValues(*pc, column, constant_pool, first_row, row_count, result);
+                break;
+            }
+            for (size_t row(0); row < row_count; ++row) {
+                if (not column.isMissing(first_row + row) or not isActive(row))
+                    continue;
+                switch (column.getType()) {
+                case NodeType::FLOAT_NODE:
+                    target.floats_[row] = constant_pool.getFloat(pc->getOperand2());
+                    break;
+                case NodeType::INT_NODE:
+                    target.ints_[row] = constant_pool.getInt(pc->getOperand2());
+                    break;
+                case NodeType::BOOLEAN_NODE:
+                    SetMaskBit(target.bools_.data(), row, pc->getOperand2() != 0);
+                    break;
+                default:
+                    target.strings_[row] = &constant_pool.getString(pc->getOperand2());
+                }
+            }
+            break;
+        }
+        case Instruction::FCONVI:
+            for (size_t row(0); row < row_count; ++row)
+                top.floats_[row] = static_cast<double>(top.ints_[row]);
+            break;
+        case Instruction::FCONVB:
+            for (size_t row(0); row < row_count; ++row)
+                top.floats_[row] = GetMaskBit(top.bools_.data(), row) ? 1.0 : 0.0;
+            break;
+        case Instruction::FCONVS:
+            for (size_t row(0); row < row_count; ++row) {
+                if (not StringToFloat(*top.strings_[row], &top.floats_[row]) and isActive(row))
+                    result->setError(first_row + row, SourceLocationPrefix(pc->getSourceLocation())
+                                     + "can't convert \"" + *top.strings_[row] + "\" to a floating point number!");
+            }
+            break;
+        case Instruction::SCONVF:
+            for (size_t row(0); row < row_count; ++row) {
+                FloatToString(top.floats_[row], &top.string_buffers_[row]);
+                top.strings_[row] = &top.string_buffers_[row];
+            }
+            break;
+        case Instruction::SCONVI:
+            for (size_t row(0); row < row_count; ++row) {
+                IntToString(top.ints_[row], &top.string_buffers_[row]);
+                top.strings_[row] = &top.string_buffers_[row];
+            }
+            break;
+        case Instruction::SCONVB:
+            for (size_t row(0); row < row_count; ++row)
+                top.strings_[row] = &BoolToString(GetMaskBit(top.bools_.data(), row));
+            break;
+        case Instruction::FPUSH:
+            std::fill_n(registers_[depth++].floats_.begin(), row_count, constant_pool.getFloat(pc->getOperand()));
+            break;
+        case Instruction::SPUSH:
+            std::fill_n(registers_[depth++].strings_.begin(), row_count, &constant_pool.getString(pc->getOperand()));
+            break;
+        case Instruction::BPUSH:
+            std::fill_n(registers_[depth++].bools_.begin(), MaskWordCount(row_count),
+                        pc->getOperand() != 0 ? ~uint64_t(0) : uint64_t(0));
+            break;
+        case Instruction::IPUSH:
+            std::fill_n(registers_[depth++].ints_.begin(), row_count, constant_pool.getInt(pc->getOperand()));
+            break;
+        case Instruction::STORE: {
+            const NodeType type(static_cast<NodeType>(pc->getOperand2()));
+            Register &local(locals_[pc->getOperand()]);
+            CopyRegister(top, type, row_count, &local);
+            if (type != NodeType::STRING_NODE)
+                break;
+            for (size_t row(0); row < row_count; ++row) {
+                if (local.strings_[row] == &top.string_buffers_[row]) {
+                    local.string_buffers_[row] = top.string_buffers_[row];
+                    local.strings_[row] = &local.string_buffers_[row];
+                }
+            }
+            break;
+        }
+        case Instruction::LOAD:
+            CopyRegister(locals_[pc->getOperand()], static_cast<NodeType>(pc->getOperand2()), row_count,
+                         &registers_[depth++]);
+            break;
+        case Instruction::JUMP:
+            takeJump(*pc, depth, row_count);
+            pc = skipInactiveCode(program, pc);
+            break;
+        case Instruction::JUMP_IF_FALSE:
+        case Instruction::JUMP_IF_TRUE:
+            --depth;
+            takeJump(*pc, depth, row_count);
+            if (not AnyRows(active_rows_.data(), row_count))
+                pc = skipInactiveCode(program, pc);
+            break;
+        case Instruction::IADD:
+            kernels_->getIntArithmeticKernel(SimdKernels::ADD)(below_top.ints_.data(), top.ints_.data(),
+                                                               overflow_rows_.data(), row_count);
+            reportIntOverflows(pc->getSourceLocation(), first_row, row_count, result);
+            --depth;
+            break;
+        case Instruction::ISUB:
+            kernels_->getIntArithmeticKernel(SimdKernels::SUB)(below_top.ints_.data(), top.ints_.data(),
+                                                               overflow_rows_.data(), row_count);
+            reportIntOverflows(pc->getSourceLocation(), first_row, row_count, result);
+            --depth;
+            break;
+        case Instruction::IMUL:
+            kernels_->getIntArithmeticKernel(SimdKernels::MUL)(below_top.ints_.data(), top.ints_.data(),
+                                                               overflow_rows_.data(), row_count);
+            reportIntOverflows(pc->getSourceLocation(), first_row, row_count, result);
+            --depth;
+            break;
+        case Instruction::IDIV:
+        case Instruction::IMOD: {
+            // Unlike FDIV we can't let a zero divisor through, not even for rows that failed or are inactive.
+            const bool is_division(pc->getCode() == Instruction::IDIV);
+            std::fill_n(overflow_rows_.begin(), MaskWordCount(row_count), 0);
+            for (size_t row(0); row < row_count; ++row) {
+                int64_t &divisor_and_result(below_top.ints_[row]);
+                if (divisor_and_result == 0) {
+                    if (isActive(row))
+                        result->setError(first_row + row,
+                                         SourceLocationPrefix(pc->getSourceLocation()) + "division by zero!");
+                } else if (not is_division)
+                    divisor_and_result = IntModulo(top.ints_[row], divisor_and_result);
+                else if (QuotientOverflows(top.ints_[row], divisor_and_result, &divisor_and_result))
+                    SetMaskBit(overflow_rows_.data(), row, true);
+            }
+            reportIntOverflows(pc->getSourceLocation(), first_row, row_count, result);
+            --depth;
+            break;
+        }
+        case Instruction::IUMINUS:
+            std::fill_n(overflow_rows_.begin(), MaskWordCount(row_count), 0);
+            for (size_t row(0); row < row_count; ++row) {
+                if (NegateOverflows(top.ints_[row], &top.ints_[row]))
+                    SetMaskBit(overflow_rows_.data(), row, true);
+            }
+            reportIntOverflows(pc->getSourceLocation(), first_row, row_count, result);
+            break;
+        case Instruction::FAREFI: {
+            Register &target(registers_[depth++]);
+            const ColumnView &column(*attrib_columns_[pc->getOperand()]);
+            const int64_t * const values(column.getInts() + first_row);
+            for (size_t row(0); row < row_count; ++row)
+                target.floats_[row] = static_cast<double>(values[row]);
+            reportMissingValues(*pc, column, constant_pool, first_row, row_count, result);
+            break;
+        }
+        case Instruction::BEQLFAC:
+        case Instruction::BNEQLFAC:
+        case Instruction::BGTFAC:
+        case Instruction::BLTFAC:
+        case Instruction::BGTEFAC:
+        case Instruction::BLTEFAC:
+        case Instruction::BEQLIAC:
+        case Instruction::BNEQLIAC:
+        case Instruction::BGTIAC:
+        case Instruction::BLTIAC:
+        case Instruction::BGTEIAC:
+        case Instruction::BLTEIAC:
+            compareAttribWithConstant(*pc, constant_pool, first_row, row_count, &registers_[depth++], result);
+            break;
+        case Instruction::SCONCATF:
+            for (size_t row(0); row < row_count; ++row) {
+                FloatToString(top.floats_[row], &top.string_buffers_[row]);
+                ConcatenateRow(top.string_buffers_[row], row, below_top.strings_.data(),
+                               below_top.string_buffers_.data());
+            }
+            --depth;
+            break;
+        case Instruction::SCONCATI:
+            for (size_t row(0); row < row_count; ++row) {
+                IntToString(top.ints_[row], &top.string_buffers_[row]);
+                ConcatenateRow(top.string_buffers_[row], row, below_top.strings_.data(),
+                               below_top.string_buffers_.data());
+            }
+            --depth;
+            break;
+        case Instruction::SCONCATB:
+            for (size_t row(0); row < row_count; ++row)
+                ConcatenateRow(BoolToString(GetMaskBit(top.bools_.data(), row)), row, below_top.strings_.data(),
+                               below_top.string_buffers_.data());
+            --depth;
+            break;
+        }
+    }
+    if (program_has_jumps_ and jump_target_indices_[program.size()] != NO_JUMP_TARGET)
+        mergeArrivingRows(static_cast<uint32_t>(program.size()), row_count, &depth);
+
+    if (depth != 1)
+        throw std::logic_error("in BatchEvaluator::evaluateChunk: corrupt program, stack depth is "
+                               + std::to_string(depth) + " after execution!");
+
+    const Register &result_register(registers_[0]);
+    switch (result->getType()) {
+    case NodeType::FLOAT_NODE:
+        std::copy_n(result_register.floats_.cbegin(), row_count, result->getFloats() + first_row);
+        break;
+    case NodeType::INT_NODE:
+        std::copy_n(result_register.ints_.cbegin(), row_count, result->getInts() + first_row);
+        break;
+    case NodeType::BOOLEAN_NODE:
+        for (size_t row(0); row < row_count; ++row)
+            result->getBools()[first_row + row] = GetMaskBit(result_register.bools_.data(), row);
+        break;
+    case NodeType::STRING_NODE:
+        for (size_t row(0); row < row_count; ++row)
+            result->setString(first_row + row, *result_register.strings_[row]);
+        break;
+    default:
+        throw std::logic_error("in BatchEvaluator::evaluateChunk: program has no result type!");
+    }
+}
+
+
+void BatchEvaluator::CopyRegister(const Register &source, const NodeType type, const size_t row_count,
+                                  Register * const target)
+{
+    switch (type) {
+    case NodeType::FLOAT_NODE:
+        std::copy_n(source.floats_.cbegin(), row_count, target->floats_.begin());
+        break;
+    case NodeType::INT_NODE:
+        std::copy_n(source.ints_.cbegin(), row_count, target->ints_.begin());
+        break;
+    case NodeType::BOOLEAN_NODE:
+        std::copy_n(source.bools_.cbegin(), MaskWordCount(row_count), target->bools_.begin());
+        break;
+    case NodeType::STRING_NODE:
+        std::copy_n(source.strings_.cbegin(), row_count, target->strings_.begin());
+        break;
+    default:
+        throw std::logic_error("in BatchEvaluator::CopyRegister: unexpected type " + NodeTypeToString(type) + "!");
+    }
+}
+
+
+void BatchEvaluator::reportMissingValues(const CodeAndSourceLocation &attrib_ref_instruction,
+                                         const ColumnView &column, const ConstantPool &constant_pool,
+                                         const size_t first_row, const size_t row_count, ResultColumn * const result)
+{
+    if (column.getMissingFlags() == nullptr)
+        return;
+
+    for (size_t row(0); row < row_count; ++row) {
+        if (column.isMissing(first_row + row) and isActive(row))
+            result->setError(first_row + row, SourceLocationPrefix(attrib_ref_instruction.getSourceLocation())
+                             + "attribute \"" + constant_pool.getAttribRef(attrib_ref_instruction.getOperand()).name_
+                             + "\" has no value!");
+    }
+}
+
+
+// The constant is broadcast into the target register, so that the SimdKernels can compare the column values
+// directly.
+void BatchEvaluator::compareAttribWithConstant(const CodeAndSourceLocation &comparison,
+                                               const ConstantPool &constant_pool, const size_t first_row,
+                                               const size_t row_count, Register * const target,
+                                               ResultColumn * const result)
+{
+    SimdKernels::ComparisonOp op;
+    bool is_float_comparison(true);
+    switch (comparison.getCode()) {
+    case Instruction::BEQLIAC:
+        is_float_comparison = false; // Fall through!
+    case Instruction::BEQLFAC:
+        op = SimdKernels::EQUAL;
+        break;
+    case Instruction::BNEQLIAC:
+        is_float_comparison = false; // Fall through!
+    case Instruction::BNEQLFAC:
+        op = SimdKernels::NOT_EQUAL;
+        break;
+    case Instruction::BGTIAC:
+        is_float_comparison = false; // Fall through!
+    case Instruction::BGTFAC:
+        op = SimdKernels::GREATER_THAN;
+        break;
+    case Instruction::BLTIAC:
+        is_float_comparison = false; // Fall through!
+    case Instruction::BLTFAC:
+        op = SimdKernels::LESS_THAN;
+        break;
+    case Instruction::BGTEIAC:
+        is_float_comparison = false; // Fall through!
+    case Instruction::BGTEFAC:
+        op = SimdKernels::GREATER_OR_EQUAL;
+        break;
+    case Instruction::BLTEIAC:
+        is_float_comparison = false; // Fall through!
+    case Instruction::BLTEFAC:
+        op = SimdKernels::LESS_OR_EQUAL;
+        break;
+    default:
+        throw std::logic_error("in BatchEvaluator::compareAttribWithConstant: not an attribute comparison!");
+    }
+
+    const ColumnView &column(*attrib_columns_[comparison.getOperand()]);
+    if (is_float_comparison) {
+        std::fill_n(target->floats_.begin(), row_count, constant_pool.getFloat(comparison.getOperand2()));
+        kernels_->getFloatComparisonKernel(op)(target->bools_.data(), column.getFloats() + first_row,
+                                               target->floats_.data(), row_count);
+    } else {
+        std::fill_n(target->ints_.begin(), row_count, constant_pool.getInt(comparison.getOperand2()));
+        kernels_->getIntComparisonKernel(op)(target->bools_.data(), column.getInts() + first_row,
+                                             target->ints_.data(), row_count);
+    }
+    reportMissingValues(comparison, column, constant_pool, first_row, row_count, result);
+}
+
+
+void BatchEvaluator::reportIntOverflows(const size_t source_location, const size_t first_row, const size_t row_count,
+                                        ResultColumn * const result)
+{
+    if (not CHECK_INT_OVERFLOW or not AnyRows(overflow_rows_.data(), row_count))
+        return;
+
+    for (size_t row(0); row < row_count; ++row) {
+        if (GetMaskBit(overflow_rows_.data(), row) and isActive(row))
+            result->setError(first_row + row, SourceLocationPrefix(source_location) + "integer overflow!");
+    }
+}
+
+
+const uint8_t *BatchEvaluator::getSkippedRows(const size_t first_row, const size_t row_count,
+                                              const ResultColumn &result)
+{
+    const uint8_t * const error_flags(result.getErrorFlags() + first_row);
+    if (not program_has_jumps_)
+        return error_flags;
+
+    bool all_rows_are_active(true);
+    for (size_t row(0); row < row_count; ++row) {
+        const bool is_active(GetMaskBit(active_rows_.data(), row));
+        skipped_rows_[row] = error_flags[row] != 0 or not is_active;
+        all_rows_are_active = all_rows_are_active and is_active;
+    }
+    return all_rows_are_active ? error_flags : skipped_rows_.data();
+}
+
+
+// The rows that take the jump get deactivated.  An unconditional JUMP takes all active rows to its target along w/
+// the value on top of the stack, which the code up to the target is going to overwrite.
+void BatchEvaluator::takeJump(const CodeAndSourceLocation &jump, const unsigned depth, const size_t row_count) {
+    JumpTarget &target(jump_targets_[jump_target_indices_[jump.getOperand()]]);
+    target.depth_ = depth;
+    const size_t word_count(MaskWordCount(row_count));
+
+    if (jump.getCode() == Instruction::JUMP) {
+        target.carried_type_ = static_cast<NodeType>(jump.getOperand2());
+        MoveRows(&registers_[depth - 1], target.carried_type_, active_rows_.data(), row_count,
+                 &target.carried_values_);
+        for (size_t word_no(0); word_no < word_count; ++word_no) {
+            target.arriving_rows_[word_no] |= active_rows_[word_no];
+            target.carried_rows_[word_no] |= active_rows_[word_no];
+            active_rows_[word_no] = 0;
+        }
+        return;
+    }
+
+    // The condition is in the register just above the new top of the stack.
+    const uint64_t * const condition(registers_[depth].bools_.data());
+    const uint64_t jump_if(jump.getCode() == Instruction::JUMP_IF_TRUE ? ~uint64_t(0) : uint64_t(0));
+    for (size_t word_no(0); word_no < word_count; ++word_no) {
+        const uint64_t jumping_rows(active_rows_[word_no] & ~(condition[word_no] ^ jump_if));
+        target.arriving_rows_[word_no] |= jumping_rows;
+        active_rows_[word_no] &= ~jumping_rows;
+    }
+}
+
+
+void BatchEvaluator::mergeArrivingRows(const uint32_t address, const size_t row_count, unsigned * const depth) {
+    JumpTarget &target(jump_targets_[jump_target_indices_[address]]);
+    if (not AnyRows(target.arriving_rows_.data(), row_count))
+        return;
+
+    *depth = target.depth_;
+    if (AnyRows(target.carried_rows_.data(), row_count))
+        MoveRows(&target.carried_values_, target.carried_type_, target.carried_rows_.data(), row_count,
+                 &registers_[*depth - 1]);
+
+    for (size_t word_no(0); word_no < MaskWordCount(row_count); ++word_no) {
+        active_rows_[word_no] |= target.arriving_rows_[word_no];
+        target.arriving_rows_[word_no] = target.carried_rows_[word_no] = 0;
+    }
+}
+
+
+const CodeAndSourceLocation *BatchEvaluator::skipInactiveCode(const Program &program,
+                                                              const CodeAndSourceLocation * const pc) const
+{
+    uint32_t address(static_cast<uint32_t>(pc - program.data()) + 1);
+    for (/* Empty! */; address < program.size(); ++address) {
+        const uint32_t jump_target_index(jump_target_indices_[address]);
+        if (jump_target_index != NO_JUMP_TARGET
+            and AnyRows(jump_targets_[jump_target_index].arriving_rows_.data(), CHUNK_SIZE))
+            break;
+    }
+    return program.data() + address - 1;
+}
+
+
+void BatchEvaluator::MoveRows(Register * const source, const NodeType type, const uint64_t * const rows,
+                              const size_t row_count, Register * const target)
+{
+    if (type == NodeType::BOOLEAN_NODE) {
+        for (size_t word_no(0); word_no < MaskWordCount(row_count); ++word_no)
+            target->bools_[word_no] = (target->bools_[word_no] & ~rows[word_no])
+                                      | (source->bools_[word_no] & rows[word_no]);
+        return;
+    }
+
+    for (size_t row(0); row < row_count; ++row) {
+        if (not GetMaskBit(rows, row))
+            continue;
+        switch (type) {
+        case NodeType::FLOAT_NODE:
+            target->floats_[row] = source->floats_[row];
+            break;
+        case NodeType::INT_NODE:
+            target->ints_[row] = source->ints_[row];
+            break;
+        case NodeType::STRING_NODE:
+            if (source->strings_[row] == &source->string_buffers_[row]) {
+                target->string_buffers_[row].swap(source->string_buffers_[row]);
+                target->strings_[row] = &target->string_buffers_[row];
+            } else
+                target->strings_[row] = source->strings_[row];
+            break;
+        default:
+            throw std::logic_error("in BatchEvaluator::MoveRows: unexpected type " + NodeTypeToString(type) + "!");
+        }
+    }
+}
+
+
+void BatchEvaluator::call(const ConstantPool::CallSite &call_site, const unsigned first_arg_register,
+                          const size_t first_row, const size_t row_count, const size_t source_location,
+                          const uint8_t * const skipped_rows, ResultColumn * const result)
+{
+    // The first argument is in the lowest register, which also receives the result.
+    const size_t arg_count(call_site.arg_types_.size());
+    call_arg_columns_.resize(arg_count);
+    for (size_t arg_no(0); arg_no < arg_count; ++arg_no) {
+        const Register &arg(registers_[first_arg_register + arg_no]);
+        switch (call_site.arg_types_[arg_no]) {
+        case NodeType::FLOAT_NODE:
+            call_arg_columns_[arg_no].floats_ = arg.floats_.data();
+            break;
+        case NodeType::INT_NODE:
+            call_arg_columns_[arg_no].ints_ = arg.ints_.data();
+            break;
+        case NodeType::BOOLEAN_NODE:
+            call_arg_columns_[arg_no].bools_ = arg.bools_.data();
+            break;
+        case NodeType::STRING_NODE:
+            call_arg_columns_[arg_no].strings_ = arg.strings_.data();
+            break;
+        default:
+            throw std::logic_error("in BatchEvaluator::call: unexpected argument type "
+                                   + NodeTypeToString(call_site.arg_types_[arg_no]) + "!");
+        }
+    }
+
+    Register &result_register(registers_[first_arg_register]);
+    void *result_values;
+    switch (call_site.return_type_) {
+    case NodeType::FLOAT_NODE:
+        result_values = result_register.floats_.data();
+        break;
+    case NodeType::INT_NODE:
+        result_values = result_register.ints_.data();
+        break;
+    case NodeType::BOOLEAN_NODE:
+        result_values = result_register.bools_.data();
+        break;
+    default:
+        result_values = nullptr;
+
+        // Functions don't set the results of skipped rows, whose pointers must not dangle nevertheless.
+        if (arg_count == 0 or call_site.arg_types_[0] != NodeType::STRING_NODE) {
+            for (size_t row(0); row < row_count; ++row)
+                result_register.strings_[row] = &result_register.string_buffers_[row];
+        }
+    }
+
+    call_errors_.clear();
+    const BatchFuncArgs args(call_arg_columns_.data(), call_site.arg_types_.data(), arg_count, row_count);
+    BatchFuncResult function_result(call_site.return_type_, result_values, result_register.strings_.data(),
+                                    result_register.string_buffers_.data(), row_count, skipped_rows,
+                                    &call_errors_);
+    call_site.function_->evaluateBatch(args, &function_result);
+
+    for (const auto &row_and_error_message : call_errors_) {
+        if (not isActive(row_and_error_message.first))
+            continue;
+        result->setError(first_row + row_and_error_message.first,
+                         SourceLocationPrefix(source_location) + row_and_error_message.second);
+    }
+}
+
+
+} // namespace Nyaa
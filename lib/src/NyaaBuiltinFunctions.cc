@@ -0,0 +1,1100 @@
+/** \file    NyaaBuiltinFunctions.cc
+ *  \brief   Implementation of the built-in functions.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "NyaaBuiltinFunctions.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <cctype>
+#include <cmath>
+#include "NyaaIntArithmetic.h"
+#include "NyaaSimdKernels.h"
+
+
+namespace Nyaa {
+
+
+namespace {
+
+
+const double PI(3.14159265358979323846);
+
+
+[[noreturn]] void ThrowDomainError(const std::string &function_name, const char * const message) {
+    throw std::domain_error(function_name + "(): " + message);
+}
+
+
+[[noreturn]] void ThrowInvalidArgument(const std::string &function_name, const char * const message) {
+    throw std::invalid_argument(function_name + "(): " + message);
+}
+
+
+inline bool AllArgsAre(const std::vector<NodeType> &arg_types, const NodeType type) {
+    return std::all_of(arg_types.cbegin(), arg_types.cend(),
+                       [type](const NodeType arg_type) { return arg_type == type; });
+}
+
+
+class BuiltinFunction : public Function {
+    const std::string name_, summary_, usage_description_;
+    const NodeType return_type_;
+public:
+    BuiltinFunction(const std::string &name, const std::string &summary, const std::string &usage_description,
+                    const NodeType return_type)
+        : name_(name), summary_(summary), usage_description_(usage_description), return_type_(return_type) { }
+
+    const std::string &getName() const override { return name_; }
+    const std::string getFunctionSummary() const override { return summary_; }
+    const std::string getUsageDescription() const override { return usage_description_; }
+    NodeType getReturnType() const override { return return_type_; }
+    bool isPure() const override { return true; }
+};
+
+
+// Traits for functions of a single floating point argument "x".  NaN's are in the domain of every function.
+#define UNARY_MATH_TRAITS(traits_name, function_name, summary, domain, expression) \
+    struct traits_name {                                                          \
+        static const char *GetName() { return function_name; }                    \
+        static const char *GetSummary() { return summary; }                       \
+        static inline bool IsInDomain(const double x) { return std::isnan(x) or (domain); } \
+        static inline double Compute(const double x) { return expression; }       \
+    }
+
+
+UNARY_MATH_TRAITS(SqrtTraits, "SQRT", "Calculates the square root of a number.", x >= 0.0, std::sqrt(x));
+UNARY_MATH_TRAITS(ExpTraits, "EXP", "Raises e to the power of a number.", true, std::exp(x));
+UNARY_MATH_TRAITS(LnTraits, "LN", "Calculates the natural logarithm of a number.", x > 0.0, std::log(x));
+UNARY_MATH_TRAITS(Log10Traits, "LOG10", "Calculates the decimal logarithm of a number.", x > 0.0, std::log10(x));
+UNARY_MATH_TRAITS(SinTraits, "SIN", "Calculates the sine of an angle given in radians.", true, std::sin(x));
+UNARY_MATH_TRAITS(CosTraits, "COS", "Calculates the cosine of an angle given in radians.", true, std::cos(x));
+UNARY_MATH_TRAITS(TanTraits, "TAN", "Calculates the tangent of an angle given in radians.", true, std::tan(x));
+UNARY_MATH_TRAITS(AsinTraits, "ASIN", "Calculates the arcsine, in radians, of a number.", x >= -1.0 and x <= 1.0,
+                  std::asin(x));
+UNARY_MATH_TRAITS(AcosTraits, "ACOS", "Calculates the arccosine, in radians, of a number.", x >= -1.0 and x <= 1.0,
+                  std::acos(x));
+UNARY_MATH_TRAITS(AtanTraits, "ATAN", "Calculates the arctangent, in radians, of a number.", true, std::atan(x));
+UNARY_MATH_TRAITS(SinhTraits, "SINH", "Calculates the hyperbolic sine of a number.", true, std::sinh(x));
+UNARY_MATH_TRAITS(CoshTraits, "COSH", "Calculates the hyperbolic cosine of a number.", true, std::cosh(x));
+UNARY_MATH_TRAITS(TanhTraits, "TANH", "Calculates the hyperbolic tangent of a number.", true, std::tanh(x));
+UNARY_MATH_TRAITS(DegreesTraits, "DEGREES", "Converts an angle from radians to degrees.", true, x * (180.0 / PI));
+UNARY_MATH_TRAITS(RadiansTraits, "RADIANS", "Converts an angle from degrees to radians.", true, x * (PI / 180.0));
+UNARY_MATH_TRAITS(FloorTraits, "FLOOR", "Rounds a number down to the nearest integer.", true, std::floor(x));
+UNARY_MATH_TRAITS(CeilTraits, "CEIL", "Rounds a number up to the nearest integer.", true, std::ceil(x));
+UNARY_MATH_TRAITS(TruncTraits, "TRUNC", "Rounds a number towards zero to the nearest integer.", true,
+                  std::trunc(x));
+
+
+#undef UNARY_MATH_TRAITS
+
+
+template<typename Traits> class UnaryMathFunction final : public BuiltinFunction {
+public:
+    UnaryMathFunction()
+        : BuiltinFunction(Traits::GetName(), Traits::GetSummary(),
+                          "Call with " + std::string(Traits::GetName()) + "(number).", NodeType::FLOAT_NODE) { }
+
+    NodeType validateArgTypes(const std::vector<NodeType> &arg_types) const override {
+        return (arg_types.size() == 1 and arg_types[0] == NodeType::FLOAT_NODE) ? NodeType::FLOAT_NODE
+                                                                               : NodeType::NULL_NODE;
+    }
+
+    void evaluateFunction(const FuncArgs &args, FuncResult * const result) const override
+        { result->setFloat(Evaluate(args.getFloat(0))); }
+
+    // The arguments are checked in a separate pass, so that the compiler can vectorise the computation.
+    void evaluateBatch(const BatchFuncArgs &args, BatchFuncResult * const result) const override {
+        const double * const x(args.getFloats(0));
+        for (size_t row(0); row < args.getRowCount(); ++row) {
+            if (not Traits::IsInDomain(x[row]) and not result->hasFailed(row))
+                result->setError(row, getName() + "(): argument out of range!");
+        }
+
+        double * const y(result->getFloats());
+        for (size_t row(0); row < args.getRowCount(); ++row)
+            y[row] = Traits::Compute(x[row]);
+    }
+
+    FuncFastPath getFastPath(const std::vector<NodeType> &/*arg_types*/) const override { return FastPath; }
+private:
+    static inline double Evaluate(const double x) {
+        if (not Traits::IsInDomain(x))
+            ThrowDomainError(Traits::GetName(), "argument out of range!");
+        return Traits::Compute(x);
+    }
+
+    static void FastPath(FuncValue * const args, const size_t) { args[0].float_ = Evaluate(args[0].float_); }
+};
+
+
+struct AbsTraits {
+    static const char *GetName() { return "ABS"; }
+    static const char *GetSummary() { return "Calculates the absolute value of a number."; }
+    static inline double ComputeFloat(const double x) { return std::fabs(x); }
+    static inline bool IntOverflows(const int64_t x, int64_t * const result) {
+        if (x < 0)
+            return NegateOverflows(x, result);
+        *result = x;
+        return false;
+    }
+};
+
+
+struct SignTraits {
+    static const char *GetName() { return "SIGN"; }
+    static const char *GetSummary() { return "Returns 1 for positive numbers, -1 for negative numbers and 0 for 0."; }
+    static inline double ComputeFloat(const double x) { return x > 0.0 ? 1.0 : (x < 0.0 ? -1.0 : x); }
+    static inline bool IntOverflows(const int64_t x, int64_t * const result) {
+        *result = (x > 0) - (x < 0);
+        return false;
+    }
+};
+
+
+/** A function of a single argument that returns a result of the same type, either a floating point number or an
+ *  integer.
+ */
+template<typename Traits> class UnaryNumericFunction final : public BuiltinFunction {
+public:
+    UnaryNumericFunction()
+        : BuiltinFunction(Traits::GetName(), Traits::GetSummary(),
+                          "Call with " + std::string(Traits::GetName()) + "(number).", NodeType::NULL_NODE) { }
+
+    NodeType validateArgTypes(const std::vector<NodeType> &arg_types) const override {
+        if (arg_types.size() != 1 or (arg_types[0] != NodeType::FLOAT_NODE and arg_types[0] != NodeType::INT_NODE))
+            return NodeType::NULL_NODE;
+        return arg_types[0];
+    }
+
+    void evaluateFunction(const FuncArgs &args, FuncResult * const result) const override {
+        if (args.getType(0) == NodeType::INT_NODE)
+            result->setInt(EvaluateInt(args.getInt(0)));
+        else
+            result->setFloat(Traits::ComputeFloat(args.getFloat(0)));
+    }
+
+    void evaluateBatch(const BatchFuncArgs &args, BatchFuncResult * const result) const override {
+        if (args.getType(0) == NodeType::INT_NODE) {
+            const int64_t * const x(args.getInts(0));
+            int64_t * const y(result->getInts());
+            for (size_t row(0); row < args.getRowCount(); ++row) {
+                if (Traits::IntOverflows(x[row], &y[row]) and not result->hasFailed(row))
+                    result->setError(row, getName() + "(): integer overflow!");
+            }
+        } else {
+            const double * const x(args.getFloats(0));
+            double * const y(result->getFloats());
+            for (size_t row(0); row < args.getRowCount(); ++row)
+                y[row] = Traits::ComputeFloat(x[row]);
+        }
+    }
+
+    FuncFastPath getFastPath(const std::vector<NodeType> &arg_types) const override
+        { return arg_types[0] == NodeType::INT_NODE ? IntFastPath : FloatFastPath; }
+private:
+    static inline int64_t EvaluateInt(const int64_t x) {
+        int64_t y;
+        if (Traits::IntOverflows(x, &y))
+            ThrowDomainError(Traits::GetName(), "integer overflow!");
+        return y;
+    }
+
+    static void FloatFastPath(FuncValue * const args, const size_t)
+        { args[0].float_ = Traits::ComputeFloat(args[0].float_); }
+    static void IntFastPath(FuncValue * const args, const size_t) { args[0].int_ = EvaluateInt(args[0].int_); }
+};
+
+
+struct Atan2Traits {
+    static const char *GetName() { return "ATAN2"; }
+    static const char *GetSummary() { return "Calculates the angle, in radians, of the point (x, y)."; }
+    static const char *GetUsageDescription() { return "Call with ATAN2(y, x)."; }
+    static inline bool IsInDomain(const double /*y*/, const double /*x*/) { return true; }
+    static inline double Compute(const double y, const double x) { return std::atan2(y, x); }
+};
+
+
+struct LogTraits {
+    static const char *GetName() { return "LOG"; }
+    static const char *GetSummary() { return "Calculates the logarithm of a number to a given base."; }
+    static const char *GetUsageDescription() { return "Call with LOG(number, base)."; }
+    static inline bool IsInDomain(const double x, const double base) {
+        return std::isnan(x) or std::isnan(base) or (x > 0.0 and base > 0.0 and base != 1.0);
+    }
+    static inline double Compute(const double x, const double base) { return std::log(x) / std::log(base); }
+};
+
+
+template<typename Traits> class BinaryMathFunction final : public BuiltinFunction {
+public:
+    BinaryMathFunction()
+        : BuiltinFunction(Traits::GetName(), Traits::GetSummary(), Traits::GetUsageDescription(),
+                          NodeType::FLOAT_NODE) { }
+
+    NodeType validateArgTypes(const std::vector<NodeType> &arg_types) const override {
+        return (arg_types.size() == 2 and AllArgsAre(arg_types, NodeType::FLOAT_NODE)) ? NodeType::FLOAT_NODE
+                                                                                       : NodeType::NULL_NODE;
+    }
+
+    void evaluateFunction(const FuncArgs &args, FuncResult * const result) const override
+        { result->setFloat(Evaluate(args.getFloat(0), args.getFloat(1))); }
+
+    void evaluateBatch(const BatchFuncArgs &args, BatchFuncResult * const result) const override {
+        const double * const lhs(args.getFloats(0));
+        const double * const rhs(args.getFloats(1));
+        for (size_t row(0); row < args.getRowCount(); ++row) {
+            if (not Traits::IsInDomain(lhs[row], rhs[row]) and not result->hasFailed(row))
+                result->setError(row, getName() + "(): argument out of range!");
+        }
+
+        double * const y(result->getFloats());
+        for (size_t row(0); row < args.getRowCount(); ++row)
+            y[row] = Traits::Compute(lhs[row], rhs[row]);
+    }
+
+    FuncFastPath getFastPath(const std::vector<NodeType> &/*arg_types*/) const override { return FastPath; }
+private:
+    static inline double Evaluate(const double lhs, const double rhs) {
+        if (not Traits::IsInDomain(lhs, rhs))
+            ThrowDomainError(Traits::GetName(), "argument out of range!");
+        return Traits::Compute(lhs, rhs);
+    }
+
+    static void FastPath(FuncValue * const args, const size_t)
+        { args[0].float_ = Evaluate(args[0].float_, args[1].float_); }
+};
+
+
+class RoundFunction final : public BuiltinFunction {
+public:
+    RoundFunction()
+        : BuiltinFunction("ROUND", "Rounds a number to a given number of decimal places, halfway cases away from "
+                          "zero.", "Call with ROUND(number) or ROUND(number, decimal_places).", NodeType::FLOAT_NODE)
+        { }
+
+    NodeType validateArgTypes(const std::vector<NodeType> &arg_types) const override {
+        if (arg_types.size() == 1 and arg_types[0] == NodeType::FLOAT_NODE)
+            return NodeType::FLOAT_NODE;
+        if (arg_types.size() == 2 and arg_types[0] == NodeType::FLOAT_NODE and arg_types[1] == NodeType::INT_NODE)
+            return NodeType::FLOAT_NODE;
+        return NodeType::NULL_NODE;
+    }
+
+    void evaluateFunction(const FuncArgs &args, FuncResult * const result) const override
+        { result->setFloat(args.size() == 1 ? std::round(args.getFloat(0)) : Round(args.getFloat(0), args.getInt(1))); }
+
+    void evaluateBatch(const BatchFuncArgs &args, BatchFuncResult * const result) const override {
+        const double * const x(args.getFloats(0));
+        double * const y(result->getFloats());
+        if (args.size() == 1) {
+            for (size_t row(0); row < args.getRowCount(); ++row)
+                y[row] = std::round(x[row]);
+        } else {
+            const int64_t * const decimal_places(args.getInts(1));
+            for (size_t row(0); row < args.getRowCount(); ++row)
+                y[row] = Round(x[row], decimal_places[row]);
+        }
+    }
+
+    FuncFastPath getFastPath(const std::vector<NodeType> &arg_types) const override
+        { return arg_types.size() == 1 ? FastPath : FastPathWithDecimalPlaces; }
+private:
+    static double Round(const double x, const int64_t decimal_places) {
+        if (decimal_places == 0)
+            return std::round(x);
+        if (decimal_places > std::numeric_limits<double>::max_exponent10)
+            return x;
+        if (decimal_places < -std::numeric_limits<double>::max_exponent10)
+            return std::copysign(0.0, x);
+
+        const double scale(std::pow(10.0, static_cast<double>(decimal_places < 0 ? -decimal_places
+                                                                                  : decimal_places)));
+        if (decimal_places < 0)
+            return std::round(x / scale) * scale;
+        const double scaled_x(x * scale);
+        return std::isfinite(scaled_x) ? std::round(scaled_x) / scale : x;
+    }
+
+    static void FastPath(FuncValue * const args, const size_t) { args[0].float_ = std::round(args[0].float_); }
+    static void FastPathWithDecimalPlaces(FuncValue * const args, const size_t)
+        { args[0].float_ = Round(args[0].float_, args[1].int_); }
+};
+
+
+class ModFunction final : public BuiltinFunction {
+public:
+    ModFunction()
+        : BuiltinFunction("MOD", "Calculates the remainder of a division, w/ the sign of the divisor.",
+                          "Call with MOD(dividend, divisor).", NodeType::NULL_NODE) { }
+
+    NodeType validateArgTypes(const std::vector<NodeType> &arg_types) const override {
+        if (arg_types.size() != 2 or arg_types[0] != arg_types[1]
+            or (arg_types[0] != NodeType::FLOAT_NODE and arg_types[0] != NodeType::INT_NODE))
+            return NodeType::NULL_NODE;
+        return arg_types[0];
+    }
+
+    void evaluateFunction(const FuncArgs &args, FuncResult * const result) const override {
+        if (args.getType(0) == NodeType::INT_NODE)
+            result->setInt(ModInt(args.getInt(0), args.getInt(1)));
+        else
+            result->setFloat(ModFloat(args.getFloat(0), args.getFloat(1)));
+    }
+
+    FuncFastPath getFastPath(const std::vector<NodeType> &arg_types) const override
+        { return arg_types[0] == NodeType::INT_NODE ? IntFastPath : FloatFastPath; }
+
+    IntrinsicKind getIntrinsicKind(const std::vector<NodeType> &arg_types) const override
+        { return arg_types[0] == NodeType::INT_NODE ? IntrinsicKind::INT_MODULO : IntrinsicKind::NONE; }
+private:
+    static int64_t ModInt(const int64_t dividend, const int64_t divisor) {
+        if (divisor == 0)
+            ThrowDomainError("MOD", "division by zero!");
+        return IntModulo(dividend, divisor);
+    }
+
+    static double ModFloat(const double dividend, const double divisor) {
+        if (divisor == 0.0)
+            ThrowDomainError("MOD", "division by zero!");
+        const double remainder(std::fmod(dividend, divisor));
+        return (remainder != 0.0 and (remainder < 0.0) != (divisor < 0.0)) ? remainder + divisor : remainder;
+    }
+
+    static void IntFastPath(FuncValue * const args, const size_t)
+        { args[0].int_ = ModInt(args[0].int_, args[1].int_); }
+    static void FloatFastPath(FuncValue * const args, const size_t)
+        { args[0].float_ = ModFloat(args[0].float_, args[1].float_); }
+};
+
+
+class QuotientFunction final : public BuiltinFunction {
+public:
+    QuotientFunction()
+        : BuiltinFunction("QUOTIENT", "Divides and discards the remainder, i.e. rounds the quotient towards zero.",
+                          "Call with QUOTIENT(dividend, divisor).", NodeType::NULL_NODE) { }
+
+    NodeType validateArgTypes(const std::vector<NodeType> &arg_types) const override {
+        if (arg_types.size() != 2 or arg_types[0] != arg_types[1]
+            or (arg_types[0] != NodeType::FLOAT_NODE and arg_types[0] != NodeType::INT_NODE))
+            return NodeType::NULL_NODE;
+        return arg_types[0];
+    }
+
+    void evaluateFunction(const FuncArgs &args, FuncResult * const result) const override {
+        if (args.getType(0) == NodeType::INT_NODE)
+            result->setInt(QuotientInt(args.getInt(0), args.getInt(1)));
+        else
+            result->setFloat(QuotientFloat(args.getFloat(0), args.getFloat(1)));
+    }
+
+    FuncFastPath getFastPath(const std::vector<NodeType> &arg_types) const override
+        { return arg_types[0] == NodeType::INT_NODE ? IntFastPath : FloatFastPath; }
+
+    IntrinsicKind getIntrinsicKind(const std::vector<NodeType> &arg_types) const override
+        { return arg_types[0] == NodeType::INT_NODE ? IntrinsicKind::INT_QUOTIENT : IntrinsicKind::NONE; }
+private:
+    static int64_t QuotientInt(const int64_t dividend, const int64_t divisor) {
+        if (divisor == 0)
+            ThrowDomainError("QUOTIENT", "division by zero!");
+        int64_t quotient;
+        if (QuotientOverflows(dividend, divisor, &quotient))
+            ThrowDomainError("QUOTIENT", "integer overflow!");
+        return quotient;
+    }
+
+    static double QuotientFloat(const double dividend, const double divisor) {
+        if (divisor == 0.0)
+            ThrowDomainError("QUOTIENT", "division by zero!");
+        return std::trunc(dividend / divisor);
+    }
+
+    static void IntFastPath(FuncValue * const args, const size_t)
+        { args[0].int_ = QuotientInt(args[0].int_, args[1].int_); }
+    static void FloatFastPath(FuncValue * const args, const size_t)
+        { args[0].float_ = QuotientFloat(args[0].float_, args[1].float_); }
+};
+
+
+class PiFunction final : public BuiltinFunction {
+public:
+    PiFunction(): BuiltinFunction("PI", "Returns the number pi.", "Call with PI().", NodeType::FLOAT_NODE) { }
+
+    NodeType validateArgTypes(const std::vector<NodeType> &arg_types) const override
+        { return arg_types.empty() ? NodeType::FLOAT_NODE : NodeType::NULL_NODE; }
+    void evaluateFunction(const FuncArgs &/*args*/, FuncResult * const result) const override
+        { result->setFloat(PI); }
+    FuncFastPath getFastPath(const std::vector<NodeType> &/*arg_types*/) const override { return FastPath; }
+private:
+    static void FastPath(FuncValue * const args, const size_t) { args[0].float_ = PI; }
+};
+
+
+// Reductions over all arguments of a call.  The traits of functions that also accept integers have a ReduceInt().
+
+
+struct SumTraits {
+    static const char *GetName() { return "SUM"; }
+    static const char *GetSummary() { return "Calculates the sum of its arguments."; }
+    static size_t GetMinArgCount() { return 1; }
+
+    static double ReduceFloat(const FuncValue * const args, const size_t arg_count) {
+        double sum(0.0);
+        for (size_t arg_no(0); arg_no < arg_count; ++arg_no)
+            sum += args[arg_no].float_;
+        return sum;
+    }
+
+    static int64_t ReduceInt(const FuncValue * const args, const size_t arg_count) {
+        int64_t sum(0);
+        for (size_t arg_no(0); arg_no < arg_count; ++arg_no) {
+            if (AddOverflows(sum, args[arg_no].int_, &sum))
+                ThrowDomainError(GetName(), "integer overflow!");
+        }
+        return sum;
+    }
+};
+
+
+struct MinTraits {
+    static const char *GetName() { return "MIN"; }
+    static const char *GetSummary() { return "Returns the smallest of its arguments."; }
+    static size_t GetMinArgCount() { return 1; }
+
+    // A NaN anywhere makes the result NaN and -0.0 counts as less than +0.0, so that the order of the arguments never
+    // matters.
+    static double ReduceFloat(const FuncValue * const args, const size_t arg_count) {
+        double min(args[0].float_);
+        for (size_t arg_no(1); arg_no < arg_count; ++arg_no) {
+            const double value(args[arg_no].float_);
+            if (value < min or std::isnan(value) or (value == min and std::signbit(value)))
+                min = value;
+        }
+        return min;
+    }
+
+    static int64_t ReduceInt(const FuncValue * const args, const size_t arg_count) {
+        int64_t min(args[0].int_);
+        for (size_t arg_no(1); arg_no < arg_count; ++arg_no)
+            min = std::min(min, args[arg_no].int_);
+        return min;
+    }
+};
+
+
+struct MaxTraits {
+    static const char *GetName() { return "MAX"; }
+    static const char *GetSummary() { return "Returns the largest of its arguments."; }
+    static size_t GetMinArgCount() { return 1; }
+
+    // Like MinTraits::ReduceFloat().
+    static double ReduceFloat(const FuncValue * const args, const size_t arg_count) {
+        double max(args[0].float_);
+        for (size_t arg_no(1); arg_no < arg_count; ++arg_no) {
+            const double value(args[arg_no].float_);
+            if (value > max or std::isnan(value) or (value == max and not std::signbit(value)))
+                max = value;
+        }
+        return max;
+    }
+
+    static int64_t ReduceInt(const FuncValue * const args, const size_t arg_count) {
+        int64_t max(args[0].int_);
+        for (size_t arg_no(1); arg_no < arg_count; ++arg_no)
+            max = std::max(max, args[arg_no].int_);
+        return max;
+    }
+};
+
+
+struct AverageTraits {
+    static const char *GetName() { return "AVERAGE"; }
+    static const char *GetSummary() { return "Calculates the arithmetic mean of its arguments."; }
+    static size_t GetMinArgCount() { return 1; }
+
+    static double ReduceFloat(const FuncValue * const args, const size_t arg_count)
+        { return SumTraits::ReduceFloat(args, arg_count) / static_cast<double>(arg_count); }
+};
+
+
+struct MedianTraits {
+    static const char *GetName() { return "MEDIAN"; }
+    static const char *GetSummary() { return "Calculates the median of its arguments."; }
+    static size_t GetMinArgCount() { return 1; }
+
+    static double ReduceFloat(const FuncValue * const args, const size_t arg_count) {
+        // Calls w/ a handful of arguments are the norm, so we only allocate for unusually long argument lists.
+        const size_t MAX_STACK_VALUE_COUNT(32);
+        double stack_values[MAX_STACK_VALUE_COUNT] = { };
+        std::vector<double> heap_values;
+        double *values(stack_values);
+        if (arg_count > MAX_STACK_VALUE_COUNT) {
+            heap_values.resize(arg_count);
+            values = heap_values.data();
+        }
+        for (size_t arg_no(0); arg_no < arg_count; ++arg_no) {
+            // NaNs would break the strict weak ordering std::nth_element() relies on.
+            if (std::isnan(args[arg_no].float_))
+                return args[arg_no].float_;
+            values[arg_no] = args[arg_no].float_;
+        }
+
+        double * const middle(values + arg_count / 2);
+        std::nth_element(values, middle, values + arg_count);
+        if (arg_count % 2 == 1)
+            return *middle;
+        return (*std::max_element(values, middle) + *middle) / 2.0;
+    }
+};
+
+
+struct VarTraits {
+    static const char *GetName() { return "VAR"; }
+    static const char *GetSummary() { return "Calculates the sample variance of its arguments."; }
+    static size_t GetMinArgCount() { return 2; }
+
+    static double ReduceFloat(const FuncValue * const args, const size_t arg_count) {
+        const double mean(AverageTraits::ReduceFloat(args, arg_count));
+        double sum_of_squares(0.0);
+        for (size_t arg_no(0); arg_no < arg_count; ++arg_no)
+            sum_of_squares += (args[arg_no].float_ - mean) * (args[arg_no].float_ - mean);
+        return sum_of_squares / static_cast<double>(arg_count - 1);
+    }
+};
+
+
+struct StdevTraits {
+    static const char *GetName() { return "STDEV"; }
+    static const char *GetSummary() { return "Calculates the sample standard deviation of its arguments."; }
+    static size_t GetMinArgCount() { return 2; }
+
+    static double ReduceFloat(const FuncValue * const args, const size_t arg_count)
+        { return std::sqrt(VarTraits::ReduceFloat(args, arg_count)); }
+};
+
+
+/** A function of any number of floating point arguments. */
+template<typename Traits> class FloatReductionFunction : public BuiltinFunction {
+public:
+    FloatReductionFunction(const NodeType return_type = NodeType::FLOAT_NODE)
+        : BuiltinFunction(Traits::GetName(), Traits::GetSummary(),
+                          "Call with " + std::string(Traits::GetName()) + "(number, number, ...).", return_type) { }
+
+    NodeType validateArgTypes(const std::vector<NodeType> &arg_types) const override {
+        return (arg_types.size() >= Traits::GetMinArgCount() and AllArgsAre(arg_types, NodeType::FLOAT_NODE))
+               ? NodeType::FLOAT_NODE : NodeType::NULL_NODE;
+    }
+
+    void evaluateFunction(const FuncArgs &args, FuncResult * const result) const override
+        { result->setFloat(Traits::ReduceFloat(args.getValues(), args.size())); }
+
+    FuncFastPath getFastPath(const std::vector<NodeType> &/*arg_types*/) const override { return FloatFastPath; }
+private:
+    static void FloatFastPath(FuncValue * const args, const size_t arg_count)
+        { args[0].float_ = Traits::ReduceFloat(args, arg_count); }
+};
+
+
+/** Like FloatReductionFunction but if all arguments are integers, so is the result. */
+template<typename Traits> class NumericReductionFunction final : public FloatReductionFunction<Traits> {
+public:
+    NumericReductionFunction(): FloatReductionFunction<Traits>(NodeType::NULL_NODE) { }
+
+    NodeType validateArgTypes(const std::vector<NodeType> &arg_types) const override {
+        if (arg_types.size() >= Traits::GetMinArgCount() and AllArgsAre(arg_types, NodeType::INT_NODE))
+            return NodeType::INT_NODE;
+        return FloatReductionFunction<Traits>::validateArgTypes(arg_types);
+    }
+
+    void evaluateFunction(const FuncArgs &args, FuncResult * const result) const override {
+        if (args.getType(0) == NodeType::INT_NODE)
+            result->setInt(Traits::ReduceInt(args.getValues(), args.size()));
+        else
+            FloatReductionFunction<Traits>::evaluateFunction(args, result);
+    }
+
+    FuncFastPath getFastPath(const std::vector<NodeType> &arg_types) const override {
+        return arg_types[0] == NodeType::INT_NODE ? IntFastPath
+                                                  : FloatReductionFunction<Traits>::getFastPath(arg_types);
+    }
+private:
+    static void IntFastPath(FuncValue * const args, const size_t arg_count)
+        { args[0].int_ = Traits::ReduceInt(args, arg_count); }
+};
+
+
+class NotFunction final : public BuiltinFunction {
+public:
+    NotFunction()
+        : BuiltinFunction("NOT", "Negates a truth value.", "Call with NOT(truth_value).", NodeType::BOOLEAN_NODE) { }
+
+    NodeType validateArgTypes(const std::vector<NodeType> &arg_types) const override {
+        return (arg_types.size() == 1 and arg_types[0] == NodeType::BOOLEAN_NODE) ? NodeType::BOOLEAN_NODE
+                                                                                 : NodeType::NULL_NODE;
+    }
+
+    void evaluateFunction(const FuncArgs &args, FuncResult * const result) const override
+        { result->setBool(not args.getBool(0)); }
+
+    void evaluateBatch(const BatchFuncArgs &args, BatchFuncResult * const result) const override {
+        const uint64_t * const x(args.getBools(0));
+        uint64_t * const y(result->getBools());
+        for (size_t word_no(0); word_no < MaskWordCount(args.getRowCount()); ++word_no)
+            y[word_no] = ~x[word_no];
+    }
+
+    FuncFastPath getFastPath(const std::vector<NodeType> &/*arg_types*/) const override { return FastPath; }
+private:
+    static void FastPath(FuncValue * const args, const size_t) { args[0].bool_ = not args[0].bool_; }
+};
+
+
+struct AndTraits {
+    static const char *GetName() { return "AND"; }
+    static ShortCircuitKind GetShortCircuitKind() { return ShortCircuitKind::AND; }
+    static const char *GetSummary() { return "Returns true if all of its arguments are true."; }
+    static inline bool Combine(const bool lhs, const bool rhs) { return lhs and rhs; }
+    static inline uint64_t CombineWords(const uint64_t lhs, const uint64_t rhs) { return lhs & rhs; }
+};
+
+
+struct OrTraits {
+    static const char *GetName() { return "OR"; }
+    static ShortCircuitKind GetShortCircuitKind() { return ShortCircuitKind::OR; }
+    static const char *GetSummary() { return "Returns true if at least one of its arguments is true."; }
+    static inline bool Combine(const bool lhs, const bool rhs) { return lhs or rhs; }
+    static inline uint64_t CombineWords(const uint64_t lhs, const uint64_t rhs) { return lhs | rhs; }
+};
+
+
+struct XorTraits {
+    static const char *GetName() { return "XOR"; }
+    static ShortCircuitKind GetShortCircuitKind() { return ShortCircuitKind::NONE; }
+    static const char *GetSummary() { return "Returns true if an odd number of its arguments is true."; }
+    static inline bool Combine(const bool lhs, const bool rhs) { return lhs != rhs; }
+    static inline uint64_t CombineWords(const uint64_t lhs, const uint64_t rhs) { return lhs ^ rhs; }
+};
+
+
+/** A function that combines any number of truth values. */
+template<typename Traits> class LogicalFunction final : public BuiltinFunction {
+public:
+    LogicalFunction()
+        : BuiltinFunction(Traits::GetName(), Traits::GetSummary(),
+                          "Call with " + std::string(Traits::GetName()) + "(truth_value, truth_value, ...).",
+                          NodeType::BOOLEAN_NODE) { }
+
+    NodeType validateArgTypes(const std::vector<NodeType> &arg_types) const override {
+        return (not arg_types.empty() and AllArgsAre(arg_types, NodeType::BOOLEAN_NODE)) ? NodeType::BOOLEAN_NODE
+                                                                                        : NodeType::NULL_NODE;
+    }
+
+    void evaluateFunction(const FuncArgs &args, FuncResult * const result) const override
+        { result->setBool(Reduce(args.getValues(), args.size())); }
+
+    // 64 rows at a time.
+    void evaluateBatch(const BatchFuncArgs &args, BatchFuncResult * const result) const override {
+        uint64_t * const y(result->getBools());
+        for (size_t word_no(0); word_no < MaskWordCount(args.getRowCount()); ++word_no) {
+            uint64_t word(args.getBools(0)[word_no]);
+            for (size_t arg_no(1); arg_no < args.size(); ++arg_no)
+                word = Traits::CombineWords(word, args.getBools(arg_no)[word_no]);
+            y[word_no] = word;
+        }
+    }
+
+    FuncFastPath getFastPath(const std::vector<NodeType> &/*arg_types*/) const override { return FastPath; }
+    ShortCircuitKind getShortCircuitKind() const override { return Traits::GetShortCircuitKind(); }
+private:
+    static inline bool Reduce(const FuncValue * const args, const size_t arg_count) {
+        bool value(args[0].bool_);
+        for (size_t arg_no(1); arg_no < arg_count; ++arg_no)
+            value = Traits::Combine(value, args[arg_no].bool_);
+        return value;
+    }
+
+    static void FastPath(FuncValue * const args, const size_t arg_count)
+        { args[0].bool_ = Reduce(args, arg_count); }
+};
+
+
+class IfFunction final : public BuiltinFunction {
+public:
+    IfFunction()
+        : BuiltinFunction("IF", "Returns one of two values depending on a condition.",
+                          "Call with IF(condition, value_if_true, value_if_false).", NodeType::NULL_NODE) { }
+
+    NodeType validateArgTypes(const std::vector<NodeType> &arg_types) const override {
+        if (arg_types.size() != 3 or arg_types[0] != NodeType::BOOLEAN_NODE or arg_types[1] != arg_types[2])
+            return NodeType::NULL_NODE;
+        return arg_types[1];
+    }
+
+    void evaluateFunction(const FuncArgs &args, FuncResult * const result) const override {
+        const size_t chosen_arg_no(args.getBool(0) ? 1 : 2);
+        switch (args.getType(chosen_arg_no)) {
+        case NodeType::FLOAT_NODE:
+            result->setFloat(args.getFloat(chosen_arg_no));
+            break;
+        case NodeType::INT_NODE:
+            result->setInt(args.getInt(chosen_arg_no));
+            break;
+        case NodeType::BOOLEAN_NODE:
+            result->setBool(args.getBool(chosen_arg_no));
+            break;
+        default:
+            result->setString(args.getString(chosen_arg_no));
+        }
+    }
+
+    FuncFastPath getFastPath(const std::vector<NodeType> &arg_types) const override {
+        switch (arg_types[1]) {
+        case NodeType::FLOAT_NODE:
+            return FastPath<double, &FuncValue::float_>;
+        case NodeType::INT_NODE:
+            return FastPath<int64_t, &FuncValue::int_>;
+        case NodeType::BOOLEAN_NODE:
+            return FastPath<bool, &FuncValue::bool_>;
+        default:
+            return nullptr;
+        }
+    }
+
+    ShortCircuitKind getShortCircuitKind() const override { return ShortCircuitKind::IF; }
+private:
+    template<typename ValueType, ValueType FuncValue::*member>
+    static void FastPath(FuncValue * const args, const size_t)
+        { args[0].*member = args[0].bool_ ? args[1].*member : args[2].*member; }
+};
+
+
+class LenFunction final : public BuiltinFunction {
+public:
+    LenFunction()
+        : BuiltinFunction("LEN", "Returns the number of characters in a string.", "Call with LEN(string).",
+                          NodeType::INT_NODE) { }
+
+    NodeType validateArgTypes(const std::vector<NodeType> &arg_types) const override {
+        return (arg_types.size() == 1 and arg_types[0] == NodeType::STRING_NODE) ? NodeType::INT_NODE
+                                                                                : NodeType::NULL_NODE;
+    }
+
+    void evaluateFunction(const FuncArgs &args, FuncResult * const result) const override
+        { result->setInt(static_cast<int64_t>(args.getString(0).size())); }
+    FuncFastPath getFastPath(const std::vector<NodeType> &/*arg_types*/) const override { return FastPath; }
+private:
+    static void FastPath(FuncValue * const args, const size_t)
+        { args[0].int_ = static_cast<int64_t>(args[0].string_->size()); }
+};
+
+
+class FindFunction final : public BuiltinFunction {
+public:
+    FindFunction()
+        : BuiltinFunction("FIND", "Returns the position, starting at 1, of the first occurrence of a string in "
+                          "another string or 0 if there is none.",
+                          "Call with FIND(needle, haystack) or FIND(needle, haystack, start_position).",
+                          NodeType::INT_NODE) { }
+
+    NodeType validateArgTypes(const std::vector<NodeType> &arg_types) const override {
+        if ((arg_types.size() != 2 and arg_types.size() != 3) or arg_types[0] != NodeType::STRING_NODE
+            or arg_types[1] != NodeType::STRING_NODE
+            or (arg_types.size() == 3 and arg_types[2] != NodeType::INT_NODE))
+            return NodeType::NULL_NODE;
+        return NodeType::INT_NODE;
+    }
+
+    void evaluateFunction(const FuncArgs &args, FuncResult * const result) const override
+        { result->setInt(Find(args.getValues(), args.size())); }
+    FuncFastPath getFastPath(const std::vector<NodeType> &/*arg_types*/) const override { return FastPath; }
+private:
+    static int64_t Find(const FuncValue * const args, const size_t arg_count) {
+        const int64_t start_position(arg_count == 3 ? args[2].int_ : 1);
+        if (start_position < 1)
+            ThrowInvalidArgument("FIND", "start position must be at least 1!");
+        const std::string &haystack(*args[1].string_);
+        if (static_cast<uint64_t>(start_position - 1) > haystack.size())
+            return 0;
+
+        const size_t position(haystack.find(*args[0].string_, static_cast<size_t>(start_position - 1)));
+        return position == std::string::npos ? 0 : static_cast<int64_t>(position + 1);
+    }
+
+    static void FastPath(FuncValue * const args, const size_t arg_count) { args[0].int_ = Find(args, arg_count); }
+};
+
+
+/** A function w/ a string result, for which we have no fast paths. */
+class StringFunction : public BuiltinFunction {
+    const std::vector<NodeType> mandatory_arg_types_;
+    const std::vector<NodeType> optional_arg_types_;
+public:
+    StringFunction(const std::string &name, const std::string &summary, const std::string &usage_description,
+                   const std::vector<NodeType> &mandatory_arg_types,
+                   const std::vector<NodeType> &optional_arg_types = {})
+        : BuiltinFunction(name, summary, usage_description, NodeType::STRING_NODE),
+          mandatory_arg_types_(mandatory_arg_types), optional_arg_types_(optional_arg_types) { }
+
+    NodeType validateArgTypes(const std::vector<NodeType> &arg_types) const override {
+        if (arg_types.size() < mandatory_arg_types_.size()
+            or arg_types.size() > mandatory_arg_types_.size() + optional_arg_types_.size())
+            return NodeType::NULL_NODE;
+        for (size_t arg_no(0); arg_no < arg_types.size(); ++arg_no) {
+            const NodeType expected_type(arg_no < mandatory_arg_types_.size()
+                                         ? mandatory_arg_types_[arg_no]
+                                         : optional_arg_types_[arg_no - mandatory_arg_types_.size()]);
+            if (arg_types[arg_no] != expected_type)
+                return NodeType::NULL_NODE;
+        }
+        return NodeType::STRING_NODE;
+    }
+protected:
+    /** \return "count" if it is not negative, else throws std::invalid_argument. */
+    size_t checkCount(const int64_t count) const {
+        if (count < 0)
+            ThrowInvalidArgument(getName(), "negative count!");
+        return static_cast<size_t>(count);
+    }
+};
+
+
+class UpperFunction final : public StringFunction {
+public:
+    UpperFunction(): StringFunction("UPPER", "Converts a string to upper case.", "Call with UPPER(string).",
+                                    { NodeType::STRING_NODE }) { }
+
+    void evaluateFunction(const FuncArgs &args, FuncResult * const result) const override {
+        std::string &upper_case_string(result->setString(args.getString(0)));
+        std::transform(upper_case_string.begin(), upper_case_string.end(), upper_case_string.begin(),
+                       [](const unsigned char ch) { return static_cast<char>(std::toupper(ch)); });
+    }
+};
+
+
+class LowerFunction final : public StringFunction {
+public:
+    LowerFunction(): StringFunction("LOWER", "Converts a string to lower case.", "Call with LOWER(string).",
+                                    { NodeType::STRING_NODE }) { }
+
+    void evaluateFunction(const FuncArgs &args, FuncResult * const result) const override {
+        std::string &lower_case_string(result->setString(args.getString(0)));
+        std::transform(lower_case_string.begin(), lower_case_string.end(), lower_case_string.begin(),
+                       [](const unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+    }
+};
+
+
+class TrimFunction final : public StringFunction {
+public:
+    TrimFunction(): StringFunction("TRIM", "Removes leading and trailing whitespace from a string.",
+                                   "Call with TRIM(string).", { NodeType::STRING_NODE }) { }
+
+    void evaluateFunction(const FuncArgs &args, FuncResult * const result) const override {
+        const std::string &s(args.getString(0));
+        const auto is_space([](const unsigned char ch) { return std::isspace(ch) != 0; });
+        const auto first(std::find_if_not(s.cbegin(), s.cend(), is_space));
+        const auto last(std::find_if_not(s.crbegin(), std::string::const_reverse_iterator(first), is_space).base());
+        result->setString(s.data() + (first - s.cbegin()), static_cast<size_t>(last - first));
+    }
+};
+
+
+class LeftFunction final : public StringFunction {
+public:
+    LeftFunction(): StringFunction("LEFT", "Returns the first characters of a string.",
+                                   "Call with LEFT(string) or LEFT(string, count).", { NodeType::STRING_NODE },
+                                   { NodeType::INT_NODE }) { }
+
+    void evaluateFunction(const FuncArgs &args, FuncResult * const result) const override {
+        const std::string &s(args.getString(0));
+        const size_t count(args.size() == 1 ? 1 : checkCount(args.getInt(1)));
+        result->setString(s.data(), std::min(count, s.size()));
+    }
+};
+
+
+class RightFunction final : public StringFunction {
+public:
+    RightFunction(): StringFunction("RIGHT", "Returns the last characters of a string.",
+                                    "Call with RIGHT(string) or RIGHT(string, count).", { NodeType::STRING_NODE },
+                                    { NodeType::INT_NODE }) { }
+
+    void evaluateFunction(const FuncArgs &args, FuncResult * const result) const override {
+        const std::string &s(args.getString(0));
+        const size_t count(std::min(args.size() == 1 ? 1 : checkCount(args.getInt(1)), s.size()));
+        result->setString(s.data() + s.size() - count, count);
+    }
+};
+
+
+class MidFunction final : public StringFunction {
+public:
+    MidFunction(): StringFunction("MID", "Returns the characters of a string starting at a given position, the first "
+                                  "position being 1.", "Call with MID(string, start_position, count).",
+                                  { NodeType::STRING_NODE, NodeType::INT_NODE, NodeType::INT_NODE }) { }
+
+    void evaluateFunction(const FuncArgs &args, FuncResult * const result) const override {
+        const std::string &s(args.getString(0));
+        if (args.getInt(1) < 1)
+            ThrowInvalidArgument(getName(), "start position must be at least 1!");
+        const size_t count(checkCount(args.getInt(2)));
+
+        const uint64_t start(static_cast<uint64_t>(args.getInt(1)) - 1);
+        if (start >= s.size())
+            result->setString(s.data(), 0);
+        else
+            result->setString(s.data() + start, std::min(count, s.size() - static_cast<size_t>(start)));
+    }
+};
+
+
+class SubstituteFunction final : public StringFunction {
+public:
+    SubstituteFunction()
+        : StringFunction("SUBSTITUTE", "Replaces all occurrences of a string in another string.",
+                         "Call with SUBSTITUTE(string, old_text, new_text).",
+                         { NodeType::STRING_NODE, NodeType::STRING_NODE, NodeType::STRING_NODE }) { }
+
+    // Only the first argument may share storage w/ the result, so we can replace in place.
+    void evaluateFunction(const FuncArgs &args, FuncResult * const result) const override {
+        const std::string &old_text(args.getString(1)), &new_text(args.getString(2));
+        std::string &s(result->setString(args.getString(0)));
+        if (old_text.empty())
+            return;
+
+        for (size_t position(s.find(old_text)); position != std::string::npos;
+             position = s.find(old_text, position + new_text.size()))
+            s.replace(position, old_text.size(), new_text);
+    }
+};
+
+
+class ReptFunction final : public StringFunction {
+    static const size_t MAX_RESULT_LENGTH = 1u << 24;
+public:
+    ReptFunction(): StringFunction("REPT", "Repeats a string a given number of times.",
+                                   "Call with REPT(string, count).", { NodeType::STRING_NODE, NodeType::INT_NODE })
+        { }
+
+    void evaluateFunction(const FuncArgs &args, FuncResult * const result) const override {
+        const size_t length(args.getString(0).size());
+        const size_t count(checkCount(args.getInt(1)));
+        if (count == 0 or length == 0) {
+            result->setString(nullptr, 0);
+            return;
+        }
+        if (count > MAX_RESULT_LENGTH / length)
+            ThrowInvalidArgument(getName(), "result too long!");
+
+        std::string &s(result->setString(args.getString(0)));
+        s.reserve(length * count);
+        for (size_t i(1); i < count; ++i)
+            s.append(s, 0, length);
+    }
+};
+
+
+class ConcatenateFunction final : public BuiltinFunction {
+public:
+    ConcatenateFunction()
+        : BuiltinFunction("CONCATENATE", "Joins strings.", "Call with CONCATENATE(string, string, ...).",
+                          NodeType::STRING_NODE) { }
+
+    NodeType validateArgTypes(const std::vector<NodeType> &arg_types) const override {
+        return (not arg_types.empty() and AllArgsAre(arg_types, NodeType::STRING_NODE)) ? NodeType::STRING_NODE
+                                                                                       : NodeType::NULL_NODE;
+    }
+
+    void evaluateFunction(const FuncArgs &args, FuncResult * const result) const override {
+        std::string &s(result->setString(args.getString(0)));
+        for (size_t arg_no(1); arg_no < args.size(); ++arg_no)
+            s += args.getString(arg_no);
+    }
+};
+
+
+} // unnamed namespace
+
+
+// Never destroyed, so that the functions remain usable during static destruction.
+const std::vector<const Function *> &GetBuiltinFunctions() {
+    static const std::vector<const Function *> * const builtin_functions(new std::vector<const Function *>{
+        new UnaryMathFunction<SqrtTraits>(),
+        new UnaryMathFunction<ExpTraits>(),
+        new UnaryMathFunction<LnTraits>(),
+        new UnaryMathFunction<Log10Traits>(),
+        new UnaryMathFunction<SinTraits>(),
+        new UnaryMathFunction<CosTraits>(),
+        new UnaryMathFunction<TanTraits>(),
+        new UnaryMathFunction<AsinTraits>(),
+        new UnaryMathFunction<AcosTraits>(),
+        new UnaryMathFunction<AtanTraits>(),
+        new UnaryMathFunction<SinhTraits>(),
+        new UnaryMathFunction<CoshTraits>(),
+        new UnaryMathFunction<TanhTraits>(),
+        new UnaryMathFunction<DegreesTraits>(),
+        new UnaryMathFunction<RadiansTraits>(),
+        new UnaryMathFunction<FloorTraits>(),
+        new UnaryMathFunction<CeilTraits>(),
+        new UnaryMathFunction<TruncTraits>(),
+        new UnaryNumericFunction<AbsTraits>(),
+        new UnaryNumericFunction<SignTraits>(),
+        new BinaryMathFunction<Atan2Traits>(),
+        new BinaryMathFunction<LogTraits>(),
+        new RoundFunction(),
+        new ModFunction(),
+        new QuotientFunction(),
+        new PiFunction(),
+        new NumericReductionFunction<SumTraits>(),
+        new NumericReductionFunction<MinTraits>(),
+        new NumericReductionFunction<MaxTraits>(),
+        new FloatReductionFunction<AverageTraits>(),
+        new FloatReductionFunction<MedianTraits>(),
+        new FloatReductionFunction<VarTraits>(),
+        new FloatReductionFunction<StdevTraits>(),
+        new NotFunction(),
+        new LogicalFunction<AndTraits>(),
+        new LogicalFunction<OrTraits>(),
+        new LogicalFunction<XorTraits>(),
+        new IfFunction(),
+        new LenFunction(),
+        new FindFunction(),
+        new UpperFunction(),
+        new LowerFunction(),
+        new TrimFunction(),
+        new LeftFunction(),
+        new RightFunction(),
+        new MidFunction(),
+        new SubstituteFunction(),
+        new ReptFunction(),
+        new ConcatenateFunction(),
+    });
+
+    return *builtin_functions;
+}
+
+
+void RegisterBuiltinFunctions(FunctionRegistry * const function_registry) {
+    for (const auto function : GetBuiltinFunctions())
+        function_registry->registerFunction(*function);
+}
+
+
+} // namespace Nyaa
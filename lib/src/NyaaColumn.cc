@@ -0,0 +1,111 @@
+/** \file    NyaaColumn.cc
+ *  \brief   Implementation of the column types.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "NyaaColumn.h"
+
+
+namespace Nyaa {
+
+
+constexpr size_t ResultColumn::ERROR_BLOCK_SIZE;
+
+
+void ResultColumn::reset(const NodeType type, const size_t size) {
+    type_ = type;
+
+    floats_.clear();
+    ints_.clear();
+    bools_.clear();
+    strings_.clear();
+    switch (type) {
+    case NodeType::FLOAT_NODE:
+        floats_.resize(size);
+        break;
+    case NodeType::INT_NODE:
+        ints_.resize(size);
+        break;
+    case NodeType::BOOLEAN_NODE:
+        bools_.resize(size);
+        break;
+    case NodeType::STRING_NODE:
+        strings_.resize(size);
+        break;
+    default:
+        break;
+    }
+
+    errors_.assign(size, 0);
+    error_messages_.clear();
+    error_messages_.resize((size + ERROR_BLOCK_SIZE - 1) / ERROR_BLOCK_SIZE);
+}
+
+
+const std::string &ResultColumn::getErrorMessage(const size_t row) const {
+    static const std::string NO_ERROR;
+    if (errors_[row] == 0)
+        return NO_ERROR;
+    return error_messages_[row / ERROR_BLOCK_SIZE].find(row)->second;
+}
+
+
+size_t ResultColumn::getErrorCount() const {
+    size_t error_count(0);
+    for (const auto &block_error_messages : error_messages_)
+        error_count += block_error_messages.size();
+    return error_count;
+}
+
+
+void ResultColumn::setError(const size_t row, const std::string &error_message) {
+    if (errors_[row] != 0)
+        return;
+
+    errors_[row] = 1;
+    error_messages_[row / ERROR_BLOCK_SIZE].emplace(row, error_message);
+}
+
+
+void ResultColumn::clearError(const size_t row) {
+    if (errors_[row] == 0)
+        return;
+
+    errors_[row] = 0;
+    error_messages_[row / ERROR_BLOCK_SIZE].erase(row);
+}
+
+
+ColumnView ResultColumn::getColumnView() const {
+    switch (type_) {
+    case NodeType::FLOAT_NODE:
+        return ColumnView(floats_.data(), size(), errors_.data());
+    case NodeType::INT_NODE:
+        return ColumnView(ints_.data(), size(), errors_.data());
+    case NodeType::BOOLEAN_NODE:
+        return ColumnView(bools_.data(), size(), errors_.data());
+    case NodeType::STRING_NODE:
+        return ColumnView(strings_.data(), size(), errors_.data());
+    default:
+        return ColumnView();
+    }
+}
+
+
+} // namespace Nyaa
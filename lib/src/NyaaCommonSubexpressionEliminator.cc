@@ -0,0 +1,378 @@
+/** \file    NyaaCommonSubexpressionEliminator.cc
+ *  \brief   Implementation of the CommonSubexpressionEliminator class.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "NyaaCommonSubexpressionEliminator.h"
+#include <algorithm>
+#include <stdexcept>
+
+
+namespace Nyaa {
+
+
+static NodeType GetResultType(const CodeAndSourceLocation &instruction, const ConstantPool &constant_pool) {
+    switch (instruction.getCode()) {
+    case Instruction::FADD:
+    case Instruction::FSUB:
+    case Instruction::FMUL:
+    case Instruction::FDIV:
+    case Instruction::FPOW:
+    case Instruction::FUMINUS:
+    case Instruction::FUPLUS:
+    case Instruction::FCONVI:
+    case Instruction::FCONVB:
+    case Instruction::FCONVS:
+    case Instruction::FPUSH:
+    case Instruction::FAREFI:
+        return NodeType::FLOAT_NODE;
+    case Instruction::SCONCAT:
+    case Instruction::SCONVF:
+    case Instruction::SCONVI:
+    case Instruction::SCONVB:
+    case Instruction::SPUSH:
+    case Instruction::SCONCATF:
+    case Instruction::SCONCATI:
+    case Instruction::SCONCATB:
+        return NodeType::STRING_NODE;
+    case Instruction::BEQLF:
+    case Instruction::BNEQLF:
+    case Instruction::BGTF:
+    case Instruction::BLTF:
+    case Instruction::BGTEF:
+    case Instruction::BLTEF:
+    case Instruction::BEQLS:
+    case Instruction::BNEQLS:
+    case Instruction::BGTS:
+    case Instruction::BLTS:
+    case Instruction::BGTES:
+    case Instruction::BLTES:
+    case Instruction::BGTB:
+    case Instruction::BLTB:
+    case Instruction::BGTEB:
+    case Instruction::BLTEB:
+    case Instruction::BEQLB:
+    case Instruction::BNEQLB:
+    case Instruction::BEQLI:
+    case Instruction::BNEQLI:
+    case Instruction::BGTI:
+    case Instruction::BLTI:
+    case Instruction::BGTEI:
+    case Instruction::BLTEI:
+    case Instruction::BPUSH:
+    case Instruction::BEQLFAC:
+    case Instruction::BNEQLFAC:
+    case Instruction::BGTFAC:
+    case Instruction::BLTFAC:
+    case Instruction::BGTEFAC:
+    case Instruction::BLTEFAC:
+    case Instruction::BEQLIAC:
+    case Instruction::BNEQLIAC:
+    case Instruction::BGTIAC:
+    case Instruction::BLTIAC:
+    case Instruction::BGTEIAC:
+    case Instruction::BLTEIAC:
+        return NodeType::BOOLEAN_NODE;
+    case Instruction::IADD:
+    case Instruction::ISUB:
+    case Instruction::IMUL:
+    case Instruction::IDIV:
+    case Instruction::IMOD:
+    case Instruction::IUMINUS:
+    case Instruction::IPUSH:
+        return NodeType::INT_NODE;
+    case Instruction::CALL:
+    case Instruction::CALLF:
+        return constant_pool.getCallSite(instruction.getOperand()).return_type_;
+    case Instruction::AREF:
+    case Instruction::AREF2:
+        return constant_pool.getAttribRef(instruction.getOperand()).type_;
+    case Instruction::STORE:
+    case Instruction::LOAD:
+        return static_cast<NodeType>(instruction.getOperand2());
+    case Instruction::JUMP:
+    case Instruction::JUMP_IF_FALSE:
+    case Instruction::JUMP_IF_TRUE:
+        throw std::logic_error("in GetResultType: jumps have no result!");
+    }
+
+    throw std::range_error("in GetResultType: unknown instruction "
+                           + std::to_string(static_cast<int>(instruction.getCode())) + "!");
+}
+
+
+static inline bool IsPush(const Instruction instruction) {
+    return instruction == Instruction::FPUSH or instruction == Instruction::SPUSH or instruction == Instruction::BPUSH
+           or instruction == Instruction::IPUSH;
+}
+
+
+static inline void AppendUInt32(const uint32_t value, std::string * const key) {
+    key->append(reinterpret_cast<const char *>(&value), sizeof value);
+}
+
+
+static constexpr uint32_t NONE(UINT32_MAX);
+
+
+void CommonSubexpressionEliminator::eliminate(Program * const program) {
+    reuse_count_ = 0;
+    if (program->empty())
+        return;
+
+    code_.assign(program->begin(), program->end());
+    numberValues(program->getConstantPool());
+    buildDominanceTable();
+    markReuses();
+
+    program->clearCode();
+    emit(program);
+}
+
+
+// Instructions are postfix, so we can recover the operands of each instruction w/ a stack.  The value number of an
+// instruction is determined by the instruction, its operands and the value numbers of its operands.  At the target of
+// a jump we continue w/ the stack that was saved at the jump, unless we can also fall through to it, which leaves
+// the same values on the stack.  Only the value carried by a JUMP differs between the paths and thus gets a value
+// number of its own, which is never shared.
+void CommonSubexpressionEliminator::numberValues(const ConstantPool &constant_pool) {
+    nodes_.resize(code_.size());
+    key_to_value_number_map_.clear();
+    candidates_.clear();
+    has_jumps_ = false;
+
+    struct JumpTargetState {
+        std::vector<StackEntry> stack_;
+        bool carries_value_;
+    };
+    std::unordered_map<uint32_t, JumpTargetState> target_to_state_map;
+
+    std::vector<StackEntry> stack;
+    std::string key;
+    bool reachable(true); // By falling through from the previous instruction.
+    for (uint32_t address(0); address <= code_.size(); ++address) {
+        const auto target_and_state(target_to_state_map.find(address));
+        if (target_and_state != target_to_state_map.end()) {
+            if (not reachable)
+                stack.swap(target_and_state->second.stack_);
+            if (target_and_state->second.carries_value_) {
+                if (stack.empty())
+                    throw std::logic_error("in CommonSubexpressionEliminator::numberValues: corrupt program, "
+                                           "JUMP w/o a value!");
+                key.clear();
+                AppendUInt32(NONE, &key);
+                AppendUInt32(address, &key);
+                stack.back() = StackEntry{ key_to_value_number_map_.emplace(key, key_to_value_number_map_.size())
+                                           .first->second, address, /* is_pure_ = */false };
+            }
+            reachable = true;
+        }
+        if (address == code_.size())
+            break;
+
+        const CodeAndSourceLocation &instruction(code_[address]);
+        const unsigned operand_count(GetOperandCount(instruction.getCode(), instruction.getOperand2()));
+        if (stack.size() < operand_count)
+            throw std::logic_error("in CommonSubexpressionEliminator::numberValues: corrupt program!");
+
+        if (IsJump(instruction.getCode())) {
+            has_jumps_ = true;
+            stack.resize(stack.size() - operand_count);
+            auto jump_target_and_state(target_to_state_map.find(instruction.getOperand()));
+            if (jump_target_and_state == target_to_state_map.end())
+                jump_target_and_state = target_to_state_map.emplace(instruction.getOperand(),
+                                                                    JumpTargetState{ stack, false }).first;
+            if (instruction.getCode() == Instruction::JUMP) {
+                jump_target_and_state->second.carries_value_ = true;
+                reachable = false;
+            }
+            continue;
+        }
+
+        bool is_pure((instruction.getCode() != Instruction::CALL and instruction.getCode() != Instruction::CALLF)
+                     or constant_pool.getCallSite(instruction.getOperand()).function_->isPure());
+        key.clear();
+        AppendUInt32(static_cast<uint32_t>(instruction.getCode()), &key);
+        AppendUInt32(instruction.getOperand(), &key);
+        AppendUInt32(instruction.getOperand2(), &key);
+        for (auto operand(stack.cend() - operand_count); operand != stack.cend(); ++operand) {
+            AppendUInt32(operand->value_number_, &key);
+            is_pure = is_pure and operand->is_pure_;
+        }
+        const uint32_t start(operand_count == 0 ? address : (stack.cend() - operand_count)->start_);
+        stack.resize(stack.size() - operand_count);
+
+        Node &node(nodes_[address]);
+        node.value_number_ = key_to_value_number_map_.emplace(key, key_to_value_number_map_.size()).first->second;
+        node.start_ = start;
+        node.is_candidate_ = is_pure and not IsPush(instruction.getCode())
+                             and instruction.getCode() != Instruction::STORE
+                             and instruction.getCode() != Instruction::LOAD;
+        node.reuse_count_ = 0;
+        node.local_ = node.definition_ = node.reuse_end_ = NONE;
+        if (node.is_candidate_)
+            candidates_.emplace_back(address);
+
+        stack.emplace_back(StackEntry{ node.value_number_, start, is_pure });
+    }
+
+    if (stack.size() != 1)
+        throw std::logic_error("in CommonSubexpressionEliminator::numberValues: corrupt program, stack depth is "
+                               + std::to_string(stack.size()) + " after execution!");
+}
+
+
+// As all jumps go forward, "address1" dominates a later "address2" unless a jump from before "address1" lands after
+// it but no later than "address2".  Level k of the table holds the lowest jump source for every range of 2^k
+// consecutive target addresses, so that dominates() only needs to look at two entries.
+void CommonSubexpressionEliminator::buildDominanceTable() {
+    if (not has_jumps_)
+        return;
+
+    const size_t width(code_.size() + 1);
+    min_jump_sources_.assign(width, NONE);
+    for (uint32_t address(0); address < code_.size(); ++address) {
+        if (IsJump(code_[address].getCode()))
+            min_jump_sources_[code_[address].getOperand()] = std::min(min_jump_sources_[code_[address].getOperand()],
+                                                                      address);
+    }
+
+    for (size_t range_size(2); range_size <= width; range_size *= 2) {
+        const size_t previous_level(min_jump_sources_.size() - width);
+        for (size_t target(0); target < width; ++target) {
+            const size_t second_half(target + range_size / 2);
+            min_jump_sources_.emplace_back(second_half < width ? std::min(min_jump_sources_[previous_level + target],
+                                                                          min_jump_sources_[previous_level
+                                                                                            + second_half])
+                                                               : min_jump_sources_[previous_level + target]);
+        }
+    }
+}
+
+
+bool CommonSubexpressionEliminator::dominates(const uint32_t address1, const uint32_t address2) const {
+    if (not has_jumps_)
+        return true;
+
+    const size_t width(code_.size() + 1);
+    const uint32_t first_target(address1 + 1), range_size(address2 - address1);
+    const unsigned level(31 - __builtin_clz(range_size));
+    const uint32_t min_jump_source(std::min(min_jump_sources_[level * width + first_target],
+                                            min_jump_sources_[level * width + address2 + 1 - (1u << level)]));
+    return min_jump_source > address1;
+}
+
+
+// Visits the candidates in the order in which they will be evaluated, i.e. every subexpression before its own
+// subexpressions.  The code of a subexpression occupies the addresses from its start to the subexpression itself, so
+// sorting by start and then by descending address does the trick.  Everything below an occurrence that will be
+// replaced by a LOAD will never be evaluated and can neither be reused nor reuse anything itself.
+void CommonSubexpressionEliminator::markReuses() {
+    std::sort(candidates_.begin(), candidates_.end(), [this](const uint32_t address1, const uint32_t address2) {
+        return nodes_[address1].start_ < nodes_[address2].start_
+               or (nodes_[address1].start_ == nodes_[address2].start_ and address1 > address2);
+    });
+
+    definitions_.clear();
+    last_definitions_.assign(key_to_value_number_map_.size(), NONE);
+    uint32_t skipped_code_end(0);
+    for (const uint32_t address : candidates_) {
+        Node &node(nodes_[address]);
+        if (node.start_ < skipped_code_end)
+            continue;
+
+        uint32_t definition(last_definitions_[node.value_number_]);
+        while (definition != NONE and not dominates(definitions_[definition].address_, address))
+            definition = definitions_[definition].previous_;
+
+        if (definition == NONE) {
+            definitions_.emplace_back(Definition{ address, last_definitions_[node.value_number_] });
+            last_definitions_[node.value_number_] = static_cast<uint32_t>(definitions_.size() - 1);
+        } else {
+            node.definition_ = definitions_[definition].address_;
+            ++nodes_[node.definition_].reuse_count_;
+            nodes_[node.start_].reuse_end_ = address;
+            skipped_code_end = address + 1;
+        }
+    }
+}
+
+
+void CommonSubexpressionEliminator::emit(Program * const program) {
+    first_jump_to_.assign(code_.size() + 1, NONE);
+    next_jump_.clear();
+
+    for (uint32_t address(0); address < code_.size(); ++address) {
+        patchPendingJumps(address, program);
+
+        const CodeAndSourceLocation &instruction(code_[address]);
+        if (IsJump(instruction.getCode())) {
+            addPendingJump(instruction.getOperand(),
+                           program->emitJump(instruction.getCode(), instruction.getSourceLocation(),
+                                             static_cast<NodeType>(instruction.getOperand2())));
+            continue;
+        }
+
+        const uint32_t reuse_end(nodes_[address].reuse_end_);
+        if (reuse_end != NONE) {
+            for (uint32_t skipped_address(address + 1); skipped_address <= reuse_end; ++skipped_address) {
+                if (IsJump(code_[skipped_address].getCode()) or first_jump_to_[skipped_address] != NONE)
+                    throw std::logic_error("in CommonSubexpressionEliminator::emit: jump into or out of a shared "
+                                           "subexpression!");
+            }
+
+            const CodeAndSourceLocation &reuse(code_[reuse_end]);
+            program->emit(Instruction::LOAD, reuse.getSourceLocation(), nodes_[nodes_[reuse_end].definition_].local_,
+                          static_cast<uint32_t>(GetResultType(reuse, program->getConstantPool())));
+            ++reuse_count_;
+            address = reuse_end;
+            continue;
+        }
+
+        program->emit(instruction.getCode(), instruction.getSourceLocation(), instruction.getOperand(),
+                      instruction.getOperand2());
+        Node &node(nodes_[address]);
+        if (node.reuse_count_ > 0) {
+            node.local_ = program->allocateLocal();
+            program->emit(Instruction::STORE, instruction.getSourceLocation(), node.local_,
+                          static_cast<uint32_t>(GetResultType(instruction, program->getConstantPool())));
+        }
+    }
+
+    patchPendingJumps(static_cast<uint32_t>(code_.size()), program);
+}
+
+
+void CommonSubexpressionEliminator::addPendingJump(const uint32_t old_target, const uint32_t new_jump_address) {
+    if (next_jump_.size() <= new_jump_address)
+        next_jump_.resize(new_jump_address + 1);
+    next_jump_[new_jump_address] = first_jump_to_[old_target];
+    first_jump_to_[old_target] = new_jump_address;
+}
+
+
+void CommonSubexpressionEliminator::patchPendingJumps(const uint32_t old_target, Program * const program) {
+    for (uint32_t jump_address(first_jump_to_[old_target]); jump_address != NONE;
+         jump_address = next_jump_[jump_address])
+        program->patchJump(jump_address);
+    first_jump_to_[old_target] = NONE;
+}
+
+
+} // namespace Nyaa
@@ -0,0 +1,51 @@
+/** \file    NyaaCompiler.cc
+ *  \brief   Implementation of the Compiler class.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "NyaaCompiler.h"
+
+
+namespace Nyaa {
+
+
+bool Compiler::compile(const std::string &equation, const Parser::AttribNameToTypeMap &attrib_name_to_type_map,
+                       Program * const program)
+{
+    program->clear();
+    if (not parser_.parse(equation, attrib_name_to_type_map)) {
+        error_msg_ = parser_.getErrorMsg();
+        return false;
+    }
+
+    error_msg_.clear();
+    NodeArena &node_arena(parser_.getNodeArena());
+    const AbstractNode * const parse_tree(constant_folder_.fold(*parser_.getParseTree(), &node_arena));
+    parse_tree->genCode(program);
+    program->setResultType(parse_tree->getType());
+    node_bytes_ = node_arena.getBytesInUse();
+    parser_.clear(); // All nodes are gone after this.
+    common_subexpression_eliminator_.eliminate(program);
+    peephole_optimizer_.optimize(program);
+
+    return true;
+}
+
+
+} // namespace Nyaa
@@ -0,0 +1,278 @@
+/** \file    NyaaConstantFolder.cc
+ *  \brief   Implementation of the ConstantFolder class.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "NyaaConstantFolder.h"
+#include <stdexcept>
+#include <vector>
+#include <cmath>
+
+
+namespace Nyaa {
+
+
+namespace {
+
+
+// Constant subexpressions don't reference any attributes, so none of these will ever be called.
+class NoAttribContext: public AttribContext {
+public:
+    bool getFloatAttrib(const std::string &/*attrib_name*/, double * const /*value*/) const override { return false; }
+    bool getIntAttrib(const std::string &/*attrib_name*/, int64_t * const /*value*/) const override { return false; }
+    bool getBooleanAttrib(const std::string &/*attrib_name*/, bool * const /*value*/) const override { return false; }
+    const std::string *getStringAttrib(const std::string &/*attrib_name*/) const override { return nullptr; }
+};
+
+
+} // unnamed namespace
+
+
+static bool IsConstant(const TreeNode &node) {
+    return dynamic_cast<const FloatConstantNode *>(&node) != nullptr
+           or dynamic_cast<const IntConstantNode *>(&node) != nullptr
+           or dynamic_cast<const BooleanConstantNode *>(&node) != nullptr
+           or dynamic_cast<const StringConstantNode *>(&node) != nullptr;
+}
+
+
+/** \return true if "node" is a floating point or integer constant equal to "value". */
+static bool IsNumericConstant(const TreeNode &node, const int value) {
+    const FloatConstantNode * const float_constant_node(dynamic_cast<const FloatConstantNode *>(&node));
+    if (float_constant_node != nullptr)
+        return float_constant_node->getValue() == value;
+    const IntConstantNode * const int_constant_node(dynamic_cast<const IntConstantNode *>(&node));
+    return int_constant_node != nullptr and int_constant_node->getValue() == value;
+}
+
+
+/** \return true if "node" is an integer zero or a floating point +0.0, i.e. an identity for subtraction. */
+static bool IsSubtractionIdentity(const TreeNode &node) {
+    const FloatConstantNode * const float_constant_node(dynamic_cast<const FloatConstantNode *>(&node));
+    if (float_constant_node != nullptr)
+        return float_constant_node->getValue() == 0.0 and not std::signbit(float_constant_node->getValue());
+    return IsNumericConstant(node, 0);
+}
+
+
+static bool IsEmptyStringConstant(const TreeNode &node) {
+    const StringConstantNode * const string_constant_node(dynamic_cast<const StringConstantNode *>(&node));
+    return string_constant_node != nullptr and string_constant_node->getValue().empty();
+}
+
+
+static size_t CountNodes(const TreeNode * const node) {
+    if (node == nullptr)
+        return 0;
+
+    size_t count(1);
+    const FuncCallNode * const func_call_node(dynamic_cast<const FuncCallNode *>(node));
+    if (func_call_node != nullptr) {
+        for (size_t arg_no(0); arg_no < func_call_node->getArgCount(); ++arg_no)
+            count += CountNodes(func_call_node->getArg(arg_no));
+    }
+
+    const IdentNode * const ident_node(dynamic_cast<const IdentNode *>(node));
+    if (ident_node != nullptr and ident_node->getDefaultValue() != nullptr)
+        ++count;
+
+    return count + CountNodes(node->getLeftChild()) + CountNodes(node->getRightChild());
+}
+
+
+static const AbstractNode &AsAbstractNode(const TreeNode * const node) {
+    return dynamic_cast<const AbstractNode &>(*node);
+}
+
+
+const AbstractNode *ConstantFolder::fold(const AbstractNode &tree, NodeArena * const node_arena) {
+    node_arena_ = node_arena;
+    const AbstractNode * const folded_tree(foldNode(tree));
+    node_arena_ = nullptr;
+    eliminated_node_count_ = CountNodes(&tree) - CountNodes(folded_tree);
+    return folded_tree;
+}
+
+
+// Nodes are immutable and don't own their children, so subtrees that are not changed by folding are shared w/ the
+// original tree instead of being copied.
+const AbstractNode *ConstantFolder::foldNode(const AbstractNode &node) {
+    if (IsConstant(node) or dynamic_cast<const IdentNode *>(&node) != nullptr)
+        return &node;
+
+    if (const auto bin_op_node = dynamic_cast<const BinOpNode *>(&node))
+        return foldBinOpNode(*bin_op_node);
+    if (const auto unary_op_node = dynamic_cast<const UnaryOpNode *>(&node))
+        return foldUnaryOpNode(*unary_op_node);
+    if (const auto func_call_node = dynamic_cast<const FuncCallNode *>(&node))
+        return foldFuncCallNode(*func_call_node);
+
+    if (dynamic_cast<const FConvNode *>(&node) != nullptr or dynamic_cast<const SConvNode *>(&node) != nullptr) {
+        const AbstractNode * const convertee(foldNode(AsAbstractNode(node.getLeftChild())));
+        if (not IsConstant(*convertee))
+            return convertee == node.getLeftChild() ? &node : makeConversionNode(node, convertee);
+        return evaluate(*makeConversionNode(node, convertee));
+    }
+
+    throw std::logic_error("in ConstantFolder::foldNode: unexpected node: " + node.toString() + "!");
+}
+
+
+const AbstractNode *ConstantFolder::foldBinOpNode(const BinOpNode &bin_op_node) {
+    const AbstractNode * const lhs(foldNode(AsAbstractNode(bin_op_node.getLeftChild())));
+    const AbstractNode * const rhs(foldNode(AsAbstractNode(bin_op_node.getRightChild())));
+
+    const Token &operator_type(bin_op_node.getOperator());
+    switch (operator_type.getType()) {
+    case TokenType::MUL:
+        if (IsNumericConstant(*lhs, 1))
+            return rhs;
+        if (IsNumericConstant(*rhs, 1))
+            return lhs;
+        break;
+    case TokenType::DIV:
+    case TokenType::CARET:
+        if (IsNumericConstant(*rhs, 1))
+            return lhs;
+        break;
+    case TokenType::PLUS:
+        // Not for floats, as -0.0 + 0.0 is 0.0.
+        if (bin_op_node.getType() != NodeType::INT_NODE)
+            break;
+        if (IsNumericConstant(*lhs, 0))
+            return rhs;
+        if (IsNumericConstant(*rhs, 0))
+            return lhs;
+        break;
+    case TokenType::MINUS:
+        // Not for -0.0, as -0.0 - -0.0 is 0.0.
+        if (IsSubtractionIdentity(*rhs))
+            return lhs;
+        break;
+    case TokenType::AMPERSAND:
+        if (IsEmptyStringConstant(*lhs))
+            return rhs;
+        if (IsEmptyStringConstant(*rhs))
+            return lhs;
+        break;
+    default:
+        break;
+    }
+
+    const AbstractNode *folded_node(&bin_op_node);
+    if (lhs != bin_op_node.getLeftChild() or rhs != bin_op_node.getRightChild())
+        folded_node = node_arena_->create<BinOpNode>(bin_op_node.getSourceLocation(), operator_type, lhs, rhs);
+
+    return (IsConstant(*lhs) and IsConstant(*rhs)) ? evaluate(*folded_node) : folded_node;
+}
+
+
+const AbstractNode *ConstantFolder::foldUnaryOpNode(const UnaryOpNode &unary_op_node) {
+    const AbstractNode * const operand(foldNode(AsAbstractNode(unary_op_node.getLeftChild())));
+
+    const Token &operator_type(unary_op_node.getOperator());
+    if (operator_type == PLUS)
+        return operand;
+    // Not for ints, as negating INT64_MIN is an overflow error.
+    if (operator_type == MINUS and unary_op_node.getType() == NodeType::FLOAT_NODE) {
+        const UnaryOpNode * const nested_unary_op_node(dynamic_cast<const UnaryOpNode *>(operand));
+        if (nested_unary_op_node != nullptr and nested_unary_op_node->getOperator() == MINUS)
+            return &AsAbstractNode(nested_unary_op_node->getLeftChild()); // Already folded.
+    }
+
+    const AbstractNode *folded_node(&unary_op_node);
+    if (operand != unary_op_node.getLeftChild())
+        folded_node = node_arena_->create<UnaryOpNode>(unary_op_node.getSourceLocation(), operator_type, operand);
+
+    return IsConstant(*operand) ? evaluate(*folded_node) : folded_node;
+}
+
+
+const AbstractNode *ConstantFolder::foldFuncCallNode(const FuncCallNode &func_call_node) {
+    const size_t arg_count(func_call_node.getArgCount());
+    const TreeNode ** const args(node_arena_->allocateArray<const TreeNode *>(arg_count));
+    bool args_have_changed(false), all_args_are_constant(true);
+    for (size_t arg_no(0); arg_no < arg_count; ++arg_no) {
+        const AbstractNode * const arg(foldNode(AsAbstractNode(func_call_node.getArg(arg_no))));
+        args[arg_no] = arg;
+        if (arg != func_call_node.getArg(arg_no))
+            args_have_changed = true;
+        if (not IsConstant(*arg))
+            all_args_are_constant = false;
+    }
+
+    // Only the chosen value of a conditional w/ a constant condition would ever be evaluated.
+    if (func_call_node.getFunction().getShortCircuitKind() == ShortCircuitKind::IF and arg_count == 3) {
+        const BooleanConstantNode * const condition(dynamic_cast<const BooleanConstantNode *>(args[0]));
+        if (condition != nullptr)
+            return &AsAbstractNode(args[condition->getValue() ? 1 : 2]);
+    }
+
+    const AbstractNode *folded_node(&func_call_node);
+    if (args_have_changed)
+        folded_node = node_arena_->create<FuncCallNode>(func_call_node.getSourceLocation(),
+                                                         func_call_node.getFunction(), func_call_node.getType(),
+                                                         args, arg_count);
+
+    return (all_args_are_constant and func_call_node.getFunction().isPure()) ? evaluate(*folded_node) : folded_node;
+}
+
+
+const AbstractNode *ConstantFolder::makeConversionNode(const AbstractNode &conversion_node,
+                                                       const AbstractNode * const convertee)
+{
+    if (dynamic_cast<const FConvNode *>(&conversion_node) != nullptr)
+        return node_arena_->create<FConvNode>(convertee);
+    return node_arena_->create<SConvNode>(convertee);
+}
+
+
+const AbstractNode *ConstantFolder::evaluate(const AbstractNode &node) {
+    scratch_program_.clear();
+    node.genCode(&scratch_program_);
+    scratch_program_.setResultType(node.getType());
+
+    static const NoAttribContext no_attrib_context;
+    const size_t source_location(node.getSourceLocation());
+    try {
+        const FuncArg value(interpreter_.evaluate(scratch_program_, no_attrib_context));
+        switch (value.getType()) {
+        case NodeType::FLOAT_NODE:
+            return node_arena_->create<FloatConstantNode>(source_location, value.getDoubleValue());
+        case NodeType::INT_NODE:
+            return node_arena_->create<IntConstantNode>(source_location, value.getIntValue());
+        case NodeType::BOOLEAN_NODE:
+            return node_arena_->create<BooleanConstantNode>(source_location, value.getBoolValue());
+        case NodeType::STRING_NODE:
+            return node_arena_->create<StringConstantNode>(source_location, value.getStringValue());
+        default:
+            throw std::logic_error("in ConstantFolder::evaluate: unexpected result type "
+                                   + NodeTypeToString(value.getType()) + "!");
+        }
+    } catch (const std::domain_error &) {
+        return &node;
+    } catch (const std::invalid_argument &) {
+        return &node;
+    } catch (const std::runtime_error &) {
+        return &node;
+    }
+}
+
+
+} // namespace Nyaa
@@ -0,0 +1,96 @@
+/** \file    NyaaConstantPool.cc
+ *  \brief   Implementation of the ConstantPool class.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "NyaaConstantPool.h"
+#include <stdexcept>
+#include <cstring>
+
+
+namespace Nyaa {
+
+
+void ConstantPool::clear() {
+    floats_.clear();
+    float_bits_to_index_.clear();
+    ints_.clear();
+    int_to_index_.clear();
+    strings_.clear();
+    string_to_index_.clear();
+    attrib_refs_.clear();
+    attrib_name_to_index_.clear();
+    call_sites_.clear();
+}
+
+
+uint32_t ConstantPool::internFloat(const double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof bits);
+
+    const auto bits_and_index(float_bits_to_index_.emplace(bits, floats_.size()));
+    if (bits_and_index.second)
+        floats_.emplace_back(value);
+    return bits_and_index.first->second;
+}
+
+
+uint32_t ConstantPool::internInt(const int64_t value) {
+    const auto value_and_index(int_to_index_.emplace(value, ints_.size()));
+    if (value_and_index.second)
+        ints_.emplace_back(value);
+    return value_and_index.first->second;
+}
+
+
+uint32_t ConstantPool::internString(const std::string &value) {
+    const auto value_and_index(string_to_index_.emplace(value, strings_.size()));
+    if (value_and_index.second)
+        strings_.emplace_back(value);
+    return value_and_index.first->second;
+}
+
+
+uint32_t ConstantPool::internAttribRef(const std::string &attrib_name, const NodeType type) {
+    const auto name_and_index(attrib_name_to_index_.emplace(attrib_name, attrib_refs_.size()));
+    if (name_and_index.second)
+        attrib_refs_.emplace_back(attrib_name, type);
+    else if (attrib_refs_[name_and_index.first->second].type_ != type)
+        throw std::invalid_argument("in ConstantPool::internAttribRef: attribute \"" + attrib_name
+                                    + "\" was previously interned with a different type!");
+    return name_and_index.first->second;
+}
+
+
+uint32_t ConstantPool::internCallSite(const Function &function, const std::vector<NodeType> &arg_types,
+                                      const NodeType return_type)
+{
+    // Equations rarely contain more than a handful of calls, so a linear search is perfectly adequate.
+    for (uint32_t index(0); index < call_sites_.size(); ++index) {
+        const CallSite &call_site(call_sites_[index]);
+        if (call_site.function_ == &function and call_site.arg_types_ == arg_types)
+            return index;
+    }
+
+    call_sites_.emplace_back(function, arg_types, return_type);
+    return call_sites_.size() - 1;
+}
+
+
+} // namespace Nyaa
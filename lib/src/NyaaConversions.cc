@@ -0,0 +1,79 @@
+/** \file    NyaaConversions.cc
+ *  \brief   Implementation of the value conversions of the Nyaa interpreter.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "NyaaConversions.h"
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+
+
+namespace Nyaa {
+
+
+bool StringToFloat(const std::string &s, double * const value) {
+    const char *start(s.c_str());
+    while (std::isspace(static_cast<unsigned char>(*start)))
+        ++start;
+    if (*start == '\0')
+        return false;
+
+    char *end;
+    *value = std::strtod(start, &end);
+    if (end == start)
+        return false;
+
+    while (std::isspace(static_cast<unsigned char>(*end)))
+        ++end;
+    return *end == '\0' and end == s.c_str() + s.length();
+}
+
+
+void FloatToString(const double value, std::string * const s) {
+    char buf[32];
+    for (int precision(15); precision <= 17; ++precision) {
+        std::snprintf(buf, sizeof buf, "%.*g", precision, value);
+        if (precision == 17 or std::strtod(buf, nullptr) == value)
+            break;
+    }
+    s->assign(buf);
+}
+
+
+void IntToString(const int64_t value, std::string * const s) {
+    char buf[24];
+    std::snprintf(buf, sizeof buf, "%" PRId64, value);
+    s->assign(buf);
+}
+
+
+const std::string &BoolToString(const bool value) {
+    static const std::string TRUE_STRING("true"), FALSE_STRING("false");
+    return value ? TRUE_STRING : FALSE_STRING;
+}
+
+
+
+std::string SourceLocationPrefix(const size_t source_location) {
+    return source_location == static_cast<size_t>(-1) ? std::string() : std::to_string(source_location) + ": ";
+}
+
+
+} // namespace Nyaa
@@ -0,0 +1,374 @@
+/** \file    NyaaDagScheduler.cc
+ *  \brief   Implementation of the DagScheduler class.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "NyaaDagScheduler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+
+namespace Nyaa {
+
+
+namespace {
+
+
+/** The dependencies in compressed sparse row form. */
+class TaskDependents {
+    std::vector<size_t> offsets_; // The dependents of task t are dependents_[offsets_[t], offsets_[t + 1]).
+    std::vector<size_t> dependents_;
+public:
+    explicit TaskDependents(const TaskGraph &task_graph);
+
+    inline const size_t *begin(const size_t task) const { return dependents_.data() + offsets_[task]; }
+    inline const size_t *end(const size_t task) const { return dependents_.data() + offsets_[task + 1]; }
+};
+
+
+TaskDependents::TaskDependents(const TaskGraph &task_graph): offsets_(task_graph.size() + 1) {
+    for (const auto &dependency : task_graph.getDependencies()) {
+        if (dependency.first >= task_graph.size() or dependency.second >= task_graph.size())
+            throw std::invalid_argument("in DagScheduler::run: dependency on a nonexistent task!");
+        ++offsets_[dependency.first + 1];
+    }
+    for (size_t task(0); task < task_graph.size(); ++task)
+        offsets_[task + 1] += offsets_[task];
+
+    dependents_.resize(task_graph.getDependencies().size());
+    std::vector<size_t> next_positions(offsets_.cbegin(), offsets_.cend() - 1);
+    for (const auto &dependency : task_graph.getDependencies())
+        dependents_[next_positions[dependency.first]++] = dependency.second;
+}
+
+
+/** \return the tasks in an order in which every task comes after its prerequisites. */
+std::vector<size_t> SortTopologically(const TaskDependents &task_dependents,
+                                      const std::vector<size_t> &prerequisite_counts)
+{
+    std::vector<size_t> pending_counts(prerequisite_counts);
+    std::vector<size_t> order;
+    order.reserve(pending_counts.size());
+    for (size_t task(0); task < pending_counts.size(); ++task) {
+        if (pending_counts[task] == 0)
+            order.emplace_back(task);
+    }
+    for (size_t position(0); position < order.size(); ++position) {
+        for (const size_t *dependent(task_dependents.begin(order[position]));
+             dependent != task_dependents.end(order[position]); ++dependent)
+        {
+            if (--pending_counts[*dependent] == 0)
+                order.emplace_back(*dependent);
+        }
+    }
+
+    if (order.size() < pending_counts.size())
+        throw std::invalid_argument("in DagScheduler::run: circular dependencies between tasks!");
+    return order;
+}
+
+
+struct TaskQueue {
+    std::mutex mutex_;
+    std::deque<size_t> tasks_;
+
+    inline void push(const size_t task) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.emplace_back(task);
+    }
+
+    /** Takes the most recently pushed task. */
+    inline bool pop(size_t * const task) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (tasks_.empty())
+            return false;
+        *task = tasks_.back();
+        tasks_.pop_back();
+        return true;
+    }
+
+    /** Takes the least recently pushed task. */
+    inline bool steal(size_t * const task) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (tasks_.empty())
+            return false;
+        *task = tasks_.front();
+        tasks_.pop_front();
+        return true;
+    }
+};
+
+
+} // unnamed namespace
+
+
+/** The state of a single call to DagScheduler::run(), shared by all threads that take part in it. */
+struct DagScheduler::Run {
+    const TaskDependents &task_dependents_;
+    const TaskFunction &task_function_;
+    const unsigned worker_count_;
+    std::unique_ptr<std::atomic<size_t>[]> pending_counts_; // Prerequisites that haven't completed yet, per task.
+    std::unique_ptr<TaskQueue[]> queues_;                   // One per worker.
+    std::vector<TaskTiming> *task_timings_;                 // nullptr if no statistics were requested.
+    const std::chrono::steady_clock::time_point start_;
+    std::atomic<size_t> remaining_task_count_, queued_task_count_;
+    std::atomic<unsigned> waiting_worker_count_;
+    std::atomic<bool> abort_;
+    std::exception_ptr first_exception_;
+    std::mutex mutex_; // Protects "first_exception_" and goes w/ "task_available_".
+    std::condition_variable task_available_;
+
+    Run(const TaskDependents &task_dependents, const std::vector<size_t> &prerequisite_counts,
+        const TaskFunction &task_function, const unsigned worker_count, std::vector<TaskTiming> * const task_timings);
+
+    inline double secondsSinceStart() const
+        { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count(); }
+
+    void work(const unsigned worker_no);
+private:
+    void push(const unsigned worker_no, const size_t task);
+
+    /** \return false if there are no more tasks to run, else true and the next task in "*task". */
+    bool take(const unsigned worker_no, size_t * const task);
+
+    void wakeAllWorkers();
+};
+
+
+DagScheduler::Run::Run(const TaskDependents &task_dependents, const std::vector<size_t> &prerequisite_counts,
+                       const TaskFunction &task_function, const unsigned worker_count,
+                       std::vector<TaskTiming> * const task_timings)
+    : task_dependents_(task_dependents), task_function_(task_function), worker_count_(worker_count),
+      pending_counts_(new std::atomic<size_t>[prerequisite_counts.size()]), queues_(new TaskQueue[worker_count]),
+      task_timings_(task_timings), start_(std::chrono::steady_clock::now()),
+      remaining_task_count_(prerequisite_counts.size()), queued_task_count_(0), waiting_worker_count_(0),
+      abort_(false)
+{
+    unsigned next_queue(0);
+    for (size_t task(0); task < prerequisite_counts.size(); ++task) {
+        pending_counts_[task].store(prerequisite_counts[task], std::memory_order_relaxed);
+        if (prerequisite_counts[task] == 0) {
+            queues_[next_queue].tasks_.emplace_back(task);
+            queued_task_count_.fetch_add(1, std::memory_order_relaxed);
+            next_queue = (next_queue + 1) % worker_count_;
+        }
+    }
+}
+
+
+void DagScheduler::Run::work(const unsigned worker_no) {
+    try {
+        size_t task;
+        while (take(worker_no, &task)) {
+            if (task_timings_ != nullptr)
+                (*task_timings_)[task].start_ = secondsSinceStart();
+            task_function_(task, worker_no);
+            if (task_timings_ != nullptr)
+                (*task_timings_)[task].end_ = secondsSinceStart();
+
+            for (const size_t *dependent(task_dependents_.begin(task)); dependent != task_dependents_.end(task);
+                 ++dependent)
+            {
+                if (pending_counts_[*dependent].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    push(worker_no, *dependent);
+            }
+            if (remaining_task_count_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                wakeAllWorkers();
+        }
+    } catch (...) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (first_exception_ == nullptr)
+                first_exception_ = std::current_exception();
+            abort_.store(true);
+        }
+        task_available_.notify_all();
+    }
+}
+
+
+// A waiting worker announces itself before it checks "queued_task_count_" and we check for waiting workers after
+// incrementing it, so that at least one of the two sees the other.  Locking the mutex before notifying ensures that
+// the worker is actually waiting by then.  This way we don't have to touch the mutex while all workers are busy.
+void DagScheduler::Run::push(const unsigned worker_no, const size_t task) {
+    queues_[worker_no].push(task);
+    queued_task_count_.fetch_add(1);
+    if (waiting_worker_count_.load() > 0) {
+        { std::lock_guard<std::mutex> lock(mutex_); }
+        task_available_.notify_one();
+    }
+}
+
+
+bool DagScheduler::Run::take(const unsigned worker_no, size_t * const task) {
+    const auto is_done([this]() {
+        return remaining_task_count_.load(std::memory_order_acquire) == 0 or abort_.load(std::memory_order_relaxed);
+    });
+
+    for (;;) {
+        if (is_done())
+            return false;
+
+        bool found_task(queues_[worker_no].pop(task));
+        for (unsigned offset(1); not found_task and offset < worker_count_; ++offset)
+            found_task = queues_[(worker_no + offset) % worker_count_].steal(task);
+        if (found_task) {
+            queued_task_count_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        // Nothing to do until some other worker completes a task.
+        std::unique_lock<std::mutex> lock(mutex_);
+        waiting_worker_count_.fetch_add(1);
+        task_available_.wait(lock, [this, &is_done]() { return queued_task_count_.load() > 0 or is_done(); });
+        waiting_worker_count_.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+
+void DagScheduler::Run::wakeAllWorkers() {
+    { std::lock_guard<std::mutex> lock(mutex_); }
+    task_available_.notify_all();
+}
+
+
+DagScheduler::DagScheduler(const unsigned thread_count)
+    : thread_count_(thread_count), run_(nullptr), run_number_(0), run_worker_count_(0), busy_thread_count_(0),
+      shutting_down_(false)
+{
+    if (thread_count_ == 0)
+        thread_count_ = std::max(1u, std::thread::hardware_concurrency());
+
+    // The calling thread of run() will be thread number 0.
+    threads_.reserve(thread_count_ - 1);
+    try {
+        for (unsigned thread_no(1); thread_no < thread_count_; ++thread_no)
+            threads_.emplace_back(&DagScheduler::serve, this, thread_no);
+    } catch (...) { // We may not be able to create as many threads as we wanted, which is OK.
+    }
+    thread_count_ = static_cast<unsigned>(threads_.size() + 1);
+}
+
+
+DagScheduler::~DagScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shutting_down_ = true;
+    }
+    run_started_.notify_all();
+    for (auto &thread : threads_)
+        thread.join();
+}
+
+
+void DagScheduler::run(const TaskGraph &task_graph, const TaskFunction &task_function, Statistics * const statistics)
+{
+    const size_t task_count(task_graph.size());
+    const TaskDependents task_dependents(task_graph);
+    std::vector<size_t> prerequisite_counts(task_count);
+    for (const auto &dependency : task_graph.getDependencies())
+        ++prerequisite_counts[dependency.second];
+    const std::vector<size_t> topological_order(SortTopologically(task_dependents, prerequisite_counts));
+
+    std::lock_guard<std::mutex> run_lock(run_mutex_);
+    const unsigned worker_count(static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(thread_count_,
+                                                                                          task_count))));
+    std::vector<TaskTiming> task_timings(statistics == nullptr ? 0 : task_count);
+    Run run(task_dependents, prerequisite_counts, task_function, worker_count,
+            statistics == nullptr ? nullptr : &task_timings);
+
+    // The calling thread does its share of the work as worker 0.
+    if (worker_count > 1) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            run_ = &run;
+            ++run_number_;
+            run_worker_count_ = worker_count;
+            busy_thread_count_ = worker_count - 1;
+        }
+        run_started_.notify_all();
+    }
+    run.work(0);
+    if (worker_count > 1) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        run_finished_.wait(lock, [this]() { return busy_thread_count_ == 0; });
+        run_ = nullptr;
+    }
+
+    if (run.first_exception_ != nullptr)
+        std::rethrow_exception(run.first_exception_);
+
+    if (statistics != nullptr) {
+        // The longest chain ending w/ each task, computed in topological order.
+        std::vector<double> chain_seconds(task_count);
+        double critical_path_seconds(0.0);
+        for (const size_t task : topological_order) {
+            chain_seconds[task] += task_timings[task].end_ - task_timings[task].start_;
+            critical_path_seconds = std::max(critical_path_seconds, chain_seconds[task]);
+            for (const size_t *dependent(task_dependents.begin(task)); dependent != task_dependents.end(task);
+                 ++dependent)
+                chain_seconds[*dependent] = std::max(chain_seconds[*dependent], chain_seconds[task]);
+        }
+
+        statistics->task_timings_.swap(task_timings);
+        statistics->wall_seconds_ = run.secondsSinceStart();
+        statistics->critical_path_seconds_ = critical_path_seconds;
+    }
+}
+
+
+// Only the threads whose numbers the current run uses get woken up.
+void DagScheduler::serve(const unsigned thread_no) {
+    uint64_t last_run_number(0);
+    for (;;) {
+        Run *run;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            run_started_.wait(lock, [this, thread_no, last_run_number]() {
+                return shutting_down_ or (run_number_ != last_run_number and thread_no < run_worker_count_);
+            });
+            if (shutting_down_)
+                return;
+            last_run_number = run_number_;
+            run = run_;
+        }
+
+        run->work(thread_no);
+
+        bool is_last;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            is_last = --busy_thread_count_ == 0;
+        }
+        if (is_last)
+            run_finished_.notify_one();
+    }
+}
+
+
+} // namespace Nyaa
@@ -0,0 +1,217 @@
+/** \file    NyaaDependencyGraph.cc
+ *  \brief   Implementation of the DependencyGraph class.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "NyaaDependencyGraph.h"
+#include <algorithm>
+#include <stdexcept>
+#include "NyaaNodes.h"
+
+
+namespace Nyaa {
+
+
+size_t DependencyGraph::addColumn(const std::string &name, const std::shared_ptr<const Program> &program) {
+    if (program == nullptr)
+        throw std::invalid_argument("in DependencyGraph::addColumn: no program for column \"" + name + "\"!");
+
+    const size_t column_index(columns_.size());
+    if (not name_to_index_map_.emplace(name, column_index).second)
+        throw std::invalid_argument("in DependencyGraph::addColumn: duplicate column \"" + name + "\"!");
+    columns_.emplace_back(name, program);
+    is_resolved_ = false;
+
+    return column_index;
+}
+
+
+void DependencyGraph::setProgram(const size_t column_index, const std::shared_ptr<const Program> &program) {
+    if (program == nullptr)
+        throw std::invalid_argument("in DependencyGraph::setProgram: no program for column \""
+                                    + columns_[column_index].name_ + "\"!");
+
+    columns_[column_index].program_ = program;
+    is_resolved_ = false;
+}
+
+
+bool DependencyGraph::lookup(const std::string &name, size_t * const index) const {
+    const auto name_and_index(name_to_index_map_.find(name));
+    if (name_and_index == name_to_index_map_.cend())
+        return false;
+
+    *index = name_and_index->second;
+    return true;
+}
+
+
+// Kahn's algorithm.  Columns w/o pending dependencies are emitted in index order, so the result is deterministic.
+void DependencyGraph::resolve() {
+    attrib_name_to_readers_map_.clear();
+    for (auto &column : columns_) {
+        column.dependencies_.clear();
+        column.dependents_.clear();
+    }
+
+    for (size_t column_index(0); column_index < columns_.size(); ++column_index) {
+        Column &column(columns_[column_index]);
+        const ConstantPool &constant_pool(column.program_->getConstantPool());
+        for (uint32_t attrib_ref_index(0); attrib_ref_index < constant_pool.getAttribRefCount(); ++attrib_ref_index) {
+            const ConstantPool::AttribRef &attrib_ref(constant_pool.getAttribRef(attrib_ref_index));
+            attrib_name_to_readers_map_[attrib_ref.name_].emplace_back(column_index);
+
+            size_t dependency_index;
+            if (not lookup(attrib_ref.name_, &dependency_index))
+                continue;
+
+            const NodeType dependency_type(columns_[dependency_index].program_->getResultType());
+            if (dependency_type != attrib_ref.type_)
+                throw std::invalid_argument("in DependencyGraph::resolve: column \"" + column.name_ + "\" expects \""
+                                            + attrib_ref.name_ + "\" to be of type "
+                                            + NodeTypeToString(attrib_ref.type_) + " but it is of type "
+                                            + NodeTypeToString(dependency_type) + "!");
+            column.dependencies_.emplace_back(dependency_index);
+            columns_[dependency_index].dependents_.emplace_back(column_index);
+        }
+    }
+
+    std::vector<size_t> in_degrees(columns_.size());
+    std::vector<size_t> ready_columns;
+    for (size_t column_index(columns_.size()); column_index > 0; --column_index) {
+        in_degrees[column_index - 1] = columns_[column_index - 1].dependencies_.size();
+        if (in_degrees[column_index - 1] == 0)
+            ready_columns.emplace_back(column_index - 1);
+    }
+
+    evaluation_order_.clear();
+    evaluation_order_.reserve(columns_.size());
+    while (not ready_columns.empty()) {
+        const size_t column_index(ready_columns.back());
+        ready_columns.pop_back();
+        evaluation_order_.emplace_back(column_index);
+        for (const size_t dependent_index : columns_[column_index].dependents_) {
+            if (--in_degrees[dependent_index] == 0)
+                ready_columns.emplace_back(dependent_index);
+        }
+    }
+
+    if (evaluation_order_.size() < columns_.size())
+        throw std::runtime_error("in DependencyGraph::resolve: circular dependency: " + describeCycle(in_degrees)
+                                 + "!");
+
+    evaluation_ranks_.resize(columns_.size());
+    for (size_t rank(0); rank < evaluation_order_.size(); ++rank)
+        evaluation_ranks_[evaluation_order_[rank]] = rank;
+    is_resolved_ = true;
+}
+
+
+const std::vector<size_t> &DependencyGraph::getEvaluationOrder() const {
+    checkResolved("getEvaluationOrder");
+    return evaluation_order_;
+}
+
+
+const std::vector<size_t> &DependencyGraph::getDependencies(const size_t column_index) const {
+    checkResolved("getDependencies");
+    return columns_[column_index].dependencies_;
+}
+
+
+const std::vector<size_t> &DependencyGraph::getDependents(const size_t column_index) const {
+    checkResolved("getDependents");
+    return columns_[column_index].dependents_;
+}
+
+
+std::vector<size_t> DependencyGraph::getAffectedColumns(const std::vector<std::string> &changed_attrib_names) const {
+    checkResolved("getAffectedColumns");
+
+    std::vector<bool> is_affected(columns_.size());
+    std::vector<size_t> affected_columns, columns_to_visit;
+    const auto mark_affected([&](const size_t column_index) {
+        if (not is_affected[column_index]) {
+            is_affected[column_index] = true;
+            affected_columns.emplace_back(column_index);
+            columns_to_visit.emplace_back(column_index);
+        }
+    });
+
+    for (const auto &attrib_name : changed_attrib_names) {
+        size_t column_index;
+        if (lookup(attrib_name, &column_index))
+            mark_affected(column_index);
+
+        const auto name_and_readers(attrib_name_to_readers_map_.find(attrib_name));
+        if (name_and_readers != attrib_name_to_readers_map_.cend()) {
+            for (const size_t reader_index : name_and_readers->second)
+                mark_affected(reader_index);
+        }
+    }
+
+    while (not columns_to_visit.empty()) {
+        const size_t column_index(columns_to_visit.back());
+        columns_to_visit.pop_back();
+        for (const size_t dependent_index : columns_[column_index].dependents_)
+            mark_affected(dependent_index);
+    }
+
+    std::sort(affected_columns.begin(), affected_columns.end(), [this](const size_t lhs, const size_t rhs) {
+        return evaluation_ranks_[lhs] < evaluation_ranks_[rhs];
+    });
+    return affected_columns;
+}
+
+
+void DependencyGraph::checkResolved(const char * const function_name) const {
+    if (not is_resolved_)
+        throw std::logic_error("in DependencyGraph::" + std::string(function_name) + ": resolve() has not been called "
+                               "since the last change!");
+}
+
+
+// Every column that could not be sorted has at least one dependency that couldn't be sorted either, so following
+// these dependencies must lead us around a cycle.
+std::string DependencyGraph::describeCycle(const std::vector<size_t> &in_degrees) const {
+    size_t column_index(0);
+    while (in_degrees[column_index] == 0)
+        ++column_index;
+
+    std::vector<size_t> visit_positions(columns_.size(), columns_.size());
+    std::vector<size_t> path;
+    while (visit_positions[column_index] == columns_.size()) {
+        visit_positions[column_index] = path.size();
+        path.emplace_back(column_index);
+        for (const size_t dependency_index : columns_[column_index].dependencies_) {
+            if (in_degrees[dependency_index] != 0) {
+                column_index = dependency_index;
+                break;
+            }
+        }
+    }
+
+    std::string description;
+    for (size_t position(visit_positions[column_index]); position < path.size(); ++position)
+        description += columns_[path[position]].name_ + " -> ";
+    return description + columns_[column_index].name_;
+}
+
+
+} // namespace Nyaa
@@ -0,0 +1,169 @@
+/** \file    NyaaEquationCache.cc
+ *  \brief   Implementation of the EquationCache class.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "NyaaEquationCache.h"
+#include <stdexcept>
+#include <utility>
+#include "NyaaCompiler.h"
+#include "NyaaTokenizer.h"
+
+
+namespace Nyaa {
+
+
+constexpr size_t EquationCache::DEFAULT_MAX_SIZE;
+
+
+// Builds the cache key from the token stream, so that it can't differ in its meaning from the text: an optional
+// leading "=" is dropped and the tokens' source texts are joined w/ single blanks.  String constants and attribute
+// names in braces thus keep their exact spelling.
+// \return false if "equation" can't be tokenized, in which case it can't be compiled either and must not be cached.
+static bool NormaliseEquation(const std::string &equation, std::string * const normalised_equation) {
+    normalised_equation->clear();
+    normalised_equation->reserve(equation.size());
+
+    Tokenizer tokenizer(equation);
+    Token token(tokenizer.getToken());
+    if (token == EQUAL)
+        token = tokenizer.getToken();
+    for (/* Intentionally empty! */; token != EOS; token = tokenizer.getToken()) {
+        if (token == ERROR)
+            return false;
+        if (not normalised_equation->empty())
+            *normalised_equation += ' ';
+        const StringView text(tokenizer.getText(token));
+        normalised_equation->append(text.data(), text.size());
+    }
+
+    return true;
+}
+
+
+// A variant may be reused if all attributes the equation referenced have the same types as before.  N.B. we can't
+// rely on the program's constant pool here, as constant folding may have eliminated some of the references.
+static bool IsCompatible(const std::vector<std::pair<std::string, NodeType>> &attrib_names_and_types,
+                         const Parser::AttribNameToTypeMap &attrib_name_to_type_map)
+{
+    for (const auto &attrib_name_and_type : attrib_names_and_types) {
+        const auto name_and_type(attrib_name_to_type_map.find(attrib_name_and_type.first));
+        if (name_and_type == attrib_name_to_type_map.cend() or name_and_type->second != attrib_name_and_type.second)
+            return false;
+    }
+
+    return true;
+}
+
+
+EquationCache::EquationCache(const FunctionRegistry &function_registry, const size_t max_size)
+    : function_registry_(function_registry), max_size_(max_size), hit_count_(0), miss_count_(0)
+{
+    if (max_size == 0)
+        throw std::invalid_argument("in EquationCache::EquationCache: \"max_size\" must be positive!");
+}
+
+
+std::shared_ptr<const Program> EquationCache::compile(const std::string &equation,
+                                                      const Parser::AttribNameToTypeMap &attrib_name_to_type_map,
+                                                      std::string * const error_msg)
+{
+    std::string normalised_equation;
+    const bool cacheable(NormaliseEquation(equation, &normalised_equation));
+    std::shared_ptr<const Program> program(cacheable ? lookup(normalised_equation, attrib_name_to_type_map)
+                                                     : nullptr);
+    if (program != nullptr) {
+        hit_count_.fetch_add(1, std::memory_order_relaxed);
+        return program;
+    }
+    miss_count_.fetch_add(1, std::memory_order_relaxed);
+
+    // We compile w/o holding the lock, so that a slow compilation never blocks the lookups of other threads.
+    std::shared_ptr<Program> new_program(new Program);
+    Compiler compiler(function_registry_);
+    if (not compiler.compile(equation, attrib_name_to_type_map, new_program.get())) {
+        *error_msg = compiler.getErrorMsg();
+        return nullptr;
+    }
+
+    if (cacheable) {
+        Variant variant(new_program);
+        for (const auto &attrib_name : compiler.getAttribReferences()) {
+            const NodeType attrib_type(attrib_name_to_type_map.find(attrib_name)->second);
+            variant.attrib_names_and_types_.emplace_back(attrib_name, attrib_type);
+        }
+        insert(normalised_equation, std::move(variant));
+    }
+    return new_program;
+}
+
+
+void EquationCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    normalised_equation_to_entry_map_.clear();
+    entries_.clear();
+}
+
+
+size_t EquationCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+
+std::shared_ptr<const Program> EquationCache::lookup(const std::string &normalised_equation,
+                                                     const Parser::AttribNameToTypeMap &attrib_name_to_type_map)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto normalised_equation_and_entry(normalised_equation_to_entry_map_.find(normalised_equation));
+    if (normalised_equation_and_entry == normalised_equation_to_entry_map_.end())
+        return nullptr;
+
+    const auto entry(normalised_equation_and_entry->second);
+    entries_.splice(entries_.begin(), entries_, entry);
+    for (const auto &variant : entry->variants_) {
+        if (IsCompatible(variant.attrib_names_and_types_, attrib_name_to_type_map))
+            return variant.program_;
+    }
+
+    return nullptr;
+}
+
+
+void EquationCache::insert(const std::string &normalised_equation, Variant &&variant) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto normalised_equation_and_entry(normalised_equation_to_entry_map_.find(normalised_equation));
+    if (normalised_equation_and_entry == normalised_equation_to_entry_map_.end()) {
+        entries_.emplace_front(normalised_equation);
+        normalised_equation_and_entry =
+            normalised_equation_to_entry_map_.emplace(normalised_equation, entries_.begin()).first;
+
+        if (entries_.size() > max_size_) {
+            normalised_equation_to_entry_map_.erase(entries_.back().normalised_equation_);
+            entries_.pop_back();
+        }
+    }
+
+    // N.B. if another thread compiled the same equation concurrently we may end up w/ two equivalent variants, which
+    // is harmless.
+    normalised_equation_and_entry->second->variants_.emplace_back(std::move(variant));
+}
+
+
+} // namespace Nyaa
@@ -0,0 +1,90 @@
+/** \file    NyaaFunction.cc
+ *  \brief   Implementation of the default batch interface of functions.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "NyaaFunction.h"
+#include "NyaaNodes.h"
+#include "NyaaSimdKernels.h"
+
+
+namespace Nyaa {
+
+
+void Function::evaluateBatch(const BatchFuncArgs &args, BatchFuncResult * const result) const {
+    std::vector<FuncValue> row_args(args.size());
+    const FuncArgs row_args_view(row_args.data(), args.getTypes(), args.size());
+    for (size_t row(0); row < args.getRowCount(); ++row) {
+        if (result->hasFailed(row)) // Don't call functions w/ garbage arguments.
+            continue;
+
+        for (size_t arg_no(0); arg_no < args.size(); ++arg_no) {
+            switch (args.getType(arg_no)) {
+            case NodeType::FLOAT_NODE:
+                row_args[arg_no].float_ = args.getFloats(arg_no)[row];
+                break;
+            case NodeType::INT_NODE:
+                row_args[arg_no].int_ = args.getInts(arg_no)[row];
+                break;
+            case NodeType::BOOLEAN_NODE:
+                row_args[arg_no].bool_ = GetMaskBit(args.getBools(arg_no), row);
+                break;
+            case NodeType::STRING_NODE:
+                row_args[arg_no].string_ = args.getStrings(arg_no)[row];
+                break;
+            default:
+                throw std::logic_error("in Function::evaluateBatch: unexpected argument type "
+                                       + NodeTypeToString(args.getType(arg_no)) + "!");
+            }
+        }
+
+        FuncValue value;
+        FuncResult row_result(&value, result->getStringBuffer(row));
+        try {
+            evaluateFunction(row_args_view, &row_result);
+        } catch (const std::domain_error &x) {
+            result->setError(row, x.what());
+            continue;
+        } catch (const std::invalid_argument &x) {
+            result->setError(row, x.what());
+            continue;
+        }
+
+        if (row_result.getType() != result->getType())
+            throw std::logic_error("in Function::evaluateBatch: " + getName() + "() returned a value of the wrong "
+                                   "type!");
+
+        switch (result->getType()) {
+        case NodeType::FLOAT_NODE:
+            result->getFloats()[row] = value.float_;
+            break;
+        case NodeType::INT_NODE:
+            result->getInts()[row] = value.int_;
+            break;
+        case NodeType::BOOLEAN_NODE:
+            SetMaskBit(result->getBools(), row, value.bool_);
+            break;
+        default:
+            result->setStringPointer(row, value.string_);
+        }
+    }
+}
+
+
+} // namespace Nyaa
@@ -0,0 +1,116 @@
+/** \file    NyaaFunctionRegistry.cc
+ *  \brief   Implementation of the FunctionRegistry class.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "NyaaFunctionRegistry.h"
+#include <algorithm>
+#include <stdexcept>
+#include <cctype>
+
+
+namespace Nyaa {
+
+
+static inline unsigned char ToUpper(const char ch) {
+    return static_cast<unsigned char>(std::toupper(static_cast<unsigned char>(ch)));
+}
+
+
+void FunctionRegistry::registerFunction(const Function &function) {
+    const std::string &name(function.getName());
+    const uint64_t hash(CaseInsensitiveHash(name.data(), name.size()));
+    if (findEntry(name.data(), name.size(), hash) != nullptr)
+        throw std::invalid_argument("in FunctionRegistry::registerFunction: a function named \"" + name
+                                    + "\" has already been registered!");
+
+    // Keep the load factor at or below 1/2, so that probe sequences remain short.
+    if (2 * (size_ + 1) > entries_.size())
+        grow();
+
+    const size_t mask(entries_.size() - 1);
+    size_t index(hash & mask);
+    while (entries_[index].function_ != nullptr)
+        index = (index + 1) & mask;
+
+    Entry &entry(entries_[index]);
+    entry.hash_ = hash;
+    entry.upper_case_name_.resize(name.size());
+    std::transform(name.cbegin(), name.cend(), entry.upper_case_name_.begin(), ToUpper);
+    entry.function_ = &function;
+    ++size_;
+}
+
+
+const Function *FunctionRegistry::lookup(const char * const name, const size_t name_length) const {
+    const Entry * const entry(findEntry(name, name_length, CaseInsensitiveHash(name, name_length)));
+    return entry == nullptr ? nullptr : entry->function_;
+}
+
+
+// FNV-1a over the upper-case characters.
+uint64_t FunctionRegistry::CaseInsensitiveHash(const char * const name, const size_t name_length) {
+    uint64_t hash(UINT64_C(0xCBF29CE484222325));
+    for (size_t i(0); i < name_length; ++i) {
+        hash ^= ToUpper(name[i]);
+        hash *= UINT64_C(0x100000001B3);
+    }
+    return hash;
+}
+
+
+const FunctionRegistry::Entry *FunctionRegistry::findEntry(const char * const name, const size_t name_length,
+                                                           const uint64_t hash) const
+{
+    if (entries_.empty())
+        return nullptr;
+
+    const size_t mask(entries_.size() - 1);
+    for (size_t index(hash & mask); entries_[index].function_ != nullptr; index = (index + 1) & mask) {
+        const Entry &entry(entries_[index]);
+        if (entry.hash_ == hash and entry.upper_case_name_.size() == name_length
+            and std::equal(name, name + name_length, entry.upper_case_name_.cbegin(),
+                           [](const char ch, const char upper_case_ch) {
+                               return ToUpper(ch) == static_cast<unsigned char>(upper_case_ch);
+                           }))
+            return &entry;
+    }
+
+    return nullptr;
+}
+
+
+void FunctionRegistry::grow() {
+    std::vector<Entry> old_entries(entries_.empty() ? 16 : 2 * entries_.size());
+    old_entries.swap(entries_);
+
+    const size_t mask(entries_.size() - 1);
+    for (auto &old_entry : old_entries) {
+        if (old_entry.function_ == nullptr)
+            continue;
+
+        size_t index(old_entry.hash_ & mask);
+        while (entries_[index].function_ != nullptr)
+            index = (index + 1) & mask;
+        entries_[index] = std::move(old_entry);
+    }
+}
+
+
+} // namespace Nyaa
@@ -0,0 +1,575 @@
+/** \file    NyaaInterpreter.cc
+ *  \brief   Implementation of the Interpreter class.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "NyaaInterpreter.h"
+#include <stdexcept>
+#include <cmath>
+#include "NyaaConversions.h"
+#include "NyaaIntArithmetic.h"
+#include "NyaaNodes.h"
+
+
+namespace Nyaa {
+
+
+// Binary operators find their left operand on top of the stack and replace their right operand w/ the result.
+#define BINARY_OP(result_member, operand_member, op)                                        \
+    --sp;                                                                                   \
+    (sp - 1)->result_member = sp->operand_member op (sp - 1)->operand_member;               \
+    break
+
+#define CHECKED_INT_OP(overflows)                                                           \
+    --sp;                                                                                   \
+    if (overflows(sp->int_, (sp - 1)->int_, &(sp - 1)->int_))                               \
+        ThrowIntOverflow(pc->getSourceLocation());                                          \
+    break
+
+// Fused AREF, ?PUSH and comparison.
+#define ATTRIB_CONSTANT_COMPARISON(value_type, attrib_getter, constant_getter, op)          \
+    {                                                                                       \
+        value_type attrib_value;                                                            \
+        if (not attrib_source.attrib_getter(pc->getOperand(), &attrib_value))               \
+            ThrowNoValue(*pc, constant_pool);                                               \
+        (sp++)->bool_ = attrib_value op constant_pool.constant_getter(pc->getOperand2());   \
+        break;                                                                              \
+    }
+
+// Pops the left operand and replaces the right one w/ "lhs" followed by it.  The fused SCONV? and SCONCAT
+// instructions convert their left operand into the string buffer of its own slot first.
+#define CONCATENATION(lhs)                                                                  \
+    {                                                                                       \
+        --sp;                                                                               \
+        std::string &result(string_buffers_[sp - 1 - stack_base]);                          \
+        Concatenate(lhs, *(sp - 1)->string_, &result);                                      \
+        (sp - 1)->string_ = &result;                                                        \
+        break;                                                                              \
+    }
+
+#define STRING_COMPARISON(op)                                                               \
+    --sp;                                                                                   \
+    (sp - 1)->bool_ = sp->string_->compare(*(sp - 1)->string_) op 0;                         \
+    break
+
+
+namespace {
+
+
+// The sources of attribute values for Interpreter::execute().  Attributes are identified by their reference index.
+
+
+class NamedAttribSource {
+    const AttribContext &context_;
+    const ConstantPool &constant_pool_;
+public:
+    NamedAttribSource(const AttribContext &context, const ConstantPool &constant_pool)
+        : context_(context), constant_pool_(constant_pool) { }
+
+    inline bool getFloatAttrib(const uint32_t attrib_ref_index, double * const value) const
+        { return context_.getFloatAttrib(constant_pool_.getAttribRef(attrib_ref_index).name_, value); }
+    inline bool getIntAttrib(const uint32_t attrib_ref_index, int64_t * const value) const
+        { return context_.getIntAttrib(constant_pool_.getAttribRef(attrib_ref_index).name_, value); }
+    inline bool getBooleanAttrib(const uint32_t attrib_ref_index, bool * const value) const
+        { return context_.getBooleanAttrib(constant_pool_.getAttribRef(attrib_ref_index).name_, value); }
+    inline const std::string *getStringAttrib(const uint32_t attrib_ref_index) const
+        { return context_.getStringAttrib(constant_pool_.getAttribRef(attrib_ref_index).name_); }
+};
+
+
+class BoundAttribSource {
+    const IndexedAttribContext &context_;
+    const Binding &binding_;
+public:
+    BoundAttribSource(const IndexedAttribContext &context, const Binding &binding)
+        : context_(context), binding_(binding) { }
+
+    inline bool getFloatAttrib(const uint32_t attrib_ref_index, double * const value) const
+        { return context_.getFloatAttrib(binding_.getSlot(attrib_ref_index), value); }
+    inline bool getIntAttrib(const uint32_t attrib_ref_index, int64_t * const value) const
+        { return context_.getIntAttrib(binding_.getSlot(attrib_ref_index), value); }
+    inline bool getBooleanAttrib(const uint32_t attrib_ref_index, bool * const value) const
+        { return context_.getBooleanAttrib(binding_.getSlot(attrib_ref_index), value); }
+    inline const std::string *getStringAttrib(const uint32_t attrib_ref_index) const
+        { return context_.getStringAttrib(binding_.getSlot(attrib_ref_index)); }
+};
+
+
+[[noreturn]] void ThrowNoValue(const CodeAndSourceLocation &attrib_ref_instruction, const ConstantPool &constant_pool) {
+    throw std::runtime_error(SourceLocationPrefix(attrib_ref_instruction.getSourceLocation()) + "attribute \""
+                             + constant_pool.getAttribRef(attrib_ref_instruction.getOperand()).name_
+                             + "\" has no value!");
+}
+
+
+/** Stores "lhs" followed by "rhs" in "*result", which may be where "rhs" lives. */
+inline void Concatenate(const std::string &lhs, const std::string &rhs, std::string * const result) {
+    if (&rhs == result)
+        result->insert(0, lhs);
+    else {
+        result->assign(lhs);
+        result->append(rhs);
+    }
+}
+
+
+[[noreturn]] void ThrowIntOverflow(const size_t source_location) {
+    throw std::domain_error(SourceLocationPrefix(source_location) + "integer overflow!");
+}
+
+
+[[noreturn]] void ThrowDivisionByZero(const size_t source_location) {
+    throw std::domain_error(SourceLocationPrefix(source_location) + "division by zero!");
+}
+
+
+/** \return "value", which has to be left on the stack by "program", as a FuncArg. */
+FuncArg MakeResult(const Program &program, const FuncValue &value) {
+    switch (program.getResultType()) {
+    case NodeType::FLOAT_NODE:
+        return FuncArg(value.float_);
+    case NodeType::INT_NODE:
+        return FuncArg(value.int_);
+    case NodeType::BOOLEAN_NODE:
+        return FuncArg(value.bool_);
+    case NodeType::STRING_NODE:
+        return FuncArg(*value.string_);
+    default:
+        throw std::logic_error("in Interpreter::evaluate: program has no result type!");
+    }
+}
+
+
+} // unnamed namespace
+
+
+FuncArg Interpreter::evaluate(const Program &program, const AttribContext &context) {
+    return execute(program, NamedAttribSource(context, program.getConstantPool()));
+}
+
+
+FuncArg Interpreter::evaluate(const Binding &binding, const IndexedAttribContext &context) {
+    return execute(binding.getProgram(), BoundAttribSource(context, binding));
+}
+
+
+template<typename AttribSource> FuncArg Interpreter::execute(const Program &program,
+                                                             const AttribSource &attrib_source)
+{
+    if (stack_.size() < program.getMaxStackDepth()) {
+        stack_.resize(program.getMaxStackDepth());
+        string_buffers_.resize(program.getMaxStackDepth());
+    }
+    if (locals_.size() < program.getLocalCount()) {
+        locals_.resize(program.getLocalCount());
+        local_string_buffers_.resize(program.getLocalCount());
+    }
+
+    if (jit_threshold_ != NO_JIT) {
+        const NativeCode * const native_code(program.getJitTier().countEvaluation(program, jit_threshold_));
+        if (native_code != nullptr)
+            return executeNative(*native_code, program, attrib_source);
+    }
+
+    const ConstantPool &constant_pool(program.getConstantPool());
+    Value * const stack_base(stack_.data());
+    Value *sp(stack_base); // Points to the first unused slot.
+
+    const CodeAndSourceLocation * const end(program.data() + program.size());
+    for (const CodeAndSourceLocation *pc(program.data()); pc != end; ++pc) {
+        switch (pc->getCode()) {
+        // Addition and multiplication start w/ the right operand, as the JitCompiler's code does, so that both
+        // return the same NaN if both operands are NaNs.
+        case Instruction::FADD:
+            --sp;
+            (sp - 1)->float_ = (sp - 1)->float_ + sp->float_;
+            break;
+        case Instruction::FSUB:
+            BINARY_OP(float_, float_, -);
+        case Instruction::FMUL:
+            --sp;
+            (sp - 1)->float_ = (sp - 1)->float_ * sp->float_;
+            break;
+        case Instruction::FDIV:
+            --sp;
+            if ((sp - 1)->float_ == 0.0)
+                ThrowDivisionByZero(pc->getSourceLocation());
+            (sp - 1)->float_ = sp->float_ / (sp - 1)->float_;
+            break;
+        case Instruction::FPOW:
+            --sp;
+            (sp - 1)->float_ = std::pow(sp->float_, (sp - 1)->float_);
+            break;
+        case Instruction::SCONCAT:
+            CONCATENATION(*sp->string_);
+        case Instruction::BEQLF:
+            BINARY_OP(bool_, float_, ==);
+        case Instruction::BNEQLF:
+            BINARY_OP(bool_, float_, !=);
+        case Instruction::BGTF:
+            BINARY_OP(bool_, float_, >);
+        case Instruction::BLTF:
+            BINARY_OP(bool_, float_, <);
+        case Instruction::BGTEF:
+            BINARY_OP(bool_, float_, >=);
+        case Instruction::BLTEF:
+            BINARY_OP(bool_, float_, <=);
+        case Instruction::BEQLS:
+            STRING_COMPARISON(==);
+        case Instruction::BNEQLS:
+            STRING_COMPARISON(!=);
+        case Instruction::BGTS:
+            STRING_COMPARISON(>);
+        case Instruction::BLTS:
+            STRING_COMPARISON(<);
+        case Instruction::BGTES:
+            STRING_COMPARISON(>=);
+        case Instruction::BLTES:
+            STRING_COMPARISON(<=);
+        case Instruction::BGTB:
+            BINARY_OP(bool_, bool_, >);
+        case Instruction::BLTB:
+            BINARY_OP(bool_, bool_, <);
+        case Instruction::BGTEB:
+            BINARY_OP(bool_, bool_, >=);
+        case Instruction::BLTEB:
+            BINARY_OP(bool_, bool_, <=);
+        case Instruction::BEQLB:
+            BINARY_OP(bool_, bool_, ==);
+        case Instruction::BNEQLB:
+            BINARY_OP(bool_, bool_, !=);
+        case Instruction::BEQLI:
+            BINARY_OP(bool_, int_, ==);
+        case Instruction::BNEQLI:
+            BINARY_OP(bool_, int_, !=);
+        case Instruction::BGTI:
+            BINARY_OP(bool_, int_, >);
+        case Instruction::BLTI:
+            BINARY_OP(bool_, int_, <);
+        case Instruction::BGTEI:
+            BINARY_OP(bool_, int_, >=);
+        case Instruction::BLTEI:
+            BINARY_OP(bool_, int_, <=);
+        case Instruction::CALL: {
+            const unsigned arg_count(pc->getOperand2());
+            sp -= arg_count;
+            call(constant_pool.getCallSite(pc->getOperand()), sp, sp - stack_base, pc->getSourceLocation());
+            ++sp;
+            break;
+        }
+        case Instruction::CALLF: {
+            const unsigned arg_count(pc->getOperand2());
+            sp -= arg_count;
+            callFastPath(constant_pool.getCallSite(pc->getOperand()), sp, arg_count, pc->getSourceLocation());
+            ++sp;
+            break;
+        }
+        case Instruction::FUMINUS:
+            (sp - 1)->float_ = -(sp - 1)->float_;
+            break;
+        case Instruction::FUPLUS:
+            break;
+        case Instruction::AREF:
+        case Instruction::AREF2: {
+            const ConstantPool::AttribRef &attrib_ref(constant_pool.getAttribRef(pc->getOperand()));
+            bool found;
+            switch (attrib_ref.type_) {
+            case NodeType::FLOAT_NODE:
+                found = attrib_source.getFloatAttrib(pc->getOperand(), &sp->float_);
+                break;
+            case NodeType::INT_NODE:
+                found = attrib_source.getIntAttrib(pc->getOperand(), &sp->int_);
+                break;
+            case NodeType::BOOLEAN_NODE:
+                found = attrib_source.getBooleanAttrib(pc->getOperand(), &sp->bool_);
+                break;
+            case NodeType::STRING_NODE:
+                found = (sp->string_ = attrib_source.getStringAttrib(pc->getOperand())) != nullptr;
+                break;
+            default:
+                throw std::runtime_error("in Interpreter::evaluate: unexpected attribute type "
+                                         + NodeTypeToString(attrib_ref.type_) + "!");
+            }
+
+            if (not found) {
+                if (pc->getCode() == Instruction::AREF)
+                    ThrowNoValue(*pc, constant_pool);
+                switch (attrib_ref.type_) {
+                case NodeType::FLOAT_NODE:
+                    sp->float_ = constant_pool.getFloat(pc->getOperand2());
+                    break;
+                case NodeType::INT_NODE:
+                    sp->int_ = constant_pool.getInt(pc->getOperand2());
+                    break;
+                case NodeType::BOOLEAN_NODE:
+                    sp->bool_ = pc->getOperand2() != 0;
+                    break;
+                default:
+                    sp->string_ = &constant_pool.getString(pc->getOperand2());
+                }
+            }
+            ++sp;
+            break;
+        }
+        case Instruction::FCONVI:
+            (sp - 1)->float_ = static_cast<double>((sp - 1)->int_);
+            break;
+        case Instruction::FCONVB:
+            (sp - 1)->float_ = (sp - 1)->bool_ ? 1.0 : 0.0;
+            break;
+        case Instruction::FCONVS: {
+            const std::string &convertee(*(sp - 1)->string_);
+            if (not StringToFloat(convertee, &(sp - 1)->float_))
+                throw std::invalid_argument(SourceLocationPrefix(pc->getSourceLocation()) + "can't convert \""
+                                            + convertee + "\" to a floating point number!");
+            break;
+        }
+        case Instruction::SCONVF: {
+            std::string &result(string_buffers_[sp - 1 - stack_base]);
+            FloatToString((sp - 1)->float_, &result);
+            (sp - 1)->string_ = &result;
+            break;
+        }
+        case Instruction::SCONVI: {
+            std::string &result(string_buffers_[sp - 1 - stack_base]);
+            IntToString((sp - 1)->int_, &result);
+            (sp - 1)->string_ = &result;
+            break;
+        }
+        case Instruction::SCONVB:
+            (sp - 1)->string_ = &BoolToString((sp - 1)->bool_);
+            break;
+        case Instruction::FPUSH:
+            (sp++)->float_ = constant_pool.getFloat(pc->getOperand());
+            break;
+        case Instruction::SPUSH:
+            (sp++)->string_ = &constant_pool.getString(pc->getOperand());
+            break;
+        case Instruction::BPUSH:
+            (sp++)->bool_ = pc->getOperand() != 0;
+            break;
+        case Instruction::IPUSH:
+            (sp++)->int_ = constant_pool.getInt(pc->getOperand());
+            break;
+        case Instruction::STORE: {
+            Value &local(locals_[pc->getOperand()]);
+            local = *(sp - 1);
+            if (static_cast<NodeType>(pc->getOperand2()) == NodeType::STRING_NODE
+                and local.string_ == &string_buffers_[sp - 1 - stack_base])
+            {
+                local_string_buffers_[pc->getOperand()] = *local.string_;
+                local.string_ = &local_string_buffers_[pc->getOperand()];
+            }
+            break;
+        }
+        case Instruction::LOAD:
+            *sp++ = locals_[pc->getOperand()];
+            break;
+        case Instruction::JUMP: // The loop increment takes us to the target.
+            pc = program.data() + pc->getOperand() - 1;
+            break;
+        case Instruction::JUMP_IF_FALSE:
+            if (not (--sp)->bool_)
+                pc = program.data() + pc->getOperand() - 1;
+            break;
+        case Instruction::JUMP_IF_TRUE:
+            if ((--sp)->bool_)
+                pc = program.data() + pc->getOperand() - 1;
+            break;
+        case Instruction::IADD:
+            CHECKED_INT_OP(AddOverflows);
+        case Instruction::ISUB:
+            CHECKED_INT_OP(SubOverflows);
+        case Instruction::IMUL:
+            CHECKED_INT_OP(MulOverflows);
+        case Instruction::IDIV:
+            --sp;
+            if ((sp - 1)->int_ == 0)
+                ThrowDivisionByZero(pc->getSourceLocation());
+            if (QuotientOverflows(sp->int_, (sp - 1)->int_, &(sp - 1)->int_))
+                ThrowIntOverflow(pc->getSourceLocation());
+            break;
+        case Instruction::IMOD:
+            --sp;
+            if ((sp - 1)->int_ == 0)
+                ThrowDivisionByZero(pc->getSourceLocation());
+            (sp - 1)->int_ = IntModulo(sp->int_, (sp - 1)->int_);
+            break;
+        case Instruction::IUMINUS:
+            if (NegateOverflows((sp - 1)->int_, &(sp - 1)->int_))
+                ThrowIntOverflow(pc->getSourceLocation());
+            break;
+        case Instruction::FAREFI: {
+            int64_t attrib_value;
+            if (not attrib_source.getIntAttrib(pc->getOperand(), &attrib_value))
+                ThrowNoValue(*pc, constant_pool);
+            (sp++)->float_ = static_cast<double>(attrib_value);
+            break;
+        }
+        case Instruction::BEQLFAC:
+            ATTRIB_CONSTANT_COMPARISON(double, getFloatAttrib, getFloat, ==);
+        case Instruction::BNEQLFAC:
+            ATTRIB_CONSTANT_COMPARISON(double, getFloatAttrib, getFloat, !=);
+        case Instruction::BGTFAC:
+            ATTRIB_CONSTANT_COMPARISON(double, getFloatAttrib, getFloat, >);
+        case Instruction::BLTFAC:
+            ATTRIB_CONSTANT_COMPARISON(double, getFloatAttrib, getFloat, <);
+        case Instruction::BGTEFAC:
+            ATTRIB_CONSTANT_COMPARISON(double, getFloatAttrib, getFloat, >=);
+        case Instruction::BLTEFAC:
+            ATTRIB_CONSTANT_COMPARISON(double, getFloatAttrib, getFloat, <=);
+        case Instruction::BEQLIAC:
+            ATTRIB_CONSTANT_COMPARISON(int64_t, getIntAttrib, getInt, ==);
+        case Instruction::BNEQLIAC:
+            ATTRIB_CONSTANT_COMPARISON(int64_t, getIntAttrib, getInt, !=);
+        case Instruction::BGTIAC:
+            ATTRIB_CONSTANT_COMPARISON(int64_t, getIntAttrib, getInt, >);
+        case Instruction::BLTIAC:
+            ATTRIB_CONSTANT_COMPARISON(int64_t, getIntAttrib, getInt, <);
+        case Instruction::BGTEIAC:
+            ATTRIB_CONSTANT_COMPARISON(int64_t, getIntAttrib, getInt, >=);
+        case Instruction::BLTEIAC:
+            ATTRIB_CONSTANT_COMPARISON(int64_t, getIntAttrib, getInt, <=);
+        case Instruction::SCONCATF:
+            FloatToString((sp - 1)->float_, &string_buffers_[sp - 1 - stack_base]);
+            CONCATENATION(string_buffers_[sp - stack_base]);
+        case Instruction::SCONCATI:
+            IntToString((sp - 1)->int_, &string_buffers_[sp - 1 - stack_base]);
+            CONCATENATION(string_buffers_[sp - stack_base]);
+        case Instruction::SCONCATB:
+            CONCATENATION(BoolToString(sp->bool_));
+        }
+    }
+
+    if (sp != stack_base + 1)
+        throw std::logic_error("in Interpreter::evaluate: corrupt program, stack depth is "
+                               + std::to_string(sp - stack_base) + " after execution!");
+
+    return MakeResult(program, *stack_base);
+}
+
+
+// The native code reports errors by returning a status, so that no exceptions have to be propagated through it.
+template<typename AttribSource> FuncArg Interpreter::executeNative(const NativeCode &native_code,
+                                                                   const Program &program,
+                                                                   const AttribSource &attrib_source)
+{
+    JitFrame frame;
+    frame.stack_ = stack_.data();
+    frame.locals_ = locals_.data();
+    frame.program_ = &program;
+    frame.attrib_source_ = &attrib_source;
+    frame.interpreter_ = this;
+    frame.get_float_attrib_ = GetAttrib<AttribSource, double, &AttribSource::getFloatAttrib>;
+    frame.get_int_attrib_ = GetAttrib<AttribSource, int64_t, &AttribSource::getIntAttrib>;
+    frame.get_boolean_attrib_ = GetAttrib<AttribSource, bool, &AttribSource::getBooleanAttrib>;
+    frame.call_ = Call;
+
+    const JitStatus status(native_code.run(&frame));
+    switch (status) {
+    case JitStatus::OK:
+        return MakeResult(program, stack_[0]);
+    case JitStatus::NO_VALUE:
+        ThrowNoValue(program[frame.error_address_], program.getConstantPool());
+    case JitStatus::DIVISION_BY_ZERO:
+        ThrowDivisionByZero(program[frame.error_address_].getSourceLocation());
+    case JitStatus::INT_OVERFLOW:
+        ThrowIntOverflow(program[frame.error_address_].getSourceLocation());
+    case JitStatus::EXCEPTION: {
+        std::exception_ptr exception;
+        exception.swap(jit_exception_);
+        std::rethrow_exception(exception);
+    }
+    }
+
+    throw std::logic_error("in Interpreter::executeNative: unknown status " + std::to_string(static_cast<int>(status))
+                           + "!");
+}
+
+
+#undef BINARY_OP
+#undef CHECKED_INT_OP
+#undef ATTRIB_CONSTANT_COMPARISON
+#undef CONCATENATION
+#undef STRING_COMPARISON
+
+
+// The arguments are in consecutive slots starting at "args" and the result replaces the first argument.
+void Interpreter::call(const ConstantPool::CallSite &call_site, Value * const args, const size_t stack_depth,
+                       const size_t source_location)
+{
+    FuncResult result(args, &string_buffers_[stack_depth]);
+    try {
+        call_site.function_->evaluateFunction(FuncArgs(args, call_site.arg_types_.data(), call_site.arg_types_.size()),
+                                              &result);
+    } catch (const std::domain_error &x) {
+        throw std::domain_error(SourceLocationPrefix(source_location) + x.what());
+    } catch (const std::invalid_argument &x) {
+        throw std::invalid_argument(SourceLocationPrefix(source_location) + x.what());
+    }
+
+    if (result.getType() != call_site.return_type_)
+        throw std::logic_error("in Interpreter::call: " + call_site.function_->getName()
+                               + "() returned a value of the wrong type!");
+}
+
+
+template<typename AttribSource, typename ValueType,
+         bool (AttribSource::*getter)(const uint32_t, ValueType * const) const>
+int Interpreter::GetAttrib(JitFrame * const frame, const uint32_t attrib_ref_index, ValueType * const value) {
+    try {
+        return (static_cast<const AttribSource *>(frame->attrib_source_)->*getter)(attrib_ref_index, value) ? 1 : 0;
+    } catch (...) {
+        static_cast<Interpreter *>(frame->interpreter_)->jit_exception_ = std::current_exception();
+        return -1;
+    }
+}
+
+
+int Interpreter::Call(JitFrame * const frame, const uint32_t address, Value * const args) {
+    Interpreter &interpreter(*static_cast<Interpreter *>(frame->interpreter_));
+    const CodeAndSourceLocation &instruction((*frame->program_)[address]);
+    const ConstantPool::CallSite &call_site(frame->program_->getConstantPool().getCallSite(instruction.getOperand()));
+    try {
+        if (instruction.getCode() == Instruction::CALL)
+            interpreter.call(call_site, args, args - frame->stack_, instruction.getSourceLocation());
+        else
+            interpreter.callFastPath(call_site, args, instruction.getOperand2(), instruction.getSourceLocation());
+        return 0;
+    } catch (...) {
+        interpreter.jit_exception_ = std::current_exception();
+        return -1;
+    }
+}
+
+
+void Interpreter::callFastPath(const ConstantPool::CallSite &call_site, Value * const args, const size_t arg_count,
+                               const size_t source_location)
+{
+    try {
+        call_site.fast_path_(args, arg_count);
+    } catch (const std::domain_error &x) {
+        throw std::domain_error(SourceLocationPrefix(source_location) + x.what());
+    } catch (const std::invalid_argument &x) {
+        throw std::invalid_argument(SourceLocationPrefix(source_location) + x.what());
+    }
+}
+
+
+} // namespace Nyaa
@@ -0,0 +1,869 @@
+/** \file    NyaaJitCompiler.cc
+ *  \brief   Implementation of the JitCompiler class and its helpers.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "NyaaJitCompiler.h"
+#include <algorithm>
+#include <initializer_list>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#if defined(__x86_64__) and defined(__linux__) and not defined(NYAA_NO_JIT)
+#   include <sys/mman.h>
+#   include <unistd.h>
+#   define NYAA_HAVE_JIT 1
+#endif
+#include "NyaaIntArithmetic.h"
+#include "NyaaProgram.h"
+
+
+namespace Nyaa {
+
+
+#ifdef NYAA_HAVE_JIT
+
+
+/** A large mapping that the native code of many programs is bump-allocated from.  Code is only ever written to the
+ *  read/write tail of a chunk, after which the pages it occupies are sealed, i.e. made read/execute-only.  As the
+ *  sealed pages always form a prefix of the chunk, the kernel merges them and a chunk never takes up more than two
+ *  mappings.  The code of each program starts on a page of its own, as sealed pages can't be written to anymore.
+ */
+struct ExecutableChunk {
+    char * const memory_;
+    const size_t size_;
+    size_t sealed_size_;     // Always a multiple of the page size.
+    size_t live_code_count_; // The number of NativeCode instances that have been allocated from us.
+
+    ExecutableChunk(void * const memory, const size_t size)
+        : memory_(reinterpret_cast<char *>(memory)), size_(size), sealed_size_(0), live_code_count_(0) { }
+};
+
+
+namespace {
+
+
+constexpr size_t EXECUTABLE_CHUNK_SIZE(1u << 20); // A multiple of all the page sizes out there.
+
+
+/** Hands out sealed code from the current chunk and starts a new chunk once it is full.  Chunks, other than the
+ *  current one, are unmapped as soon as the last NativeCode in them has been destroyed.
+ */
+class ExecutableArena {
+    std::mutex mutex_;
+    const size_t page_size_;
+    ExecutableChunk *current_chunk_;
+public:
+    ExecutableArena(): page_size_(static_cast<size_t>(::sysconf(_SC_PAGESIZE))), current_chunk_(nullptr) { }
+
+    /** \return the sealed copy of "code" and the chunk that it has been allocated from in "*chunk". */
+    void *allocate(const uint8_t * const code, const size_t code_size, ExecutableChunk ** const chunk);
+
+    void release(ExecutableChunk * const chunk);
+
+    // Never destroyed, as NativeCode instances may still be destroyed after the static destructors have run.
+    static ExecutableArena &GetInstance() {
+        static ExecutableArena * const arena(new ExecutableArena);
+        return *arena;
+    }
+private:
+    static void UnmapChunk(ExecutableChunk * const chunk);
+};
+
+
+void *ExecutableArena::allocate(const uint8_t * const code, const size_t code_size, ExecutableChunk ** const chunk) {
+    const size_t allocation_size((code_size + page_size_ - 1) / page_size_ * page_size_);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (current_chunk_ == nullptr or current_chunk_->sealed_size_ + allocation_size > current_chunk_->size_) {
+        const size_t chunk_size(std::max(EXECUTABLE_CHUNK_SIZE, allocation_size));
+        void * const memory(::mmap(nullptr, chunk_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        if (memory == MAP_FAILED)
+            throw std::runtime_error("in ExecutableArena::allocate: mmap(2) failed!");
+        if (current_chunk_ != nullptr and current_chunk_->live_code_count_ == 0)
+            UnmapChunk(current_chunk_);
+        current_chunk_ = new ExecutableChunk(memory, chunk_size);
+    }
+
+    char * const allocation(current_chunk_->memory_ + current_chunk_->sealed_size_);
+    std::memcpy(allocation, code, code_size);
+    if (::mprotect(allocation, allocation_size, PROT_READ | PROT_EXEC) != 0)
+        throw std::runtime_error("in ExecutableArena::allocate: mprotect(2) failed!");
+    current_chunk_->sealed_size_ += allocation_size;
+    ++current_chunk_->live_code_count_;
+
+    *chunk = current_chunk_;
+    return allocation;
+}
+
+
+void ExecutableArena::release(ExecutableChunk * const chunk) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--chunk->live_code_count_ == 0 and chunk != current_chunk_)
+        UnmapChunk(chunk);
+}
+
+
+void ExecutableArena::UnmapChunk(ExecutableChunk * const chunk) {
+    ::munmap(chunk->memory_, chunk->size_);
+    delete chunk;
+}
+
+
+} // unnamed namespace
+
+
+NativeCode::NativeCode(const uint8_t * const code, const size_t code_size)
+    : memory_(ExecutableArena::GetInstance().allocate(code, code_size, &chunk_))
+{
+}
+
+
+NativeCode::~NativeCode() {
+    ExecutableArena::GetInstance().release(chunk_);
+}
+
+
+#else // ifdef NYAA_HAVE_JIT
+
+
+NativeCode::NativeCode(const uint8_t * const /*code*/, const size_t /*code_size*/)
+    : memory_(nullptr), chunk_(nullptr)
+{
+    throw std::runtime_error("in NativeCode::NativeCode: no JIT support on this platform!");
+}
+
+
+NativeCode::~NativeCode() {
+}
+
+
+#endif // ifdef NYAA_HAVE_JIT
+
+
+namespace {
+
+
+enum Register : unsigned { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+enum XmmRegister : unsigned { XMM0, XMM1 };
+
+
+// The registers that hold the same values throughout the native code.  All of them are callee-saved.
+constexpr Register STACK(RBX);  // JitFrame::stack_
+constexpr Register FRAME(R12);
+constexpr Register LOCALS(R13); // JitFrame::locals_
+
+
+// The condition codes of Jcc and SETcc.
+enum class Condition : uint8_t {
+    OVERFLOW_SET = 0x0, BELOW = 0x2, ABOVE_OR_EQUAL = 0x3, EQUAL = 0x4, NOT_EQUAL = 0x5, BELOW_OR_EQUAL = 0x6,
+    ABOVE = 0x7, SIGN_SET = 0x8, NOT_SIGN_SET = 0x9, PARITY_SET = 0xA, PARITY_CLEAR = 0xB, LESS = 0xC,
+    GREATER_OR_EQUAL = 0xD, LESS_OR_EQUAL = 0xE, GREATER = 0xF
+};
+
+
+/** Encodes the few x86-64 instruction forms we need.  Memory operands are always [base + disp32]. */
+class Assembler {
+    std::vector<uint8_t> code_;
+public:
+    inline const uint8_t *data() const { return code_.data(); }
+    inline size_t size() const { return code_.size(); }
+
+    inline void byte(const uint8_t value) { code_.push_back(value); }
+    void dword(const uint32_t value);
+    void qword(const uint64_t value);
+
+    /** An instruction w/ a register operand "reg", which may also be an opcode extension, and a memory operand. */
+    void memoryOp(const uint8_t prefix, const bool wide, const std::initializer_list<uint8_t> opcode,
+                  const unsigned reg, const unsigned base, const int32_t displacement);
+
+    /** Like memoryOp() but the second operand is the register "rm". */
+    void registerOp(const uint8_t prefix, const bool wide, const std::initializer_list<uint8_t> opcode,
+                    const unsigned reg, const unsigned rm);
+
+    void movImmediate(const Register reg, const uint64_t value);
+    inline void push(const Register reg) { rex(false, 0, reg); byte(0x50 | (reg & 7u)); }
+    inline void pop(const Register reg) { rex(false, 0, reg); byte(0x58 | (reg & 7u)); }
+
+    /** \return the offset of the rel32 to be passed to patchRel32(). */
+    size_t jump();
+    size_t jump(const Condition condition);
+
+    /** Makes the rel32 at "rel32_offset" refer to "target". */
+    void patchRel32(const size_t rel32_offset, const size_t target);
+private:
+    void rex(const bool wide, const unsigned reg, const unsigned rm);
+};
+
+
+void Assembler::dword(const uint32_t value) {
+    for (unsigned byte_no(0); byte_no < 4; ++byte_no)
+        byte(static_cast<uint8_t>(value >> (8 * byte_no)));
+}
+
+
+void Assembler::qword(const uint64_t value) {
+    dword(static_cast<uint32_t>(value));
+    dword(static_cast<uint32_t>(value >> 32u));
+}
+
+
+void Assembler::rex(const bool wide, const unsigned reg, const unsigned rm) {
+    const uint8_t prefix(0x40 | (wide ? 0x8 : 0) | ((reg & 8u) ? 0x4 : 0) | ((rm & 8u) ? 0x1 : 0));
+    if (prefix != 0x40)
+        byte(prefix);
+}
+
+
+void Assembler::memoryOp(const uint8_t prefix, const bool wide, const std::initializer_list<uint8_t> opcode,
+                         const unsigned reg, const unsigned base, const int32_t displacement)
+{
+    if (prefix != 0)
+        byte(prefix);
+    rex(wide, reg, base);
+    for (const uint8_t opcode_byte : opcode)
+        byte(opcode_byte);
+    byte(0x80 | ((reg & 7u) << 3u) | (base & 7u));
+    if ((base & 7u) == RSP) // RSP and R12 need a SIB byte.
+        byte(0x24);
+    dword(static_cast<uint32_t>(displacement));
+}
+
+
+void Assembler::registerOp(const uint8_t prefix, const bool wide, const std::initializer_list<uint8_t> opcode,
+                           const unsigned reg, const unsigned rm)
+{
+    if (prefix != 0)
+        byte(prefix);
+    rex(wide, reg, rm);
+    for (const uint8_t opcode_byte : opcode)
+        byte(opcode_byte);
+    byte(0xC0 | ((reg & 7u) << 3u) | (rm & 7u));
+}
+
+
+void Assembler::movImmediate(const Register reg, const uint64_t value) {
+    rex(true, 0, reg);
+    byte(0xB8 | (reg & 7u));
+    qword(value);
+}
+
+
+size_t Assembler::jump() {
+    byte(0xE9);
+    dword(0);
+    return size() - 4;
+}
+
+
+size_t Assembler::jump(const Condition condition) {
+    byte(0x0F);
+    byte(0x80 | static_cast<uint8_t>(condition));
+    dword(0);
+    return size() - 4;
+}
+
+
+void Assembler::patchRel32(const size_t rel32_offset, const size_t target) {
+    const int32_t rel32(static_cast<int32_t>(static_cast<int64_t>(target) - static_cast<int64_t>(rel32_offset + 4)));
+    std::memcpy(&code_[rel32_offset], &rel32, sizeof rel32);
+}
+
+
+inline int32_t SlotDisplacement(const unsigned slot) { return static_cast<int32_t>(slot * sizeof(FuncValue)); }
+
+
+inline uint64_t FloatBits(const double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof bits);
+    return bits;
+}
+
+
+/** Generates the native code for one Program.  The slot of a value on the operand stack is its stack depth, which
+ *  the code generator tracks statically.
+ */
+class CodeGenerator {
+    struct Fixup {
+        size_t rel32_offset_;
+        uint32_t target_;
+    };
+    struct ErrorExit {
+        size_t rel32_offset_;
+        JitStatus status_;
+        uint32_t address_;
+    };
+
+    const Program &program_;
+    const ConstantPool &constant_pool_;
+    Assembler assembler_;
+    std::vector<size_t> native_addresses_;  // Indexed by code address, including the one past the end.
+    std::vector<int> target_depths_;        // The stack depths at the jump targets, -1 for other addresses.
+    std::vector<Fixup> jump_fixups_;
+    std::vector<ErrorExit> error_exits_;
+public:
+    explicit CodeGenerator(const Program &program)
+        : program_(program), constant_pool_(program.getConstantPool()), native_addresses_(program.size() + 1),
+          target_depths_(program.size() + 1, -1) { }
+
+    /** \return false if the program can't be translated. */
+    bool generate();
+
+    inline const Assembler &getAssembler() const { return assembler_; }
+private:
+    /** \return false if the instruction can't be translated. */
+    bool generateInstruction(const uint32_t address, const unsigned depth);
+
+    /** Jumps to an exit that returns "status" for the instruction at "address" if "condition" holds. */
+    void exitIf(const Condition condition, const JitStatus status, const uint32_t address);
+
+    /** Calls an attribute getter for the AREF-like instruction at "address", which stores the value in "slot".
+     *  \return the offset of the rel32 of a jump that is taken if the attribute had no value.
+     */
+    size_t callAttribGetter(const uint32_t address, const size_t getter_offset, const unsigned slot);
+
+    /** Handles a missing value for the AREF-like instruction at "address", see callAttribGetter(). */
+    void handleMissingValue(const uint32_t address, const size_t no_value_jump, const unsigned slot);
+
+    /** Compares XMM0 w/ XMM1 like "comparison" (BxxF or BxxFAC) does and leaves the result in AL. */
+    void compareFloats(const Instruction comparison);
+
+    /** Compares RAX w/ RCX like "comparison" (BxxI or BxxIAC) does and leaves the result in AL. */
+    void compareInts(const Instruction comparison);
+
+    void storeBool(const unsigned slot) { assembler_.memoryOp(0, false, { 0x88 }, RAX, STACK, SlotDisplacement(slot)); }
+};
+
+
+bool CodeGenerator::generate() {
+    // Prologue.  After pushing three registers the stack is 16-byte aligned as required for calls.
+    assembler_.push(RBX);
+    assembler_.push(R12);
+    assembler_.push(R13);
+    assembler_.registerOp(0, true, { 0x89 }, RDI, FRAME);
+    assembler_.memoryOp(0, true, { 0x8B }, STACK, FRAME, offsetof(JitFrame, stack_));
+    assembler_.memoryOp(0, true, { 0x8B }, LOCALS, FRAME, offsetof(JitFrame, locals_));
+
+    unsigned depth(0);
+    bool reachable(true); // Whether the previous instruction may fall through to the current one.
+    for (uint32_t address(0); address <= program_.size(); ++address) {
+        if (target_depths_[address] >= 0) {
+            if (reachable and depth != static_cast<unsigned>(target_depths_[address]))
+                return false;
+            depth = static_cast<unsigned>(target_depths_[address]);
+        } else if (not reachable)
+            return false;
+        native_addresses_[address] = assembler_.size();
+        if (address == program_.size())
+            break;
+
+        const CodeAndSourceLocation &instruction(program_[address]);
+        const unsigned operand_count(GetOperandCount(instruction.getCode(), instruction.getOperand2()));
+        if (operand_count > depth or not generateInstruction(address, depth))
+            return false;
+
+        reachable = instruction.getCode() != Instruction::JUMP;
+        depth = depth - operand_count + (IsJump(instruction.getCode()) ? 0 : 1);
+        if (IsJump(instruction.getCode())) {
+            const uint32_t target(instruction.getOperand());
+            if (target <= address or target > program_.size()
+                or (target_depths_[target] >= 0 and static_cast<unsigned>(target_depths_[target]) != depth))
+                return false;
+            target_depths_[target] = static_cast<int>(depth);
+        }
+    }
+    if (depth != 1)
+        return false;
+
+    // Epilogue.
+    assembler_.byte(0xB8); // MOV EAX, imm32
+    assembler_.dword(static_cast<uint32_t>(JitStatus::OK));
+    const size_t epilogue(assembler_.size());
+    assembler_.pop(R13);
+    assembler_.pop(R12);
+    assembler_.pop(RBX);
+    assembler_.byte(0xC3); // RET
+
+    for (const auto &error_exit : error_exits_) {
+        assembler_.patchRel32(error_exit.rel32_offset_, assembler_.size());
+        assembler_.memoryOp(0, false, { 0xC7 }, 0, FRAME, offsetof(JitFrame, error_address_));
+        assembler_.dword(error_exit.address_);
+        assembler_.byte(0xB8); // MOV EAX, imm32
+        assembler_.dword(static_cast<uint32_t>(error_exit.status_));
+        assembler_.patchRel32(assembler_.jump(), epilogue);
+    }
+
+    for (const auto &jump_fixup : jump_fixups_)
+        assembler_.patchRel32(jump_fixup.rel32_offset_, native_addresses_[jump_fixup.target_]);
+
+    return true;
+}
+
+
+// Binary operators find their left operand in the topmost slot and replace the right one, i.e. the one below it,
+// w/ their result.
+bool CodeGenerator::generateInstruction(const uint32_t address, const unsigned depth) {
+    const CodeAndSourceLocation &instruction(program_[address]);
+    const int32_t top(depth > 0 ? SlotDisplacement(depth - 1) : 0);
+    const int32_t below_top(depth > 1 ? SlotDisplacement(depth - 2) : 0);
+    const int32_t next(SlotDisplacement(depth)); // The slot an instruction w/o operands pushes its result to.
+    switch (instruction.getCode()) {
+    case Instruction::FADD:
+    case Instruction::FMUL: {
+        // When both operands are NaNs, the result is the first one.  Like the Interpreter's compiled code, we start
+        // w/ the right operand.
+        const uint8_t opcode(instruction.getCode() == Instruction::FADD ? 0x58 : 0x59);
+        assembler_.memoryOp(0xF2, false, { 0x0F, 0x10 }, XMM0, STACK, below_top);         // MOVSD XMM0, rhs
+        assembler_.memoryOp(0xF2, false, { 0x0F, opcode }, XMM0, STACK, top);             // ADDSD/MULSD XMM0, lhs
+        assembler_.memoryOp(0xF2, false, { 0x0F, 0x11 }, XMM0, STACK, below_top);         // MOVSD rhs, XMM0
+        return true;
+    }
+    case Instruction::FSUB:
+        assembler_.memoryOp(0xF2, false, { 0x0F, 0x10 }, XMM0, STACK, top);               // MOVSD XMM0, lhs
+        assembler_.memoryOp(0xF2, false, { 0x0F, 0x5C }, XMM0, STACK, below_top);         // SUBSD XMM0, rhs
+        assembler_.memoryOp(0xF2, false, { 0x0F, 0x11 }, XMM0, STACK, below_top);
+        return true;
+    case Instruction::FDIV: {
+        assembler_.memoryOp(0xF2, false, { 0x0F, 0x10 }, XMM1, STACK, below_top);         // MOVSD XMM1, rhs
+        assembler_.registerOp(0x66, false, { 0x0F, 0x57 }, XMM0, XMM0);                   // XORPD XMM0, XMM0
+        assembler_.registerOp(0x66, false, { 0x0F, 0x2E }, XMM1, XMM0);                   // UCOMISD XMM1, XMM0
+        assembler_.byte(0x7A);                                                            // JP over the JE
+        assembler_.byte(6);
+        exitIf(Condition::EQUAL, JitStatus::DIVISION_BY_ZERO, address);
+        assembler_.memoryOp(0xF2, false, { 0x0F, 0x10 }, XMM0, STACK, top);               // MOVSD XMM0, lhs
+        assembler_.registerOp(0xF2, false, { 0x0F, 0x5E }, XMM0, XMM1);                   // DIVSD XMM0, XMM1
+        assembler_.memoryOp(0xF2, false, { 0x0F, 0x11 }, XMM0, STACK, below_top);         // MOVSD rhs, XMM0
+        return true;
+    }
+    case Instruction::FPOW:
+        assembler_.memoryOp(0xF2, false, { 0x0F, 0x10 }, XMM0, STACK, top);
+        assembler_.memoryOp(0xF2, false, { 0x0F, 0x10 }, XMM1, STACK, below_top);
+        assembler_.movImmediate(RAX, reinterpret_cast<uint64_t>(static_cast<double (*)(double, double)>(std::pow)));
+        assembler_.registerOp(0, false, { 0xFF }, 2, RAX);                                // CALL RAX
+        assembler_.memoryOp(0xF2, false, { 0x0F, 0x11 }, XMM0, STACK, below_top);
+        return true;
+    case Instruction::BEQLF:
+    case Instruction::BNEQLF:
+    case Instruction::BGTF:
+    case Instruction::BLTF:
+    case Instruction::BGTEF:
+    case Instruction::BLTEF:
+        assembler_.memoryOp(0xF2, false, { 0x0F, 0x10 }, XMM0, STACK, top);
+        assembler_.memoryOp(0xF2, false, { 0x0F, 0x10 }, XMM1, STACK, below_top);
+        compareFloats(instruction.getCode());
+        storeBool(depth - 2);
+        return true;
+    case Instruction::BGTB:
+    case Instruction::BLTB:
+    case Instruction::BGTEB:
+    case Instruction::BLTEB:
+    case Instruction::BEQLB:
+    case Instruction::BNEQLB: {
+        Condition condition;
+        switch (instruction.getCode()) {
+        case Instruction::BGTB:
+            condition = Condition::ABOVE;
+            break;
+        case Instruction::BLTB:
+            condition = Condition::BELOW;
+            break;
+        case Instruction::BGTEB:
+            condition = Condition::ABOVE_OR_EQUAL;
+            break;
+        case Instruction::BLTEB:
+            condition = Condition::BELOW_OR_EQUAL;
+            break;
+        case Instruction::BEQLB:
+            condition = Condition::EQUAL;
+            break;
+        default:
+            condition = Condition::NOT_EQUAL;
+        }
+        assembler_.memoryOp(0, false, { 0x0F, 0xB6 }, RAX, STACK, top);                   // MOVZX EAX, BYTE lhs
+        assembler_.memoryOp(0, false, { 0x0F, 0xB6 }, RCX, STACK, below_top);             // MOVZX ECX, BYTE rhs
+        assembler_.registerOp(0, false, { 0x39 }, RCX, RAX);                              // CMP EAX, ECX
+        assembler_.registerOp(0, false, { 0x0F, static_cast<uint8_t>(0x90 | static_cast<uint8_t>(condition)) }, 0,
+                              RAX);                                                       // SETcc AL
+        storeBool(depth - 2);
+        return true;
+    }
+    case Instruction::BEQLI:
+    case Instruction::BNEQLI:
+    case Instruction::BGTI:
+    case Instruction::BLTI:
+    case Instruction::BGTEI:
+    case Instruction::BLTEI:
+        assembler_.memoryOp(0, true, { 0x8B }, RAX, STACK, top);
+        assembler_.memoryOp(0, true, { 0x8B }, RCX, STACK, below_top);
+        compareInts(instruction.getCode());
+        storeBool(depth - 2);
+        return true;
+    case Instruction::CALL:
+    case Instruction::CALLF:
+        assembler_.registerOp(0, true, { 0x89 }, FRAME, RDI);                             // MOV RDI, FRAME
+        assembler_.byte(0xBE);                                                            // MOV ESI, imm32
+        assembler_.dword(address);
+        assembler_.memoryOp(0, true, { 0x8D }, RDX, STACK,
+                            SlotDisplacement(depth - instruction.getOperand2()));        // LEA RDX, args
+        assembler_.memoryOp(0, false, { 0xFF }, 2, FRAME, offsetof(JitFrame, call_));     // CALL [FRAME + call_]
+        assembler_.registerOp(0, false, { 0x85 }, RAX, RAX);                              // TEST EAX, EAX
+        exitIf(Condition::SIGN_SET, JitStatus::EXCEPTION, address);
+        return true;
+    case Instruction::FUMINUS:
+        assembler_.memoryOp(0, true, { 0x8B }, RAX, STACK, top);
+        assembler_.registerOp(0, true, { 0x0F, 0xBA }, 7, RAX);                           // BTC RAX, 63
+        assembler_.byte(63);
+        assembler_.memoryOp(0, true, { 0x89 }, RAX, STACK, top);
+        return true;
+    case Instruction::FUPLUS:
+        return true;
+    case Instruction::AREF:
+    case Instruction::AREF2: {
+        size_t getter_offset;
+        switch (constant_pool_.getAttribRef(instruction.getOperand()).type_) {
+        case NodeType::FLOAT_NODE:
+            getter_offset = offsetof(JitFrame, get_float_attrib_);
+            break;
+        case NodeType::INT_NODE:
+            getter_offset = offsetof(JitFrame, get_int_attrib_);
+            break;
+        case NodeType::BOOLEAN_NODE:
+            getter_offset = offsetof(JitFrame, get_boolean_attrib_);
+            break;
+        default:
+            return false;
+        }
+        handleMissingValue(address, callAttribGetter(address, getter_offset, depth), depth);
+        return true;
+    }
+    case Instruction::FCONVI:
+        assembler_.memoryOp(0xF2, true, { 0x0F, 0x2A }, XMM0, STACK, top);                // CVTSI2SD XMM0, QWORD top
+        assembler_.memoryOp(0xF2, false, { 0x0F, 0x11 }, XMM0, STACK, top);
+        return true;
+    case Instruction::FCONVB:
+        assembler_.memoryOp(0, false, { 0x0F, 0xB6 }, RAX, STACK, top);
+        assembler_.registerOp(0xF2, true, { 0x0F, 0x2A }, XMM0, RAX);                     // CVTSI2SD XMM0, RAX
+        assembler_.memoryOp(0xF2, false, { 0x0F, 0x11 }, XMM0, STACK, top);
+        return true;
+    case Instruction::FPUSH:
+        assembler_.movImmediate(RAX, FloatBits(constant_pool_.getFloat(instruction.getOperand())));
+        assembler_.memoryOp(0, true, { 0x89 }, RAX, STACK, next);
+        return true;
+    case Instruction::SPUSH:
+        assembler_.movImmediate(RAX, reinterpret_cast<uint64_t>(&constant_pool_.getString(instruction.getOperand())));
+        assembler_.memoryOp(0, true, { 0x89 }, RAX, STACK, next);
+        return true;
+    case Instruction::BPUSH:
+        assembler_.memoryOp(0, false, { 0xC6 }, 0, STACK, next);                          // MOV BYTE next, imm8
+        assembler_.byte(instruction.getOperand() != 0 ? 1 : 0);
+        return true;
+    case Instruction::IPUSH:
+        assembler_.movImmediate(RAX, static_cast<uint64_t>(constant_pool_.getInt(instruction.getOperand())));
+        assembler_.memoryOp(0, true, { 0x89 }, RAX, STACK, next);
+        return true;
+    case Instruction::STORE:
+        if (static_cast<NodeType>(instruction.getOperand2()) == NodeType::STRING_NODE)
+            return false; // Strings in the string buffers would have to be copied.
+        assembler_.memoryOp(0, true, { 0x8B }, RAX, STACK, top);
+        assembler_.memoryOp(0, true, { 0x89 }, RAX, LOCALS, SlotDisplacement(instruction.getOperand()));
+        return true;
+    case Instruction::LOAD:
+        assembler_.memoryOp(0, true, { 0x8B }, RAX, LOCALS, SlotDisplacement(instruction.getOperand()));
+        assembler_.memoryOp(0, true, { 0x89 }, RAX, STACK, next);
+        return true;
+    case Instruction::JUMP:
+        jump_fixups_.emplace_back(Fixup{ assembler_.jump(), instruction.getOperand() });
+        return true;
+    case Instruction::JUMP_IF_FALSE:
+    case Instruction::JUMP_IF_TRUE:
+        assembler_.memoryOp(0, false, { 0x80 }, 7, STACK, top);                           // CMP BYTE top, 0
+        assembler_.byte(0);
+        jump_fixups_.emplace_back(Fixup{ assembler_.jump(instruction.getCode() == Instruction::JUMP_IF_FALSE
+                                                         ? Condition::EQUAL : Condition::NOT_EQUAL),
+                                         instruction.getOperand() });
+        return true;
+    case Instruction::IADD:
+    case Instruction::ISUB:
+    case Instruction::IMUL:
+        assembler_.memoryOp(0, true, { 0x8B }, RAX, STACK, top);
+        if (instruction.getCode() == Instruction::IADD)
+            assembler_.memoryOp(0, true, { 0x03 }, RAX, STACK, below_top);                // ADD RAX, rhs
+        else if (instruction.getCode() == Instruction::ISUB)
+            assembler_.memoryOp(0, true, { 0x2B }, RAX, STACK, below_top);                // SUB RAX, rhs
+        else
+            assembler_.memoryOp(0, true, { 0x0F, 0xAF }, RAX, STACK, below_top);          // IMUL RAX, rhs
+        if (CHECK_INT_OVERFLOW)
+            exitIf(Condition::OVERFLOW_SET, JitStatus::INT_OVERFLOW, address);
+        assembler_.memoryOp(0, true, { 0x89 }, RAX, STACK, below_top);
+        return true;
+    case Instruction::IDIV:
+    case Instruction::IMOD: {
+        const bool is_division(instruction.getCode() == Instruction::IDIV);
+        assembler_.memoryOp(0, true, { 0x8B }, RCX, STACK, below_top);                    // MOV RCX, divisor
+        assembler_.registerOp(0, true, { 0x85 }, RCX, RCX);                               // TEST RCX, RCX
+        exitIf(Condition::EQUAL, JitStatus::DIVISION_BY_ZERO, address);
+        assembler_.memoryOp(0, true, { 0x8B }, RAX, STACK, top);                          // MOV RAX, dividend
+        assembler_.registerOp(0, false, { 0x31 }, RDX, RDX);                              // XOR EDX, EDX
+        assembler_.registerOp(0, true, { 0x83 }, 7, RCX);                                 // CMP RCX, -1
+        assembler_.byte(0xFF);
+        const size_t not_minus_one(assembler_.jump(Condition::NOT_EQUAL));
+
+        // A divisor of -1 would trap for INT64_MIN, see QuotientOverflows() and IntModulo().
+        if (is_division) {
+            assembler_.registerOp(0, true, { 0xF7 }, 3, RAX);                             // NEG RAX
+            if (CHECK_INT_OVERFLOW)
+                exitIf(Condition::OVERFLOW_SET, JitStatus::INT_OVERFLOW, address);
+        }
+        const size_t minus_one_done(assembler_.jump());
+
+        assembler_.patchRel32(not_minus_one, assembler_.size());
+        assembler_.byte(0x48);                                                            // CQO
+        assembler_.byte(0x99);
+        assembler_.registerOp(0, true, { 0xF7 }, 7, RCX);                                 // IDIV RCX
+        if (not is_division) { // The remainder has to get the sign of the divisor.
+            assembler_.registerOp(0, true, { 0x85 }, RDX, RDX);                           // TEST RDX, RDX
+            const size_t zero_remainder(assembler_.jump(Condition::EQUAL));
+            assembler_.registerOp(0, true, { 0x89 }, RDX, RAX);                           // MOV RAX, RDX
+            assembler_.registerOp(0, true, { 0x31 }, RCX, RAX);                           // XOR RAX, RCX
+            const size_t same_signs(assembler_.jump(Condition::NOT_SIGN_SET));
+            assembler_.registerOp(0, true, { 0x01 }, RCX, RDX);                           // ADD RDX, RCX
+            assembler_.patchRel32(zero_remainder, assembler_.size());
+            assembler_.patchRel32(same_signs, assembler_.size());
+        }
+
+        assembler_.patchRel32(minus_one_done, assembler_.size());
+        assembler_.memoryOp(0, true, { 0x89 }, is_division ? RAX : RDX, STACK, below_top);
+        return true;
+    }
+    case Instruction::IUMINUS:
+        assembler_.memoryOp(0, true, { 0x8B }, RAX, STACK, top);
+        assembler_.registerOp(0, true, { 0xF7 }, 3, RAX);                                 // NEG RAX
+        if (CHECK_INT_OVERFLOW)
+            exitIf(Condition::OVERFLOW_SET, JitStatus::INT_OVERFLOW, address);
+        assembler_.memoryOp(0, true, { 0x89 }, RAX, STACK, top);
+        return true;
+    case Instruction::FAREFI:
+        handleMissingValue(address, callAttribGetter(address, offsetof(JitFrame, get_int_attrib_), depth), depth);
+        assembler_.memoryOp(0xF2, true, { 0x0F, 0x2A }, XMM0, STACK, next);
+        assembler_.memoryOp(0xF2, false, { 0x0F, 0x11 }, XMM0, STACK, next);
+        return true;
+    case Instruction::BEQLFAC:
+    case Instruction::BNEQLFAC:
+    case Instruction::BGTFAC:
+    case Instruction::BLTFAC:
+    case Instruction::BGTEFAC:
+    case Instruction::BLTEFAC:
+        handleMissingValue(address, callAttribGetter(address, offsetof(JitFrame, get_float_attrib_), depth), depth);
+        assembler_.memoryOp(0xF2, false, { 0x0F, 0x10 }, XMM0, STACK, next);
+        assembler_.movImmediate(RAX, FloatBits(constant_pool_.getFloat(instruction.getOperand2())));
+        assembler_.registerOp(0x66, true, { 0x0F, 0x6E }, XMM1, RAX);                     // MOVQ XMM1, RAX
+        compareFloats(instruction.getCode());
+        storeBool(depth);
+        return true;
+    case Instruction::BEQLIAC:
+    case Instruction::BNEQLIAC:
+    case Instruction::BGTIAC:
+    case Instruction::BLTIAC:
+    case Instruction::BGTEIAC:
+    case Instruction::BLTEIAC:
+        handleMissingValue(address, callAttribGetter(address, offsetof(JitFrame, get_int_attrib_), depth), depth);
+        assembler_.memoryOp(0, true, { 0x8B }, RAX, STACK, next);
+        assembler_.movImmediate(RCX, static_cast<uint64_t>(constant_pool_.getInt(instruction.getOperand2())));
+        compareInts(instruction.getCode());
+        storeBool(depth);
+        return true;
+    default: // String operations.
+        return false;
+    }
+}
+
+
+void CodeGenerator::exitIf(const Condition condition, const JitStatus status, const uint32_t address) {
+    error_exits_.emplace_back(ErrorExit{ assembler_.jump(condition), status, address });
+}
+
+
+size_t CodeGenerator::callAttribGetter(const uint32_t address, const size_t getter_offset, const unsigned slot) {
+    assembler_.registerOp(0, true, { 0x89 }, FRAME, RDI);                                 // MOV RDI, FRAME
+    assembler_.byte(0xBE);                                                                // MOV ESI, imm32
+    assembler_.dword(program_[address].getOperand());
+    assembler_.memoryOp(0, true, { 0x8D }, RDX, STACK, SlotDisplacement(slot));           // LEA RDX, slot
+    assembler_.memoryOp(0, false, { 0xFF }, 2, FRAME, static_cast<int32_t>(getter_offset)); // CALL [FRAME + getter]
+    assembler_.registerOp(0, false, { 0x85 }, RAX, RAX);                                  // TEST EAX, EAX
+    exitIf(Condition::SIGN_SET, JitStatus::EXCEPTION, address);
+    return assembler_.jump(Condition::EQUAL);
+}
+
+
+// Only AREF2 has a default value, which is encoded like the operand of the ?PUSH instruction for its type.
+void CodeGenerator::handleMissingValue(const uint32_t address, const size_t no_value_jump, const unsigned slot) {
+    const CodeAndSourceLocation &instruction(program_[address]);
+    if (instruction.getCode() != Instruction::AREF2) {
+        error_exits_.emplace_back(ErrorExit{ no_value_jump, JitStatus::NO_VALUE, address });
+        return;
+    }
+
+    const size_t found(assembler_.jump());
+    assembler_.patchRel32(no_value_jump, assembler_.size());
+    switch (constant_pool_.getAttribRef(instruction.getOperand()).type_) {
+    case NodeType::FLOAT_NODE:
+        assembler_.movImmediate(RAX, FloatBits(constant_pool_.getFloat(instruction.getOperand2())));
+        assembler_.memoryOp(0, true, { 0x89 }, RAX, STACK, SlotDisplacement(slot));
+        break;
+    case NodeType::INT_NODE:
+        assembler_.movImmediate(RAX, static_cast<uint64_t>(constant_pool_.getInt(instruction.getOperand2())));
+        assembler_.memoryOp(0, true, { 0x89 }, RAX, STACK, SlotDisplacement(slot));
+        break;
+    default:
+        assembler_.memoryOp(0, false, { 0xC6 }, 0, STACK, SlotDisplacement(slot));
+        assembler_.byte(instruction.getOperand2() != 0 ? 1 : 0);
+    }
+    assembler_.patchRel32(found, assembler_.size());
+}
+
+
+// UCOMISD sets ZF, PF and CF for unordered operands, i.e. if either of them is a NaN, so that only ABOVE and
+// ABOVE_OR_EQUAL are false for NaNs.  Less-than comparisons therefore swap the operands.
+void CodeGenerator::compareFloats(const Instruction comparison) {
+    const auto set_condition([this](const Condition condition, const Register reg) {
+        assembler_.registerOp(0, false, { 0x0F, static_cast<uint8_t>(0x90 | static_cast<uint8_t>(condition)) }, 0, reg);
+    });
+
+    switch (comparison) {
+    case Instruction::BGTF:
+    case Instruction::BGTFAC:
+    case Instruction::BGTEF:
+    case Instruction::BGTEFAC:
+        assembler_.registerOp(0x66, false, { 0x0F, 0x2E }, XMM0, XMM1);                   // UCOMISD XMM0, XMM1
+        set_condition(comparison == Instruction::BGTF or comparison == Instruction::BGTFAC ? Condition::ABOVE
+                                                                                            : Condition::ABOVE_OR_EQUAL,
+                      RAX);
+        break;
+    case Instruction::BLTF:
+    case Instruction::BLTFAC:
+    case Instruction::BLTEF:
+    case Instruction::BLTEFAC:
+        assembler_.registerOp(0x66, false, { 0x0F, 0x2E }, XMM1, XMM0);                   // UCOMISD XMM1, XMM0
+        set_condition(comparison == Instruction::BLTF or comparison == Instruction::BLTFAC ? Condition::ABOVE
+                                                                                            : Condition::ABOVE_OR_EQUAL,
+                      RAX);
+        break;
+    case Instruction::BEQLF:
+    case Instruction::BEQLFAC:
+        assembler_.registerOp(0x66, false, { 0x0F, 0x2E }, XMM0, XMM1);
+        set_condition(Condition::EQUAL, RAX);
+        set_condition(Condition::PARITY_CLEAR, RCX);
+        assembler_.registerOp(0, false, { 0x20 }, RCX, RAX);                              // AND AL, CL
+        break;
+    default: // BNEQLF and BNEQLFAC.
+        assembler_.registerOp(0x66, false, { 0x0F, 0x2E }, XMM0, XMM1);
+        set_condition(Condition::NOT_EQUAL, RAX);
+        set_condition(Condition::PARITY_SET, RCX);
+        assembler_.registerOp(0, false, { 0x08 }, RCX, RAX);                              // OR AL, CL
+    }
+}
+
+
+void CodeGenerator::compareInts(const Instruction comparison) {
+    Condition condition;
+    switch (comparison) {
+    case Instruction::BEQLI:
+    case Instruction::BEQLIAC:
+        condition = Condition::EQUAL;
+        break;
+    case Instruction::BNEQLI:
+    case Instruction::BNEQLIAC:
+        condition = Condition::NOT_EQUAL;
+        break;
+    case Instruction::BGTI:
+    case Instruction::BGTIAC:
+        condition = Condition::GREATER;
+        break;
+    case Instruction::BLTI:
+    case Instruction::BLTIAC:
+        condition = Condition::LESS;
+        break;
+    case Instruction::BGTEI:
+    case Instruction::BGTEIAC:
+        condition = Condition::GREATER_OR_EQUAL;
+        break;
+    default: // BLTEI and BLTEIAC.
+        condition = Condition::LESS_OR_EQUAL;
+    }
+    assembler_.registerOp(0, true, { 0x39 }, RCX, RAX);                                   // CMP RAX, RCX
+    assembler_.registerOp(0, false, { 0x0F, static_cast<uint8_t>(0x90 | static_cast<uint8_t>(condition)) }, 0, RAX);
+}
+
+
+} // unnamed namespace
+
+
+bool JitCompiler::IsAvailable() {
+#ifdef NYAA_HAVE_JIT
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+std::unique_ptr<NativeCode> JitCompiler::Compile(const Program &program) {
+    if (not IsAvailable() or program.empty())
+        return nullptr;
+
+    CodeGenerator code_generator(program);
+    if (not code_generator.generate())
+        return nullptr;
+
+    const Assembler &assembler(code_generator.getAssembler());
+    try {
+        return std::unique_ptr<NativeCode>(new NativeCode(assembler.data(), assembler.size()));
+    } catch (const std::runtime_error &) {
+        return nullptr;
+    }
+}
+
+
+void JitTier::reset() {
+    delete native_code_.exchange(nullptr);
+    evaluation_count_.store(0, std::memory_order_relaxed);
+    compilation_started_.store(false, std::memory_order_relaxed);
+}
+
+
+// Only the thread that gets to set "compilation_started_" compiles, the others keep interpreting in the meantime.
+// Programs that can't be compiled are interpreted for good.
+const NativeCode *JitTier::countEvaluation(const Program &program, const uint32_t threshold) const {
+    const NativeCode * const native_code(native_code_.load(std::memory_order_acquire));
+    if (native_code != nullptr or compilation_started_.load(std::memory_order_relaxed))
+        return native_code;
+    if (evaluation_count_.fetch_add(1, std::memory_order_relaxed) + 1 < threshold
+        or compilation_started_.exchange(true))
+        return nullptr;
+
+    std::unique_ptr<NativeCode> new_native_code(JitCompiler::Compile(program));
+    native_code_.store(new_native_code.get(), std::memory_order_release);
+    return new_native_code.release();
+}
+
+
+} // namespace Nyaa
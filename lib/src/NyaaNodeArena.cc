@@ -0,0 +1,98 @@
+/** \file    NyaaNodeArena.cc
+ *  \brief   Implementation of the NodeArena class.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "NyaaNodeArena.h"
+#include <algorithm>
+#include <cstdint>
+
+
+namespace Nyaa {
+
+
+// The block headers are padded so that the usable space starts at the strictest fundamental alignment.
+static constexpr size_t BLOCK_HEADER_SIZE(((sizeof(void *) + sizeof(size_t) + alignof(std::max_align_t) - 1)
+                                           / alignof(std::max_align_t)) * alignof(std::max_align_t));
+
+
+NodeArena::NodeArena(const size_t min_block_size)
+    : min_block_size_(min_block_size), blocks_(nullptr), next_free_(nullptr), block_end_(nullptr), bytes_in_use_(0),
+      peak_bytes_in_use_(0), block_bytes_(0)
+{
+}
+
+
+NodeArena::~NodeArena() {
+    clear();
+    ::operator delete(blocks_);
+}
+
+
+void NodeArena::clear() {
+    for (auto destructor(destructors_.rbegin()); destructor != destructors_.rend(); ++destructor)
+        destructor->destroy_(destructor->object_);
+    destructors_.clear();
+
+    // Keep the current block, it is the largest one.
+    if (blocks_ != nullptr) {
+        for (Block *block(blocks_->next_); block != nullptr;) {
+            Block * const next(block->next_);
+            ::operator delete(block);
+            block = next;
+        }
+        blocks_->next_ = nullptr;
+        block_bytes_ = blocks_->size_;
+        next_free_ = reinterpret_cast<char *>(blocks_) + BLOCK_HEADER_SIZE;
+        block_end_ = next_free_ + blocks_->size_;
+    }
+    bytes_in_use_ = 0;
+}
+
+
+void *NodeArena::allocate(const size_t size, const size_t alignment) {
+    uintptr_t address((reinterpret_cast<uintptr_t>(next_free_) + alignment - 1) & ~(uintptr_t(alignment) - 1));
+    if (next_free_ == nullptr or address + size > reinterpret_cast<uintptr_t>(block_end_)) {
+        addBlock(size + alignment);
+        address = (reinterpret_cast<uintptr_t>(next_free_) + alignment - 1) & ~(uintptr_t(alignment) - 1);
+    }
+
+    next_free_ = reinterpret_cast<char *>(address + size);
+    bytes_in_use_ += size;
+    peak_bytes_in_use_ = std::max(peak_bytes_in_use_, bytes_in_use_);
+
+    return reinterpret_cast<void *>(address);
+}
+
+
+// Block sizes double, so that the number of blocks grows only logarithmically w/ the size of a tree.
+void NodeArena::addBlock(const size_t min_size) {
+    const size_t block_size(std::max({ min_size, min_block_size_, blocks_ == nullptr ? 0 : 2 * blocks_->size_ }));
+    Block * const new_block(static_cast<Block *>(::operator new(BLOCK_HEADER_SIZE + block_size)));
+    new_block->next_ = blocks_;
+    new_block->size_ = block_size;
+    blocks_ = new_block;
+    block_bytes_ += block_size;
+
+    next_free_ = reinterpret_cast<char *>(new_block) + BLOCK_HEADER_SIZE;
+    block_end_ = next_free_ + block_size;
+}
+
+
+} // namespace Nyaa
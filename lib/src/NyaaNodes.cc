@@ -21,7 +21,6 @@
 */
 #include "NyaaNodes.h"
 #include <stdexcept>
-#include "NyaaCodeAndSourceLocation.h"
 
 
 namespace Nyaa {
@@ -39,66 +38,63 @@ BinOpNode::BinOpNode(const size_t source_location, const Token &operator_type, c
 }
 
   
-void BinOpNode::genCode(std::stack<CodeAndSourceLocation> * const code_stack) const {
-    rhs_->genCode(code_stack);
-    lhs_->genCode(code_stack);
+void BinOpNode::genCode(Program * const program) const {
+    rhs_->genCode(program);
+    lhs_->genCode(program);
 
+    const bool int_operands(lhs_->getType() == NodeType::INT_NODE);
     switch (operator_.getType()) {
     case TokenType::CARET:
-       code_stack->emplace(CodeAndSourceLocation(Instruction::FPOW, getSourceLocation()));
-       break;
+        if (int_operands)
+            throw std::runtime_error(std::to_string(getSourceLocation()) + ": no integer exponentiation!");
+        program->emit(Instruction::FPOW, getSourceLocation());
+        break;
     case TokenType::PLUS:
-        code_stack->emplace(CodeAndSourceLocation(Instruction::FADD, getSourceLocation()));
-	break;
+        program->emit(int_operands ? Instruction::IADD : Instruction::FADD, getSourceLocation());
+        break;
     case TokenType::MINUS:
-        code_stack->emplace(CodeAndSourceLocation(Instruction::FSUB, getSourceLocation()));
-	break;
+        program->emit(int_operands ? Instruction::ISUB : Instruction::FSUB, getSourceLocation());
+        break;
     case TokenType::DIV:
-        code_stack->emplace(CodeAndSourceLocation(Instruction::FDIV, getSourceLocation()));
-	break;
+        program->emit(int_operands ? Instruction::IDIV : Instruction::FDIV, getSourceLocation());
+        break;
     case TokenType::MUL:
-        code_stack->emplace(CodeAndSourceLocation(Instruction::FMUL, getSourceLocation()));
-	break;
+        program->emit(int_operands ? Instruction::IMUL : Instruction::FMUL, getSourceLocation());
+        break;
     case TokenType::EQUAL:
-      code_stack->emplace(CodeAndSourceLocation(determineOpCode(Instruction::BEQLF, Instruction::BEQLS,
-								Instruction::BEQLB, Instruction::BEQLI),
-						getSourceLocation()));
-	break;
+        program->emit(determineOpCode(Instruction::BEQLF, Instruction::BEQLS, Instruction::BEQLB, Instruction::BEQLI),
+                      getSourceLocation());
+        break;
     case TokenType::NOT_EQUAL:
-        code_stack->emplace(CodeAndSourceLocation(determineOpCode(Instruction::BNEQLF, Instruction::BNEQLS,
-								  Instruction::BNEQLB, Instruction::BNEQLI),
-						  getSourceLocation()));
-	break;
+        program->emit(determineOpCode(Instruction::BNEQLF, Instruction::BNEQLS, Instruction::BNEQLB, Instruction::BNEQLI),
+                      getSourceLocation());
+        break;
     case TokenType::GREATER_THAN:
-        code_stack->emplace(CodeAndSourceLocation(determineOpCode(Instruction::BGTF, Instruction::BGTS,
-								  Instruction::BGTB, Instruction::BGTI),
-						  getSourceLocation()));
-	break;
+        program->emit(determineOpCode(Instruction::BGTF, Instruction::BGTS, Instruction::BGTB, Instruction::BGTI),
+                      getSourceLocation());
+        break;
     case TokenType::LESS_THAN:
-        code_stack->emplace(CodeAndSourceLocation(determineOpCode(Instruction::BLTF, Instruction::BLTS,
-								  Instruction::BLTB, Instruction::BLTI),
-						  getSourceLocation()));
-	break;
+        program->emit(determineOpCode(Instruction::BLTF, Instruction::BLTS, Instruction::BLTB, Instruction::BLTI),
+                      getSourceLocation());
+        break;
     case TokenType::GREATER_OR_EQUAL:
-        code_stack->emplace(CodeAndSourceLocation(determineOpCode(Instruction::BGTEF, Instruction::BGTES,
-								  Instruction::BGTEB, Instruction::BGTEI),
-						  getSourceLocation()));
-	break;
+        program->emit(determineOpCode(Instruction::BGTEF, Instruction::BGTES, Instruction::BGTEB, Instruction::BGTEI),
+                      getSourceLocation());
+        break;
     case TokenType::LESS_OR_EQUAL:
-        code_stack->emplace(CodeAndSourceLocation(determineOpCode(Instruction::BLTEF, Instruction::BLTES,
-								  Instruction::BLTEB, Instruction::BLTEI),
-						  getSourceLocation()));
-	break;
+        program->emit(determineOpCode(Instruction::BLTEF, Instruction::BLTES, Instruction::BLTEB, Instruction::BLTEI),
+                      getSourceLocation());
+        break;
     case TokenType::AMPERSAND:
-        code_stack->emplace(CodeAndSourceLocation(Instruction::SCONCAT, getSourceLocation()));
-	break;
+        program->emit(Instruction::SCONCAT, getSourceLocation());
+        break;
     default:
       throw std::runtime_error(std::to_string(getSourceLocation()) + ": unknown operator: " + operator_.getStringRep() + ".");
     }
 }
 
 
-static std::string NodeTypeToString(const NodeType node_type) {
+std::string NodeTypeToString(const NodeType node_type) {
     switch (node_type) {
     case NodeType::FLOAT_NODE:
         return "FLOAT";
@@ -108,7 +104,11 @@ static std::string NodeTypeToString(const NodeType node_type) {
         return "BOOLEAN";
     case NodeType::INT_NODE:
         return "INT";
+    case NodeType::NULL_NODE:
+        return "NULL";
     }
+
+    throw std::range_error("in NodeTypeToString: unknown node type " + std::to_string(static_cast<int>(node_type)) + "!");
 }
 
   
@@ -122,7 +122,7 @@ Instruction BinOpNode::determineOpCode(const Instruction float_op_code, const In
         return string_op_code;
     else if (operand_type == NodeType::BOOLEAN_NODE)
         return boolean_op_code;
-    else
+    else if (operand_type == NodeType::INT_NODE)
         return int_op_code;
 
     throw std::runtime_error(std::to_string(lhs_->getSourceLocation()) + ": invalid LHS operand type for comparison: "
@@ -130,4 +130,171 @@ Instruction BinOpNode::determineOpCode(const Instruction float_op_code, const In
 }
 
 
+
+FuncCallNode::FuncCallNode(const size_t source_location, const Function &func, const NodeType return_type,
+                           const TreeNode * const * const args, const size_t arg_count)
+    : AbstractNode(source_location), func_(func), return_type_(return_type), args_(args), arg_count_(arg_count)
+{
+    if (return_type == NodeType::NULL_NODE)
+        throw std::invalid_argument("in FuncCallNode::FuncCallNode: \"return_type\" must not be NULL_NODE.");
+}
+
+
+void FuncCallNode::genCode(Program * const program) const {
+    switch (func_.getShortCircuitKind()) {
+    case ShortCircuitKind::IF:
+        genConditionalCode(program);
+        return;
+    case ShortCircuitKind::AND:
+        genShortCircuitCode(Instruction::JUMP_IF_FALSE, program);
+        return;
+    case ShortCircuitKind::OR:
+        genShortCircuitCode(Instruction::JUMP_IF_TRUE, program);
+        return;
+    case ShortCircuitKind::NONE:
+        break;
+    }
+
+    std::vector<NodeType> arg_types;
+    arg_types.reserve(arg_count_);
+    for (size_t arg_no(0); arg_no < arg_count_; ++arg_no)
+        arg_types.emplace_back(args_[arg_no]->getType());
+
+    const IntrinsicKind intrinsic_kind(func_.getIntrinsicKind(arg_types));
+    if (intrinsic_kind != IntrinsicKind::NONE) {
+        genIntrinsicCode(intrinsic_kind, program);
+        return;
+    }
+
+    for (size_t arg_no(0); arg_no < arg_count_; ++arg_no)
+        args_[arg_no]->genCode(program);
+    ConstantPool &constant_pool(program->getConstantPool());
+    const uint32_t call_site_index(constant_pool.internCallSite(func_, arg_types, return_type_));
+    const bool has_fast_path(constant_pool.getCallSite(call_site_index).fast_path_ != nullptr);
+    program->emit(has_fast_path ? Instruction::CALLF : Instruction::CALL, getSourceLocation(), call_site_index,
+                  static_cast<uint32_t>(arg_count_));
+}
+
+
+// Like a BinOpNode, i.e. w/ the first argument on top of the stack: divisor dividend IDIV/IMOD
+void FuncCallNode::genIntrinsicCode(const IntrinsicKind intrinsic_kind, Program * const program) const {
+    if (arg_count_ != 2)
+        throw std::logic_error("in FuncCallNode::genIntrinsicCode: " + func_.getName() + "() has "
+                               + std::to_string(arg_count_) + " arguments instead of 2!");
+
+    args_[1]->genCode(program);
+    args_[0]->genCode(program);
+    program->emit(intrinsic_kind == IntrinsicKind::INT_QUOTIENT ? Instruction::IDIV : Instruction::IMOD,
+                  getSourceLocation());
+}
+
+
+// condition JUMP_IF_FALSE else value_if_true JUMP end else: value_if_false end:
+void FuncCallNode::genConditionalCode(Program * const program) const {
+    if (arg_count_ != 3)
+        throw std::logic_error("in FuncCallNode::genConditionalCode: " + func_.getName() + "() has "
+                               + std::to_string(arg_count_) + " arguments instead of 3!");
+
+    args_[0]->genCode(program);
+    const uint32_t jump_to_else(program->emitJump(Instruction::JUMP_IF_FALSE, getSourceLocation()));
+    args_[1]->genCode(program);
+    const uint32_t jump_to_end(program->emitJump(Instruction::JUMP, getSourceLocation(), return_type_));
+    program->patchJump(jump_to_else);
+    args_[2]->genCode(program);
+    program->patchJump(jump_to_end);
+}
+
+
+// For AND: arg1 JUMP_IF_FALSE short ... argN-1 JUMP_IF_FALSE short argN JUMP end short: BPUSH 0 end:
+void FuncCallNode::genShortCircuitCode(const Instruction short_circuit_jump, Program * const program) const {
+    if (arg_count_ == 0)
+        throw std::logic_error("in FuncCallNode::genShortCircuitCode: " + func_.getName() + "() has no arguments!");
+
+    std::vector<uint32_t> short_circuit_jumps;
+    for (size_t arg_no(0); arg_no < arg_count_ - 1; ++arg_no) {
+        args_[arg_no]->genCode(program);
+        short_circuit_jumps.emplace_back(program->emitJump(short_circuit_jump, getSourceLocation()));
+    }
+    args_[arg_count_ - 1]->genCode(program);
+    if (short_circuit_jumps.empty())
+        return;
+
+    const uint32_t jump_to_end(program->emitJump(Instruction::JUMP, getSourceLocation(), NodeType::BOOLEAN_NODE));
+    for (const uint32_t jump_address : short_circuit_jumps)
+        program->patchJump(jump_address);
+    program->emit(Instruction::BPUSH, getSourceLocation(), short_circuit_jump == Instruction::JUMP_IF_TRUE ? 1 : 0);
+    program->patchJump(jump_to_end);
+}
+
+
+void IdentNode::genCode(Program * const program) const {
+    ConstantPool &constant_pool(program->getConstantPool());
+    const uint32_t attrib_ref_index(constant_pool.internAttribRef(attrib_name_, type_));
+    if (default_value_ == nullptr) {
+        program->emit(Instruction::AREF, getSourceLocation(), attrib_ref_index);
+        return;
+    }
+
+    uint32_t default_value;
+    if (type_ == NodeType::FLOAT_NODE)
+        default_value = constant_pool.internFloat(dynamic_cast<const FloatConstantNode &>(*default_value_).getValue());
+    else if (type_ == NodeType::INT_NODE)
+        default_value = constant_pool.internInt(dynamic_cast<const IntConstantNode &>(*default_value_).getValue());
+    else if (type_ == NodeType::STRING_NODE)
+        default_value = constant_pool.internString(dynamic_cast<const StringConstantNode &>(*default_value_).getValue());
+    else
+        default_value = dynamic_cast<const BooleanConstantNode &>(*default_value_).getValue();
+
+    program->emit(Instruction::AREF2, getSourceLocation(), attrib_ref_index, default_value);
+}
+
+
+void SConvNode::genCode(Program * const program) const {
+    convertee_->genCode(program);
+
+    const NodeType type(convertee_->getType());
+    if (type == NodeType::FLOAT_NODE)
+        program->emit(Instruction::SCONVF, getSourceLocation());
+    else if (type == NodeType::INT_NODE)
+        program->emit(Instruction::SCONVI, getSourceLocation());
+    else if (type == NodeType::BOOLEAN_NODE)
+        program->emit(Instruction::SCONVB, getSourceLocation());
+    else
+        throw std::range_error("in SConvNode::genCode: unknown node type: " + NodeTypeToString(type) + ".");
+}
+
+
+void UnaryOpNode::genCode(Program * const program) const {
+    operand_->genCode(program);
+
+    switch (operator_.getType()) {
+    case TokenType::PLUS:
+        program->emit(Instruction::FUPLUS, getSourceLocation());
+        break;
+    case TokenType::MINUS:
+        program->emit(operand_->getType() == NodeType::INT_NODE ? Instruction::IUMINUS : Instruction::FUMINUS,
+                      getSourceLocation());
+        break;
+    default:
+        throw std::runtime_error(std::to_string(getSourceLocation()) + ": invalid unary operation: "
+                                 + operator_.getStringRep() + ".");
+    }
+}
+
+
+void FConvNode::genCode(Program * const program) const {
+    convertee_->genCode(program);
+
+    const NodeType type(convertee_->getType());
+    if (type == NodeType::INT_NODE)
+        program->emit(Instruction::FCONVI, getSourceLocation());
+    else if (type == NodeType::BOOLEAN_NODE)
+        program->emit(Instruction::FCONVB, getSourceLocation());
+    else if (type == NodeType::STRING_NODE)
+        program->emit(Instruction::FCONVS, getSourceLocation());
+    else
+        throw std::range_error("in FConvNode::genCode: unknown node type: " + NodeTypeToString(type) + ".");
+}
+
+
 } // namespace Nyaa
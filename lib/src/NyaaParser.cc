@@ -0,0 +1,406 @@
+/** \file    NyaaParser.cc
+ *  \brief   Implementation of the Parser class.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "NyaaParser.h"
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include <cmath>
+
+
+namespace Nyaa {
+
+
+// Syntax and type errors are reported by throwing a std::runtime_error whose message is prefixed w/ the source
+// location, parse() turns these into an error message.
+
+
+static inline bool IsNumeric(const NodeType type) {
+    return type == NodeType::FLOAT_NODE or type == NodeType::INT_NODE;
+}
+
+
+static const AbstractNode *ToFloat(const AbstractNode * const node, NodeArena * const node_arena) {
+    if (node->getType() == NodeType::FLOAT_NODE)
+        return node;
+    return node_arena->create<FConvNode>(node);
+}
+
+
+static const AbstractNode *ToString(const AbstractNode * const node, NodeArena * const node_arena) {
+    if (node->getType() == NodeType::STRING_NODE)
+        return node;
+    return node_arena->create<SConvNode>(node);
+}
+
+
+static const AbstractNode *MakeArithmeticOpNode(const size_t source_location, const Token &operator_type,
+                                                const AbstractNode * const lhs, const AbstractNode * const rhs,
+                                                NodeArena * const node_arena)
+{
+    if (not IsNumeric(lhs->getType()) or not IsNumeric(rhs->getType()))
+        throw std::runtime_error(std::to_string(source_location) + ": operands of \"" + operator_type.getStringRep()
+                                 + "\" must be numeric, found " + NodeTypeToString(lhs->getType()) + " and "
+                                 + NodeTypeToString(rhs->getType()) + "!");
+
+    // Integers stay integers, except for "/" and "^" whose results usually aren't integral.
+    if (lhs->getType() == NodeType::INT_NODE and rhs->getType() == NodeType::INT_NODE
+        and operator_type != DIV and operator_type != CARET)
+        return node_arena->create<BinOpNode>(source_location, operator_type, lhs, rhs);
+    return node_arena->create<BinOpNode>(source_location, operator_type, ToFloat(lhs, node_arena),
+                                         ToFloat(rhs, node_arena));
+}
+
+
+bool Parser::parse(const std::string &equation, const AttribNameToTypeMap &attrib_name_to_type_map) {
+    clear();
+    attrib_references_.clear();
+    error_msg_.clear();
+    nesting_depth_ = 0;
+    operator_count_ = 0;
+
+    Tokenizer tokenizer(equation);
+    tokenizer_ = &tokenizer;
+    attrib_name_to_type_map_ = &attrib_name_to_type_map;
+    try {
+        // Allow for a leading "=" as in spreadsheets.
+        const Token token(nextToken());
+        if (token != EQUAL)
+            tokenizer.ungetToken(token);
+
+        const AbstractNode * const parse_tree(parseComparison());
+        if (nextToken() != EOS)
+            throw std::runtime_error(std::to_string(tokenizer.getStartPos()) + ": unexpected input after the end of "
+                                     "the equation!");
+        parse_tree_ = parse_tree;
+    } catch (const std::runtime_error &x) {
+        error_msg_ = x.what();
+        attrib_references_.clear();
+        arg_stack_.clear();
+        node_arena_.clear();
+    }
+    tokenizer_ = nullptr;
+    attrib_name_to_type_map_ = nullptr;
+
+    return parse_tree_ != nullptr;
+}
+
+
+Token Parser::nextToken() {
+    const Token token(tokenizer_->getToken());
+    if (token == ERROR)
+        throw std::runtime_error(std::to_string(tokenizer_->getStartPos()) + ": " + tokenizer_->getErrMsg());
+    return token;
+}
+
+
+void Parser::countOperator(const size_t source_location) {
+    if (++operator_count_ > MAX_OPERATOR_COUNT)
+        throw std::runtime_error(std::to_string(source_location) + ": equation has more than "
+                                 + std::to_string(MAX_OPERATOR_COUNT) + " operators and function calls!");
+}
+
+
+namespace {
+
+
+/** Increments a nesting depth for as long as it exists. */
+class NestingLevel {
+    unsigned &nesting_depth_;
+public:
+    explicit NestingLevel(unsigned * const nesting_depth): nesting_depth_(*nesting_depth) { ++nesting_depth_; }
+    ~NestingLevel() { --nesting_depth_; }
+};
+
+
+} // unnamed namespace
+
+
+const AbstractNode *Parser::parseComparison() {
+    const AbstractNode *lhs(parseConcatenation());
+    for (;;) {
+        const Token token(nextToken());
+        if (not token.isCompOp()) {
+            tokenizer_->ungetToken(token);
+            return lhs;
+        }
+        const size_t source_location(tokenizer_->getStartPos());
+        countOperator(source_location);
+
+        const AbstractNode *rhs(parseConcatenation());
+        if (lhs->getType() != rhs->getType()) {
+            if (not IsNumeric(lhs->getType()) or not IsNumeric(rhs->getType()))
+                throw std::runtime_error(std::to_string(source_location) + ": can't compare "
+                                         + NodeTypeToString(lhs->getType()) + " with "
+                                         + NodeTypeToString(rhs->getType()) + "!");
+            lhs = ToFloat(lhs, &node_arena_);
+            rhs = ToFloat(rhs, &node_arena_);
+        }
+        lhs = node_arena_.create<BinOpNode>(source_location, token, lhs, rhs);
+    }
+}
+
+
+const AbstractNode *Parser::parseConcatenation() {
+    const AbstractNode *lhs(parseSum());
+    for (;;) {
+        const Token token(nextToken());
+        if (token != AMPERSAND) {
+            tokenizer_->ungetToken(token);
+            return lhs;
+        }
+        const size_t source_location(tokenizer_->getStartPos());
+        countOperator(source_location);
+
+        const AbstractNode *rhs(parseSum());
+        lhs = node_arena_.create<BinOpNode>(source_location, token, ToString(lhs, &node_arena_),
+                                            ToString(rhs, &node_arena_));
+    }
+}
+
+
+const AbstractNode *Parser::parseSum() {
+    const AbstractNode *lhs(parseTerm());
+    for (;;) {
+        const Token token(nextToken());
+        if (token != PLUS and token != MINUS) {
+            tokenizer_->ungetToken(token);
+            return lhs;
+        }
+        const size_t source_location(tokenizer_->getStartPos());
+        countOperator(source_location);
+
+        lhs = MakeArithmeticOpNode(source_location, token, lhs, parseTerm(), &node_arena_);
+    }
+}
+
+
+const AbstractNode *Parser::parseTerm() {
+    const AbstractNode *lhs(parsePower());
+    for (;;) {
+        const Token token(nextToken());
+        if (token != MUL and token != DIV) {
+            tokenizer_->ungetToken(token);
+            return lhs;
+        }
+        const size_t source_location(tokenizer_->getStartPos());
+        countOperator(source_location);
+
+        lhs = MakeArithmeticOpNode(source_location, token, lhs, parsePower(), &node_arena_);
+    }
+}
+
+
+// Exponentiation is right-associative, i.e. 2^3^2 = 2^(3^2).
+const AbstractNode *Parser::parsePower() {
+    const AbstractNode *base(parseFactor());
+    const Token token(nextToken());
+    if (token != CARET) {
+        tokenizer_->ungetToken(token);
+        return base;
+    }
+    const size_t source_location(tokenizer_->getStartPos());
+    countOperator(source_location);
+
+    return MakeArithmeticOpNode(source_location, token, base, parsePower(), &node_arena_);
+}
+
+
+const AbstractNode *Parser::parseFactor() {
+    const Token token(nextToken());
+    const size_t source_location(tokenizer_->getStartPos());
+    const NestingLevel nesting_level(&nesting_depth_);
+    if (nesting_depth_ > MAX_NESTING_DEPTH)
+        throw std::runtime_error(std::to_string(source_location) + ": expression is nested more than "
+                                 + std::to_string(MAX_NESTING_DEPTH) + " levels deep!");
+    switch (token.getType()) {
+    case TokenType::FLOAT_CONSTANT:
+        return node_arena_.create<FloatConstantNode>(source_location, tokenizer_->getFloatConstant());
+    case TokenType::INT_CONSTANT:
+        return node_arena_.create<IntConstantNode>(source_location, tokenizer_->getIntConstant());
+    case TokenType::STRING_CONSTANT:
+        return node_arena_.create<StringConstantNode>(source_location, tokenizer_->getStringConstant().toString());
+    case TokenType::BOOLEAN_CONSTANT:
+        return node_arena_.create<BooleanConstantNode>(source_location, tokenizer_->getBooleanConstant());
+    case TokenType::OPEN_PAREN: {
+        const AbstractNode *expr(parseComparison());
+        if (nextToken() != CLOSE_PAREN)
+            throw std::runtime_error(std::to_string(tokenizer_->getStartPos()) + ": expected \")\"!");
+        return expr;
+    }
+    case TokenType::PLUS:
+    case TokenType::MINUS: {
+        const AbstractNode *operand(parseFactor());
+        if (not IsNumeric(operand->getType()))
+            throw std::runtime_error(std::to_string(source_location) + ": operand of unary \"" + token.getStringRep()
+                                     + "\" must be numeric, found " + NodeTypeToString(operand->getType()) + "!");
+        if (token == PLUS)
+            return operand;
+        countOperator(source_location);
+        return node_arena_.create<UnaryOpNode>(source_location, token, operand);
+    }
+    case TokenType::DOLLAR: {
+        const Token next_token(nextToken());
+        if (next_token == OPEN_BRACE)
+            return parseAttribRef(source_location, /* in_braces = */ true);
+        tokenizer_->ungetToken(next_token);
+        return parseAttribRef(source_location, /* in_braces = */ false);
+    }
+    case TokenType::OPEN_BRACE:
+        return parseAttribRef(source_location, /* in_braces = */ true);
+    case TokenType::IDENTIFIER:
+        return parseFunctionCall(source_location, tokenizer_->getIdent().toString());
+    case TokenType::EOS:
+        throw std::runtime_error(std::to_string(source_location) + ": unexpected end of equation!");
+    default:
+        throw std::runtime_error(std::to_string(source_location) + ": expected a constant, an attribute reference, "
+                                 "a function call or \"(\" but found \"" + token.getStringRep() + "\"!");
+    }
+}
+
+
+const AbstractNode *Parser::parseAttribRef(const size_t source_location, const bool in_braces) {
+    if (nextToken() != IDENTIFIER)
+        throw std::runtime_error(std::to_string(tokenizer_->getStartPos()) + ": expected an attribute name!");
+    const std::string attrib_name(tokenizer_->getIdent().toString());
+
+    const auto name_and_type(attrib_name_to_type_map_->find(attrib_name));
+    if (name_and_type == attrib_name_to_type_map_->cend())
+        throw std::runtime_error(std::to_string(tokenizer_->getStartPos()) + ": unknown attribute \"" + attrib_name
+                                 + "\"!");
+    const NodeType attrib_type(name_and_type->second);
+    attrib_references_.emplace(attrib_name);
+
+    const AbstractNode *default_value(nullptr);
+    if (in_braces) {
+        Token token(nextToken());
+        if (token == COLON) {
+            default_value = parseDefaultValue(attrib_name, attrib_type);
+            token = nextToken();
+        }
+        if (token != CLOSE_BRACE)
+            throw std::runtime_error(std::to_string(tokenizer_->getStartPos()) + ": expected \"}\"!");
+    }
+
+    return node_arena_.create<IdentNode>(source_location, attrib_name, default_value, attrib_type);
+}
+
+
+const AbstractNode *Parser::parseDefaultValue(const std::string &attrib_name, const NodeType attrib_type) {
+    Token token(nextToken());
+    const size_t source_location(tokenizer_->getStartPos());
+    const bool negative(token == MINUS);
+    if (token == MINUS or token == PLUS)
+        token = nextToken();
+
+    if (token == FLOAT_CONSTANT and attrib_type == NodeType::FLOAT_NODE) {
+        const double value(tokenizer_->getFloatConstant());
+        return node_arena_.create<FloatConstantNode>(source_location, negative ? -value : value);
+    }
+    if (token == INT_CONSTANT and attrib_type == NodeType::FLOAT_NODE) {
+        const double value(static_cast<double>(tokenizer_->getIntConstant()));
+        return node_arena_.create<FloatConstantNode>(source_location, negative ? -value : value);
+    }
+    if (token == INT_CONSTANT and attrib_type == NodeType::INT_NODE) {
+        const int64_t value(tokenizer_->getIntConstant()); // Never negative, so negation can't overflow.
+        return node_arena_.create<IntConstantNode>(source_location, negative ? -value : value);
+    }
+    if (token == FLOAT_CONSTANT and attrib_type == NodeType::INT_NODE) {
+        const double value(negative ? -tokenizer_->getFloatConstant() : tokenizer_->getFloatConstant());
+        if (value != std::trunc(value) or value < -9223372036854775808.0 or value >= 9223372036854775808.0)
+            throw std::runtime_error(std::to_string(source_location) + ": default value for \"" + attrib_name
+                                     + "\" must be an integer!");
+        return node_arena_.create<IntConstantNode>(source_location, static_cast<int64_t>(value));
+    }
+    if (not negative and token == STRING_CONSTANT and attrib_type == NodeType::STRING_NODE)
+        return node_arena_.create<StringConstantNode>(source_location, tokenizer_->getStringConstant().toString());
+    if (not negative and token == BOOLEAN_CONSTANT and attrib_type == NodeType::BOOLEAN_NODE)
+        return node_arena_.create<BooleanConstantNode>(source_location, tokenizer_->getBooleanConstant());
+
+    throw std::runtime_error(std::to_string(source_location) + ": default value for \"" + attrib_name
+                             + "\" must be a constant of type " + NodeTypeToString(attrib_type) + "!");
+}
+
+
+const AbstractNode *Parser::parseFunctionCall(const size_t source_location, const std::string &function_name)
+{
+    const Function * const function(function_registry_.lookup(function_name));
+    if (function == nullptr)
+        throw std::runtime_error(std::to_string(source_location) + ": unknown function \"" + function_name + "\"!");
+    countOperator(source_location);
+
+    if (nextToken() != OPEN_PAREN)
+        throw std::runtime_error(std::to_string(tokenizer_->getStartPos()) + ": expected \"(\" after \""
+                                 + function_name + "\"!");
+
+    // The arguments of nested calls are collected on top of ours.
+    const size_t first_arg(arg_stack_.size());
+    Token token(nextToken());
+    if (token != CLOSE_PAREN) {
+        tokenizer_->ungetToken(token);
+        for (;;) {
+            const AbstractNode * const arg(parseComparison());
+            arg_stack_.emplace_back(arg);
+            token = nextToken();
+            if (token == CLOSE_PAREN)
+                break;
+            if (token != COMMA)
+                throw std::runtime_error(std::to_string(tokenizer_->getStartPos()) + ": expected \",\" or \")\" in "
+                                         "call to " + function->getName() + "()!");
+        }
+    }
+    const size_t arg_count(arg_stack_.size() - first_arg);
+
+    std::vector<NodeType> arg_types;
+    arg_types.reserve(arg_count);
+    for (size_t arg_no(0); arg_no < arg_count; ++arg_no)
+        arg_types.emplace_back(arg_stack_[first_arg + arg_no]->getType());
+    NodeType return_type(function->validateArgTypes(arg_types));
+
+    // Our second and last attempt: integers as floating point numbers.
+    if (return_type == NodeType::NULL_NODE) {
+        bool have_int_args(false);
+        for (auto &arg_type : arg_types) {
+            if (arg_type == NodeType::INT_NODE) {
+                arg_type = NodeType::FLOAT_NODE;
+                have_int_args = true;
+            }
+        }
+        if (have_int_args)
+            return_type = function->validateArgTypes(arg_types);
+        if (return_type == NodeType::NULL_NODE)
+            throw std::runtime_error(std::to_string(source_location) + ": invalid number or type of arguments in "
+                                     "call to " + function->getName() + "()!");
+        for (size_t arg_no(0); arg_no < arg_count; ++arg_no) {
+            if (arg_stack_[first_arg + arg_no]->getType() == NodeType::INT_NODE)
+                arg_stack_[first_arg + arg_no] = ToFloat(arg_stack_[first_arg + arg_no], &node_arena_);
+        }
+    }
+
+    const TreeNode ** const args(node_arena_.allocateArray<const TreeNode *>(arg_count));
+    std::copy(arg_stack_.cbegin() + first_arg, arg_stack_.cend(), args);
+    arg_stack_.resize(first_arg);
+
+    return node_arena_.create<FuncCallNode>(source_location, *function, return_type, args, arg_count);
+}
+
+
+} // namespace Nyaa
@@ -0,0 +1,208 @@
+/** \file    NyaaPeepholeOptimizer.cc
+ *  \brief   Implementation of the PeepholeOptimizer class.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "NyaaPeepholeOptimizer.h"
+
+
+namespace Nyaa {
+
+
+static constexpr uint32_t NO_JUMP(UINT32_MAX);
+
+
+/** \param  attrib_is_rhs  Whether the attribute is the right operand of "comparison", which then gets mirrored.
+ *  \return whether "comparison" has a fused counterpart "*fused" for comparing an attribute w/ a constant.
+ */
+static bool GetAttribConstantComparison(const Instruction comparison, const bool attrib_is_rhs,
+                                        Instruction * const fused)
+{
+    switch (comparison) {
+    case Instruction::BEQLF:
+        *fused = Instruction::BEQLFAC;
+        return true;
+    case Instruction::BNEQLF:
+        *fused = Instruction::BNEQLFAC;
+        return true;
+    case Instruction::BGTF:
+        *fused = attrib_is_rhs ? Instruction::BLTFAC : Instruction::BGTFAC;
+        return true;
+    case Instruction::BLTF:
+        *fused = attrib_is_rhs ? Instruction::BGTFAC : Instruction::BLTFAC;
+        return true;
+    case Instruction::BGTEF:
+        *fused = attrib_is_rhs ? Instruction::BLTEFAC : Instruction::BGTEFAC;
+        return true;
+    case Instruction::BLTEF:
+        *fused = attrib_is_rhs ? Instruction::BGTEFAC : Instruction::BLTEFAC;
+        return true;
+    case Instruction::BEQLI:
+        *fused = Instruction::BEQLIAC;
+        return true;
+    case Instruction::BNEQLI:
+        *fused = Instruction::BNEQLIAC;
+        return true;
+    case Instruction::BGTI:
+        *fused = attrib_is_rhs ? Instruction::BLTIAC : Instruction::BGTIAC;
+        return true;
+    case Instruction::BLTI:
+        *fused = attrib_is_rhs ? Instruction::BGTIAC : Instruction::BLTIAC;
+        return true;
+    case Instruction::BGTEI:
+        *fused = attrib_is_rhs ? Instruction::BLTEIAC : Instruction::BGTEIAC;
+        return true;
+    case Instruction::BLTEI:
+        *fused = attrib_is_rhs ? Instruction::BGTEIAC : Instruction::BLTEIAC;
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+static inline bool IsNumericPush(const Instruction instruction) {
+    return instruction == Instruction::FPUSH or instruction == Instruction::IPUSH;
+}
+
+
+void PeepholeOptimizer::optimize(Program * const program) {
+    saved_instruction_count_ = 0;
+    code_.assign(program->begin(), program->end());
+    is_jump_target_.assign(code_.size() + 1, false);
+    for (const auto &instruction : code_) {
+        if (IsJump(instruction.getCode()))
+            is_jump_target_[instruction.getOperand()] = true;
+    }
+
+    const unsigned local_count(program->getLocalCount());
+    program->clearCode();
+    for (unsigned local_no(0); local_no < local_count; ++local_no)
+        program->allocateLocal(); // We keep the locals of the CommonSubexpressionEliminator.
+
+    first_jump_to_.assign(code_.size() + 1, NO_JUMP);
+    next_jump_.clear();
+    uint32_t address(0);
+    while (address < code_.size()) {
+        patchJumpsTo(address, program);
+
+        const unsigned fused_length(emitFused(address, program));
+        if (fused_length > 0) {
+            saved_instruction_count_ += fused_length - 1;
+            address += fused_length;
+            continue;
+        }
+
+        const CodeAndSourceLocation &instruction(code_[address]);
+        if (IsJump(instruction.getCode()))
+            addPendingJump(instruction.getOperand(),
+                           program->emitJump(instruction.getCode(), instruction.getSourceLocation(),
+                                             static_cast<NodeType>(instruction.getOperand2())));
+        else
+            program->emit(instruction.getCode(), instruction.getSourceLocation(), instruction.getOperand(),
+                          instruction.getOperand2());
+        ++address;
+    }
+    patchJumpsTo(address, program);
+}
+
+
+bool PeepholeOptimizer::canFuse(const uint32_t address, const unsigned length) const {
+    if (address + length > code_.size())
+        return false;
+    for (uint32_t following_address(address + 1); following_address < address + length; ++following_address) {
+        if (is_jump_target_[following_address])
+            return false;
+    }
+    return true;
+}
+
+
+// The fused instructions inherit the source location of the instruction that may fail, if any.
+unsigned PeepholeOptimizer::emitFused(const uint32_t address, Program * const program) const {
+    const ConstantPool &constant_pool(program->getConstantPool());
+    const CodeAndSourceLocation &first(code_[address]);
+
+    // "{attrib} op constant" is compiled to "constant AREF op" and "constant op {attrib}" to "AREF constant op".
+    if (canFuse(address, 3)) {
+        const CodeAndSourceLocation &second(code_[address + 1]), &third(code_[address + 2]);
+        const bool attrib_is_lhs(IsNumericPush(first.getCode()) and second.getCode() == Instruction::AREF);
+        const bool attrib_is_rhs(first.getCode() == Instruction::AREF and IsNumericPush(second.getCode()));
+        Instruction fused;
+        if ((attrib_is_lhs or attrib_is_rhs) and GetAttribConstantComparison(third.getCode(), attrib_is_rhs, &fused)) {
+            const CodeAndSourceLocation &aref(attrib_is_lhs ? second : first);
+            const CodeAndSourceLocation &push(attrib_is_lhs ? first : second);
+            const NodeType constant_type(push.getCode() == Instruction::FPUSH ? NodeType::FLOAT_NODE
+                                                                              : NodeType::INT_NODE);
+            if (constant_pool.getAttribRef(aref.getOperand()).type_ == constant_type) {
+                program->emit(fused, aref.getSourceLocation(), aref.getOperand(), push.getOperand());
+                return 3;
+            }
+        }
+    }
+
+    if (canFuse(address, 2)) {
+        const CodeAndSourceLocation &second(code_[address + 1]);
+        if (first.getCode() == Instruction::AREF and second.getCode() == Instruction::FCONVI
+            and constant_pool.getAttribRef(first.getOperand()).type_ == NodeType::INT_NODE)
+        {
+            program->emit(Instruction::FAREFI, first.getSourceLocation(), first.getOperand());
+            return 2;
+        }
+
+        if (second.getCode() == Instruction::SCONCAT) {
+            switch (first.getCode()) {
+            case Instruction::SCONVF:
+                program->emit(Instruction::SCONCATF, second.getSourceLocation());
+                return 2;
+            case Instruction::SCONVI:
+                program->emit(Instruction::SCONCATI, second.getSourceLocation());
+                return 2;
+            case Instruction::SCONVB:
+                program->emit(Instruction::SCONCATB, second.getSourceLocation());
+                return 2;
+            default:
+                break;
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+// The jumps to each original target form a singly-linked list through "next_jump_", so that patching them is
+// independent of the number of other pending jumps.
+void PeepholeOptimizer::addPendingJump(const uint32_t original_target, const uint32_t new_jump_address) {
+    if (next_jump_.size() <= new_jump_address)
+        next_jump_.resize(new_jump_address + 1);
+    next_jump_[new_jump_address] = first_jump_to_[original_target];
+    first_jump_to_[original_target] = new_jump_address;
+}
+
+
+void PeepholeOptimizer::patchJumpsTo(const uint32_t address, Program * const program) {
+    for (uint32_t jump_address(first_jump_to_[address]); jump_address != NO_JUMP;
+         jump_address = next_jump_[jump_address])
+        program->patchJump(jump_address);
+    first_jump_to_[address] = NO_JUMP;
+}
+
+
+} // namespace Nyaa
@@ -0,0 +1,165 @@
+/** \file    NyaaProgram.cc
+ *  \brief   Implementation of the Program class.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "NyaaProgram.h"
+#include <stdexcept>
+
+
+namespace Nyaa {
+
+
+unsigned GetOperandCount(const Instruction instruction, const uint32_t operand2) {
+    switch (instruction) {
+    case Instruction::FADD:
+    case Instruction::FSUB:
+    case Instruction::FMUL:
+    case Instruction::FDIV:
+    case Instruction::FPOW:
+    case Instruction::SCONCAT:
+    case Instruction::BEQLF:
+    case Instruction::BNEQLF:
+    case Instruction::BGTF:
+    case Instruction::BLTF:
+    case Instruction::BGTEF:
+    case Instruction::BLTEF:
+    case Instruction::BEQLS:
+    case Instruction::BNEQLS:
+    case Instruction::BGTS:
+    case Instruction::BLTS:
+    case Instruction::BGTES:
+    case Instruction::BLTES:
+    case Instruction::BGTB:
+    case Instruction::BLTB:
+    case Instruction::BGTEB:
+    case Instruction::BLTEB:
+    case Instruction::BEQLB:
+    case Instruction::BNEQLB:
+    case Instruction::BEQLI:
+    case Instruction::BNEQLI:
+    case Instruction::BGTI:
+    case Instruction::BLTI:
+    case Instruction::BGTEI:
+    case Instruction::BLTEI:
+    case Instruction::IADD:
+    case Instruction::ISUB:
+    case Instruction::IMUL:
+    case Instruction::IDIV:
+    case Instruction::IMOD:
+    case Instruction::SCONCATF:
+    case Instruction::SCONCATI:
+    case Instruction::SCONCATB:
+        return 2;
+    case Instruction::CALL:
+    case Instruction::CALLF:
+        return operand2;
+    case Instruction::FUMINUS:
+    case Instruction::FUPLUS:
+    case Instruction::IUMINUS:
+    case Instruction::FCONVI:
+    case Instruction::FCONVB:
+    case Instruction::FCONVS:
+    case Instruction::SCONVF:
+    case Instruction::SCONVI:
+    case Instruction::SCONVB:
+    case Instruction::STORE:
+    case Instruction::JUMP_IF_FALSE:
+    case Instruction::JUMP_IF_TRUE:
+        return 1;
+    case Instruction::AREF:
+    case Instruction::AREF2:
+    case Instruction::FPUSH:
+    case Instruction::SPUSH:
+    case Instruction::BPUSH:
+    case Instruction::IPUSH:
+    case Instruction::LOAD:
+    case Instruction::JUMP:
+    case Instruction::FAREFI:
+    case Instruction::BEQLFAC:
+    case Instruction::BNEQLFAC:
+    case Instruction::BGTFAC:
+    case Instruction::BLTFAC:
+    case Instruction::BGTEFAC:
+    case Instruction::BLTEFAC:
+    case Instruction::BEQLIAC:
+    case Instruction::BNEQLIAC:
+    case Instruction::BGTIAC:
+    case Instruction::BLTIAC:
+    case Instruction::BGTEIAC:
+    case Instruction::BLTEIAC:
+        return 0;
+    }
+
+    throw std::range_error("in GetOperandCount: unknown instruction " + std::to_string(static_cast<int>(instruction))
+                           + "!");
+}
+
+
+void Program::clear() {
+    code_.clear();
+    constant_pool_.clear();
+    result_type_ = NodeType::NULL_NODE;
+    stack_depth_ = max_stack_depth_ = 0;
+    local_count_ = 0;
+    jit_tier_.reset();
+}
+
+
+void Program::clearCode() {
+    code_.clear();
+    stack_depth_ = max_stack_depth_ = 0;
+    local_count_ = 0;
+    jit_tier_.reset();
+}
+
+
+void Program::emit(const Instruction instruction, const size_t source_location, const uint32_t operand,
+                   const uint32_t operand2)
+{
+    code_.emplace_back(instruction, source_location, operand, operand2);
+
+    stack_depth_ = stack_depth_ + (IsJump(instruction) ? 0 : 1) - GetOperandCount(instruction, operand2);
+    if (stack_depth_ > max_stack_depth_)
+        max_stack_depth_ = stack_depth_;
+}
+
+
+// Until the jump gets patched its operand holds the stack depth at the target, which is the depth right after the
+// jump.
+uint32_t Program::emitJump(const Instruction jump, const size_t source_location, const NodeType carried_type) {
+    if (not IsJump(jump))
+        throw std::invalid_argument("in Program::emitJump: not a jump instruction!");
+    emit(jump, source_location, 0, static_cast<uint32_t>(carried_type));
+    code_.back() = CodeAndSourceLocation(jump, source_location, stack_depth_, static_cast<uint32_t>(carried_type));
+    return static_cast<uint32_t>(code_.size() - 1);
+}
+
+
+// The code emitted since the jump may have left a different number of values on the stack, e.g. the "then" branch
+// of a conditional expression when we get to the "else" branch.
+void Program::patchJump(const uint32_t jump_address) {
+    const CodeAndSourceLocation &jump(code_[jump_address]);
+    stack_depth_ = jump.getOperand();
+    code_[jump_address] = CodeAndSourceLocation(jump.getCode(), jump.getSourceLocation(),
+                                                static_cast<uint32_t>(code_.size()), jump.getOperand2());
+}
+
+
+} // namespace Nyaa
@@ -0,0 +1,236 @@
+/** \file    NyaaRecalculator.cc
+ *  \brief   Implementation of the Recalculator class.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "NyaaRecalculator.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include "NyaaNodes.h"
+
+
+namespace Nyaa {
+
+
+namespace {
+
+
+/** Presents one row of a ColumnMap to the Interpreter. */
+class RowAttribContext final : public AttribContext {
+    const ColumnMap &columns_;
+    const size_t row_;
+public:
+    RowAttribContext(const ColumnMap &columns, const size_t row): columns_(columns), row_(row) { }
+
+    bool getFloatAttrib(const std::string &attrib_name, double * const value) const override {
+        const ColumnView * const column(getColumn(attrib_name));
+        if (column == nullptr)
+            return false;
+        *value = column->getFloats()[row_];
+        return true;
+    }
+
+    bool getIntAttrib(const std::string &attrib_name, int64_t * const value) const override {
+        const ColumnView * const column(getColumn(attrib_name));
+        if (column == nullptr)
+            return false;
+        *value = column->getInts()[row_];
+        return true;
+    }
+
+    bool getBooleanAttrib(const std::string &attrib_name, bool * const value) const override {
+        const ColumnView * const column(getColumn(attrib_name));
+        if (column == nullptr)
+            return false;
+        *value = column->getBools()[row_] != 0;
+        return true;
+    }
+
+    const std::string *getStringAttrib(const std::string &attrib_name) const override {
+        const ColumnView * const column(getColumn(attrib_name));
+        return column == nullptr ? nullptr : column->getStrings() + row_;
+    }
+private:
+    /** \return the column of "attrib_name" or nullptr if it has no value in our row. */
+    const ColumnView *getColumn(const std::string &attrib_name) const {
+        const auto name_and_column(columns_.find(attrib_name));
+        if (name_and_column == columns_.cend() or name_and_column->second.isMissing(row_))
+            return nullptr;
+        return &name_and_column->second;
+    }
+};
+
+
+} // unnamed namespace
+
+
+constexpr size_t Recalculator::ROWS_PER_TASK;
+static_assert(Recalculator::ROWS_PER_TASK % ResultColumn::ERROR_BLOCK_SIZE == 0,
+              "tasks of the same column must not share error blocks!");
+
+
+Recalculator::Recalculator(const DependencyGraph &graph, const unsigned thread_count)
+    : graph_(graph), row_count_(0), scheduler_(thread_count), batch_evaluators_(scheduler_.getThreadCount())
+{
+    statistics_.wall_seconds_ = statistics_.critical_path_seconds_ = 0.0;
+}
+
+
+void Recalculator::recalculateAll(const ColumnMap &base_columns, const size_t row_count) {
+    for (const auto &name_and_column : base_columns) {
+        size_t column_index;
+        if (graph_.lookup(name_and_column.first, &column_index))
+            throw std::invalid_argument("in Recalculator::recalculateAll: base column \"" + name_and_column.first
+                                        + "\" has the same name as a computed column!");
+    }
+
+    const std::vector<size_t> &evaluation_order(graph_.getEvaluationOrder());
+    columns_ = base_columns;
+    row_count_ = row_count;
+    results_.clear();
+    results_.resize(graph_.size());
+    evaluateColumns(evaluation_order);
+}
+
+
+size_t Recalculator::recalculateColumns(const std::vector<std::string> &changed_attrib_names) {
+    const std::vector<size_t> affected_columns(graph_.getAffectedColumns(changed_attrib_names));
+    evaluateColumns(affected_columns);
+
+    return affected_columns.size();
+}
+
+
+size_t Recalculator::recalculateRows(const std::vector<std::string> &changed_attrib_names,
+                                     const std::vector<size_t> &rows)
+{
+    for (const size_t row : rows) {
+        if (row >= row_count_)
+            throw std::out_of_range("in Recalculator::recalculateRows: row " + std::to_string(row)
+                                    + " is out of range!");
+    }
+
+    const std::vector<size_t> affected_columns(graph_.getAffectedColumns(changed_attrib_names));
+    for (const size_t column_index : affected_columns) {
+        for (const size_t row : rows)
+            recalculateCell(column_index, row);
+    }
+
+    return affected_columns.size();
+}
+
+
+const ResultColumn &Recalculator::getResult(const std::string &column_name) const {
+    size_t column_index;
+    if (not graph_.lookup(column_name, &column_index))
+        throw std::out_of_range("in Recalculator::getResult: unknown column \"" + column_name + "\"!");
+    return results_[column_index];
+}
+
+
+void Recalculator::evaluateColumns(const std::vector<size_t> &column_indices) {
+    // W/ a single thread splitting columns would only add overhead.
+    const size_t rows_per_task(scheduler_.getThreadCount() == 1 ? std::max<size_t>(row_count_, 1) : ROWS_PER_TASK);
+    const size_t tasks_per_column(std::max<size_t>((row_count_ + rows_per_task - 1) / rows_per_task, 1));
+
+    // Task "position * tasks_per_column + i" evaluates the i-th range of rows of column_indices[position].  All
+    // results have to be sized and published in "columns_" up front, as "columns_" must not change while tasks
+    // are running.
+    static const size_t NOT_RECALCULATED(std::numeric_limits<size_t>::max());
+    std::vector<size_t> column_positions(graph_.size(), NOT_RECALCULATED);
+    task_graph_.clear();
+    for (size_t position(0); position < column_indices.size(); ++position) {
+        const size_t column_index(column_indices[position]);
+        column_positions[column_index] = position;
+        results_[column_index].reset(graph_.getProgram(column_index).getResultType(), row_count_);
+        columns_[graph_.getName(column_index)] = results_[column_index].getColumnView();
+
+        for (size_t i(0); i < tasks_per_column; ++i)
+            task_graph_.addTask();
+        for (const size_t dependency_index : graph_.getDependencies(column_index)) {
+            const size_t dependency_position(column_positions[dependency_index]);
+            if (dependency_position == NOT_RECALCULATED)
+                continue;
+            for (size_t i(0); i < tasks_per_column; ++i)
+                task_graph_.addDependency(dependency_position * tasks_per_column + i,
+                                          position * tasks_per_column + i);
+        }
+    }
+
+    DagScheduler::Statistics scheduler_statistics;
+    scheduler_.run(task_graph_, [&](const size_t task, const unsigned thread_no) {
+        const size_t column_index(column_indices[task / tasks_per_column]);
+        const size_t first_row((task % tasks_per_column) * rows_per_task);
+        batch_evaluators_[thread_no].evaluateRange(graph_.getProgram(column_index), columns_, first_row,
+                                                   std::min(rows_per_task, row_count_ - first_row),
+                                                   &results_[column_index]);
+    }, &scheduler_statistics);
+
+    statistics_.column_seconds_.assign(graph_.size(), 0.0);
+    for (size_t position(0); position < column_indices.size(); ++position) {
+        double start(std::numeric_limits<double>::max()), end(0.0);
+        for (size_t task(position * tasks_per_column); task < (position + 1) * tasks_per_column; ++task) {
+            start = std::min(start, scheduler_statistics.task_timings_[task].start_);
+            end = std::max(end, scheduler_statistics.task_timings_[task].end_);
+        }
+        statistics_.column_seconds_[column_indices[position]] = end - start;
+    }
+    statistics_.wall_seconds_ = scheduler_statistics.wall_seconds_;
+    statistics_.critical_path_seconds_ = scheduler_statistics.critical_path_seconds_;
+}
+
+
+// The results are updated in place, so the view in "columns_" stays valid.
+void Recalculator::recalculateCell(const size_t column_index, const size_t row) {
+    ResultColumn &result(results_[column_index]);
+    try {
+        const FuncArg value(interpreter_.evaluate(graph_.getProgram(column_index), RowAttribContext(columns_, row)));
+        switch (value.getType()) {
+        case NodeType::FLOAT_NODE:
+            result.setFloat(row, value.getDoubleValue());
+            break;
+        case NodeType::INT_NODE:
+            result.setInt(row, value.getIntValue());
+            break;
+        case NodeType::BOOLEAN_NODE:
+            result.setBool(row, value.getBoolValue());
+            break;
+        case NodeType::STRING_NODE:
+            result.setString(row, value.getStringValue());
+            break;
+        default:
+            throw std::logic_error("in Recalculator::recalculateCell: unexpected result type "
+                                   + NodeTypeToString(value.getType()) + "!");
+        }
+        result.clearError(row);
+    } catch (const std::domain_error &x) {
+        result.clearError(row);
+        result.setError(row, x.what());
+    } catch (const std::invalid_argument &x) {
+        result.clearError(row);
+        result.setError(row, x.what());
+    } catch (const std::runtime_error &x) {
+        result.clearError(row);
+        result.setError(row, x.what());
+    }
+}
+
+
+} // namespace Nyaa
@@ -0,0 +1,74 @@
+/** \file    NyaaSchema.cc
+ *  \brief   Implementation of the Schema and Binding classes.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "NyaaSchema.h"
+#include <stdexcept>
+#include "NyaaNodes.h"
+
+
+namespace Nyaa {
+
+
+uint32_t Schema::addAttribute(const std::string &name, const NodeType type) {
+    if (type == NodeType::NULL_NODE)
+        throw std::invalid_argument("in Schema::addAttribute: attribute \"" + name + "\" must not have type NULL!");
+
+    const uint32_t slot(static_cast<uint32_t>(attributes_.size()));
+    if (not name_to_slot_map_.emplace(name, slot).second)
+        throw std::invalid_argument("in Schema::addAttribute: duplicate attribute \"" + name + "\"!");
+    attributes_.emplace_back(name, type);
+    attrib_name_to_type_map_.emplace(name, type);
+    ++version_;
+
+    return slot;
+}
+
+
+bool Schema::lookup(const std::string &name, uint32_t * const slot) const {
+    const auto name_and_slot(name_to_slot_map_.find(name));
+    if (name_and_slot == name_to_slot_map_.cend())
+        return false;
+
+    *slot = name_and_slot->second;
+    return true;
+}
+
+
+Binding::Binding(const Program &program, const Schema &schema)
+    : program_(&program), schema_(&schema), schema_version_(schema.getVersion())
+{
+    const ConstantPool &constant_pool(program.getConstantPool());
+    slots_.reserve(constant_pool.getAttribRefCount());
+    for (uint32_t attrib_ref_index(0); attrib_ref_index < constant_pool.getAttribRefCount(); ++attrib_ref_index) {
+        const ConstantPool::AttribRef &attrib_ref(constant_pool.getAttribRef(attrib_ref_index));
+        uint32_t slot;
+        if (not schema.lookup(attrib_ref.name_, &slot))
+            throw std::invalid_argument("in Binding::Binding: unknown attribute \"" + attrib_ref.name_ + "\"!");
+        if (schema.getType(slot) != attrib_ref.type_)
+            throw std::invalid_argument("in Binding::Binding: attribute \"" + attrib_ref.name_ + "\" has type "
+                                        + NodeTypeToString(schema.getType(slot)) + " but "
+                                        + NodeTypeToString(attrib_ref.type_) + " was expected!");
+        slots_.emplace_back(slot);
+    }
+}
+
+
+} // namespace Nyaa
@@ -0,0 +1,379 @@
+/** \file    NyaaSimdKernels.cc
+ *  \brief   Implementation of the SIMD kernels.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "NyaaSimdKernels.h"
+#include "NyaaIntArithmetic.h"
+#include <algorithm>
+#include <stdexcept>
+#if defined(__x86_64__) || defined(__i386__)
+#   include <immintrin.h>
+#   define NYAA_X86_KERNELS
+#endif
+
+
+// Every kernel exists in a scalar version and, on x86, in versions for SSE2, AVX2 and AVX-512.  The vector versions
+// are compiled w/ the "target" attribute, so that they are available independent of the -m/-march flags the library
+// is built with and are only ever called after a runtime check of the CPU's capabilities.  The comparison kernels
+// produce packed masks, 64 rows per word, and use the ordered predicates for everything except "not equal", matching
+// the semantics of the C++ operators in the presence of NaN's.  Integer arithmetic detects overflows unless the library
+// has been built w/ NYAA_UNCHECKED_INT_ARITHMETIC, see NyaaIntArithmetic.h.
+
+
+namespace Nyaa {
+
+
+SimdLevel GetSimdLevel() {
+#ifdef NYAA_X86_KERNELS
+    static const SimdLevel simd_level([]() {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+            return SimdLevel::AVX512;
+        if (__builtin_cpu_supports("avx2"))
+            return SimdLevel::AVX2;
+        if (__builtin_cpu_supports("sse2"))
+            return SimdLevel::SSE2;
+        return SimdLevel::SCALAR;
+    }());
+    return simd_level;
+#else
+    return SimdLevel::SCALAR;
+#endif
+}
+
+
+std::string SimdLevelToString(const SimdLevel simd_level) {
+    switch (simd_level) {
+    case SimdLevel::SCALAR:
+        return "scalar";
+    case SimdLevel::SSE2:
+        return "SSE2";
+    case SimdLevel::AVX2:
+        return "AVX2";
+    case SimdLevel::AVX512:
+        return "AVX-512";
+    }
+
+    throw std::range_error("in SimdLevelToString: unknown SIMD level "
+                           + std::to_string(static_cast<int>(simd_level)) + "!");
+}
+
+
+#define SCALAR_ARITHMETIC_KERNEL(name, op)                                                                   \
+    static void name##Scalar(double * const __restrict__ rhs_and_result, const double * const __restrict__ lhs, \
+                             const size_t count)                                                             \
+    {                                                                                                        \
+        for (size_t row(0); row < count; ++row)                                                              \
+            rhs_and_result[row] = lhs[row] op rhs_and_result[row];                                           \
+    }
+
+
+#define VECTOR_ARITHMETIC_KERNEL(name, target_name, width, vector_type, load, store, intrinsic, op)         \
+    __attribute__((target(target_name)))                                                                     \
+    static void name(double * const __restrict__ rhs_and_result, const double * const __restrict__ lhs,        \
+                     const size_t count)                                                                     \
+    {                                                                                                        \
+        size_t row(0);                                                                                       \
+        for (/* Intentionally empty! */; row + width <= count; row += width) {                               \
+            const vector_type result(intrinsic(load(lhs + row), load(rhs_and_result + row)));               \
+            store(rhs_and_result + row, result);                                                             \
+        }                                                                                                    \
+        for (/* Intentionally empty! */; row < count; ++row)                                                 \
+            rhs_and_result[row] = lhs[row] op rhs_and_result[row];                                           \
+    }
+
+
+// Like the comparison kernels, the integer arithmetic kernels assemble a packed mask, of the rows that overflowed.
+// "vector_overflows" has to return a bitmask w/ one bit per lane for the vectors "l", "r" and "result".
+#define VECTOR_INT_ARITHMETIC_KERNEL(name, target_attribute, vector_type, width, load, store, vector_op,       \
+                                     vector_overflows, overflows)                                            \
+    target_attribute                                                                                         \
+    static void name(int64_t * const __restrict__ rhs_and_result, const int64_t * const __restrict__ lhs,      \
+                     uint64_t * const __restrict__ overflow_mask, const size_t count)                        \
+    {                                                                                                        \
+        for (size_t first_row(0); first_row < count; first_row += 64) {                                      \
+            const size_t block_size(std::min<size_t>(64, count - first_row));                                \
+            const int64_t * const lhs_block(lhs + first_row);                                                \
+            int64_t * const rhs_block(rhs_and_result + first_row);                                           \
+            uint64_t word(0);                                                                                \
+            size_t row(0);                                                                                   \
+            for (/* Intentionally empty! */; row + width <= block_size; row += width) {                      \
+                const vector_type l(load(lhs_block + row)), r(load(rhs_block + row));                        \
+                const vector_type result(vector_op(l, r));                                                   \
+                if (CHECK_INT_OVERFLOW)                                                                      \
+                    word |= static_cast<uint64_t>(vector_overflows) << row;                                  \
+                store(rhs_block + row, result);                                                              \
+            }                                                                                                \
+            for (/* Intentionally empty! */; row < block_size; ++row)                                        \
+                word |= static_cast<uint64_t>(overflows(lhs_block[row], rhs_block[row], &rhs_block[row])) << row; \
+            overflow_mask[first_row / 64] = word;                                                            \
+        }                                                                                                    \
+    }
+
+
+#define SCALAR_INT_ARITHMETIC_KERNEL(name, overflows)                                                        \
+    static void name(int64_t * const __restrict__ rhs_and_result, const int64_t * const __restrict__ lhs,      \
+                     uint64_t * const __restrict__ overflow_mask, const size_t count)                        \
+    {                                                                                                        \
+        for (size_t first_row(0); first_row < count; first_row += 64) {                                      \
+            const size_t block_size(std::min<size_t>(64, count - first_row));                                \
+            const int64_t * const lhs_block(lhs + first_row);                                                \
+            int64_t * const rhs_block(rhs_and_result + first_row);                                           \
+            uint64_t word(0);                                                                                \
+            for (size_t row(0); row < block_size; ++row)                                                     \
+                word |= static_cast<uint64_t>(overflows(lhs_block[row], rhs_block[row], &rhs_block[row])) << row; \
+            overflow_mask[first_row / 64] = word;                                                            \
+        }                                                                                                    \
+    }
+
+
+// Assembles the packed mask 64 rows at a time, "vector_compare" has to return a bitmask w/ one bit per lane.
+#define VECTOR_COMPARISON_KERNEL(name, target_attribute, operand_type, width, vector_compare, op)            \
+    target_attribute                                                                                         \
+    static void name(uint64_t * const __restrict__ result_mask, const operand_type * const __restrict__ lhs,   \
+                     const operand_type * const __restrict__ rhs, const size_t count)                        \
+    {                                                                                                        \
+        for (size_t first_row(0); first_row < count; first_row += 64) {                                      \
+            const size_t block_size(std::min<size_t>(64, count - first_row));                                \
+            const operand_type * const l(lhs + first_row);                                                   \
+            const operand_type * const r(rhs + first_row);                                                   \
+            uint64_t word(0);                                                                                \
+            size_t row(0);                                                                                   \
+            for (/* Intentionally empty! */; row + width <= block_size; row += width)                        \
+                word |= static_cast<uint64_t>(vector_compare) << row;                                        \
+            for (/* Intentionally empty! */; row < block_size; ++row)                                        \
+                word |= static_cast<uint64_t>(l[row] op r[row]) << row;                                      \
+            result_mask[first_row / 64] = word;                                                              \
+        }                                                                                                    \
+    }
+
+
+#define SCALAR_COMPARISON_KERNEL(name, operand_type, op)                                                     \
+    static void name(uint64_t * const __restrict__ result_mask, const operand_type * const __restrict__ lhs,   \
+                     const operand_type * const __restrict__ rhs, const size_t count)                        \
+    {                                                                                                        \
+        std::fill_n(result_mask, MaskWordCount(count), 0);                                                   \
+        for (size_t row(0); row < count; ++row)                                                              \
+            result_mask[row / 64] |= static_cast<uint64_t>(lhs[row] op rhs[row]) << (row % 64);              \
+    }
+
+
+#define SCALAR_COMPARISON_KERNELS(type_name, operand_type)                                                    \
+    SCALAR_COMPARISON_KERNEL(type_name##EqualScalar, operand_type, ==)                                       \
+    SCALAR_COMPARISON_KERNEL(type_name##NotEqualScalar, operand_type, !=)                                    \
+    SCALAR_COMPARISON_KERNEL(type_name##GreaterThanScalar, operand_type, >)                                  \
+    SCALAR_COMPARISON_KERNEL(type_name##LessThanScalar, operand_type, <)                                     \
+    SCALAR_COMPARISON_KERNEL(type_name##GreaterOrEqualScalar, operand_type, >=)                              \
+    SCALAR_COMPARISON_KERNEL(type_name##LessOrEqualScalar, operand_type, <=)
+
+
+SCALAR_ARITHMETIC_KERNEL(Add, +)
+SCALAR_ARITHMETIC_KERNEL(Sub, -)
+SCALAR_ARITHMETIC_KERNEL(Mul, *)
+SCALAR_ARITHMETIC_KERNEL(Div, /)
+SCALAR_INT_ARITHMETIC_KERNEL(IntAddScalar, AddOverflows)
+SCALAR_INT_ARITHMETIC_KERNEL(IntSubScalar, SubOverflows)
+SCALAR_INT_ARITHMETIC_KERNEL(IntMulScalar, MulOverflows)
+SCALAR_COMPARISON_KERNELS(Float, double)
+SCALAR_COMPARISON_KERNELS(Int, int64_t)
+
+
+#ifdef NYAA_X86_KERNELS
+
+
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+
+
+VECTOR_ARITHMETIC_KERNEL(AddSse2, "sse2", 2, __m128d, _mm_loadu_pd, _mm_storeu_pd, _mm_add_pd, +)
+VECTOR_ARITHMETIC_KERNEL(SubSse2, "sse2", 2, __m128d, _mm_loadu_pd, _mm_storeu_pd, _mm_sub_pd, -)
+VECTOR_ARITHMETIC_KERNEL(MulSse2, "sse2", 2, __m128d, _mm_loadu_pd, _mm_storeu_pd, _mm_mul_pd, *)
+VECTOR_ARITHMETIC_KERNEL(DivSse2, "sse2", 2, __m128d, _mm_loadu_pd, _mm_storeu_pd, _mm_div_pd, /)
+VECTOR_ARITHMETIC_KERNEL(AddAvx2, "avx2", 4, __m256d, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_add_pd, +)
+VECTOR_ARITHMETIC_KERNEL(SubAvx2, "avx2", 4, __m256d, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_sub_pd, -)
+VECTOR_ARITHMETIC_KERNEL(MulAvx2, "avx2", 4, __m256d, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_mul_pd, *)
+VECTOR_ARITHMETIC_KERNEL(DivAvx2, "avx2", 4, __m256d, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_div_pd, /)
+VECTOR_ARITHMETIC_KERNEL(AddAvx512, "avx512f", 8, __m512d, _mm512_loadu_pd, _mm512_storeu_pd, _mm512_add_pd, +)
+VECTOR_ARITHMETIC_KERNEL(SubAvx512, "avx512f", 8, __m512d, _mm512_loadu_pd, _mm512_storeu_pd, _mm512_sub_pd, -)
+VECTOR_ARITHMETIC_KERNEL(MulAvx512, "avx512f", 8, __m512d, _mm512_loadu_pd, _mm512_storeu_pd, _mm512_mul_pd, *)
+VECTOR_ARITHMETIC_KERNEL(DivAvx512, "avx512f", 8, __m512d, _mm512_loadu_pd, _mm512_storeu_pd, _mm512_div_pd, /)
+
+
+// A sum overflows if its sign differs from the signs of both operands, a difference if the operands have different
+// signs and the sign of the result differs from that of the left operand.  Only AVX-512 has a 64-bit multiplication
+// and no vector instruction set detects its overflows, so unless overflows are unchecked IntMulScalar is used.
+#define SSE2_INT_LOAD(pointer) _mm_loadu_si128(reinterpret_cast<const __m128i *>(pointer))
+#define SSE2_INT_STORE(pointer, vector) _mm_storeu_si128(reinterpret_cast<__m128i *>(pointer), vector)
+#define SSE2_SIGNS(vector) _mm_movemask_pd(_mm_castsi128_pd(vector))
+#define SSE2_ADD_OVERFLOWS SSE2_SIGNS(_mm_and_si128(_mm_xor_si128(l, result), _mm_xor_si128(r, result)))
+#define SSE2_SUB_OVERFLOWS SSE2_SIGNS(_mm_and_si128(_mm_xor_si128(l, r), _mm_xor_si128(l, result)))
+VECTOR_INT_ARITHMETIC_KERNEL(IntAddSse2, TARGET_SSE2, __m128i, 2, SSE2_INT_LOAD, SSE2_INT_STORE, _mm_add_epi64,
+                             SSE2_ADD_OVERFLOWS, AddOverflows)
+VECTOR_INT_ARITHMETIC_KERNEL(IntSubSse2, TARGET_SSE2, __m128i, 2, SSE2_INT_LOAD, SSE2_INT_STORE, _mm_sub_epi64,
+                             SSE2_SUB_OVERFLOWS, SubOverflows)
+
+#define AVX2_INT_LOAD(pointer) _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pointer))
+#define AVX2_INT_STORE(pointer, vector) _mm256_storeu_si256(reinterpret_cast<__m256i *>(pointer), vector)
+#define AVX2_SIGNS(vector) _mm256_movemask_pd(_mm256_castsi256_pd(vector))
+#define AVX2_ADD_OVERFLOWS AVX2_SIGNS(_mm256_and_si256(_mm256_xor_si256(l, result), _mm256_xor_si256(r, result)))
+#define AVX2_SUB_OVERFLOWS AVX2_SIGNS(_mm256_and_si256(_mm256_xor_si256(l, r), _mm256_xor_si256(l, result)))
+VECTOR_INT_ARITHMETIC_KERNEL(IntAddAvx2, TARGET_AVX2, __m256i, 4, AVX2_INT_LOAD, AVX2_INT_STORE, _mm256_add_epi64,
+                             AVX2_ADD_OVERFLOWS, AddOverflows)
+VECTOR_INT_ARITHMETIC_KERNEL(IntSubAvx2, TARGET_AVX2, __m256i, 4, AVX2_INT_LOAD, AVX2_INT_STORE, _mm256_sub_epi64,
+                             AVX2_SUB_OVERFLOWS, SubOverflows)
+
+#define AVX512_SIGNS(vector) _mm512_cmplt_epi64_mask(vector, _mm512_setzero_si512())
+#define AVX512_ADD_OVERFLOWS AVX512_SIGNS(_mm512_and_si512(_mm512_xor_si512(l, result), _mm512_xor_si512(r, result)))
+#define AVX512_SUB_OVERFLOWS AVX512_SIGNS(_mm512_and_si512(_mm512_xor_si512(l, r), _mm512_xor_si512(l, result)))
+VECTOR_INT_ARITHMETIC_KERNEL(IntAddAvx512, TARGET_AVX512, __m512i, 8, _mm512_loadu_si512, _mm512_storeu_si512,
+                             _mm512_add_epi64, AVX512_ADD_OVERFLOWS, AddOverflows)
+VECTOR_INT_ARITHMETIC_KERNEL(IntSubAvx512, TARGET_AVX512, __m512i, 8, _mm512_loadu_si512, _mm512_storeu_si512,
+                             _mm512_sub_epi64, AVX512_SUB_OVERFLOWS, SubOverflows)
+VECTOR_INT_ARITHMETIC_KERNEL(IntMulAvx512, TARGET_AVX512, __m512i, 8, _mm512_loadu_si512, _mm512_storeu_si512,
+                             _mm512_mullox_epi64, 0 /* Unchecked only! */, MulOverflows)
+
+
+#define SSE2_FLOAT_COMPARE(intrinsic) \
+    _mm_movemask_pd(intrinsic(_mm_loadu_pd(l + row), _mm_loadu_pd(r + row)))
+VECTOR_COMPARISON_KERNEL(FloatEqualSse2, TARGET_SSE2, double, 2, SSE2_FLOAT_COMPARE(_mm_cmpeq_pd), ==)
+VECTOR_COMPARISON_KERNEL(FloatNotEqualSse2, TARGET_SSE2, double, 2, SSE2_FLOAT_COMPARE(_mm_cmpneq_pd), !=)
+VECTOR_COMPARISON_KERNEL(FloatGreaterThanSse2, TARGET_SSE2, double, 2, SSE2_FLOAT_COMPARE(_mm_cmpgt_pd), >)
+VECTOR_COMPARISON_KERNEL(FloatLessThanSse2, TARGET_SSE2, double, 2, SSE2_FLOAT_COMPARE(_mm_cmplt_pd), <)
+VECTOR_COMPARISON_KERNEL(FloatGreaterOrEqualSse2, TARGET_SSE2, double, 2, SSE2_FLOAT_COMPARE(_mm_cmpge_pd), >=)
+VECTOR_COMPARISON_KERNEL(FloatLessOrEqualSse2, TARGET_SSE2, double, 2, SSE2_FLOAT_COMPARE(_mm_cmple_pd), <=)
+
+
+#define AVX2_FLOAT_COMPARE(predicate) \
+    _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(l + row), _mm256_loadu_pd(r + row), predicate))
+VECTOR_COMPARISON_KERNEL(FloatEqualAvx2, TARGET_AVX2, double, 4, AVX2_FLOAT_COMPARE(_CMP_EQ_OQ), ==)
+VECTOR_COMPARISON_KERNEL(FloatNotEqualAvx2, TARGET_AVX2, double, 4, AVX2_FLOAT_COMPARE(_CMP_NEQ_UQ), !=)
+VECTOR_COMPARISON_KERNEL(FloatGreaterThanAvx2, TARGET_AVX2, double, 4, AVX2_FLOAT_COMPARE(_CMP_GT_OQ), >)
+VECTOR_COMPARISON_KERNEL(FloatLessThanAvx2, TARGET_AVX2, double, 4, AVX2_FLOAT_COMPARE(_CMP_LT_OQ), <)
+VECTOR_COMPARISON_KERNEL(FloatGreaterOrEqualAvx2, TARGET_AVX2, double, 4, AVX2_FLOAT_COMPARE(_CMP_GE_OQ), >=)
+VECTOR_COMPARISON_KERNEL(FloatLessOrEqualAvx2, TARGET_AVX2, double, 4, AVX2_FLOAT_COMPARE(_CMP_LE_OQ), <=)
+
+
+#define AVX2_INT_MOVEMASK(vector) _mm256_movemask_pd(_mm256_castsi256_pd(vector))
+#define AVX2_INT_EQUAL AVX2_INT_MOVEMASK(_mm256_cmpeq_epi64(AVX2_INT_LOAD(l + row), AVX2_INT_LOAD(r + row)))
+#define AVX2_INT_GREATER AVX2_INT_MOVEMASK(_mm256_cmpgt_epi64(AVX2_INT_LOAD(l + row), AVX2_INT_LOAD(r + row)))
+#define AVX2_INT_LESS AVX2_INT_MOVEMASK(_mm256_cmpgt_epi64(AVX2_INT_LOAD(r + row), AVX2_INT_LOAD(l + row)))
+VECTOR_COMPARISON_KERNEL(IntEqualAvx2, TARGET_AVX2, int64_t, 4, AVX2_INT_EQUAL, ==)
+VECTOR_COMPARISON_KERNEL(IntNotEqualAvx2, TARGET_AVX2, int64_t, 4, AVX2_INT_EQUAL ^ 0xFu, !=)
+VECTOR_COMPARISON_KERNEL(IntGreaterThanAvx2, TARGET_AVX2, int64_t, 4, AVX2_INT_GREATER, >)
+VECTOR_COMPARISON_KERNEL(IntLessThanAvx2, TARGET_AVX2, int64_t, 4, AVX2_INT_LESS, <)
+VECTOR_COMPARISON_KERNEL(IntGreaterOrEqualAvx2, TARGET_AVX2, int64_t, 4, AVX2_INT_LESS ^ 0xFu, >=)
+VECTOR_COMPARISON_KERNEL(IntLessOrEqualAvx2, TARGET_AVX2, int64_t, 4, AVX2_INT_GREATER ^ 0xFu, <=)
+
+
+#define AVX512_FLOAT_COMPARE(predicate) \
+    _mm512_cmp_pd_mask(_mm512_loadu_pd(l + row), _mm512_loadu_pd(r + row), predicate)
+VECTOR_COMPARISON_KERNEL(FloatEqualAvx512, TARGET_AVX512, double, 8, AVX512_FLOAT_COMPARE(_CMP_EQ_OQ), ==)
+VECTOR_COMPARISON_KERNEL(FloatNotEqualAvx512, TARGET_AVX512, double, 8, AVX512_FLOAT_COMPARE(_CMP_NEQ_UQ), !=)
+VECTOR_COMPARISON_KERNEL(FloatGreaterThanAvx512, TARGET_AVX512, double, 8, AVX512_FLOAT_COMPARE(_CMP_GT_OQ), >)
+VECTOR_COMPARISON_KERNEL(FloatLessThanAvx512, TARGET_AVX512, double, 8, AVX512_FLOAT_COMPARE(_CMP_LT_OQ), <)
+VECTOR_COMPARISON_KERNEL(FloatGreaterOrEqualAvx512, TARGET_AVX512, double, 8, AVX512_FLOAT_COMPARE(_CMP_GE_OQ), >=)
+VECTOR_COMPARISON_KERNEL(FloatLessOrEqualAvx512, TARGET_AVX512, double, 8, AVX512_FLOAT_COMPARE(_CMP_LE_OQ), <=)
+
+
+#define AVX512_INT_COMPARE(predicate) \
+    _mm512_cmp_epi64_mask(_mm512_loadu_si512(l + row), _mm512_loadu_si512(r + row), predicate)
+VECTOR_COMPARISON_KERNEL(IntEqualAvx512, TARGET_AVX512, int64_t, 8, AVX512_INT_COMPARE(_MM_CMPINT_EQ), ==)
+VECTOR_COMPARISON_KERNEL(IntNotEqualAvx512, TARGET_AVX512, int64_t, 8, AVX512_INT_COMPARE(_MM_CMPINT_NE), !=)
+VECTOR_COMPARISON_KERNEL(IntGreaterThanAvx512, TARGET_AVX512, int64_t, 8, AVX512_INT_COMPARE(_MM_CMPINT_NLE), >)
+VECTOR_COMPARISON_KERNEL(IntLessThanAvx512, TARGET_AVX512, int64_t, 8, AVX512_INT_COMPARE(_MM_CMPINT_LT), <)
+VECTOR_COMPARISON_KERNEL(IntGreaterOrEqualAvx512, TARGET_AVX512, int64_t, 8, AVX512_INT_COMPARE(_MM_CMPINT_NLT), >=)
+VECTOR_COMPARISON_KERNEL(IntLessOrEqualAvx512, TARGET_AVX512, int64_t, 8, AVX512_INT_COMPARE(_MM_CMPINT_LE), <=)
+
+
+#endif // ifdef NYAA_X86_KERNELS
+
+
+#define SET_KERNELS(suffix)                                                                                  \
+    float_arithmetic_kernels_[ADD] = Add##suffix;                                                            \
+    float_arithmetic_kernels_[SUB] = Sub##suffix;                                                            \
+    float_arithmetic_kernels_[MUL] = Mul##suffix;                                                            \
+    float_arithmetic_kernels_[DIV] = Div##suffix;                                                            \
+    float_comparison_kernels_[EQUAL] = FloatEqual##suffix;                                                   \
+    float_comparison_kernels_[NOT_EQUAL] = FloatNotEqual##suffix;                                            \
+    float_comparison_kernels_[GREATER_THAN] = FloatGreaterThan##suffix;                                      \
+    float_comparison_kernels_[LESS_THAN] = FloatLessThan##suffix;                                            \
+    float_comparison_kernels_[GREATER_OR_EQUAL] = FloatGreaterOrEqual##suffix;                               \
+    float_comparison_kernels_[LESS_OR_EQUAL] = FloatLessOrEqual##suffix
+
+#define SET_INT_ARITHMETIC_KERNELS(add_suffix, mul_suffix)                                                   \
+    int_arithmetic_kernels_[ADD] = IntAdd##add_suffix;                                                       \
+    int_arithmetic_kernels_[SUB] = IntSub##add_suffix;                                                       \
+    int_arithmetic_kernels_[MUL] = IntMul##mul_suffix;                                                       \
+    int_arithmetic_kernels_[DIV] = nullptr
+
+#define SET_INT_COMPARISON_KERNELS(suffix)                                                                   \
+    int_comparison_kernels_[EQUAL] = IntEqual##suffix;                                                       \
+    int_comparison_kernels_[NOT_EQUAL] = IntNotEqual##suffix;                                                \
+    int_comparison_kernels_[GREATER_THAN] = IntGreaterThan##suffix;                                          \
+    int_comparison_kernels_[LESS_THAN] = IntLessThan##suffix;                                                \
+    int_comparison_kernels_[GREATER_OR_EQUAL] = IntGreaterOrEqual##suffix;                                   \
+    int_comparison_kernels_[LESS_OR_EQUAL] = IntLessOrEqual##suffix
+
+
+SimdKernels::SimdKernels(const SimdLevel simd_level): simd_level_(simd_level) {
+    if (simd_level > GetSimdLevel())
+        throw std::invalid_argument("in SimdKernels::SimdKernels: this CPU does not support "
+                                    + SimdLevelToString(simd_level) + "!");
+
+    switch (simd_level) {
+    case SimdLevel::SCALAR:
+        SET_KERNELS(Scalar);
+        SET_INT_ARITHMETIC_KERNELS(Scalar, Scalar);
+        SET_INT_COMPARISON_KERNELS(Scalar);
+        break;
+#ifdef NYAA_X86_KERNELS
+    case SimdLevel::SSE2: // SSE2 has no 64-bit integer comparisons.
+        SET_KERNELS(Sse2);
+        SET_INT_ARITHMETIC_KERNELS(Sse2, Scalar);
+        SET_INT_COMPARISON_KERNELS(Scalar);
+        break;
+    case SimdLevel::AVX2:
+        SET_KERNELS(Avx2);
+        SET_INT_ARITHMETIC_KERNELS(Avx2, Scalar);
+        SET_INT_COMPARISON_KERNELS(Avx2);
+        break;
+    case SimdLevel::AVX512:
+        SET_KERNELS(Avx512);
+        SET_INT_ARITHMETIC_KERNELS(Avx512, Avx512);
+        if (CHECK_INT_OVERFLOW)
+            int_arithmetic_kernels_[MUL] = IntMulScalar;
+        SET_INT_COMPARISON_KERNELS(Avx512);
+        break;
+#else
+    default:
+        throw std::logic_error("in SimdKernels::SimdKernels: no kernels for " + SimdLevelToString(simd_level) + "!");
+#endif
+    }
+}
+
+
+const SimdKernels &SimdKernels::GetBest() {
+    static const SimdKernels best_kernels(GetSimdLevel());
+    return best_kernels;
+}
+
+
+} // namespace Nyaa
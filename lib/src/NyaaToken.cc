@@ -26,13 +26,15 @@
 namespace Nyaa {
 
 
-const std::string Token::NO_STRING_REP("?");
+constexpr const char *Token::NO_STRING_REP;
 
 
 Token &Token::swap(Token &other) {
     std::swap(token_type_, other.token_type_);
     std::swap(string_rep_, other.string_rep_);
     std::swap(op_type_, other.op_type_);
+    std::swap(offset_, other.offset_);
+    std::swap(length_, other.length_);
 
     return *this;
 }
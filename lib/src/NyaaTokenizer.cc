@@ -20,54 +20,178 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "NyaaTokenizer.h"
+#include <locale>
+#include <sstream>
 #include <stdexcept>
-#include <cctype>
+#include <cerrno>
+#include <clocale>
+#include <cmath>
+#include <cstdlib>
 #include <cstring>
+#include <strings.h>
+#ifdef __SSE2__
+#   include <emmintrin.h>
+#endif
 
 
 namespace Nyaa {
 
 
+// Character classes, see CHAR_CLASSES below.  Unlike the <cctype> functions the classification does not depend on
+// the current locale and can be inlined.
+enum CharClass : uint8_t {
+    WHITESPACE            = 1u << 0,
+    DIGIT                 = 1u << 1,
+    ALPHA                 = 1u << 2,
+    IDENTIFIER_CHAR       = 1u << 3, // Letters, digits and underscores.
+    BRACE_IDENTIFIER_STOP = 1u << 4, // Characters that end an identifier in braces or have to be unescaped.
+    STRING_STOP           = 1u << 5, // Characters that end a string constant or have to be unescaped.
+};
+
+
+static constexpr uint8_t ClassifyChar(const unsigned ch) {
+    return ((ch == ' ' or (ch >= '\t' and ch <= '\r')) ? WHITESPACE : 0)
+           | ((ch >= '0' and ch <= '9') ? (DIGIT | IDENTIFIER_CHAR) : 0)
+           | (((ch >= 'a' and ch <= 'z') or (ch >= 'A' and ch <= 'Z')) ? (ALPHA | IDENTIFIER_CHAR) : 0)
+           | (ch == '_' ? IDENTIFIER_CHAR : 0)
+           | ((ch == '}' or ch == ':' or ch == ',' or ch == '(' or ch == ')' or ch == '\\')
+              ? BRACE_IDENTIFIER_STOP : 0)
+           | ((ch == '"' or ch == '\\') ? STRING_STOP : 0);
+}
+
+
+#define CLASSIFY_4(ch)  ClassifyChar(ch), ClassifyChar(ch + 1), ClassifyChar(ch + 2), ClassifyChar(ch + 3)
+#define CLASSIFY_16(ch) CLASSIFY_4(ch), CLASSIFY_4(ch + 4), CLASSIFY_4(ch + 8), CLASSIFY_4(ch + 12)
+#define CLASSIFY_64(ch) CLASSIFY_16(ch), CLASSIFY_16(ch + 16), CLASSIFY_16(ch + 32), CLASSIFY_16(ch + 48)
+static constexpr uint8_t CHAR_CLASSES[256] = { CLASSIFY_64(0u), CLASSIFY_64(64u), CLASSIFY_64(128u), CLASSIFY_64(192u) };
+#undef CLASSIFY_64
+#undef CLASSIFY_16
+#undef CLASSIFY_4
+
+
+static inline bool HasClass(const char ch, const uint8_t char_class) {
+    return (CHAR_CLASSES[static_cast<unsigned char>(ch)] & char_class) != 0;
+}
+
+
+// The Find*() functions return the first character in [ch, end) that satisfies their condition or "end".  Long runs
+// are scanned 16 characters at a time w/ SSE2 compare-and-movemask, the remainder w/ the table.
+#ifdef __SSE2__
+#   define FIND_FIRST_16(ch, end, block, match_mask_expression)                                     \
+    for (; end - ch >= 16; ch += 16) {                                                              \
+        const __m128i block(_mm_loadu_si128(reinterpret_cast<const __m128i *>(ch)));                \
+        const unsigned match_mask(static_cast<unsigned>(_mm_movemask_epi8(match_mask_expression))); \
+        if (match_mask != 0)                                                                        \
+            return ch + __builtin_ctz(match_mask);                                                  \
+    }
+#else
+#   define FIND_FIRST_16(ch, end, block, match_mask_expression)
+#endif
+
+
+#ifdef __SSE2__
+// Sets all bytes of "block" that lie in [low, low + count) to 0xFF.
+static inline __m128i InRange(const __m128i block, const char low, const char count) {
+    const __m128i offset(_mm_sub_epi8(block, _mm_set1_epi8(low)));
+    return _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(count - 1)), offset);
+}
+
+
+static inline __m128i Equals(const __m128i block, const char ch) {
+    return _mm_cmpeq_epi8(block, _mm_set1_epi8(ch));
+}
+#endif
+
+
+static inline const char *FindNonWhitespace(const char *ch, const char * const end) {
+    // Usually there is at most a single blank between tokens.
+    if (ch == end or not HasClass(*ch, WHITESPACE))
+        return ch;
+    ++ch;
+
+    FIND_FIRST_16(ch, end, block, _mm_xor_si128(_mm_or_si128(Equals(block, ' '), InRange(block, '\t', 5)),
+                                                _mm_set1_epi8(-1)));
+    while (ch != end and HasClass(*ch, WHITESPACE))
+        ++ch;
+    return ch;
+}
+
+
+static inline const char *FindNonIdentifierChar(const char *ch, const char * const end) {
+    FIND_FIRST_16(ch, end, block,
+                  _mm_xor_si128(_mm_or_si128(_mm_or_si128(InRange(block, '0', 10),
+                                                          InRange(_mm_or_si128(block, _mm_set1_epi8(0x20)), 'a', 26)),
+                                             Equals(block, '_')),
+                                _mm_set1_epi8(-1)));
+    while (ch != end and HasClass(*ch, IDENTIFIER_CHAR))
+        ++ch;
+    return ch;
+}
+
+
+static inline const char *FindBraceIdentifierStop(const char *ch, const char * const end) {
+    FIND_FIRST_16(ch, end, block,
+                  _mm_or_si128(_mm_or_si128(_mm_or_si128(Equals(block, '}'), Equals(block, ':')),
+                                            _mm_or_si128(Equals(block, ','), Equals(block, '\\'))),
+                               InRange(block, '(', 2)));
+    while (ch != end and not HasClass(*ch, BRACE_IDENTIFIER_STOP))
+        ++ch;
+    return ch;
+}
+
+
+static inline const char *FindStringStop(const char *ch, const char * const end) {
+    FIND_FIRST_16(ch, end, block, _mm_or_si128(Equals(block, '"'), Equals(block, '\\')));
+    while (ch != end and not HasClass(*ch, STRING_STOP))
+        ++ch;
+    return ch;
+}
+
+
+#undef FIND_FIRST_16
+
+
+// Every parse*() member function expects "ch_" to point at the first character of the token and leaves it pointing
+// just past the last one.  Identifiers and string constants are returned as views into the source unless they
+// contain backslash escapes, in which case they have to be unescaped into a buffer.
+
+
 Token Tokenizer::getToken() {
     // Do we have a cached token?
     if (previous_token_ != NULL_TOKEN) {
         Token retval(NULL_TOKEN);
         retval.swap(previous_token_);
-	std::swap(current_pos_, previous_current_pos_);
-	std::swap(identifier_in_braces_, previous_identifier_in_braces_);
-	std::swap(ch_, previous_ch_);
-	std::swap(token_start_pos_, previous_token_start_pos_);
-	std::swap(string_constant_, previous_string_constant_);
-	std::swap(float_constant_, previous_float_constant_);
-	std::swap(boolean_constant_, previous_boolean_constant_);
-	std::swap(int_constant_, previous_int_constant_);
-	std::swap(identifier_, previous_identifier_);
-	return retval;
+        return retval;
     }
 
-    // Skip over whitespace:
-    while (ch_ != source_.cend() and std::isspace(*ch_))
-	++ch_;
+    const Token token(scanToken());
+    return token.withExtent(token_start_pos_ - source_.cbegin(), ch_ - token_start_pos_);
+}
+
+
+Token Tokenizer::scanToken() {
+    setPosition(FindNonWhitespace(getData(ch_), getData(source_.cend())));
 
     token_start_pos_ = ch_;
 
-    if (ch_ == source_.cend()) {
-        token_start_pos_ = source_.cend();
+    if (ch_ == source_.cend())
         return EOS;
-    }
 
-    switch (*ch_) {
-    case ':': 
+    if (identifier_in_braces_ and *ch_ != '}' and *ch_ != ':')
+        return parseIdentifier();
+
+    switch (*ch_++) {
+    case ':':
         // colon separates identifier from default value in braces
-        identifier_in_braces_ = false; 
+        identifier_in_braces_ = false;
         return COLON;
     case '^': return CARET;
     case '{':
         identifier_in_braces_ = true;
         return OPEN_BRACE;
     case '}':
-       identifier_in_braces_ = false;
-       return CLOSE_BRACE;
+        identifier_in_braces_ = false;
+        return CLOSE_BRACE;
     case '(': return OPEN_PAREN;
     case ')': return CLOSE_PAREN;
     case '+': return PLUS;
@@ -78,41 +202,30 @@ Token Tokenizer::getToken() {
     case '$': return DOLLAR;
     case ',': return COMMA;
     case '&': return AMPERSAND;
-    }
-
-    if (*ch_ == '"')
-        return parseStringConstant();
-    if (not identifier_in_braces_ and (std::isdigit(*ch_) or *ch_ == '.')) {
-        --ch_;
-        return parseNumericConstant();
-    }
-
-    if (*ch_ == '<') {
-        ++ch_;
-        if (ch_ == source_.cend())
-            return LESS_THAN;
-        if (*ch_ == '>')
+    case '"': return parseStringConstant();
+    case '<':
+        if (ch_ != source_.cend() and *ch_ == '>') {
+            ++ch_;
             return NOT_EQUAL;
-        if (*ch_ == '=')
+        }
+        if (ch_ != source_.cend() and *ch_ == '=') {
+            ++ch_;
             return LESS_OR_EQUAL;
-        --ch_;
+        }
         return LESS_THAN;
-    }
-
-    if (*ch_ == '>') {
-        ++ch_;
-        if (ch_ == source_.cend())
-            return GREATER_THAN;
-        if (*ch_ == '=')
+    case '>':
+        if (ch_ != source_.cend() and *ch_ == '=') {
+            ++ch_;
             return GREATER_OR_EQUAL;
-        --ch_;
+        }
         return GREATER_THAN;
     }
+    --ch_;
 
-    if (identifier_in_braces_ or std::isalpha(*ch_)) {
-        --ch_;
-        return identifier_in_braces_ ? parseIdentifier() : parseSimpleIdentifier();
-    }
+    if (HasClass(*ch_, DIGIT) or *ch_ == '.')
+        return parseNumericConstant();
+    if (HasClass(*ch_, ALPHA))
+        return parseSimpleIdentifier();
 
     error_msg_ = "unexpected input character '" + std::string(1, *ch_) + "'";
 
@@ -127,145 +240,248 @@ void Tokenizer::ungetToken(const Token &token) {
 }
 
 
+// Unlike the other parse*() functions we get called after the opening double quote has been consumed.
 Token Tokenizer::parseStringConstant() {
-    string_constant_.clear();
+    const std::string::const_iterator string_start(ch_);
+    setPosition(FindStringStop(getData(ch_), getData(source_.cend())));
+    if (ch_ != source_.cend() and *ch_ == '"') {
+        string_constant_ = StringView(getData(string_start), ch_ - string_start);
+        ++ch_;
+        return STRING_CONSTANT;
+    }
 
-    bool escaped(false);
+    // Slow path, we have to unescape.
+    string_constant_buffer_.assign(string_start, ch_);
     while (ch_ != source_.cend()) {
-      if (*ch_ == '\\')
-          escaped = true;
-      else {
-          if (escaped) {
-              switch (*ch_) {
-              case '\\':
-                  string_constant_ += '\\';
-                  break;
-              case '"':
-                  string_constant_ += '"';
-                  break;
-              case 'n':
-                  string_constant_ += '\n';
-                  break;
-              default:
-                  error_msg_ = "unknown escape character '" + std::string(1, *ch_) + "'.";
-                  return ERROR;
-              }
-
-              escaped = false;
-          } else if (*ch_ == '"') {
-              return STRING_CONSTANT;
-          } else
-              string_constant_ += *ch_;
-      }
-
-      ++ch_;
+        const char ch(*ch_++);
+        if (ch == '"') {
+            string_constant_ = StringView(string_constant_buffer_);
+            return STRING_CONSTANT;
+        }
+
+        if (ch != '\\') {
+            string_constant_buffer_ += ch;
+            continue;
+        }
+
+        if (ch_ == source_.cend())
+            break;
+        const char escaped_ch(*ch_++);
+        switch (escaped_ch) {
+        case '\\':
+            string_constant_buffer_ += '\\';
+            break;
+        case '"':
+            string_constant_buffer_ += '"';
+            break;
+        case 'n':
+            string_constant_buffer_ += '\n';
+            break;
+        default:
+            error_msg_ = "unknown escape character '" + std::string(1, escaped_ch) + "'.";
+            return ERROR;
+        }
     }
 
     error_msg_ = "unterminated String constant.";
     return ERROR;
 }
 
-  
-Token Tokenizer::parseNumericConstant() {
-    std::string number;
-    while (ch_ != source_.cend() and std::isdigit(*ch_))
-        number += *ch_++;
 
-    if (ch_ == source_.cend() or (*ch_ != 'e' and *ch_ != 'E' and *ch_ != '.')) {
-convert:
-        if (std::sscanf(number.c_str(), "%lf", &float_constant_) != 1) {
-            error_msg_ = "invalid numeric constant.";
-	    return ERROR;
+static inline bool IsDigit(const std::string::const_iterator &ch, const std::string::const_iterator &end) {
+    return ch != end and HasClass(*ch, DIGIT);
+}
+
+
+// The powers of ten that can be represented exactly as doubles.
+static const double EXACT_POWERS_OF_TEN[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+static const int MAX_EXACT_POWER_OF_TEN(22);
+static const uint64_t MAX_EXACT_MANTISSA(uint64_t(1) << 53);
+
+
+// Clinger's fast path: if both the mantissa and the power of ten are exactly representable, a single
+// multiplication or division yields the correctly rounded result.  This assumes that double arithmetic is not
+// carried out w/ extended precision, which holds for SSE2 and all 64-bit targets.
+static bool ComputeFloatFast(uint64_t mantissa, int exponent, double * const value) {
+    if (mantissa > MAX_EXACT_MANTISSA)
+        return false;
+    if (mantissa == 0) {
+        *value = 0.0;
+        return true;
+    }
+
+    if (exponent < 0) {
+        if (exponent < -MAX_EXACT_POWER_OF_TEN)
+            return false;
+        *value = static_cast<double>(mantissa) / EXACT_POWERS_OF_TEN[-exponent];
+        return true;
+    }
+
+    // Move surplus powers of ten into the mantissa as long as that remains exact, e.g. 12e25 = 120000e22.
+    while (exponent > MAX_EXACT_POWER_OF_TEN) {
+        if (mantissa > MAX_EXACT_MANTISSA / 10)
+            return false;
+        mantissa *= 10;
+        --exponent;
+    }
+    *value = static_cast<double>(mantissa) * EXACT_POWERS_OF_TEN[exponent];
+    return true;
+}
+
+
+// Correctly rounded.  std::strtod depends on the decimal point of the current C locale, so unless that is a period
+// we have to resort to a stream w/ the classic locale.
+static bool ComputeFloatSlow(const char * const number_start, const char * const number_end, double * const value) {
+    if (std::localeconv()->decimal_point[0] == '.' and std::localeconv()->decimal_point[1] == '\0') {
+        char *end;
+        errno = 0;
+        *value = std::strtod(number_start, &end);
+        return end == number_end and not (errno == ERANGE and std::isinf(*value));
+    }
+
+    std::istringstream input(std::string(number_start, number_end));
+    input.imbue(std::locale::classic());
+    input >> *value;
+    return not input.fail();
+}
+
+
+Token Tokenizer::parseNumericConstant() {
+    const std::string::const_iterator number_start(ch_);
+
+    // Up to 19 significant digits are collected in "mantissa", the value being mantissa * 10^exponent.
+    const int MAX_SIGNIFICANT_DIGIT_COUNT(19);
+    uint64_t mantissa(0);
+    int significant_digit_count(0), exponent(0);
+    bool digits_dropped(false);
+
+    while (IsDigit(ch_, source_.cend())) {
+        if (significant_digit_count < MAX_SIGNIFICANT_DIGIT_COUNT) {
+            mantissa = mantissa * 10 + (*ch_ - '0');
+            if (mantissa != 0)
+                ++significant_digit_count;
+        } else {
+            digits_dropped = true;
+            ++exponent;
         }
-	if (ch_ != source_.cend())
-	    --ch_;
-        return FLOAT_CONSTANT;
+        ++ch_;
     }
+    bool is_integer(true);
 
     // Optional decimal point.
-    if (*ch_ == '.') {
-      number += *ch_++;
-      while (ch_ != source_.cend() and std::isdigit(*ch_))
-          number += *ch_++;
+    if (ch_ != source_.cend() and *ch_ == '.') {
+        is_integer = false;
+        ++ch_;
+        while (IsDigit(ch_, source_.cend())) {
+            if (significant_digit_count < MAX_SIGNIFICANT_DIGIT_COUNT) {
+                mantissa = mantissa * 10 + (*ch_ - '0');
+                if (mantissa != 0)
+                    ++significant_digit_count;
+                --exponent;
+            } else
+                digits_dropped = true;
+            ++ch_;
+        }
+        if (ch_ - number_start == 1) {
+            error_msg_ = "invalid numeric constant.";
+            return ERROR;
+        }
     }
 
     // Optional exponent.
-    if (*ch_ == 'e' or *ch_ == 'E') {
-        number += *ch_++;
-        if (ch_ == source_.cend()) {
-            error_msg_ = "invalid numeric constant.";
-	    return ERROR;
-	}
-
-      // Optional sign.
-      if (*ch_ == '+' or *ch_ == '-')
-          number += *ch_++;
-
-      // Now we require at least a single digit.
-      if (not std::isdigit(*ch_)) {
-          error_msg_ = "missing digits in exponent.";
-	  return ERROR;
-      }
-      --ch_;
-
-      while (ch_ != source_.cend() and std::isdigit(*ch_))
-          number += *ch_++;
+    if (ch_ != source_.cend() and (*ch_ == 'e' or *ch_ == 'E')) {
+        is_integer = false;
+        ++ch_;
+
+        // Optional sign.
+        bool negative_exponent(false);
+        if (ch_ != source_.cend() and (*ch_ == '+' or *ch_ == '-'))
+            negative_exponent = *ch_++ == '-';
+
+        // Now we require at least a single digit.
+        if (not IsDigit(ch_, source_.cend())) {
+            error_msg_ = "missing digits in exponent.";
+            return ERROR;
+        }
+
+        int explicit_exponent(0);
+        while (IsDigit(ch_, source_.cend())) {
+            if (explicit_exponent < 100000) // Way beyond the range of doubles, we just must not overflow.
+                explicit_exponent = explicit_exponent * 10 + (*ch_ - '0');
+            ++ch_;
+        }
+        exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+    }
+
+    if (is_integer and not digits_dropped and mantissa <= static_cast<uint64_t>(INT64_MAX)) {
+        int_constant_ = static_cast<int64_t>(mantissa);
+        return INT_CONSTANT;
+    }
+
+    if ((digits_dropped or not ComputeFloatFast(mantissa, exponent, &float_constant_))
+        and not ComputeFloatSlow(getData(number_start), getData(ch_), &float_constant_))
+    {
+        error_msg_ = "numeric constant out of range.";
+        return ERROR;
     }
-    --ch_;
 
-    goto convert;
+    return FLOAT_CONSTANT;
 }
 
-  
+
+static inline bool IsIdentifierTerminator(const char ch) {
+    return ch != '\\' and HasClass(ch, BRACE_IDENTIFIER_STOP);
+}
+
+
+// Within braces "TRUE" and "FALSE" are ordinary attribute names.
 Token Tokenizer::parseIdentifier() {
-    std::string identifier;
-    while (ch_ != source_.cend() and
-           ((*ch_ != '}' and *ch_ != ':' and *ch_ != ',' and *ch_ != '(' and *ch_ != ')') or escaped))
-    {
+    const std::string::const_iterator identifier_start(ch_);
+    setPosition(FindBraceIdentifierStop(getData(ch_), getData(source_.cend())));
+    identifier_in_braces_ = false;
+    if (ch_ == source_.cend() or *ch_ != '\\') {
+        identifier_ = StringView(getData(identifier_start), ch_ - identifier_start);
+        return IDENTIFIER;
+    }
+
+    // Slow path, we have to unescape.
+    identifier_buffer_.assign(identifier_start, ch_);
+    while (ch_ != source_.cend() and not IsIdentifierTerminator(*ch_)) {
         if (*ch_ == '\\') {
             ++ch_;
             if (ch_ == source_.cend()) {
                 error_msg_ = "invalid column name at end of formula.";
                 return ERROR;
             }
-	}
-	    
-        identifier += *ch_++;
-    }
-    --ch_;
+        }
 
-    if (::strcasecmp(identifier.c_str(), "TRUE") == 0) {
-        boolean_constant_ = true;
-        return BOOLEAN_CONSTANT;
-    }
-    if (::strcasecmp(identifier.c_str(), "FALSE") == 0) {
-        boolean_constant_ = false;
-        return BOOLEAN_CONSTANT;
+        identifier_buffer_ += *ch_++;
     }
+    identifier_ = StringView(identifier_buffer_);
 
-    std::swap(identifier, identifier_);
     return IDENTIFIER;
 }
 
-  
+
 Token Tokenizer::parseSimpleIdentifier() {
-    std::string identifier;
-    while (ch_ != source_.cend() and (std::isalpha(*ch_) or std::isdigit(*ch_) or *ch_ == '_'))
-        identifier += *ch_++;
-    --ch_;
+    const std::string::const_iterator identifier_start(ch_);
+    setPosition(FindNonIdentifierChar(getData(ch_), getData(source_.cend())));
+    identifier_ = StringView(getData(identifier_start), ch_ - identifier_start);
 
-    if (::strcasecmp(identifier.c_str(), "TRUE") == 0) {
+    if (identifier_.size() == 4 and ::strncasecmp(identifier_.data(), "TRUE", 4) == 0) {
         boolean_constant_ = true;
         return BOOLEAN_CONSTANT;
     }
-    if (::strcasecmp(identifier.c_str(), "FALSE") == 0) {
+    if (identifier_.size() == 5 and ::strncasecmp(identifier_.data(), "FALSE", 5) == 0) {
         boolean_constant_ = false;
         return BOOLEAN_CONSTANT;
     }
 
-    std::swap(identifier, identifier_);
     return IDENTIFIER;
 }
-  
-  
+
+
 } // namespace Nyaa
@@ -0,0 +1,163 @@
+/** \file    NyaaBuiltinFunctionsTest.cc
+ *  \brief   Checks the results of builtin functions in corner cases.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <iostream>
+#include <cinttypes>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+#include "NyaaBuiltinFunctions.h"
+#include "NyaaCompiler.h"
+#include "NyaaInterpreter.h"
+
+
+using namespace Nyaa;
+
+
+namespace {
+
+
+class Context: public AttribContext {
+    double x_;
+    int64_t i_;
+public:
+    Context(const double x, const int64_t i): x_(x), i_(i) { }
+
+    bool getFloatAttrib(const std::string &/*name*/, double * const value) const override { *value = x_; return true; }
+    bool getIntAttrib(const std::string &/*name*/, int64_t * const value) const override { *value = i_; return true; }
+    bool getBooleanAttrib(const std::string &/*name*/, bool * const /*value*/) const override { return false; }
+    const std::string *getStringAttrib(const std::string &/*name*/) const override { return nullptr; }
+};
+
+
+// NaNs are written as "nan" and signed zeroes as "+0" and "-0".
+std::string ValueToString(const FuncArg &value) {
+    std::ostringstream output;
+    output.precision(17);
+    switch (value.getType()) {
+    case NodeType::INT_NODE:
+        output << value.getIntValue();
+        break;
+    case NodeType::FLOAT_NODE:
+        if (std::isnan(value.getDoubleValue()))
+            output << "nan";
+        else if (value.getDoubleValue() == 0.0)
+            output << (std::signbit(value.getDoubleValue()) ? "-0" : "+0");
+        else
+            output << value.getDoubleValue();
+        break;
+    case NodeType::STRING_NODE:
+        output << '"' << value.getStringValue() << '"';
+        break;
+    default:
+        output << (value.getBoolValue() ? "TRUE" : "FALSE");
+    }
+    return output.str();
+}
+
+
+struct TestCase {
+    const char *equation_;
+    double x_;
+    int64_t i_;
+    const char *expected_value_;
+};
+
+
+const double NAN_VALUE(std::numeric_limits<double>::quiet_NaN());
+
+
+const TestCase TEST_CASES[] = {
+    // The order of the arguments must not matter.
+    { "MIN({x}, 1.0)",         NAN_VALUE, 0,         "nan" },
+    { "MIN(1.0, {x})",         NAN_VALUE, 0,         "nan" },
+    { "MIN(1.0, {x}, 2.0)",    NAN_VALUE, 0,         "nan" },
+    { "MAX({x}, 1.0)",         NAN_VALUE, 0,         "nan" },
+    { "MAX(1.0, {x})",         NAN_VALUE, 0,         "nan" },
+    { "MIN({x}, 0.0)",         -0.0,      0,         "-0" },
+    { "MIN(0.0, {x})",         -0.0,      0,         "-0" },
+    { "MAX({x}, 0.0)",         -0.0,      0,         "+0" },
+    { "MAX(0.0, {x})",         -0.0,      0,         "+0" },
+    { "MIN({x}, 1.0)",         3.0,       0,         "1" },
+    { "MAX(1.0, {x})",         3.0,       0,         "3" },
+    { "MEDIAN({x}, 1.0, 2.0)", NAN_VALUE, 0,         "nan" },
+    { "MEDIAN(1.0, 2.0, {x})", NAN_VALUE, 0,         "nan" },
+    { "MEDIAN(3.0, {x}, 1.0)", 2.0,       0,         "2" },
+    { "TRIM(\"\")",            0.0,       0,         "\"\"" },
+    { "TRIM(\"   \")",         0.0,       0,         "\"\"" },
+    { "TRIM(\" a b \")",       0.0,       0,         "\"a b\"" },
+
+    // Integer overflows follow the build mode, like those of the operators.
+    { "ABS({i})",              0.0,       -3,        "3" },
+#ifdef NYAA_UNCHECKED_INT_ARITHMETIC
+    { "ABS({i})",              0.0,       INT64_MIN, "-9223372036854775808" },
+    { "SUM({i}, 1)",           0.0,       INT64_MAX, "-9223372036854775808" },
+    { "SUM(1, {i}, -1)",       0.0,       INT64_MAX, "9223372036854775807" },
+#else
+    { "ABS({i})",              0.0,       INT64_MIN, "error: 0: ABS(): integer overflow!" },
+    { "SUM({i}, 1)",           0.0,       INT64_MAX, "error: 0: SUM(): integer overflow!" },
+    { "SUM(1, {i}, -1)",       0.0,       INT64_MAX, "error: 0: SUM(): integer overflow!" },
+#endif
+    { "SUM({i}, -1)",          0.0,       INT64_MAX, "9223372036854775806" },
+};
+
+
+} // unnamed namespace
+
+
+int main() {
+    FunctionRegistry function_registry;
+    RegisterBuiltinFunctions(&function_registry);
+    const Parser::AttribNameToTypeMap attrib_name_to_type_map{ { "x", NodeType::FLOAT_NODE },
+                                                               { "i", NodeType::INT_NODE } };
+    Compiler compiler(function_registry);
+    Interpreter interpreter(Interpreter::NO_JIT);
+
+    unsigned failure_count(0);
+    for (const auto &test_case : TEST_CASES) {
+        Program program;
+        std::string value;
+        if (not compiler.compile(test_case.equation_, attrib_name_to_type_map, &program))
+            value = "compile error: " + compiler.getErrorMsg();
+        else {
+            try {
+                value = ValueToString(interpreter.evaluate(program, Context(test_case.x_, test_case.i_)));
+            } catch (const std::exception &x) {
+                value = std::string("error: ") + x.what();
+            }
+        }
+
+        if (value != test_case.expected_value_) {
+            std::cerr << test_case.equation_ << " w/ x = " << test_case.x_ << " and i = " << test_case.i_ << ": expected " << test_case.expected_value_
+                      << " but got " << value << "\n";
+            ++failure_count;
+        }
+    }
+
+    if (failure_count > 0) {
+        std::cerr << failure_count << " failures!\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "All " << sizeof(TEST_CASES) / sizeof(TEST_CASES[0]) << " function calls give the right results.\n";
+    return EXIT_SUCCESS;
+}
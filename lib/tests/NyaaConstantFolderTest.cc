@@ -0,0 +1,136 @@
+/** \file    NyaaConstantFolderTest.cc
+ *  \brief   Checks that the identities the ConstantFolder removes don't change any results.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+#include "NyaaBuiltinFunctions.h"
+#include "NyaaCompiler.h"
+#include "NyaaInterpreter.h"
+
+
+using namespace Nyaa;
+
+
+namespace {
+
+
+class Context: public AttribContext {
+    double x_;
+    int64_t i_;
+public:
+    Context(const double x, const int64_t i): x_(x), i_(i) { }
+
+    bool getFloatAttrib(const std::string &/*name*/, double * const value) const override { *value = x_; return true; }
+    bool getIntAttrib(const std::string &/*name*/, int64_t * const value) const override { *value = i_; return true; }
+    bool getBooleanAttrib(const std::string &/*name*/, bool * const /*value*/) const override { return false; }
+    const std::string *getStringAttrib(const std::string &/*name*/) const override { return nullptr; }
+};
+
+
+// Signed zeroes are written as "+0" and "-0".
+std::string ValueToString(const FuncArg &value) {
+    std::ostringstream output;
+    output.precision(17);
+    if (value.getType() == NodeType::INT_NODE)
+        output << value.getIntValue();
+    else if (value.getDoubleValue() == 0.0)
+        output << (std::signbit(value.getDoubleValue()) ? "-0" : "+0");
+    else
+        output << value.getDoubleValue();
+    return output.str();
+}
+
+
+struct TestCase {
+    const char *equation_;
+    double x_;
+    int64_t i_;
+    const char *expected_value_; // As IEEE 754 or two's complement arithmetic w/o any folding would have it.
+};
+
+
+const int64_t INT64_MIN_VALUE(std::numeric_limits<int64_t>::min());
+
+
+const TestCase TEST_CASES[] = {
+    { "{x} - -0.0",   -0.0, 0, "+0" },
+    { "{x} - (-0.0)", -0.0, 0, "+0" },
+    { "{x} - 0.0",    -0.0, 0, "-0" },
+    { "{x} - 0",      -0.0, 0, "-0" },
+    { "{x} + 0",      -0.0, 0, "+0" },
+    { "0 + {x}",      -0.0, 0, "+0" },
+    { "{x} + 0.0",    -0.0, 0, "+0" },
+    { "{x} + -0.0",   -0.0, 0, "-0" },
+    { "{x} * 1",      -0.0, 0, "-0" },
+    { "-(-{x})",      -0.0, 0, "-0" },
+    { "{i} + 0",      0.0, INT64_MIN_VALUE, "-9223372036854775808" },
+    { "{i} - 0",      0.0, INT64_MIN_VALUE, "-9223372036854775808" },
+#ifdef NYAA_UNCHECKED_INT_ARITHMETIC
+    { "-(-{i})",      0.0, INT64_MIN_VALUE, "-9223372036854775808" },
+#else
+    { "-(-{i})",      0.0, INT64_MIN_VALUE, "error: 2: integer overflow!" },
+#endif
+};
+
+
+} // unnamed namespace
+
+
+int main() {
+    FunctionRegistry function_registry;
+    RegisterBuiltinFunctions(&function_registry);
+    const Parser::AttribNameToTypeMap attrib_name_to_type_map{ { "x", NodeType::FLOAT_NODE },
+                                                               { "i", NodeType::INT_NODE } };
+    Compiler compiler(function_registry);
+    Interpreter interpreter(Interpreter::NO_JIT);
+
+    unsigned failure_count(0);
+    for (const auto &test_case : TEST_CASES) {
+        Program program;
+        std::string value;
+        if (not compiler.compile(test_case.equation_, attrib_name_to_type_map, &program))
+            value = "compile error: " + compiler.getErrorMsg();
+        else {
+            try {
+                value = ValueToString(interpreter.evaluate(program, Context(test_case.x_, test_case.i_)));
+            } catch (const std::exception &x) {
+                value = std::string("error: ") + x.what();
+            }
+        }
+
+        if (value != test_case.expected_value_) {
+            std::cerr << test_case.equation_ << ": expected " << test_case.expected_value_ << " but got " << value
+                      << "\n";
+            ++failure_count;
+        }
+    }
+
+    if (failure_count > 0) {
+        std::cerr << failure_count << " failures!\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "All " << sizeof(TEST_CASES) / sizeof(TEST_CASES[0]) << " folded equations give the right results.\n";
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,273 @@
+/** \file    NyaaDifferentialTest.cc
+ *  \brief   Checks that the Interpreter, its JIT tier and the BatchEvaluator at every SIMD level agree.
+ *  \author  Dr. Johannes Ruscheinski
+ */
+
+/*
+    Copyright (C) 2018 Dr. Johannes Ruscheinski
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include "NyaaBatchEvaluator.h"
+#include "NyaaBuiltinFunctions.h"
+#include "NyaaCompiler.h"
+#include "NyaaInterpreter.h"
+#include "NyaaSimdKernels.h"
+
+
+using namespace Nyaa;
+
+
+namespace {
+
+
+// More than one batch and not a multiple of any vector width, so that all kernels have to deal w/ a remainder.
+const size_t ROW_COUNT(1000 + 3);
+
+
+struct Table {
+    std::vector<double> x_, y_;
+    std::vector<uint8_t> y_missing_;
+    std::vector<int64_t> i_, j_;
+    std::vector<uint8_t> b_;
+    std::vector<std::string> s_;
+
+    Table();
+    ColumnMap getColumns() const;
+};
+
+
+// Besides ordinary values there are NaNs, infinities, signed zeroes, the extreme integers and missing values.
+Table::Table()
+    : x_(ROW_COUNT), y_(ROW_COUNT), y_missing_(ROW_COUNT), i_(ROW_COUNT), j_(ROW_COUNT), b_(ROW_COUNT), s_(ROW_COUNT)
+{
+    static const double SPECIAL_FLOATS[] = { std::numeric_limits<double>::quiet_NaN(),
+                                             std::numeric_limits<double>::infinity(),
+                                             -std::numeric_limits<double>::infinity(), -0.0, 0.0 };
+    static const int64_t SPECIAL_INTS[] = { std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max(),
+                                            -1, 0, 1 };
+    uint64_t random(88172645463325252ull);
+    for (size_t row(0); row < ROW_COUNT; ++row) {
+        random ^= random << 13, random ^= random >> 7, random ^= random << 17; // xorshift64
+        x_[row] = row % 17 == 0 ? SPECIAL_FLOATS[row % 5] : static_cast<double>(random % 2001) / 8.0 - 125.0;
+        y_[row] = static_cast<double>(row % 11) - 5.0;
+        y_missing_[row] = row % 13 == 0;
+        i_[row] = row % 19 == 0 ? SPECIAL_INTS[row % 5] : static_cast<int64_t>(random % 41) - 20;
+        j_[row] = row % 23 == 0 ? SPECIAL_INTS[row % 5] : static_cast<int64_t>(random % 7) - 3;
+        b_[row] = (random >> 32) % 2;
+        s_[row] = std::string(row % 4, 'a' + row % 3);
+    }
+}
+
+
+ColumnMap Table::getColumns() const {
+    return ColumnMap{ { "x", ColumnView(x_.data(), ROW_COUNT) },
+                      { "y", ColumnView(y_.data(), ROW_COUNT, y_missing_.data()) },
+                      { "i", ColumnView(i_.data(), ROW_COUNT) }, { "j", ColumnView(j_.data(), ROW_COUNT) },
+                      { "b", ColumnView(b_.data(), ROW_COUNT) }, { "s", ColumnView(s_.data(), ROW_COUNT) } };
+}
+
+
+class RowContext: public AttribContext {
+    const Table &table_;
+    size_t row_;
+public:
+    explicit RowContext(const Table &table): table_(table), row_(0) { }
+    inline void setRow(const size_t row) { row_ = row; }
+
+    bool getFloatAttrib(const std::string &name, double * const value) const override {
+        if (name == "y" and table_.y_missing_[row_])
+            return false;
+        *value = name == "x" ? table_.x_[row_] : table_.y_[row_];
+        return true;
+    }
+
+    bool getIntAttrib(const std::string &name, int64_t * const value) const override {
+        *value = name == "i" ? table_.i_[row_] : table_.j_[row_];
+        return true;
+    }
+
+    bool getBooleanAttrib(const std::string &/*name*/, bool * const value) const override {
+        *value = table_.b_[row_] != 0;
+        return true;
+    }
+
+    const std::string *getStringAttrib(const std::string &/*name*/) const override { return &table_.s_[row_]; }
+};
+
+
+// The sign of a NaN is not something we promise to preserve.
+std::string FloatToString(const double value) {
+    if (std::isnan(value))
+        return "nan";
+    std::ostringstream output;
+    output.precision(17);
+    output << value;
+    return output.str();
+}
+
+
+std::string ValueToString(const FuncArg &value) {
+    switch (value.getType()) {
+    case NodeType::BOOLEAN_NODE:
+        return value.getBoolValue() ? "TRUE" : "FALSE";
+    case NodeType::INT_NODE:
+        return std::to_string(value.getIntValue());
+    case NodeType::FLOAT_NODE:
+        return FloatToString(value.getDoubleValue());
+    case NodeType::STRING_NODE:
+        return '"' + value.getStringValue() + '"';
+    default:
+        return "?";
+    }
+}
+
+
+std::string ValueToString(const ResultColumn &result, const size_t row) {
+    if (result.hasError(row))
+        return "error: " + result.getErrorMessage(row);
+
+    switch (result.getType()) {
+    case NodeType::BOOLEAN_NODE:
+        return result.getBool(row) ? "TRUE" : "FALSE";
+    case NodeType::INT_NODE:
+        return std::to_string(result.getInt(row));
+    case NodeType::FLOAT_NODE:
+        return FloatToString(result.getFloat(row));
+    case NodeType::STRING_NODE:
+        return '"' + result.getString(row) + '"';
+    default:
+        return "?";
+    }
+}
+
+
+std::string Evaluate(Interpreter * const interpreter, const Program &program, const AttribContext &context) {
+    try {
+        return ValueToString(interpreter->evaluate(program, context));
+    } catch (const std::exception &x) {
+        return std::string("error: ") + x.what();
+    }
+}
+
+
+// Covers all value types, the fused instructions, shared subexpressions, conditionals w/ jumps and errors.
+const char * const EQUATIONS[] = {
+    "{x} + {y} * 2.5 - {x} / 3",
+    "{x} * {x} - 2 * {x} + 1",
+    "-{x} + 0",
+    "{x} ^ 2 + SQRT(ABS({x}))",
+    "{i} + {j}",
+    "{i} * {j} - {j}",
+    "-{i}",
+    "QUOTIENT({i}, {j}) + MOD({i}, {j})",
+    "{i} / {j}",
+    "{i} + 0.5",
+    "{y} + 1",
+    "{y:-1} * {x}",
+    "{x} > 10",
+    "{i} <= 3",
+    "2.5 < {x}",
+    "{x} = {y:0}",
+    "{i} > {j}",
+    "IF({x} > 0, {x} * 2, -{x})",
+    "IF({b}, {i} * 2, {i})",
+    "IF({x} > {y:0}, {y:0}, {x}) + {x}",
+    "AND({b}, {x} > 0, {i} <> 0)",
+    "OR({i} = 0, {x} < -50, NOT({b}))",
+    "IF(OR({x} > 100, {j} = 0), 0, {i} / {j})",
+    "{s} & {x} & {b}",
+    "{i} & \"-\" & {s}",
+    "{s} = \"aa\"",
+    "IF({s} > \"b\", LEN({s}), -1)",
+    "{x} * 1.5 > {x} * {i}",
+    "SUM({i} * 2, {j})",
+    "MIN({x}, 1.5) + MAX(1.5, {x}, {y:0})",
+};
+
+
+} // unnamed namespace
+
+
+int main() {
+    FunctionRegistry function_registry;
+    RegisterBuiltinFunctions(&function_registry);
+    const Parser::AttribNameToTypeMap attrib_name_to_type_map{
+        { "x", NodeType::FLOAT_NODE }, { "y", NodeType::FLOAT_NODE }, { "i", NodeType::INT_NODE },
+        { "j", NodeType::INT_NODE }, { "b", NodeType::BOOLEAN_NODE }, { "s", NodeType::STRING_NODE } };
+
+    const Table table;
+    const ColumnMap columns(table.getColumns());
+    RowContext context(table);
+    Compiler compiler(function_registry);
+    Interpreter interpreter(Interpreter::NO_JIT), jit_interpreter(/* jit_threshold = */1);
+
+    unsigned mismatch_count(0);
+    const auto compare([&mismatch_count](const std::string &equation, const std::string &evaluator, const size_t row,
+                                         const std::string &expected, const std::string &actual)
+    {
+        if (actual == expected)
+            return;
+        if (++mismatch_count <= 20)
+            std::cerr << equation << ", row " << row << ": the interpreter returned " << expected << " but the "
+                      << evaluator << " returned " << actual << "\n";
+    });
+
+    for (const char * const equation : EQUATIONS) {
+        Program program;
+        if (not compiler.compile(equation, attrib_name_to_type_map, &program)) {
+            std::cerr << equation << ": " << compiler.getErrorMsg() << "\n";
+            ++mismatch_count;
+            continue;
+        }
+
+        std::vector<std::string> expected_values;
+        expected_values.reserve(ROW_COUNT);
+        for (size_t row(0); row < ROW_COUNT; ++row) {
+            context.setRow(row);
+            expected_values.emplace_back(Evaluate(&interpreter, program, context));
+        }
+
+        // Unless NYAA_NO_JIT is defined, all but the first evaluation run native code.
+        for (size_t row(0); row < ROW_COUNT; ++row) {
+            context.setRow(row);
+            compare(equation, "JIT", row, expected_values[row], Evaluate(&jit_interpreter, program, context));
+        }
+
+        for (int simd_level(0); simd_level <= static_cast<int>(GetSimdLevel()); ++simd_level) {
+            const SimdKernels simd_kernels(static_cast<SimdLevel>(simd_level));
+            BatchEvaluator batch_evaluator(simd_kernels);
+            ResultColumn result;
+            batch_evaluator.evaluate(program, columns, ROW_COUNT, &result);
+            const std::string evaluator(SimdLevelToString(static_cast<SimdLevel>(simd_level)) + " batch evaluator");
+            for (size_t row(0); row < ROW_COUNT; ++row)
+                compare(equation, evaluator, row, expected_values[row], ValueToString(result, row));
+        }
+    }
+
+    if (mismatch_count > 0) {
+        std::cerr << mismatch_count << " mismatches!\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "The interpreter, the JIT and the batch evaluator agree on "
+              << sizeof(EQUATIONS) / sizeof(EQUATIONS[0]) << " equations.\n";
+    return EXIT_SUCCESS;
+}